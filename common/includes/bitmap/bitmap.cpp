@@ -33,19 +33,116 @@ THIS SOFTWARE,
 EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 **********/
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+// The SSSE3 shuffles are compiled for that target only and picked at run
+// time, so the hosts keep building for baseline x86-64
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define BITMAP_SSSE3 1
+#endif
 
 #include "bitmap.h"
 
+// Scalar path: 4 pixels from/to three 32-bit words, then single pixels
+static void unpackWords(const unsigned char *src, int *dst, int i, int count) {
+  for (; i + 4 <= count; i += 4) {
+    unsigned int w[3];
+    memcpy(w, src + i * 3, 12);
+    dst[i] = w[0] & 0xFFFFFF;
+    dst[i + 1] = (w[0] >> 24) | ((w[1] & 0xFFFF) << 8);
+    dst[i + 2] = (w[1] >> 16) | ((w[2] & 0xFF) << 16);
+    dst[i + 3] = w[2] >> 8;
+  }
+  for (; i < count; i++)
+    dst[i] = src[i * 3] | (src[i * 3 + 1] << 8) | (src[i * 3 + 2] << 16);
+}
+
+static void packWords(const int *src, unsigned char *dst, int i, int count) {
+  for (; i + 4 <= count; i += 4) {
+    unsigned int p0 = src[i], p1 = src[i + 1], p2 = src[i + 2], p3 = src[i + 3];
+    unsigned int w[3] = {(p0 & 0xFFFFFF) | (p1 << 24),
+                         ((p1 >> 8) & 0xFFFF) | (p2 << 16),
+                         ((p2 >> 16) & 0xFF) | (p3 << 8)};
+    memcpy(dst + i * 3, w, 12);
+  }
+  for (; i < count; i++) {
+    dst[i * 3] = src[i] & 0xFF;
+    dst[i * 3 + 1] = (src[i] >> 8) & 0xFF;
+    dst[i * 3 + 2] = (src[i] >> 16) & 0xFF;
+  }
+}
+
+#ifdef BITMAP_SSSE3
+// 4 pixels per shuffle. The 16-byte load reads 4 bytes past the 12 used,
+// so the loop stops while those are still inside the row.
+__attribute__((target("ssse3"))) static int
+unpackSSSE3(const unsigned char *src, int *dst, int count) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  int i = 0;
+  for (; i + 6 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 3));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuffle));
+  }
+  return i;
+}
+
+// The 16-byte store writes 4 bytes past the 12 used; the next iteration or
+// the scalar tail overwrites them
+__attribute__((target("ssse3"))) static int packSSSE3(const int *src,
+                                                      unsigned char *dst,
+                                                      int count) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  int i = 0;
+  for (; i + 6 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i * 3), _mm_shuffle_epi8(v, shuffle));
+  }
+  return i;
+}
+
+static bool haveSSSE3() {
+  static const bool have = __builtin_cpu_supports("ssse3");
+  return have;
+}
+#endif
+
+void unpackPixels24(const unsigned char *src, int *dst, int count) {
+  int i = 0;
+#ifdef BITMAP_SSSE3
+  if (haveSSSE3())
+    i = unpackSSSE3(src, dst, count);
+#endif
+  unpackWords(src, dst, i, count);
+}
+
+void packPixels24(const int *src, unsigned char *dst, int count) {
+  int i = 0;
+#ifdef BITMAP_SSSE3
+  if (haveSSSE3())
+    i = packSSSE3(src, dst, count);
+#endif
+  packWords(src, dst, i, count);
+}
+
 BitmapInterface::BitmapInterface(const char *f) : filename(f) {
   core = NULL;
   dib = NULL;
   image = NULL;
 
+  file = NULL;
+  fileBytes = 0;
+  fileMapped = false;
+
   magicNumber = 0;
   fileSize = 0;
   offsetOfImage = 0;
@@ -55,6 +152,7 @@ BitmapInterface::BitmapInterface(const char *f) : filename(f) {
 
   height = -1;
   width = -1;
+  rowStride = 0;
 }
 
 BitmapInterface::~BitmapInterface() {
@@ -64,12 +162,24 @@ BitmapInterface::~BitmapInterface() {
     delete[] dib;
   if (image != NULL)
     delete[] image;
+  releaseFile();
 }
 
-bool BitmapInterface::readBitmapFile() {
+void BitmapInterface::releaseFile() {
+  if (file == NULL)
+    return;
+  if (fileMapped)
+    munmap(file, fileBytes);
+  else
+    delete[] file;
+  file = NULL;
+  fileBytes = 0;
+  fileMapped = false;
+}
+
+bool BitmapInterface::readBitmapFile(bool unpack) {
   // First, open the bitmap file
   int fd;
-  unsigned int fileSize;
 
   fd = open(filename, O_RDONLY);
   if (fd < 0) {
@@ -77,54 +187,120 @@ bool BitmapInterface::readBitmapFile() {
     return false;
   }
 
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 54) {
+    std::cerr << "Not a bitmap file " << filename << std::endl;
+    close(fd);
+    return false;
+  }
+
+  releaseFile();
+  fileBytes = st.st_size;
+  void *ptr = mmap(NULL, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (ptr != MAP_FAILED) {
+    file = (unsigned char *)ptr;
+    fileMapped = true;
+  } else {
+    // One bulk read instead
+    file = new unsigned char[fileBytes];
+    size_t done = 0;
+    while (done < fileBytes) {
+      ssize_t n = read(fd, file + done, fileBytes - done);
+      if (n <= 0)
+        break;
+      done += n;
+    }
+    if (done != fileBytes) {
+      std::cerr << "Cannot read image file " << filename << std::endl;
+      close(fd);
+      return false;
+    }
+  }
+  close(fd);
+
+  delete[] core;
   core = new char[14];
-  read(fd, core, 14);
+  memcpy(core, file, 14);
   magicNumber = (*(unsigned short *)(&(core[0])));
   fileSize = (*(unsigned int *)(&(core[2])));
   offsetOfImage = (*(unsigned int *)(&(core[10])));
 
   // Just read in the DIB, but don't process it
   sizeOfDIB = offsetOfImage - 14;
+  if (offsetOfImage < 54 || offsetOfImage > fileBytes) {
+    std::cerr << "Corrupt bitmap header in " << filename << std::endl;
+    return false;
+  }
+  delete[] dib;
   dib = new char[sizeOfDIB];
-  read(fd, dib, sizeOfDIB);
+  memcpy(dib, file + 14, sizeOfDIB);
 
   width = (*(int *)(&(dib[4])));
   height = (*(int *)(&(dib[8])));
+  unsigned short bitsPerPixel = (*(unsigned short *)(&(dib[14])));
+  unsigned int compression = (*(unsigned int *)(&(dib[16])));
+  if (bitsPerPixel != 24 || compression != 0) {
+    std::cerr << "Only uncompressed 24-bit bitmaps are supported: "
+              << filename << std::endl;
+    return false;
+  }
 
-  sizeOfImage = fileSize - 14 - sizeOfDIB;
-  int numPixels = sizeOfImage / 3; // RGB
+  // Rows are padded to a multiple of 4 bytes
+  rowStride = (width * 3 + 3) & ~3;
+  int rows = abs(height);
+  sizeOfImage = rowStride * rows;
+  if ((size_t)offsetOfImage + sizeOfImage > fileBytes) {
+    std::cerr << "Truncated bitmap file " << filename << std::endl;
+    return false;
+  }
+  if (fileMapped)
+    madvise(file, fileBytes, MADV_SEQUENTIAL);
 
-  image = new int[numPixels];
+  if (!unpack)
+    return true;
 
-  for (int i = 0; i < numPixels; ++i) {
-    // Use an integer for every pixel even though we might not need that
-    //  much space (padding 0 bits in the rest of the integer)
-    image[i] = 0;
-    read(fd, &(image[i]), 3);
-  }
+  // Use an integer for every pixel even though we might not need that
+  // much space (padding 0 bits in the rest of the integer)
+  delete[] image;
+  image = new int[numPixels()];
+  for (int r = 0; r < rows; r++)
+    unpackPixels24(pixelRows() + (size_t)r * rowStride,
+                   image + (size_t)r * width, width);
 
   return true;
 }
 
 bool BitmapInterface::writeBitmapFile(int *otherImage) {
   int fd;
-  fd = open("output.bmp", O_WRONLY | O_CREAT, 0644);
+  fd = open("output.bmp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
 
   if (fd < 0) {
     std::cerr << "Cannot open output.bmp for writing!" << std::endl;
     return false;
   }
 
-  write(fd, core, 14);
-  write(fd, dib, sizeOfDIB);
-
-  int numPixels = sizeOfImage / 3;
-
   int *outputImage = otherImage != NULL ? otherImage : image;
+  int rows = abs(height);
+
+  // Headers and padded pixel rows are assembled first and written at once
+  std::vector<unsigned char> out(offsetOfImage + (size_t)sizeOfImage, 0);
+  memcpy(&out[0], core, 14);
+  memcpy(&out[14], dib, sizeOfDIB);
+  for (int r = 0; r < rows; r++)
+    packPixels24(outputImage + (size_t)r * width,
+                 &out[offsetOfImage + (size_t)r * rowStride], width);
 
-  for (int i = 0; i < numPixels; ++i) {
-    write(fd, &(outputImage[i]), 3);
+  size_t done = 0;
+  while (done < out.size()) {
+    ssize_t n = write(fd, &out[done], out.size() - done);
+    if (n <= 0) {
+      std::cerr << "Cannot write output.bmp" << std::endl;
+      close(fd);
+      return false;
+    }
+    done += n;
   }
+  close(fd);
 
   return true;
 }
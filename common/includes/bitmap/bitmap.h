@@ -37,6 +37,10 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdlib.h>
 
+// 24-bit uncompressed BMP files. The file is mapped (or read with a single
+// read() where mapping fails) and the pixel rows, padded to 4 bytes in the
+// file, are unpacked to one int per pixel (0x00RRGGBB) with SIMD shuffles.
+// Writing packs them back and emits the whole file in one write.
 class BitmapInterface {
 private:
   char *core;
@@ -44,6 +48,11 @@ private:
   const char *filename;
   int *image;
 
+  // Whole input file, mapped or in a heap buffer
+  unsigned char *file;
+  size_t fileBytes;
+  bool fileMapped;
+
   // Core header information
   unsigned short magicNumber;
   unsigned int fileSize;
@@ -54,19 +63,34 @@ private:
   int sizeOfImage;
   int height;
   int width;
+  int rowStride; // bytes per row in the file, including padding
+
+  void releaseFile();
 
 public:
   BitmapInterface(const char *f);
   ~BitmapInterface();
 
-  bool readBitmapFile();
+  // unpack = false only sets up the zero-copy view below
+  bool readBitmapFile(bool unpack = true);
   bool writeBitmapFile(int *otherImage = NULL);
 
   inline int *bitmap() { return image; }
-  unsigned int numPixels() { return sizeOfImage/3; }
+  unsigned int numPixels() { return width * abs(height); }
+
+  // Zero-copy view of the 24-bit pixel rows as stored in the file: row r
+  // starts at pixelRows() + r * getRowStride(). Valid while the object lives.
+  inline const unsigned char *pixelRows() {
+    return file ? file + offsetOfImage : NULL;
+  }
+  inline int getRowStride() { return rowStride; }
 
   inline int getHeight() { return height; }
   inline int getWidth() { return width; }
 };
 
+// 24-bit BGR triplets to/from one int per pixel
+void unpackPixels24(const unsigned char *src, int *dst, int count);
+void packPixels24(const int *src, unsigned char *dst, int count);
+
 #endif
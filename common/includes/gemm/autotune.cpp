@@ -0,0 +1,284 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "autotune.hpp"
+#include "float_gemm.hpp"
+#include "quant_gemm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace gemm {
+
+typedef std::chrono::steady_clock Clock;
+
+// Timed runs of every candidate after its warm-up run; the fastest counts.
+// Slow candidates stop early once their timed runs reach TUNE_BUDGET_S.
+static const int TUNE_REPEATS = 5;
+static const double TUNE_BUDGET_S = 0.5;
+
+bool dtype_known(const std::string &dtype) {
+  return dtype == "int32" || dtype == "int8" || dtype == "int16" ||
+         dtype_is_float(dtype);
+}
+
+bool dtype_is_float(const std::string &dtype) {
+  return dtype == "fp32" || dtype == "bf16" || dtype == "fp16";
+}
+
+// Copies the elements of v into 32-bit words, the last one zero padded
+template <typename T>
+static void to_words(const std::vector<T> &v, std::vector<uint32_t> &words) {
+  words.assign((v.size() * sizeof(T) + 3) / 4, 0);
+  memcpy(words.data(), v.data(), v.size() * sizeof(T));
+}
+
+template <typename T>
+static void convert_words(const std::vector<float> &v,
+                          std::vector<uint32_t> &words) {
+  std::vector<T> t(v.size());
+  convert(v.data(), t.data(), v.size());
+  to_words(t, words);
+}
+
+void make_operands(const Shape &shape, std::vector<uint32_t> &A,
+                   std::vector<uint32_t> &B) {
+  int M = shape.M, N = shape.N, K = shape.K;
+  std::default_random_engine e;
+  if (dtype_is_float(shape.dtype)) {
+    std::uniform_real_distribution<float> dist(0, 1);
+    std::vector<float> a((size_t)M * K), b((size_t)K * N);
+    for (size_t i = 0; i < a.size(); i++)
+      a[i] = dist(e);
+    for (size_t i = 0; i < b.size(); i++)
+      b[i] = dist(e);
+    if (shape.dtype == "bf16") {
+      convert_words<bf16>(a, A);
+      convert_words<bf16>(b, B);
+    } else if (shape.dtype == "fp16") {
+      convert_words<fp16>(a, A);
+      convert_words<fp16>(b, B);
+    } else {
+      to_words(a, A);
+      to_words(b, B);
+    }
+    return;
+  }
+
+  // The full int8 range, and an int16 range whose sums stay within int32
+  // for K up to 2048
+  int lo = 0, hi = 10;
+  if (shape.dtype == "int8") {
+    lo = -128;
+    hi = 127;
+  } else if (shape.dtype == "int16") {
+    lo = -1000;
+    hi = 1000;
+  }
+  std::uniform_int_distribution<int> dist(lo, hi);
+  std::vector<int> a((size_t)M * K), b((size_t)K * N);
+  for (size_t i = 0; i < a.size(); i++)
+    a[i] = dist(e);
+  for (size_t i = 0; i < b.size(); i++)
+    b[i] = dist(e);
+  if (shape.dtype == "int32") {
+    to_words(a, A);
+    to_words(b, B);
+    return;
+  }
+  QuantWidth width = (shape.dtype == "int8") ? QUANT_INT8 : QUANT_INT16;
+  A.assign((size_t)M * quant_words(K, width), 0);
+  B.assign((size_t)quant_words(K, width) * N, 0);
+  quant_pack_rows(a.data(), A.data(), M, K, width);
+  quant_pack_cols(b.data(), B.data(), K, N, width);
+}
+
+Autotuner::Autotuner(const std::string &cache_file)
+    : m_cache_file(cache_file), m_verbose(false) {
+  load();
+}
+
+void Autotuner::add(const Variant &variant) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_variants.push_back(variant);
+}
+
+std::string Autotuner::key(const Shape &shape) {
+  std::ostringstream os;
+  os << shape.M << ' ' << shape.N << ' ' << shape.K << ' ' << shape.dtype;
+  return os.str();
+}
+
+// One entry per line: M N K dtype variant tile depth gops
+void Autotuner::load() {
+  if (m_cache_file.empty())
+    return;
+  std::ifstream in(m_cache_file.c_str());
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream is(line);
+    Shape s;
+    TuneResult r;
+    if (is >> s.M >> s.N >> s.K >> s.dtype >> r.variant >> r.tile >> r.depth >>
+        r.gops)
+      m_cache[key(s)] = r;
+  }
+}
+
+void Autotuner::save() {
+  if (m_cache_file.empty())
+    return;
+  // Write a new file and rename it so a crash never leaves half a cache
+  std::string tmp = m_cache_file + ".tmp";
+  {
+    std::ofstream out(tmp.c_str());
+    for (std::map<std::string, TuneResult>::const_iterator it =
+             m_cache.begin();
+         it != m_cache.end(); ++it)
+      out << it->first << ' ' << it->second.variant << ' ' << it->second.tile
+          << ' ' << it->second.depth << ' ' << it->second.gops << '\n';
+    if (!out) {
+      printf("WARNING: cannot write tuning cache %s\n", tmp.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp.c_str(), m_cache_file.c_str()) != 0)
+    printf("WARNING: cannot replace tuning cache %s\n", m_cache_file.c_str());
+}
+
+const Variant *Autotuner::find(const std::string &name) const {
+  for (size_t i = 0; i < m_variants.size(); i++)
+    if (m_variants[i].name == name)
+      return &m_variants[i];
+  return nullptr;
+}
+
+TuneResult Autotuner::tune(const Shape &shape) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map<std::string, TuneResult>::iterator hit = m_cache.find(key(shape));
+  // A cached winner is only usable if that variant is registered here
+  if (hit != m_cache.end() && find(hit->second.variant))
+    return hit->second;
+
+  if (!dtype_known(shape.dtype)) {
+    printf("ERROR: unknown dtype %s\n", shape.dtype.c_str());
+    exit(EXIT_FAILURE);
+  }
+  int M = shape.M, N = shape.N, K = shape.K;
+  std::vector<uint32_t> A, B;
+  make_operands(shape, A, B);
+  // int32 or float results, compared exactly or within float_tolerance()
+  std::vector<uint32_t> ref((size_t)M * N), C((size_t)M * N);
+  bool floating = dtype_is_float(shape.dtype);
+
+  double ops = 2.0 * M * N * K;
+  bool have_ref = false;
+  TuneResult best = {"", 0, 0, 0};
+  for (size_t v = 0; v < m_variants.size(); v++) {
+    const Variant &var = m_variants[v];
+    if (std::find(var.dtypes.begin(), var.dtypes.end(), shape.dtype) ==
+        var.dtypes.end())
+      continue;
+    if (var.max_dim && (M > var.max_dim || N > var.max_dim ||
+                        K > var.max_dim))
+      continue;
+    for (size_t t = 0; t < var.tiles.size(); t++) {
+      for (size_t d = 0; d < var.depths.size(); d++) {
+        // The warm-up run is checked; the first candidate that runs is the
+        // reference for the rest
+        var.run(A.data(), B.data(), C.data(), M, N, K, var.tiles[t],
+                var.depths[d], shape.dtype);
+        bool correct = true;
+        if (!have_ref) {
+          ref = C;
+          have_ref = true;
+        } else if (floating) {
+          correct = float_error((const float *)ref.data(),
+                                (const float *)C.data(), C.size())
+                        .max_rel <= float_tolerance(K);
+        } else {
+          correct = (C == ref);
+        }
+        double s = 0, spent = 0;
+        for (int r = 0; correct && r < TUNE_REPEATS && spent < TUNE_BUDGET_S;
+             r++) {
+          Clock::time_point start = Clock::now();
+          var.run(A.data(), B.data(), C.data(), M, N, K, var.tiles[t],
+                  var.depths[d], shape.dtype);
+          double run_s =
+              std::chrono::duration<double>(Clock::now() - start).count();
+          s = (r == 0) ? run_s : std::min(s, run_s);
+          spent += run_s;
+        }
+        double gops = correct ? ops / s * 1.0e-9 : 0;
+        if (m_verbose)
+          printf("  %-20s tile %5d depth %2d: %10f ms %10f GOPS%s\n",
+                 var.name.c_str(), var.tiles[t], var.depths[d], s * 1000,
+                 gops, correct ? "" : " (wrong result, skipped)");
+        if (correct && gops > best.gops) {
+          best.variant = var.name;
+          best.tile = var.tiles[t];
+          best.depth = var.depths[d];
+          best.gops = gops;
+        }
+      }
+    }
+  }
+  if (best.variant.empty()) {
+    printf("ERROR: no GEMM variant accepts %s\n", key(shape).c_str());
+    exit(EXIT_FAILURE);
+  }
+  m_cache[key(shape)] = best;
+  save();
+  return best;
+}
+
+void Autotuner::matmul(const void *A, const void *B, void *C, int M, int N,
+                       int K, const std::string &dtype) {
+  Shape shape = {M, N, K, dtype};
+  TuneResult r = tune(shape);
+  Variant::Run run;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    run = find(r.variant)->run;
+  }
+  run(A, B, C, M, N, K, r.tile, r.depth, dtype);
+}
+} // namespace gemm
@@ -0,0 +1,129 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Shape-aware dispatch between the GEMM implementations of this repository.
+// Every implementation registers itself as a Variant with the dtypes, tile
+// sizes and pipeline depths it supports. The first call for a given (M, N, K,
+// dtype) benchmarks all combinations of the variants that list dtype, on
+// operands generated in the layout of that dtype, checks them against the
+// first one and keeps the fastest. Each combination is run once to warm up,
+// then timed as the best of several runs. Winners are persisted in a plain
+// text tuning cache, so later runs dispatch straight away. Variants can be
+// device kernels or the same kernels compiled for the host.
+namespace gemm {
+
+// Element types and the layout of their operands:
+//   "int32"           row-major int32, int32 C
+//   "int8", "int16"   packed along K as in quant_gemm.hpp, A by rows and B
+//                     by columns, int32 C
+//   "fp32"            row-major float, float C
+//   "bf16", "fp16"    row-major bit patterns as in float_gemm.hpp, float C
+struct Shape {
+  int M, N, K;
+  std::string dtype;
+};
+
+// Whether dtype is one of the above, and whether its C is float
+bool dtype_known(const std::string &dtype);
+bool dtype_is_float(const std::string &dtype);
+
+// Random A and B of shape in the layout of its dtype, as tune() runs the
+// variants on, in 32-bit words. Floating-point values are in [0, 1), so that
+// results can be checked with float_tolerance().
+void make_operands(const Shape &shape, std::vector<uint32_t> &A,
+                   std::vector<uint32_t> &B);
+
+struct TuneResult {
+  std::string variant;
+  int tile;
+  int depth;
+  double gops;
+};
+
+struct Variant {
+  // C = A * B for the given shape, tile size and pipeline depth, with A, B
+  // and C in the layout of dtype
+  typedef std::function<void(const void *A, const void *B, void *C, int M,
+                             int N, int K, int tile, int depth,
+                             const std::string &dtype)>
+      Run;
+
+  std::string name;
+  std::vector<std::string> dtypes; // Dtypes run accepts
+  std::vector<int> tiles;  // Candidate tile sizes, 0 when untiled
+  std::vector<int> depths; // Candidate pipeline depths
+  int max_dim;             // Largest M, N or K accepted, 0 for no limit
+  Run run;
+};
+
+class Autotuner {
+public:
+  // cache_file may be empty to keep results in memory only
+  explicit Autotuner(const std::string &cache_file);
+
+  void add(const Variant &variant);
+
+  // Returns the cached winner for shape, benchmarking on a miss
+  TuneResult tune(const Shape &shape);
+  // Dispatches C = A * B to the winner for (M, N, K, dtype), with the
+  // operands in the layout of dtype (see Shape)
+  void matmul(const void *A, const void *B, void *C, int M, int N, int K,
+              const std::string &dtype);
+
+  // Prints every candidate timing of the next tune() calls
+  void set_verbose(bool verbose) { m_verbose = verbose; }
+
+private:
+  static std::string key(const Shape &shape);
+  void load();
+  void save();
+  const Variant *find(const std::string &name) const;
+
+  std::string m_cache_file;
+  bool m_verbose;
+  std::vector<Variant> m_variants;
+  std::map<std::string, TuneResult> m_cache;
+  std::mutex m_mutex;
+};
+} // namespace gemm
@@ -0,0 +1,270 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "bitpack.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// The SIMD paths are compiled with function target attributes and picked at
+// run time, as in quant_gemm.cpp
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITPACK_X86
+#include <immintrin.h>
+#endif
+
+namespace gemm {
+
+BitPackIsa bitpack_isa(BitPackIsa requested) {
+#ifdef BITPACK_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  BitPackIsa best = has_avx2 ? BPISA_AVX2 : BPISA_SCALAR;
+#else
+  BitPackIsa best = BPISA_SCALAR;
+#endif
+  return (requested == BPISA_AUTO || requested > best) ? best : requested;
+}
+
+const char *bitpack_isa_name(BitPackIsa isa) {
+  switch (isa) {
+  case BPISA_SCALAR:
+    return "scalar";
+  case BPISA_AVX2:
+    return "AVX2";
+  default:
+    return "auto";
+  }
+}
+
+static void scalar_min_max(const int *data, size_t begin, size_t n, int *lo,
+                           int *hi) {
+  for (size_t i = begin; i < n; i++) {
+    if (data[i] < *lo)
+      *lo = data[i];
+    if (data[i] > *hi)
+      *hi = data[i];
+  }
+}
+
+// Elements of one block of the SIMD encoder: eight vectors of 32 bytes.
+// A block fills whole words at every width.
+static const size_t BLOCK = 256;
+// Blocks per chunk of the pool, 256 KB of int32 input
+static const int CHUNK_BLOCKS = 256;
+
+#ifdef BITPACK_X86
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+// Returns the number of leading elements scanned
+AVX2_TARGET static size_t avx2_min_max(const int *data, size_t n, int *lo,
+                                       int *hi) {
+  if (n < 8)
+    return 0;
+  __m256i vlo = _mm256_loadu_si256((const __m256i *)data);
+  __m256i vhi = vlo;
+  size_t i = 8;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    vlo = _mm256_min_epi32(vlo, v);
+    vhi = _mm256_max_epi32(vhi, v);
+  }
+  int32_t l[8], h[8];
+  _mm256_storeu_si256((__m256i *)l, vlo);
+  _mm256_storeu_si256((__m256i *)h, vhi);
+  for (int t = 0; t < 8; t++) {
+    *lo = l[t] < *lo ? l[t] : *lo;
+    *hi = h[t] > *hi ? h[t] : *hi;
+  }
+  return i;
+}
+
+// 32 offsets of data from base, which fit a byte, as 32 bytes in order
+AVX2_TARGET static inline __m256i bytes32(const int *data, __m256i base) {
+  __m256i v0 =
+      _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)data), base);
+  __m256i v1 =
+      _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(data + 8)), base);
+  __m256i v2 =
+      _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(data + 16)), base);
+  __m256i v3 =
+      _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(data + 24)), base);
+  // The packs interleave the 128-bit halves; the permutation restores the
+  // order of the groups of four elements
+  __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(v0, v1),
+                                      _mm256_packus_epi32(v2, v3));
+  return _mm256_permutevar8x32_epi32(bytes,
+                                     _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+// Encodes BLOCK elements into BLOCK * width / 8 bytes. The elements are
+// first narrowed to bytes; each round then merges neighbouring bytes of
+// b bits into one of 2b bits, multiplying the upper one by 2^b with
+// vpmaddubsw, until the bytes are full.
+AVX2_TARGET static void avx2_block(const int *data, int width, __m256i base,
+                                   uint8_t *out) {
+  __m256i v[8];
+  for (int t = 0; t < 8; t++)
+    v[t] = bytes32(data + 32 * t, base);
+  int count = 8;
+  for (int bits = width; bits < 8; bits *= 2) {
+    const __m256i weights = _mm256_set1_epi16((int16_t)((1 << bits) << 8 | 1));
+    for (int t = 0; t < count / 2; t++) {
+      __m256i lo = _mm256_maddubs_epi16(v[2 * t], weights);
+      __m256i hi = _mm256_maddubs_epi16(v[2 * t + 1], weights);
+      v[t] = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+    }
+    count /= 2;
+  }
+  for (int t = 0; t < count; t++)
+    _mm256_storeu_si256((__m256i *)(out + 32 * t), v[t]);
+}
+
+// Returns the number of leading elements encoded. Whole blocks fill whole
+// words, BLOCK / lanes of them.
+AVX2_TARGET static size_t avx2_encode(const int *data, size_t n,
+                                      BitPacking packing, uint32_t *words) {
+  const __m256i base = _mm256_set1_epi32(packing.base);
+  const size_t lanes = 32 / packing.width;
+  size_t i = 0;
+  for (; i + BLOCK <= n; i += BLOCK)
+    avx2_block(data + i, packing.width, base, (uint8_t *)(words + i / lanes));
+  return i;
+}
+#endif
+
+// Minimum and maximum of data[begin, end)
+static void min_max(const int *data, size_t begin, size_t end, BitPackIsa isa,
+                    int *lo, int *hi) {
+  *lo = *hi = data[begin];
+  size_t i = 0;
+#ifdef BITPACK_X86
+  if (isa == BPISA_AVX2)
+    i = avx2_min_max(data + begin, end - begin, lo, hi);
+#else
+  (void)isa;
+#endif
+  scalar_min_max(data + begin, i, end - begin, lo, hi);
+}
+
+// Chunks of the pool over n elements, CHUNK_BLOCKS whole blocks each but
+// the last
+static int chunk_count(size_t n) {
+  size_t chunk = BLOCK * CHUNK_BLOCKS;
+  return (int)((n + chunk - 1) / chunk);
+}
+
+BitPacking bitpack_choose(const int *data, size_t n, BitPackIsa isa,
+                          ThreadPool &pool) {
+  BitPacking packing = {1, 0};
+  if (n == 0)
+    return packing;
+  isa = bitpack_isa(isa);
+  int chunks = chunk_count(n);
+  std::vector<int> los(chunks), his(chunks);
+  pool.parallel_for(0, chunks, 1, [&](int b, int e) {
+    for (int c = b; c < e; c++) {
+      size_t begin = (size_t)c * BLOCK * CHUNK_BLOCKS;
+      size_t end = std::min(n, begin + BLOCK * CHUNK_BLOCKS);
+      min_max(data, begin, end, isa, &los[c], &his[c]);
+    }
+  });
+  int lo = los[0], hi = his[0];
+  for (int c = 1; c < chunks; c++) {
+    lo = std::min(lo, los[c]);
+    hi = std::max(hi, his[c]);
+  }
+
+  int64_t range = (int64_t)hi - lo;
+  for (packing.width = 1; packing.width <= 8; packing.width *= 2)
+    if (range < ((int64_t)1 << packing.width)) {
+      packing.base = lo;
+      return packing;
+    }
+  packing.width = 32;
+  packing.base = 0;
+  return packing;
+}
+
+// Encodes data[begin, end) into the words from begin / lanes on; begin is
+// a multiple of BLOCK
+static void encode_range(const int *data, size_t begin, size_t end,
+                         BitPacking packing, uint32_t *words,
+                         BitPackIsa isa) {
+  const int width = packing.width;
+  const size_t lanes = 32 / width;
+  size_t i = 0;
+#ifdef BITPACK_X86
+  if (isa == BPISA_AVX2)
+    i = avx2_encode(data + begin, end - begin, packing, words + begin / lanes);
+#else
+  (void)isa;
+#endif
+  const uint32_t mask = (1u << width) - 1;
+  for (size_t w = (begin + i) / lanes; w < bitpack_words(end, width); w++) {
+    uint32_t word = 0;
+    for (size_t l = 0; l < lanes && w * lanes + l < end; l++)
+      word |= ((uint32_t)(data[w * lanes + l] - packing.base) & mask)
+              << (width * l);
+    words[w] = word;
+  }
+}
+
+void bitpack_encode(const int *data, size_t n, BitPacking packing,
+                    uint32_t *words, BitPackIsa isa, ThreadPool &pool) {
+  isa = bitpack_isa(isa);
+  pool.parallel_for(0, chunk_count(n), 1, [&](int b, int e) {
+    size_t begin = (size_t)b * BLOCK * CHUNK_BLOCKS;
+    size_t end = std::min(n, (size_t)e * BLOCK * CHUNK_BLOCKS);
+    if (packing.width == 32)
+      memcpy(words + begin, data + begin, (end - begin) * sizeof(int));
+    else
+      encode_range(data, begin, end, packing, words, isa);
+  });
+}
+
+void bitpack_decode(const uint32_t *words, size_t n, BitPacking packing,
+                    int *data) {
+  if (packing.width == 32) {
+    memcpy(data, words, n * sizeof(int));
+    return;
+  }
+  const int width = packing.width;
+  const int lanes = 32 / width;
+  const uint32_t mask = (1u << width) - 1;
+  for (size_t i = 0; i < n; i++)
+    data[i] = packing.base +
+              (int)((words[i / lanes] >> (width * (i % lanes))) & mask);
+}
+} // namespace gemm
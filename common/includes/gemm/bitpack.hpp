@@ -0,0 +1,95 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <limits>
+#include <stdint.h>
+
+// Transport encoding of int matrices whose values span a small range: every
+// value is sent as its offset from the smallest one in 1, 2, 4 or 8 bits,
+// lanes of consecutive elements in 32-bit words with the first element in
+// the lowest bits. This is the layout the *_bitpack kernels unpack in their
+// read loops. Values spanning more than 8 bits are sent as they are, width
+// 32. Unlike quant_gemm.hpp, this only shrinks the transfer; the kernels
+// still compute on int32.
+namespace gemm {
+
+struct BitPacking {
+  int width; // bits per element: 1, 2, 4, 8 or 32
+  int base;  // added back to every element; 0 for width 32
+};
+
+// Instruction sets of the encoder, picked as for quant_gemm.hpp
+enum BitPackIsa { BPISA_AUTO, BPISA_SCALAR, BPISA_AVX2 };
+
+BitPackIsa bitpack_isa(BitPackIsa requested = BPISA_AUTO);
+const char *bitpack_isa_name(BitPackIsa isa);
+
+// 32-bit words holding n elements of width bits
+inline size_t bitpack_words(size_t n, int width) {
+  return (n * width + 31) / 32;
+}
+
+// The narrowest encoding of the n values, from a min/max scan split across
+// the pool
+BitPacking bitpack_choose(const int *data, size_t n,
+                          BitPackIsa isa = BPISA_AUTO,
+                          ThreadPool &pool = ThreadPool::global());
+
+// Encodes n values, which must lie in [base, base + 2^width), into
+// bitpack_words(n, width) words, in chunks of whole words across the pool
+void bitpack_encode(const int *data, size_t n, BitPacking packing,
+                    uint32_t *words, BitPackIsa isa = BPISA_AUTO,
+                    ThreadPool &pool = ThreadPool::global());
+
+// Break-even throughput of bitpack_choose() plus bitpack_encode(), in GB/s
+// of int32 input: above it, packing to width bits and sending width / 32 of
+// the bytes over a link of link_gbps finishes sooner than sending the int32
+// values. encode + (width / 32) * bytes / link < bytes / link gives
+// link * 32 / (32 - width): 12.4 GB/s for 1 bit and 16 GB/s for 8 bits on a
+// 12 GB/s link. Width 32 never pays.
+inline double bitpack_break_even(int width, double link_gbps) {
+  if (width >= 32)
+    return std::numeric_limits<double>::infinity();
+  return link_gbps * 32.0 / (32 - width);
+}
+
+// The inverse of bitpack_encode
+void bitpack_decode(const uint32_t *words, size_t n, BitPacking packing,
+                    int *data);
+} // namespace gemm
@@ -0,0 +1,126 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "coexec.hpp"
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace gemm {
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+SplitScheduler::SplitScheduler(double device_share, double smoothing)
+    : m_share(std::min(1.0, std::max(0.0, device_share))),
+      m_smoothing(std::min(1.0, std::max(0.0, smoothing))), m_cpu_rate(0),
+      m_device_rate(0) {}
+
+int SplitScheduler::device_rows(int rows) const {
+  int d = (int)(rows * m_share + 0.5);
+  // Each engine keeps at least one probe row, so that a rate measured too
+  // low, e.g. on a cold first round, is measured again and can recover
+  if (rows >= 2)
+    return std::min(rows - 1, std::max(1, d));
+  return std::min(rows, std::max(0, d));
+}
+
+void SplitScheduler::update(int cpu_rows, double cpu_s, int device_rows,
+                            double device_s) {
+  // An engine that got no rows this round, only possible in a round of one
+  // row, keeps its previous estimate
+  if (cpu_rows > 0 && cpu_s > 0) {
+    double rate = cpu_rows / cpu_s;
+    m_cpu_rate = m_cpu_rate == 0
+                     ? rate
+                     : m_smoothing * rate + (1 - m_smoothing) * m_cpu_rate;
+  }
+  if (device_rows > 0 && device_s > 0) {
+    double rate = device_rows / device_s;
+    m_device_rate =
+        m_device_rate == 0
+            ? rate
+            : m_smoothing * rate + (1 - m_smoothing) * m_device_rate;
+  }
+  // Both finish together when rows are split in proportion to throughput
+  if (m_cpu_rate > 0 && m_device_rate > 0)
+    m_share = m_device_rate / (m_cpu_rate + m_device_rate);
+}
+
+CoexecStats coexecute(int rows, int round_rows, const RowEngine &cpu,
+                      const RowEngine &device, SplitScheduler &scheduler) {
+  CoexecStats stats = {};
+  round_rows = std::max(1, round_rows);
+  Clock::time_point start = Clock::now();
+
+  for (int first = 0; first < rows; first += round_rows) {
+    int last = std::min(rows, first + round_rows);
+    int split = first + scheduler.device_rows(last - first);
+
+    // The device side runs on its own thread, the CPU side on this one
+    double device_s = 0;
+    std::future<void> device_done;
+    if (split > first) {
+      device_done = std::async(std::launch::async, [&device, &device_s, first,
+                                                    split] {
+        Clock::time_point t = Clock::now();
+        device(first, split);
+        device_s = seconds_since(t);
+      });
+    }
+    double cpu_s = 0;
+    if (last > split) {
+      Clock::time_point t = Clock::now();
+      cpu(split, last);
+      cpu_s = seconds_since(t);
+    }
+    if (device_done.valid())
+      device_done.get();
+
+    scheduler.update(last - split, cpu_s, split - first, device_s);
+    stats.rounds++;
+    stats.cpu_rows += last - split;
+    stats.device_rows += split - first;
+    stats.cpu_busy_s += cpu_s;
+    stats.device_busy_s += device_s;
+  }
+  stats.total_s = seconds_since(start);
+  stats.device_share = scheduler.device_share();
+  return stats;
+}
+} // namespace gemm
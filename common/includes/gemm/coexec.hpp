@@ -0,0 +1,88 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <functional>
+
+// Co-execution of one GEMM on the CPU engine and a device at the same time.
+// The rows of C are processed in rounds; in every round the device takes the
+// first part of the rows and the CPU the rest. The split follows the measured
+// throughput (rows per second) of both engines in the previous rounds, so
+// that both sides finish a round at the same time.
+namespace gemm {
+
+// Computes rows [row_begin, row_end) of C and returns once they are in place
+typedef std::function<void(int row_begin, int row_end)> RowEngine;
+
+class SplitScheduler {
+public:
+  // device_share is the fraction of rows given to the device before anything
+  // has been measured; smoothing weighs the newest measurement (1 = only the
+  // last round counts).
+  explicit SplitScheduler(double device_share = 0.5, double smoothing = 0.5);
+
+  // Rows of the next round of `rows` that go to the device. Of two or more
+  // rows each engine gets at least one, so neither is starved of
+  // measurements and the split can always move back.
+  int device_rows(int rows) const;
+  // Feeds back the measured time of one round
+  void update(int cpu_rows, double cpu_s, int device_rows, double device_s);
+
+  double device_share() const { return m_share; }
+  double cpu_rows_per_s() const { return m_cpu_rate; }
+  double device_rows_per_s() const { return m_device_rate; }
+
+private:
+  double m_share;
+  double m_smoothing;
+  double m_cpu_rate;
+  double m_device_rate;
+};
+
+struct CoexecStats {
+  int rounds;
+  int cpu_rows;
+  int device_rows;
+  double cpu_busy_s;    // Time the CPU engine spent computing
+  double device_busy_s; // Time the device engine spent computing
+  double total_s;       // Wall clock time of the whole product
+  double device_share;  // Split in effect after the last round
+};
+
+// Computes all `rows` rows of C in rounds of round_rows rows.
+CoexecStats coexecute(int rows, int round_rows, const RowEngine &cpu,
+                      const RowEngine &device, SplitScheduler &scheduler);
+} // namespace gemm
@@ -0,0 +1,130 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "cpu_gemm.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace gemm {
+
+// Block sizes keep a K_BLOCK x N_BLOCK panel of B (256 KB) in L2
+static const int K_BLOCK = 128;
+static const int N_BLOCK = 512;
+// Rows handed to one pool task
+static const int ROW_GRAIN = 16;
+
+void matmul_block(const int *A, const int *B, int *C, int row_begin,
+                  int row_end, int N, int K) {
+  matmul_block(A, K, B, N, C, N, row_begin, row_end, N, K);
+}
+
+void matmul_block(const int *A, int lda, const int *B, int ldb, int *C,
+                  int ldc, int row_begin, int row_end, int N, int K) {
+  for (int i = row_begin; i < row_end; i++)
+    memset(C + (size_t)i * ldc, 0, N * sizeof(int));
+
+  for (int jj = 0; jj < N; jj += N_BLOCK) {
+    int j_end = std::min(N, jj + N_BLOCK);
+    for (int kk = 0; kk < K; kk += K_BLOCK) {
+      int k_end = std::min(K, kk + K_BLOCK);
+      for (int i = row_begin; i < row_end; i++) {
+        int *__restrict c = C + (size_t)i * ldc;
+        const int *a = A + (size_t)i * lda;
+        for (int k = kk; k < k_end; k++) {
+          const int a_val = a[k];
+          const int *__restrict b = B + (size_t)k * ldb;
+          for (int j = jj; j < j_end; j++)
+            c[j] += a_val * b[j];
+        }
+      }
+    }
+  }
+}
+
+// One row of epilogue_rows(), with the flags known at compile time so the
+// tests leave the loop
+template <int FLAGS>
+static void epilogue_row(const Epilogue &e, const int *acc, int *c, int N) {
+  Epilogue fixed = e;
+  fixed.flags = FLAGS;
+  if (e.beta == 0)
+    for (int j = 0; j < N; j++)
+      c[j] = epilogue_apply(fixed, acc[j], 0, e.bias ? e.bias[j] : 0);
+  else
+    for (int j = 0; j < N; j++)
+      c[j] = epilogue_apply(fixed, acc[j], c[j], e.bias ? e.bias[j] : 0);
+}
+
+void epilogue_rows(const Epilogue &e, const int *acc, int *C, int rows,
+                   int N) {
+  epilogue_check(e);
+  static void (*const row_fns[8])(const Epilogue &, const int *, int *,
+                                  int) = {
+      epilogue_row<0>, epilogue_row<1>, epilogue_row<2>, epilogue_row<3>,
+      epilogue_row<4>, epilogue_row<5>, epilogue_row<6>, epilogue_row<7>};
+  void (*row)(const Epilogue &, const int *, int *, int) =
+      row_fns[e.flags & 7];
+  for (int i = 0; i < rows; i++)
+    row(e, acc + (size_t)i * N, C + (size_t)i * N, N);
+}
+
+void cpu_matmul_rows(const int *A, const int *B, int *C, int row_begin,
+                     int row_end, int N, int K, ThreadPool &pool) {
+  pool.parallel_for(row_begin, row_end, ROW_GRAIN, [=](int b, int e) {
+    matmul_block(A, B, C, b, e, N, K);
+  });
+}
+
+void cpu_matmul_epilogue(const int *A, const int *B, int *C, int M, int N,
+                         int K, const Epilogue &e, ThreadPool &pool) {
+  epilogue_check(e);
+  const Epilogue *epi = &e;
+  pool.parallel_for(0, M, ROW_GRAIN, [=](int begin, int end) {
+    int *c = C + (size_t)begin * N;
+    if (epi->beta == 0) {
+      matmul_block(A, B, C, begin, end, N, K);
+      epilogue_rows(*epi, c, c, end - begin, N);
+      return;
+    }
+    // C_in is still needed, so the band is computed aside
+    static thread_local std::vector<int> acc;
+    acc.resize((size_t)(end - begin) * N);
+    matmul_block(A + (size_t)begin * K, K, B, N, acc.data(), N, 0,
+                 end - begin, N, K);
+    epilogue_rows(*epi, acc.data(), c, end - begin, N);
+  });
+}
+} // namespace gemm
@@ -0,0 +1,78 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "epilogue.hpp"
+#include "thread_pool.hpp"
+
+// Multithreaded CPU engine for C = A * B on row-major int32 matrices.
+// A is M x K, B is K x N and C is M x N. Rows of C are split across the
+// thread pool and each band is computed with a cache-blocked i-k-j kernel.
+namespace gemm {
+
+// Computes rows [row_begin, row_end) of C on the calling thread only.
+void matmul_block(const int *A, const int *B, int *C, int row_begin,
+                  int row_end, int N, int K);
+
+// Same for blocks of larger matrices: A, B and C have leading dimensions
+// lda, ldb and ldc instead of K, N and N.
+void matmul_block(const int *A, int lda, const int *B, int ldb, int *C,
+                  int ldc, int row_begin, int row_end, int N, int K);
+
+// Computes rows [row_begin, row_end) of C using the pool.
+void cpu_matmul_rows(const int *A, const int *B, int *C, int row_begin,
+                     int row_end, int N, int K,
+                     ThreadPool &pool = ThreadPool::global());
+
+// Computes the whole of C using the pool.
+inline void cpu_matmul(const int *A, const int *B, int *C, int M, int N,
+                       int K, ThreadPool &pool = ThreadPool::global()) {
+  cpu_matmul_rows(A, B, C, 0, M, N, K, pool);
+}
+
+// Applies e to rows rows of an N-column result acc, writing C: C[i][j] =
+// epilogue_apply(e, acc[i][j], C[i][j], e.bias[j]). acc may be C when
+// e.beta is 0. Run as a pass of its own this is the unfused epilogue.
+void epilogue_rows(const Epilogue &e, const int *acc, int *C, int rows,
+                   int N);
+
+// C = A * B with the epilogue e applied to each band of rows as soon as it
+// is computed, while it is still in cache, instead of in a second pass over
+// C. C holds C_in on entry when e.beta is not 0.
+void cpu_matmul_epilogue(const int *A, const int *B, int *C, int M, int N,
+                         int K, const Epilogue &e,
+                         ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
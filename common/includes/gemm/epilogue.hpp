@@ -0,0 +1,88 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#pragma once
+
+#include "epilogue_core.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// Post-processing of an int32 GEMM result applied as C is written out:
+//
+//   C = alpha * A * B + beta * C_in      always
+//     + bias[j]                          EPI_BIAS, one value per column
+//     max(C, 0)                          EPI_RELU
+//     round(C / 2^shift) into [-128, 127] EPI_REQUANT, to int8 kept in int32
+//
+// in that order. For alpha and beta other than INT_MIN and a shift in
+// [0, EPI_MAX_SHIFT], which epilogue_check() enforces, every step is exact
+// in 64 bits; without EPI_REQUANT the result is then truncated to its low
+// 32 bits. The *_epilogue kernels of array_partition, systolic_array and
+// large_matrix_mult compute the same with the same flags, through the same
+// epilogue() of epilogue_core.hpp, so a host can check them bit for bit.
+namespace gemm {
+
+struct Epilogue {
+  int alpha;
+  int beta;        // C_in is only read when beta is not 0
+  int flags;       // EpilogueFlags
+  int shift;       // right shift of EPI_REQUANT, rounding half up
+  const int *bias; // N values, read with EPI_BIAS
+
+  Epilogue() : alpha(1), beta(0), flags(0), shift(0), bias(NULL) {}
+  bool identity() const { return alpha == 1 && beta == 0 && flags == 0; }
+};
+
+inline int epilogue_apply(const Epilogue &e, int acc, int c_in, int bias) {
+  epilogue_args args = {e.alpha, e.beta, e.flags, e.shift};
+  return epilogue(args, acc, c_in, bias);
+}
+
+// Exits with an error when alpha or beta is INT_MIN or the shift is outside
+// [0, EPI_MAX_SHIFT]; called wherever an Epilogue is taken in, so that bad
+// arguments are not clamped silently as the kernels have to.
+inline void epilogue_check(const Epilogue &e) {
+  if (e.alpha < EPI_MIN_SCALE || e.beta < EPI_MIN_SCALE) {
+    printf("ERROR: epilogue alpha %d and beta %d must be above INT_MIN\n",
+           e.alpha, e.beta);
+    exit(EXIT_FAILURE);
+  }
+  if (e.shift < 0 || e.shift > EPI_MAX_SHIFT) {
+    printf("ERROR: epilogue shift %d is outside [0, %d]\n", e.shift,
+           EPI_MAX_SHIFT);
+    exit(EXIT_FAILURE);
+  }
+}
+} // namespace gemm
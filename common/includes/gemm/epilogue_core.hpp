@@ -0,0 +1,85 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+// Arithmetic of the epilogues described in epilogue.hpp, the one copy shared
+// by the host reference and the *_epilogue kernels of array_partition,
+// systolic_array and large_matrix_mult. The kernels include it by its path
+// relative to their src directory, so v++ finds it without extra flags, and
+// the host and the device compute C the same way bit for bit. Plain int
+// arithmetic only, so that HLS can synthesize it.
+namespace gemm {
+
+enum EpilogueFlags { EPI_BIAS = 1, EPI_RELU = 2, EPI_REQUANT = 4 };
+
+// Largest shift of EPI_REQUANT
+const int EPI_MAX_SHIFT = 62;
+
+// Smallest alpha and beta: with INT_MIN excluded each of alpha * acc and
+// beta * c_in stays below 2^62 - 2^31 in magnitude, so their sum plus a bias
+// is exact in 64 bits
+const int EPI_MIN_SCALE = -0x7fffffff;
+
+struct epilogue_args {
+  int alpha, beta, flags, shift;
+};
+static const epilogue_args epilogue_identity = {1, 0, 0, 0};
+
+// The kernels can not report bad arguments, so alpha, beta and shift are
+// clamped to the ranges above; epilogue_check() rejects them on the host.
+// Rounding half up adds bit shift - 1 after the shift instead of adding
+// 2^(shift - 1) before it, which could overflow, with the same result.
+inline int epilogue(const epilogue_args &e, int acc, int c_in, int bias) {
+#ifdef __SYNTHESIS__
+#pragma HLS INLINE
+#endif
+  long long alpha = (e.alpha < EPI_MIN_SCALE) ? EPI_MIN_SCALE : e.alpha;
+  long long beta = (e.beta < EPI_MIN_SCALE) ? EPI_MIN_SCALE : e.beta;
+  long long x = alpha * acc + beta * c_in;
+  if (e.flags & EPI_BIAS)
+    x += bias;
+  if ((e.flags & EPI_RELU) && x < 0)
+    x = 0;
+  if (e.flags & EPI_REQUANT) {
+    int s = (e.shift < 0) ? 0 : (e.shift > EPI_MAX_SHIFT) ? EPI_MAX_SHIFT
+                                                          : e.shift;
+    if (s > 0)
+      x = (x >> s) + ((x >> (s - 1)) & 1);
+    x = (x < -128) ? -128 : (x > 127) ? 127 : x;
+  }
+  return (int)x;
+}
+} // namespace gemm
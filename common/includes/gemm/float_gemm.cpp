@@ -0,0 +1,371 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "float_gemm.hpp"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// The SIMD paths are compiled with function target attributes and picked at
+// run time, as in quant_gemm.cpp
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FLOAT_X86
+#include <immintrin.h>
+#endif
+
+namespace gemm {
+
+static inline uint32_t float_bits(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+static inline float bits_float(uint32_t bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Inline for the scalar path, which widens every element of B it reads
+static inline float widen(bf16 x) { return bits_float((uint32_t)x.bits << 16); }
+
+// The exponent and mantissa of x moved to those of a float and scaled by
+// 2^(127 - 15) give x exactly, subnormals included. Free of branches, so the
+// scalar loops still vectorize.
+static inline float widen(fp16 x) {
+  uint32_t sign = (uint32_t)(x.bits & 0x8000) << 16;
+  uint32_t abs = (uint32_t)(x.bits & 0x7fff) << 13;
+  uint32_t scaled = float_bits(bits_float(abs) * 5.1922969e33f);
+  // Infinity, and NaN made quiet
+  uint32_t special = abs | 0x7f800000 | (uint32_t)(abs > 0x0f800000) << 22;
+  uint32_t is_special = 0 - (uint32_t)(abs >= 0x0f800000);
+  return bits_float(sign | (special & is_special) | (scaled & ~is_special));
+}
+
+static inline float widen(float x) { return x; }
+
+float to_float(bf16 x) { return widen(x); }
+
+float to_float(fp16 x) { return widen(x); }
+
+bf16 to_bf16(float x) {
+  uint32_t bits = float_bits(x);
+  bf16 r;
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    r.bits = (uint16_t)((bits >> 16) | 0x40); // keep NaN quiet
+    return r;
+  }
+  bits += 0x7fff + ((bits >> 16) & 1);
+  r.bits = (uint16_t)(bits >> 16);
+  return r;
+}
+
+fp16 to_fp16(float x) {
+  uint32_t bits = float_bits(x);
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs = bits & 0x7fffffff;
+  fp16 r;
+  if (abs > 0x7f800000) { // NaN
+    r.bits = (uint16_t)(sign | 0x7e00);
+  } else if (abs >= 0x477ff000) { // rounds to above 65504: infinity
+    r.bits = (uint16_t)(sign | 0x7c00);
+  } else if (abs < 0x38800000) { // below 2^-14: subnormal or zero
+    // Adding 0.5 aligns the mantissa so that the float addition rounds it
+    // to nearest even at 2^-24
+    uint32_t sub = float_bits(bits_float(abs) + 0.5f) - float_bits(0.5f);
+    r.bits = (uint16_t)(sign | sub);
+  } else {
+    uint32_t mant_odd = (abs >> 13) & 1;
+    abs += 0xc8000fff + mant_odd; // rebias from 127 to 15 and round
+    r.bits = (uint16_t)(sign | (abs >> 13));
+  }
+  return r;
+}
+
+void convert(const float *src, bf16 *dst, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    dst[i] = to_bf16(src[i]);
+}
+
+void convert(const float *src, fp16 *dst, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    dst[i] = to_fp16(src[i]);
+}
+
+void convert(const float *src, float *dst, size_t n) {
+  memcpy(dst, src, n * sizeof(float));
+}
+
+FloatIsa float_isa(FloatIsa requested) {
+#ifdef FLOAT_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2") &&
+                               __builtin_cpu_supports("fma") &&
+                               __builtin_cpu_supports("f16c");
+  static const bool has_avx512 = __builtin_cpu_supports("avx512f");
+  FloatIsa best = has_avx512 ? FISA_AVX512 : has_avx2 ? FISA_AVX2
+                                                      : FISA_SCALAR;
+#else
+  FloatIsa best = FISA_SCALAR;
+#endif
+  return (requested == FISA_AUTO || requested > best) ? best : requested;
+}
+
+const char *float_isa_name(FloatIsa isa) {
+  switch (isa) {
+  case FISA_SCALAR:
+    return "scalar";
+  case FISA_AVX2:
+    return "AVX2";
+  case FISA_AVX512:
+    return "AVX-512";
+  default:
+    return "auto";
+  }
+}
+
+// Columns [j_begin, j_end) of a row of C, k by k, from the widened row a of
+// A. ldb and ldc are the row lengths of B and C.
+template <typename T>
+static void scalar_cols(const float *a, const T *B, int ldb, float *c,
+                        int j_begin, int j_end, int K) {
+  for (int j = j_begin; j < j_end; j++)
+    c[j] = 0;
+  for (int k = 0; k < K; k++) {
+    const float a_val = a[k];
+    const T *b = B + (size_t)k * ldb;
+    for (int j = j_begin; j < j_end; j++)
+      c[j] += a_val * widen(b[j]);
+  }
+}
+
+#ifdef FLOAT_X86
+// The SIMD paths compute ROWS rows x ACCS vectors of columns of C per pass
+// over K with fused multiply-adds, so every vector of B loaded is used ROWS
+// times. B is widened as it is loaded, bf16 by a shift and fp16 with
+// vcvtph2ps, while A is widened beforehand and broadcast straight from
+// memory. They return the first column they did not compute.
+#define AVX2_TARGET __attribute__((target("avx2,fma,f16c")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+AVX2_TARGET static inline __m256 load8(const float *p) {
+  return _mm256_loadu_ps(p);
+}
+AVX2_TARGET static inline __m256 load8(const bf16 *p) {
+  return _mm256_castsi256_ps(_mm256_slli_epi32(
+      _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p)), 16));
+}
+AVX2_TARGET static inline __m256 load8(const fp16 *p) {
+  return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)p));
+}
+
+// GCC 12 reports the _mm512_undefined_* pass-through operands of the widening
+// intrinsics below as uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+AVX512_TARGET static inline __m512 load16(const float *p) {
+  return _mm512_loadu_ps(p);
+}
+AVX512_TARGET static inline __m512 load16(const bf16 *p) {
+  return _mm512_castsi512_ps(_mm512_slli_epi32(
+      _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)p)), 16));
+}
+AVX512_TARGET static inline __m512 load16(const fp16 *p) {
+  return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)p));
+}
+#pragma GCC diagnostic pop
+
+template <int ROWS, int ACCS, typename T>
+AVX2_TARGET static int avx2_cols(const float *a, const T *B, int ldb,
+                                 float *c, int ldc, int j, int j_end, int K) {
+  for (; j + 8 * ACCS <= j_end; j += 8 * ACCS) {
+    __m256 acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm256_setzero_ps();
+    for (int k = 0; k < K; k++) {
+      const T *b = B + (size_t)k * ldb + j;
+      __m256 b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = load8(b + 8 * t);
+      for (int r = 0; r < ROWS; r++) {
+        __m256 a_val = _mm256_broadcast_ss(a + (size_t)r * K + k);
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] = _mm256_fmadd_ps(a_val, b_val[t], acc[r][t]);
+      }
+    }
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        _mm256_storeu_ps(c + (size_t)r * ldc + j + 8 * t, acc[r][t]);
+  }
+  return j;
+}
+
+template <int ROWS, int ACCS, typename T>
+AVX512_TARGET static int avx512_cols(const float *a, const T *B, int ldb,
+                                     float *c, int ldc, int j, int j_end,
+                                     int K) {
+  for (; j + 16 * ACCS <= j_end; j += 16 * ACCS) {
+    __m512 acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm512_setzero_ps();
+    for (int k = 0; k < K; k++) {
+      const T *b = B + (size_t)k * ldb + j;
+      __m512 b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = load16(b + 16 * t);
+      for (int r = 0; r < ROWS; r++) {
+        __m512 a_val = _mm512_set1_ps(a[(size_t)r * K + k]);
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] = _mm512_fmadd_ps(a_val, b_val[t], acc[r][t]);
+      }
+    }
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        _mm512_storeu_ps(c + (size_t)r * ldc + j + 16 * t, acc[r][t]);
+  }
+  return j;
+}
+
+// Wide blocks of columns first, then single vectors
+template <int ROWS, typename T>
+static int simd_cols(const float *a, const T *B, int ldb, float *c, int ldc,
+                     int j_end, int K, FloatIsa isa) {
+  int j = 0;
+  if (isa == FISA_AVX512) {
+    j = avx512_cols<ROWS, 4>(a, B, ldb, c, ldc, j, j_end, K);
+    j = avx512_cols<ROWS, 1>(a, B, ldb, c, ldc, j, j_end, K);
+  } else if (isa == FISA_AVX2) {
+    j = avx2_cols<ROWS, 2>(a, B, ldb, c, ldc, j, j_end, K);
+    j = avx2_cols<ROWS, 1>(a, B, ldb, c, ldc, j, j_end, K);
+  }
+  return j;
+}
+#endif
+
+// Rows computed together by the SIMD paths
+static const int ROW_BLOCK = 4;
+
+// Columns of C computed for all rows of a block before moving on. Their
+// K x PANEL slice of B is copied to a contiguous buffer first, which then
+// stays in L2 across row blocks and is read sequentially instead of one
+// cache line from every row of B.
+static const int PANEL = 128;
+
+template <typename T>
+static void matmul_block(const T *A, const T *B, float *C, int row_begin,
+                         int row_end, int N, int K, FloatIsa isa) {
+  isa = float_isa(isa);
+  // A widened to fp32 once, for the broadcasts
+  std::vector<float> a((size_t)(row_end - row_begin) * K);
+  for (size_t k = 0; k < a.size(); k++)
+    a[k] = widen(A[(size_t)row_begin * K + k]);
+  std::vector<T> b((size_t)K * PANEL);
+
+  for (int panel = 0; panel < N; panel += PANEL) {
+    int width = (N - panel > PANEL) ? PANEL : N - panel;
+    for (int k = 0; k < K; k++)
+      memcpy(&b[(size_t)k * width], B + (size_t)k * N + panel,
+             width * sizeof(T));
+    for (int i = row_begin; i < row_end;) {
+      int rows = (row_end - i >= ROW_BLOCK) ? ROW_BLOCK : 1;
+      const float *a_rows = a.data() + (size_t)(i - row_begin) * K;
+      float *c = C + (size_t)i * N + panel;
+      int j = 0;
+#ifdef FLOAT_X86
+      j = (rows == ROW_BLOCK)
+              ? simd_cols<ROW_BLOCK>(a_rows, b.data(), width, c, N, width, K,
+                                     isa)
+              : simd_cols<1>(a_rows, b.data(), width, c, N, width, K, isa);
+#endif
+      // Columns left over by the SIMD paths, or all of them
+      for (int r = 0; r < rows; r++)
+        scalar_cols(a_rows + (size_t)r * K, b.data(), width,
+                    c + (size_t)r * N, j, width, K);
+      i += rows;
+    }
+  }
+}
+
+void float_matmul_block(const float *A, const float *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa) {
+  matmul_block(A, B, C, row_begin, row_end, N, K, isa);
+}
+
+void float_matmul_block(const bf16 *A, const bf16 *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa) {
+  matmul_block(A, B, C, row_begin, row_end, N, K, isa);
+}
+
+void float_matmul_block(const fp16 *A, const fp16 *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa) {
+  matmul_block(A, B, C, row_begin, row_end, N, K, isa);
+}
+
+// Maps the bits of a float to integers in the order of the values, so that
+// the difference of two of them is their distance in ULP
+static inline int64_t ordered(float x) {
+  uint32_t bits = float_bits(x);
+  return (bits & 0x80000000) ? -(int64_t)(bits & 0x7fffffff) : (int64_t)bits;
+}
+
+FloatError float_error(const float *gold, const float *out, size_t n) {
+  FloatError err = {0, 0, 0};
+  for (size_t i = 0; i < n; i++) {
+    double diff = std::fabs((double)out[i] - gold[i]);
+    double rel = (gold[i] != 0) ? diff / std::fabs(gold[i])
+                                : (diff != 0 || std::isnan(out[i]) ? INFINITY
+                                                                   : 0);
+    if (std::isnan(out[i]) != std::isnan(gold[i]))
+      rel = INFINITY;
+    int64_t ulp = ordered(out[i]) - ordered(gold[i]);
+    if (ulp < 0)
+      ulp = -ulp;
+    if (rel > err.max_rel || (i == 0 && rel > 0)) {
+      err.max_rel = rel;
+      err.worst = i;
+    }
+    if ((uint64_t)ulp > err.max_ulp)
+      err.max_ulp = ulp > 0xffffffff ? 0xffffffff : (uint32_t)ulp;
+  }
+  return err;
+}
+
+double float_tolerance(int K) { return 2.0 * K * std::ldexp(1.0, -24); }
+} // namespace gemm
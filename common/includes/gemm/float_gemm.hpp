@@ -0,0 +1,117 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <stdint.h>
+
+// Floating-point GEMM: fp32 operands, or bf16 and fp16 operands with fp32
+// accumulation, on row-major matrices as in cpu_gemm.hpp. Each column of C
+// is accumulated in k order in every path, so the paths only differ by the
+// rounding of fused against separate multiply-adds in fp32; bf16 and fp16
+// products are exact in fp32 and give identical results on every path.
+namespace gemm {
+
+// Raw bit patterns of the 16-bit types, the layout the *_bf16 and *_fp16
+// kernels read
+struct bf16 {
+  uint16_t bits;
+};
+struct fp16 {
+  uint16_t bits;
+};
+
+float to_float(bf16 x);
+float to_float(fp16 x);
+inline float to_float(float x) { return x; }
+
+// Round to nearest even, keeping subnormals. fp16 overflows to infinity.
+bf16 to_bf16(float x);
+fp16 to_fp16(float x);
+
+// Converts n floats, e.g. to build the operands of a reduced precision run
+void convert(const float *src, bf16 *dst, size_t n);
+void convert(const float *src, fp16 *dst, size_t n);
+void convert(const float *src, float *dst, size_t n);
+
+// Instruction sets of the CPU engine, picked as for quant_gemm.hpp. AVX2
+// also needs FMA and F16C.
+enum FloatIsa { FISA_AUTO, FISA_SCALAR, FISA_AVX2, FISA_AVX512 };
+
+FloatIsa float_isa(FloatIsa requested = FISA_AUTO);
+const char *float_isa_name(FloatIsa isa);
+
+// Computes rows [row_begin, row_end) of C = A * B on the calling thread only.
+void float_matmul_block(const float *A, const float *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa = FISA_AUTO);
+void float_matmul_block(const bf16 *A, const bf16 *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa = FISA_AUTO);
+void float_matmul_block(const fp16 *A, const fp16 *B, float *C,
+                        int row_begin, int row_end, int N, int K,
+                        FloatIsa isa = FISA_AUTO);
+
+// Computes the whole of C using the pool; T is float, bf16 or fp16.
+template <typename T>
+void float_matmul(const T *A, const T *B, float *C, int M, int N, int K,
+                  FloatIsa isa = FISA_AUTO,
+                  ThreadPool &pool = ThreadPool::global()) {
+  isa = float_isa(isa);
+  pool.parallel_for(0, M, 16, [=](int b, int e) {
+    float_matmul_block(A, B, C, b, e, N, K, isa);
+  });
+}
+
+// Largest errors of out against gold: relative error, and distance in units
+// in the last place of fp32. worst is the index of the largest relative
+// error.
+struct FloatError {
+  double max_rel;
+  uint32_t max_ulp;
+  size_t worst;
+};
+
+FloatError float_error(const float *gold, const float *out, size_t n);
+
+// Tolerance on the relative error of results accumulated over K terms in a
+// different order or with different fusing than gold. Each side of a K-term
+// fp32 sum of terms of one sign is within K * 2^-24 of the exact sum, so the
+// two are within 2 * K * 2^-24 of each other. Mixed signs can cancel and need
+// an absolute bound instead.
+double float_tolerance(int K);
+} // namespace gemm
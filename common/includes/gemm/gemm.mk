@@ -0,0 +1,4 @@
+gemm_SRCS:=${COMMON_REPO}/common/includes/gemm/thread_pool.cpp ${COMMON_REPO}/common/includes/gemm/cpu_gemm.cpp ${COMMON_REPO}/common/includes/gemm/coexec.cpp ${COMMON_REPO}/common/includes/gemm/tiled_gemm.cpp ${COMMON_REPO}/common/includes/gemm/autotune.cpp ${COMMON_REPO}/common/includes/gemm/strassen.cpp ${COMMON_REPO}/common/includes/gemm/quant_gemm.cpp ${COMMON_REPO}/common/includes/gemm/float_gemm.cpp ${COMMON_REPO}/common/includes/gemm/bitpack.cpp ${COMMON_REPO}/common/includes/gemm/sparse_gemm.cpp ${COMMON_REPO}/common/includes/gemm/semiring_gemm.cpp ${COMMON_REPO}/common/includes/gemm/gf2_gemm.cpp
+gemm_HDRS:=${COMMON_REPO}/common/includes/gemm/thread_pool.hpp ${COMMON_REPO}/common/includes/gemm/cpu_gemm.hpp ${COMMON_REPO}/common/includes/gemm/coexec.hpp ${COMMON_REPO}/common/includes/gemm/tiled_gemm.hpp ${COMMON_REPO}/common/includes/gemm/autotune.hpp ${COMMON_REPO}/common/includes/gemm/strassen.hpp ${COMMON_REPO}/common/includes/gemm/quant_gemm.hpp ${COMMON_REPO}/common/includes/gemm/float_gemm.hpp ${COMMON_REPO}/common/includes/gemm/bitpack.hpp ${COMMON_REPO}/common/includes/gemm/sparse_gemm.hpp ${COMMON_REPO}/common/includes/gemm/semiring_gemm.hpp ${COMMON_REPO}/common/includes/gemm/gf2_gemm.hpp ${COMMON_REPO}/common/includes/gemm/epilogue.hpp ${COMMON_REPO}/common/includes/gemm/epilogue_core.hpp
+gemm_CXXFLAGS:=-I${COMMON_REPO}/common/includes/gemm
+gemm_LDFLAGS:=-lpthread
@@ -0,0 +1,191 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "gf2_gemm.hpp"
+#include <algorithm>
+#include <cstring>
+
+// The SIMD paths are compiled with function target attributes and picked at
+// run time, as in quant_gemm.cpp
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GF2_X86
+#include <immintrin.h>
+#endif
+
+namespace gemm {
+
+// Rows of B per table, and the 2^8 rows of a table
+static const int GROUP_BITS = 8;
+static const int TABLE_ROWS = 1 << GROUP_BITS;
+// Words of C per pass, so a table is 32 KiB and stays in L1
+static const int WORD_BLOCK = 16;
+// Rows of C handed to one pool task; each task builds its own tables, so
+// this keeps the tables a small share of its work
+static const int ROW_GRAIN = 256;
+
+Gf2Isa gf2_isa(Gf2Isa requested) {
+#ifdef GF2_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  Gf2Isa best = has_avx2 ? GF2ISA_AVX2 : GF2ISA_SCALAR;
+#else
+  Gf2Isa best = GF2ISA_SCALAR;
+#endif
+  return (requested == GF2ISA_AUTO || requested > best) ? best : requested;
+}
+
+const char *gf2_isa_name(Gf2Isa isa) {
+  switch (isa) {
+  case GF2ISA_SCALAR:
+    return "scalar";
+  case GF2ISA_AVX2:
+    return "AVX2";
+  default:
+    return "auto";
+  }
+}
+
+// dst = a + b on n words, + being XOR or OR
+template <bool XOR> struct ScalarRows {
+  static void add(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+                  int n) {
+    for (int v = 0; v < n; v++)
+      dst[v] = XOR ? a[v] ^ b[v] : a[v] | b[v];
+  }
+};
+
+#ifdef GF2_X86
+template <bool XOR> struct Avx2Rows {
+  __attribute__((target("avx2"))) static void
+  add(uint64_t *dst, const uint64_t *a, const uint64_t *b, int n) {
+    int v = 0;
+    for (; v + 4 <= n; v += 4) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(a + v));
+      __m256i y = _mm256_loadu_si256((const __m256i *)(b + v));
+      _mm256_storeu_si256((__m256i *)(dst + v), XOR ? _mm256_xor_si256(x, y)
+                                                    : _mm256_or_si256(x, y));
+    }
+    for (; v < n; v++)
+      dst[v] = XOR ? a[v] ^ b[v] : a[v] | b[v];
+  }
+};
+#endif
+
+// Rows [row_begin, row_end) of C = A * B with the sums of Rows. Every group
+// of eight rows of B gives a table of its 256 sums, built in one sum per
+// entry from the entry without its lowest bit; a byte of a row of A is then
+// the index of the table row to add.
+template <typename Rows>
+static void m4r_rows(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                     int row_begin, int row_end) {
+  std::vector<uint64_t> table(TABLE_ROWS * WORD_BLOCK);
+  for (int w0 = 0; w0 < B.words; w0 += WORD_BLOCK) {
+    const int wn = std::min(WORD_BLOCK, B.words - w0);
+    for (int i = row_begin; i < row_end; i++)
+      memset(C.row(i) + w0, 0, wn * sizeof(uint64_t));
+    std::fill(table.begin(), table.begin() + WORD_BLOCK, 0);
+    for (int k0 = 0; k0 < A.cols; k0 += GROUP_BITS) {
+      const int entries = 1 << std::min(GROUP_BITS, A.cols - k0);
+      for (int x = 1; x < entries; x++)
+        Rows::add(&table[x * WORD_BLOCK], &table[(x & (x - 1)) * WORD_BLOCK],
+                  B.row(k0 + __builtin_ctz(x)) + w0, wn);
+      // Groups never straddle a word, 64 being a multiple of GROUP_BITS
+      const int word = k0 / 64, shift = k0 % 64;
+      for (int i = row_begin; i < row_end; i++) {
+        const int x = (int)(A.row(i)[word] >> shift) & (TABLE_ROWS - 1);
+        if (x) {
+          uint64_t *c = C.row(i) + w0;
+          Rows::add(c, c, &table[x * WORD_BLOCK], wn);
+        }
+      }
+    }
+  }
+}
+
+#ifdef GF2_X86
+// flatten inlines m4r_rows and the sums, so the loops are compiled for AVX2
+template <bool XOR>
+__attribute__((target("avx2"), flatten)) static void
+m4r_rows_avx2(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+              int row_begin, int row_end) {
+  m4r_rows<Avx2Rows<XOR> >(A, B, C, row_begin, row_end);
+}
+#endif
+
+template <bool XOR>
+static void m4r_matmul(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                       Gf2Isa isa, ThreadPool &pool) {
+  C = BitMatrix(A.rows, B.cols);
+  void (*rows)(const BitMatrix &, const BitMatrix &, BitMatrix &, int, int) =
+      m4r_rows<ScalarRows<XOR> >;
+#ifdef GF2_X86
+  if (gf2_isa(isa) == GF2ISA_AVX2)
+    rows = m4r_rows_avx2<XOR>;
+#endif
+  const BitMatrix *a = &A, *b = &B;
+  BitMatrix *c = &C;
+  pool.parallel_for(0, A.rows, ROW_GRAIN, [=](int begin, int end) {
+    rows(*a, *b, *c, begin, end);
+  });
+}
+
+void gf2_matmul(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                Gf2Isa isa, ThreadPool &pool) {
+  m4r_matmul<true>(A, B, C, isa, pool);
+}
+
+void bool_matmul_m4r(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                     Gf2Isa isa, ThreadPool &pool) {
+  m4r_matmul<false>(A, B, C, isa, pool);
+}
+
+void gf2_matmul_naive(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                      ThreadPool &pool) {
+  C = BitMatrix(A.rows, B.cols);
+  const BitMatrix *a = &A, *b = &B;
+  BitMatrix *c = &C;
+  pool.parallel_for(0, A.rows, ROW_GRAIN, [=](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      uint64_t *__restrict c_row = c->row(i);
+      const uint64_t *a_row = a->row(i);
+      for (int w = 0; w < a->words; w++)
+        for (uint64_t word = a_row[w]; word; word &= word - 1) {
+          const uint64_t *__restrict b_row =
+              b->row(w * 64 + __builtin_ctzll(word));
+          for (int v = 0; v < b->words; v++)
+            c_row[v] ^= b_row[v];
+        }
+    }
+  });
+}
+} // namespace gemm
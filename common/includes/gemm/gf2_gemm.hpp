@@ -0,0 +1,73 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#pragma once
+
+#include "semiring_gemm.hpp"
+#include "thread_pool.hpp"
+
+// Products of bit matrices (gemm::BitMatrix of semiring_gemm.hpp, 64
+// columns per word) by the Method of Four Russians: the rows of B are taken
+// eight at a time, the 256 sums of each group are tabled once, and every row
+// of A then adds one table row per byte instead of one row of B per set bit.
+//
+//   gf2_matmul       GF(2): sums are XOR, as for linear codes
+//   bool_matmul_m4r  boolean: sums are OR, as bool_matmul()
+//
+// Bits stay packed throughout, 1/32 of the memory and traffic of the same
+// matrix in int.
+namespace gemm {
+
+// Instruction sets of the table and row sums, picked as for
+// semiring_gemm.hpp
+enum Gf2Isa { GF2ISA_AUTO, GF2ISA_SCALAR, GF2ISA_AVX2 };
+
+Gf2Isa gf2_isa(Gf2Isa requested = GF2ISA_AUTO);
+const char *gf2_isa_name(Gf2Isa isa);
+
+// C = A * B over GF(2), A M x K and B K x N
+void gf2_matmul(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                Gf2Isa isa = GF2ISA_AUTO,
+                ThreadPool &pool = ThreadPool::global());
+
+// C = A * B over (OR, AND)
+void bool_matmul_m4r(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                     Gf2Isa isa = GF2ISA_AUTO,
+                     ThreadPool &pool = ThreadPool::global());
+
+// C = A * B over GF(2) by XORing the row of B of every set bit of A, the
+// reference for gf2_matmul()
+void gf2_matmul_naive(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                      ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
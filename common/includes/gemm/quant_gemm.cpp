@@ -0,0 +1,359 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "quant_gemm.hpp"
+#include <algorithm>
+
+// The SIMD paths are compiled with function target attributes and picked at
+// run time, so the rest of the build needs no -mavx2 or -march flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUANT_X86
+#include <immintrin.h>
+#endif
+
+namespace gemm {
+
+// Rows handed to one pool task
+static const int ROW_GRAIN = 16;
+
+bool quant_fits(const int *data, size_t n, QuantWidth width) {
+  const int hi = (1 << (width - 1)) - 1;
+  const int lo = -hi - 1;
+  for (size_t i = 0; i < n; i++)
+    if (data[i] < lo || data[i] > hi)
+      return false;
+  return true;
+}
+
+static inline uint32_t pack_lane(int value, int l, QuantWidth width) {
+  const int hi = (1 << (width - 1)) - 1;
+  value = std::min(std::max(value, -hi - 1), hi);
+  return ((uint32_t)value & ((1u << width) - 1)) << (width * l);
+}
+
+void quant_pack_rows(const int *A, uint32_t *packed, int M, int K,
+                     QuantWidth width) {
+  const int lanes = quant_lanes(width);
+  const int words = quant_words(K, width);
+  for (int i = 0; i < M; i++) {
+    const int *a = A + (size_t)i * K;
+    uint32_t *p = packed + (size_t)i * words;
+    for (int w = 0; w < words; w++) {
+      uint32_t word = 0;
+      for (int l = 0; l < lanes && w * lanes + l < K; l++)
+        word |= pack_lane(a[w * lanes + l], l, width);
+      p[w] = word;
+    }
+  }
+}
+
+void quant_pack_cols(const int *B, uint32_t *packed, int K, int N,
+                     QuantWidth width) {
+  const int lanes = quant_lanes(width);
+  const int words = quant_words(K, width);
+  for (int w = 0; w < words; w++) {
+    uint32_t *p = packed + (size_t)w * N;
+    for (int j = 0; j < N; j++)
+      p[j] = 0;
+    for (int l = 0; l < lanes && w * lanes + l < K; l++) {
+      const int *b = B + (size_t)(w * lanes + l) * N;
+      for (int j = 0; j < N; j++)
+        p[j] |= pack_lane(b[j], l, width);
+    }
+  }
+}
+
+QuantIsa quant_isa(QuantIsa requested) {
+#ifdef QUANT_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  static const bool has_vnni = __builtin_cpu_supports("avx512f") &&
+                               __builtin_cpu_supports("avx512vnni");
+  QuantIsa best = has_vnni ? QISA_AVX512_VNNI
+                           : has_avx2 ? QISA_AVX2 : QISA_SCALAR;
+#else
+  QuantIsa best = QISA_SCALAR;
+#endif
+  return (requested == QISA_AUTO || requested > best) ? best : requested;
+}
+
+const char *quant_isa_name(QuantIsa isa) {
+  switch (isa) {
+  case QISA_SCALAR:
+    return "scalar";
+  case QISA_AVX2:
+    return "AVX2";
+  case QISA_AVX512_VNNI:
+    return "AVX-512 VNNI";
+  default:
+    return "auto";
+  }
+}
+
+// Lane l of a packed word, sign-extended
+template <int WIDTH> static inline int lane_of(uint32_t word, int l) {
+  return WIDTH == 8 ? (int8_t)(word >> (8 * l)) : (int16_t)(word >> (16 * l));
+}
+
+// Columns [j_begin, N) of row a of C, one word of A at a time. Sums are
+// unsigned so that they wrap modulo 2^32 like the SIMD paths.
+template <int WIDTH>
+static void scalar_cols(const uint32_t *a, const uint32_t *B, int *c,
+                        int j_begin, int N, int words) {
+  const int lanes = 32 / WIDTH;
+  for (int j = j_begin; j < N; j++)
+    c[j] = 0;
+  for (int w = 0; w < words; w++) {
+    int a_val[4];
+    for (int l = 0; l < lanes; l++)
+      a_val[l] = lane_of<WIDTH>(a[w], l);
+    const uint32_t *b = B + (size_t)w * N;
+    for (int j = j_begin; j < N; j++) {
+      uint32_t sum = 0;
+      for (int l = 0; l < lanes; l++)
+        sum += (uint32_t)(a_val[l] * lane_of<WIDTH>(b[j], l));
+      c[j] = (int)((uint32_t)c[j] + sum);
+    }
+  }
+}
+
+#ifdef QUANT_X86
+// The SIMD paths compute ROWS rows x ACCS vectors of columns of C per pass
+// over K, so every vector of B loaded is used ROWS times. They return the
+// first column they did not compute.
+
+// AVX2, int16: vpmaddwd multiplies the two int16 of a word of A with those
+// of 8 words of B and adds the pairs, i.e. 8 columns x 2 k per instruction.
+template <int ROWS, int ACCS>
+__attribute__((target("avx2"))) static int
+avx2_int16_cols(const uint32_t *a, const uint32_t *B, int *c, int j, int N,
+                int words) {
+  for (; j + 8 * ACCS <= N; j += 8 * ACCS) {
+    __m256i acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm256_setzero_si256();
+    for (int w = 0; w < words; w++) {
+      const uint32_t *b = B + (size_t)w * N + j;
+      __m256i b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = _mm256_loadu_si256((const __m256i *)(b + 8 * t));
+      for (int r = 0; r < ROWS; r++) {
+        __m256i a_val = _mm256_set1_epi32((int)a[(size_t)r * words + w]);
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] =
+              _mm256_add_epi32(acc[r][t], _mm256_madd_epi16(a_val, b_val[t]));
+      }
+    }
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        _mm256_storeu_si256((__m256i *)(c + (size_t)r * N + j + 8 * t),
+                            acc[r][t]);
+  }
+  return j;
+}
+
+// AVX2, int8. vpmaddubsw would take the bytes directly but saturates its
+// int16 pair sums for full-range operands, so 4 words of B are sign-extended
+// to int16 and multiplied with vpmaddwd instead. That leaves two partial sums
+// per column, which are added once at the end of K. Each accumulator covers
+// 4 columns, ACCS is even.
+template <int ROWS, int ACCS>
+__attribute__((target("avx2"))) static int
+avx2_int8_cols(const uint32_t *a, const uint32_t *B, int *c, int j, int N,
+               int words) {
+  for (; j + 4 * ACCS <= N; j += 4 * ACCS) {
+    __m256i acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm256_setzero_si256();
+    for (int w = 0; w < words; w++) {
+      const uint32_t *b = B + (size_t)w * N + j;
+      __m256i b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128((const __m128i *)(b + 4 * t)));
+      for (int r = 0; r < ROWS; r++) {
+        // a0 a1 a2 a3 as int16, four times
+        __m256i a_val = _mm256_cvtepi8_epi16(
+            _mm_set1_epi32((int)a[(size_t)r * words + w]));
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] =
+              _mm256_add_epi32(acc[r][t], _mm256_madd_epi16(a_val, b_val[t]));
+      }
+    }
+    // Pairs of partial sums to columns: hadd leaves 128-bit lanes of
+    // c0 c1 c4 c5 | c2 c3 c6 c7, the permute restores the order
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t += 2)
+        _mm256_storeu_si256(
+            (__m256i *)(c + (size_t)r * N + j + 4 * t),
+            _mm256_permute4x64_epi64(
+                _mm256_hadd_epi32(acc[r][t], acc[r][t + 1]),
+                _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  return j;
+}
+
+// AVX-512 VNNI, int16: vpdpwssd multiplies and accumulates in one
+// instruction, 16 columns x 2 k.
+template <int ROWS, int ACCS>
+__attribute__((target("avx512f,avx512vnni"))) static int
+vnni_int16_cols(const uint32_t *a, const uint32_t *B, int *c, int j, int N,
+                int words) {
+  for (; j + 16 * ACCS <= N; j += 16 * ACCS) {
+    __m512i acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm512_setzero_si512();
+    for (int w = 0; w < words; w++) {
+      const uint32_t *b = B + (size_t)w * N + j;
+      __m512i b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = _mm512_loadu_si512(b + 16 * t);
+      for (int r = 0; r < ROWS; r++) {
+        __m512i a_val = _mm512_set1_epi32((int)a[(size_t)r * words + w]);
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] = _mm512_dpwssd_epi32(acc[r][t], a_val, b_val[t]);
+      }
+    }
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        _mm512_storeu_si512(c + (size_t)r * N + j + 16 * t, acc[r][t]);
+  }
+  return j;
+}
+
+// AVX-512 VNNI, int8: vpdpbusd multiplies unsigned with signed bytes,
+// 16 columns x 4 k. B is made unsigned by flipping its sign bits, i.e.
+// adding 128, and 128 times the sum of the row of A is subtracted at the
+// end. Products and sums are exact in int32, there is no saturation.
+template <int ROWS, int ACCS>
+__attribute__((target("avx512f,avx512vnni"))) static int
+vnni_int8_cols(const uint32_t *a, const uint32_t *B, int *c, int j, int N,
+               int words) {
+  const __m512i sign = _mm512_set1_epi8((char)0x80);
+  __m512i offset[ROWS];
+  for (int r = 0; r < ROWS; r++) {
+    uint32_t a_sum = 0;
+    for (int w = 0; w < words; w++)
+      for (int l = 0; l < 4; l++)
+        a_sum += lane_of<8>(a[(size_t)r * words + w], l);
+    offset[r] = _mm512_set1_epi32((int)(128u * a_sum));
+  }
+  for (; j + 16 * ACCS <= N; j += 16 * ACCS) {
+    __m512i acc[ROWS][ACCS];
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        acc[r][t] = _mm512_setzero_si512();
+    for (int w = 0; w < words; w++) {
+      const uint32_t *b = B + (size_t)w * N + j;
+      __m512i b_val[ACCS];
+      for (int t = 0; t < ACCS; t++)
+        b_val[t] = _mm512_xor_si512(_mm512_loadu_si512(b + 16 * t), sign);
+      for (int r = 0; r < ROWS; r++) {
+        __m512i a_val = _mm512_set1_epi32((int)a[(size_t)r * words + w]);
+        for (int t = 0; t < ACCS; t++)
+          acc[r][t] = _mm512_dpbusd_epi32(acc[r][t], b_val[t], a_val);
+      }
+    }
+    for (int r = 0; r < ROWS; r++)
+      for (int t = 0; t < ACCS; t++)
+        _mm512_storeu_si512(c + (size_t)r * N + j + 16 * t,
+                            _mm512_sub_epi32(acc[r][t], offset[r]));
+  }
+  return j;
+}
+
+// Wide blocks of columns first, then single vectors (pairs for AVX2 int8)
+template <int ROWS>
+static int simd_cols(const uint32_t *a, const uint32_t *B, int *c, int N,
+                     int words, QuantWidth width, QuantIsa isa) {
+  int j = 0;
+  if (isa == QISA_AVX512_VNNI && width == QUANT_INT8) {
+    j = vnni_int8_cols<ROWS, 4>(a, B, c, j, N, words);
+    j = vnni_int8_cols<ROWS, 1>(a, B, c, j, N, words);
+  } else if (isa == QISA_AVX512_VNNI) {
+    j = vnni_int16_cols<ROWS, 4>(a, B, c, j, N, words);
+    j = vnni_int16_cols<ROWS, 1>(a, B, c, j, N, words);
+  } else if (isa == QISA_AVX2 && width == QUANT_INT8) {
+    j = avx2_int8_cols<ROWS, 2>(a, B, c, j, N, words);
+  } else if (isa == QISA_AVX2) {
+    j = avx2_int16_cols<ROWS, 2>(a, B, c, j, N, words);
+    j = avx2_int16_cols<ROWS, 1>(a, B, c, j, N, words);
+  }
+  return j;
+}
+#endif
+
+// Rows computed together by the SIMD paths
+static const int ROW_BLOCK = 4;
+
+void quant_matmul_block(const uint32_t *A, const uint32_t *B, int *C,
+                        int row_begin, int row_end, int N, int K,
+                        QuantWidth width, QuantIsa isa) {
+  const int words = quant_words(K, width);
+  isa = quant_isa(isa);
+  for (int i = row_begin; i < row_end;) {
+    int rows = (row_end - i >= ROW_BLOCK) ? ROW_BLOCK : 1;
+    const uint32_t *a = A + (size_t)i * words;
+    int *c = C + (size_t)i * N;
+    int j = 0;
+#ifdef QUANT_X86
+    j = (rows == ROW_BLOCK)
+            ? simd_cols<ROW_BLOCK>(a, B, c, N, words, width, isa)
+            : simd_cols<1>(a, B, c, N, words, width, isa);
+#endif
+    // Columns left over by the SIMD paths, or all of them
+    for (int r = 0; r < rows; r++) {
+      if (width == QUANT_INT8)
+        scalar_cols<8>(a + (size_t)r * words, B, c + (size_t)r * N, j, N,
+                       words);
+      else
+        scalar_cols<16>(a + (size_t)r * words, B, c + (size_t)r * N, j, N,
+                        words);
+    }
+    i += rows;
+  }
+}
+
+void quant_matmul_rows(const uint32_t *A, const uint32_t *B, int *C,
+                       int row_begin, int row_end, int N, int K,
+                       QuantWidth width, QuantIsa isa, ThreadPool &pool) {
+  isa = quant_isa(isa);
+  pool.parallel_for(row_begin, row_end, ROW_GRAIN, [=](int b, int e) {
+    quant_matmul_block(A, B, C, b, e, N, K, width, isa);
+  });
+}
+} // namespace gemm
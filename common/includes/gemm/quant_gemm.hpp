@@ -0,0 +1,104 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <stdint.h>
+
+// Quantized GEMM: int8 or int16 operands, int32 accumulation. Operands are
+// packed along K into 32-bit words, four int8 or two int16 per word with the
+// lowest k in the lowest bits, which is also the layout the *_int8 and
+// *_int16 kernels read. K is padded with zeros to a whole word.
+//
+// A (M x K) is packed by rows: word w of row i holds A[i][k], k = L*w ..
+// L*w + L-1 for L operands per word. B (K x N) is packed by columns: word
+// (w, j) holds B[k][j] for the same k. A transposed B, as lmult takes it, is
+// packed by rows like A. The result equals the int32 product of the unpacked
+// operands bit for bit.
+namespace gemm {
+
+enum QuantWidth { QUANT_INT8 = 8, QUANT_INT16 = 16 };
+
+// Instruction sets of the CPU engine. QISA_AUTO picks the best one the CPU
+// supports; the others force a path, e.g. to compare them.
+enum QuantIsa { QISA_AUTO, QISA_SCALAR, QISA_AVX2, QISA_AVX512_VNNI };
+
+// Operands per packed word
+inline int quant_lanes(QuantWidth width) { return 32 / width; }
+
+// Words per packed row or column of K operands
+inline int quant_words(int K, QuantWidth width) {
+  return (K + quant_lanes(width) - 1) / quant_lanes(width);
+}
+
+// Whether all n values fit the operand range of width
+bool quant_fits(const int *data, size_t n, QuantWidth width);
+
+// Packs the row-major M x K matrix A into M x quant_words(K) words. Values
+// outside the operand range are saturated; check them with quant_fits().
+void quant_pack_rows(const int *A, uint32_t *packed, int M, int K,
+                     QuantWidth width);
+
+// Packs the row-major K x N matrix B into quant_words(K) x N words.
+void quant_pack_cols(const int *B, uint32_t *packed, int K, int N,
+                     QuantWidth width);
+
+// Resolves QISA_AUTO, and a forced path the CPU can not run, to the best
+// supported one
+QuantIsa quant_isa(QuantIsa requested = QISA_AUTO);
+const char *quant_isa_name(QuantIsa isa);
+
+// Computes rows [row_begin, row_end) of C = A * B on the calling thread
+// only, from A packed by rows and B packed by columns.
+void quant_matmul_block(const uint32_t *A, const uint32_t *B, int *C,
+                        int row_begin, int row_end, int N, int K,
+                        QuantWidth width, QuantIsa isa = QISA_AUTO);
+
+// Computes rows [row_begin, row_end) of C using the pool.
+void quant_matmul_rows(const uint32_t *A, const uint32_t *B, int *C,
+                       int row_begin, int row_end, int N, int K,
+                       QuantWidth width, QuantIsa isa = QISA_AUTO,
+                       ThreadPool &pool = ThreadPool::global());
+
+// Computes the whole of C using the pool.
+inline void quant_matmul(const uint32_t *A, const uint32_t *B, int *C, int M,
+                         int N, int K, QuantWidth width,
+                         QuantIsa isa = QISA_AUTO,
+                         ThreadPool &pool = ThreadPool::global()) {
+  quant_matmul_rows(A, B, C, 0, M, N, K, width, isa, pool);
+}
+} // namespace gemm
@@ -0,0 +1,293 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "semiring_gemm.hpp"
+#include <cstring>
+
+// The SIMD paths are compiled with function target attributes and picked at
+// run time, as in quant_gemm.cpp
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEMIRING_X86
+#include <immintrin.h>
+#endif
+
+namespace gemm {
+
+// Rows of bit matrices handed to one pool task
+static const int BIT_ROW_GRAIN = 64;
+
+SemiringIsa semiring_isa(SemiringIsa requested) {
+#ifdef SEMIRING_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  SemiringIsa best = has_avx2 ? SRISA_AVX2 : SRISA_SCALAR;
+#else
+  SemiringIsa best = SRISA_SCALAR;
+#endif
+  return (requested == SRISA_AUTO || requested > best) ? best : requested;
+}
+
+const char *semiring_isa_name(SemiringIsa isa) {
+  switch (isa) {
+  case SRISA_SCALAR:
+    return "scalar";
+  case SRISA_AVX2:
+    return "AVX2";
+  default:
+    return "auto";
+  }
+}
+
+#ifdef SEMIRING_X86
+// Min-plus (MIN) or max-plus product of rows [row_begin, row_end), blocked
+// as the scalar template. A terms equal to zero are skipped; B terms equal
+// to zero are blended back to zero after the add, so they never turn into a
+// finite sum. Sums that overflow, which can only do so towards the sign of
+// the broadcast A term, are blended to the sentinel of that sign, and the
+// max with -SEMIRING_INF takes INT_MIN to it, as semiring_add_sat() does.
+template <bool MIN>
+__attribute__((target("avx2"))) static void
+plus_block_avx2(const int *A, const int *B, int *C, int row_begin,
+                int row_end, int N, int K) {
+  const int zero = MIN ? SEMIRING_INF : -SEMIRING_INF;
+  const __m256i vzero = _mm256_set1_epi32(zero);
+  const __m256i vlow = _mm256_set1_epi32(-SEMIRING_INF);
+  for (int i = row_begin; i < row_end; i++)
+    std::fill(C + (size_t)i * N, C + (size_t)(i + 1) * N, zero);
+
+  for (int jj = 0; jj < N; jj += detail::SEMIRING_N_BLOCK) {
+    int j_end = std::min(N, jj + detail::SEMIRING_N_BLOCK);
+    for (int kk = 0; kk < K; kk += detail::SEMIRING_K_BLOCK) {
+      int k_end = std::min(K, kk + detail::SEMIRING_K_BLOCK);
+      for (int i = row_begin; i < row_end; i++) {
+        int *c = C + (size_t)i * N;
+        const int *a = A + (size_t)i * K;
+        for (int k = kk; k < k_end; k++) {
+          const int a_val = a[k];
+          if (a_val == zero)
+            continue;
+          const __m256i va = _mm256_set1_epi32(a_val);
+          const __m256i vsat =
+              _mm256_set1_epi32(a_val < 0 ? -SEMIRING_INF : SEMIRING_INF);
+          const int *b = B + (size_t)k * N;
+          int j = jj;
+          for (; j + 8 <= j_end; j += 8) {
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + j));
+            __m256i vc = _mm256_loadu_si256((const __m256i *)(c + j));
+            __m256i sum = _mm256_add_epi32(va, vb);
+            // Sign bit set where va and vb agree in sign and sum does not
+            __m256i over = _mm256_and_si256(_mm256_xor_si256(va, sum),
+                                            _mm256_xor_si256(vb, sum));
+            sum = _mm256_blendv_epi8(sum, vsat, _mm256_srai_epi32(over, 31));
+            sum = _mm256_max_epi32(sum, vlow);
+            sum = _mm256_blendv_epi8(sum, vzero,
+                                     _mm256_cmpeq_epi32(vb, vzero));
+            vc = MIN ? _mm256_min_epi32(vc, sum) : _mm256_max_epi32(vc, sum);
+            _mm256_storeu_si256((__m256i *)(c + j), vc);
+          }
+          for (; j < j_end; j++) {
+            int sum = (b[j] == zero) ? zero : semiring_add_sat(a_val, b[j]);
+            c[j] = MIN ? std::min(c[j], sum) : std::max(c[j], sum);
+          }
+        }
+      }
+    }
+  }
+}
+#endif
+
+namespace detail {
+bool semiring_simd_block(MinPlus, const int *A, const int *B, int *C,
+                         int row_begin, int row_end, int N, int K) {
+#ifdef SEMIRING_X86
+  plus_block_avx2<true>(A, B, C, row_begin, row_end, N, K);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool semiring_simd_block(MaxPlus, const int *A, const int *B, int *C,
+                         int row_begin, int row_end, int N, int K) {
+#ifdef SEMIRING_X86
+  plus_block_avx2<false>(A, B, C, row_begin, row_end, N, K);
+  return true;
+#else
+  return false;
+#endif
+}
+} // namespace detail
+
+BitMatrix bit_from_dense(const int *A, int M, int K) {
+  BitMatrix bits(M, K);
+  for (int i = 0; i < M; i++)
+    for (int k = 0; k < K; k++)
+      if (A[(size_t)i * K + k])
+        bits.set(i, k);
+  return bits;
+}
+
+void bit_to_dense(const BitMatrix &A, int *out) {
+  for (int i = 0; i < A.rows; i++)
+    for (int j = 0; j < A.cols; j++)
+      out[(size_t)i * A.cols + j] = A.get(i, j);
+}
+
+BitMatrix bit_transpose(const BitMatrix &A) {
+  BitMatrix T(A.cols, A.rows);
+  for (int i = 0; i < A.rows; i++) {
+    const uint64_t *row = A.row(i);
+    for (int w = 0; w < A.words; w++)
+      for (uint64_t word = row[w]; word; word &= word - 1)
+        T.set(w * 64 + __builtin_ctzll(word), i);
+  }
+  return T;
+}
+
+void bool_matmul(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                 ThreadPool &pool) {
+  C = BitMatrix(A.rows, B.cols);
+  const BitMatrix *a = &A, *b = &B;
+  BitMatrix *c = &C;
+  pool.parallel_for(0, A.rows, BIT_ROW_GRAIN, [=](int begin, int end) {
+    const int words = b->words;
+    for (int i = begin; i < end; i++) {
+      uint64_t *__restrict c_row = c->row(i);
+      const uint64_t *a_row = a->row(i);
+      for (int w = 0; w < a->words; w++) {
+        for (uint64_t word = a_row[w]; word; word &= word - 1) {
+          const uint64_t *__restrict b_row =
+              b->row(w * 64 + __builtin_ctzll(word));
+          for (int v = 0; v < words; v++)
+            c_row[v] |= b_row[v];
+        }
+      }
+    }
+  });
+}
+
+// Rows [begin, end) of bool_matmul_count()
+static void count_rows(const BitMatrix &A, const BitMatrix &BT, int *C,
+                       int begin, int end) {
+  const int words = A.words;
+  for (int i = begin; i < end; i++) {
+    const uint64_t *a_row = A.row(i);
+    int *c = C + (size_t)i * BT.rows;
+    for (int j = 0; j < BT.rows; j++) {
+      const uint64_t *b_row = BT.row(j);
+      int count = 0;
+      for (int w = 0; w < words; w++)
+        count += __builtin_popcountll(a_row[w] & b_row[w]);
+      c[j] = count;
+    }
+  }
+}
+
+#if defined(SEMIRING_X86) && defined(__x86_64__)
+// The same with the popcnt instruction instead of the bit tricks the
+// builtin falls back to without it
+__attribute__((target("popcnt"))) static void
+count_rows_popcnt(const BitMatrix &A, const BitMatrix &BT, int *C, int begin,
+                  int end) {
+  const int words = A.words;
+  for (int i = begin; i < end; i++) {
+    const uint64_t *a_row = A.row(i);
+    int *c = C + (size_t)i * BT.rows;
+    for (int j = 0; j < BT.rows; j++) {
+      const uint64_t *b_row = BT.row(j);
+      int count = 0;
+      for (int w = 0; w < words; w++)
+        count += (int)_mm_popcnt_u64(a_row[w] & b_row[w]);
+      c[j] = count;
+    }
+  }
+}
+#endif
+
+void bool_matmul_count(const BitMatrix &A, const BitMatrix &BT, int *C,
+                       ThreadPool &pool) {
+  void (*rows)(const BitMatrix &, const BitMatrix &, int *, int, int) =
+      count_rows;
+#if defined(SEMIRING_X86) && defined(__x86_64__)
+  if (__builtin_cpu_supports("popcnt"))
+    rows = count_rows_popcnt;
+#endif
+  const BitMatrix *a = &A, *bt = &BT;
+  pool.parallel_for(0, A.rows, BIT_ROW_GRAIN, [=](int begin, int end) {
+    rows(*a, *bt, C, begin, end);
+  });
+}
+
+int apsp_min_plus(const int *W, int *D, int n, const MinPlusProduct &product) {
+  size_t elements = (size_t)n * n;
+  std::vector<int> next(elements);
+  memcpy(D, W, elements * sizeof(int));
+  for (int i = 0; i < n; i++)
+    D[(size_t)i * n + i] = std::min(D[(size_t)i * n + i], 0);
+  int squarings = 0;
+  // Paths of up to 2^s edges are covered after s squarings
+  for (long long covered = 1; covered < n - 1; covered *= 2) {
+    product(D, D, next.data(), n);
+    squarings++;
+    if (memcmp(D, next.data(), elements * sizeof(int)) == 0)
+      break;
+    memcpy(D, next.data(), elements * sizeof(int));
+  }
+  return squarings;
+}
+
+int apsp_min_plus(const int *W, int *D, int n, SemiringIsa isa,
+                  ThreadPool &pool) {
+  return apsp_min_plus(W, D, n, [&](const int *a, const int *b, int *c,
+                                    int size) {
+    semiring_matmul<MinPlus>(a, b, c, size, size, size, isa, pool);
+  });
+}
+
+int transitive_closure(const BitMatrix &A, BitMatrix &R, ThreadPool &pool) {
+  R = A;
+  for (int i = 0; i < R.rows; i++)
+    R.set(i, i);
+  int squarings = 0;
+  BitMatrix next;
+  for (long long covered = 1; covered < R.rows - 1; covered *= 2) {
+    bool_matmul(R, R, next, pool);
+    squarings++;
+    if (next.bits == R.bits)
+      break;
+    R.bits.swap(next.bits);
+  }
+  return squarings;
+}
+} // namespace gemm
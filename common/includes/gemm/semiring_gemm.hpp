@@ -0,0 +1,219 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+// GEMM over a semiring: C[i][j] = add over k of mul(A[i][k], B[k][j]), on
+// row-major int32 matrices, A M x K, B K x N and C M x N. The semiring is a
+// type with static zero(), add() and mul(); zero() is the identity of add()
+// and absorbs mul(), so terms with a zero A are skipped.
+//
+//   PlusTimes  ordinary GEMM
+//   MinPlus    shortest paths: add is min, mul is +, zero is SEMIRING_INF
+//   MaxPlus    longest/critical paths: add is max, zero is -SEMIRING_INF
+//
+// In MinPlus and MaxPlus the zero stands for "no path" and stays so under
+// mul. Finite sums saturate at +-SEMIRING_INF instead of wrapping, so a path
+// too long for int reads as no path in MinPlus (and as no path in MaxPlus
+// when too negative). MinPlus and MaxPlus have AVX2 paths picked at run
+// time, other semirings use the scalar template.
+//
+// Boolean (OR, AND) products work on bit matrices, 64 columns per word.
+namespace gemm {
+
+const int SEMIRING_INF = INT_MAX;
+
+// a + b saturated to [-SEMIRING_INF, SEMIRING_INF]
+inline int semiring_add_sat(int a, int b) {
+  long long sum = (long long)a + b;
+  return (sum > SEMIRING_INF) ? SEMIRING_INF
+         : (sum < -SEMIRING_INF) ? -SEMIRING_INF
+                                 : (int)sum;
+}
+
+struct PlusTimes {
+  static int zero() { return 0; }
+  static int add(int a, int b) { return a + b; }
+  static int mul(int a, int b) { return a * b; }
+};
+
+struct MinPlus {
+  static int zero() { return SEMIRING_INF; }
+  static int add(int a, int b) { return a < b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == SEMIRING_INF || b == SEMIRING_INF) ? SEMIRING_INF
+                                                    : semiring_add_sat(a, b);
+  }
+};
+
+struct MaxPlus {
+  static int zero() { return -SEMIRING_INF; }
+  static int add(int a, int b) { return a > b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == -SEMIRING_INF || b == -SEMIRING_INF) ? -SEMIRING_INF
+                                                      : semiring_add_sat(a, b);
+  }
+};
+
+// Instruction sets of the engine. SRISA_AUTO picks the best one the CPU
+// supports; the others force a path, e.g. to compare them.
+enum SemiringIsa { SRISA_AUTO, SRISA_SCALAR, SRISA_AVX2 };
+
+// Resolves SRISA_AUTO, and a forced path the CPU can not run, to the best
+// supported one
+SemiringIsa semiring_isa(SemiringIsa requested = SRISA_AUTO);
+const char *semiring_isa_name(SemiringIsa isa);
+
+namespace detail {
+// Same blocking as the CPU engine of cpu_gemm.cpp
+const int SEMIRING_K_BLOCK = 128;
+const int SEMIRING_N_BLOCK = 512;
+const int SEMIRING_ROW_GRAIN = 16;
+
+// SIMD paths; the template is taken for semirings without one and returns
+// false
+template <typename S>
+bool semiring_simd_block(S, const int *, const int *, int *, int, int, int,
+                         int) {
+  return false;
+}
+bool semiring_simd_block(MinPlus, const int *A, const int *B, int *C,
+                         int row_begin, int row_end, int N, int K);
+bool semiring_simd_block(MaxPlus, const int *A, const int *B, int *C,
+                         int row_begin, int row_end, int N, int K);
+} // namespace detail
+
+// Computes rows [row_begin, row_end) of C on the calling thread only.
+template <typename S>
+void semiring_matmul_block(const int *A, const int *B, int *C, int row_begin,
+                           int row_end, int N, int K,
+                           SemiringIsa isa = SRISA_AUTO) {
+  if (semiring_isa(isa) == SRISA_AVX2 &&
+      detail::semiring_simd_block(S(), A, B, C, row_begin, row_end, N, K))
+    return;
+  const int zero = S::zero();
+  for (int i = row_begin; i < row_end; i++)
+    std::fill(C + (size_t)i * N, C + (size_t)(i + 1) * N, zero);
+
+  for (int jj = 0; jj < N; jj += detail::SEMIRING_N_BLOCK) {
+    int j_end = std::min(N, jj + detail::SEMIRING_N_BLOCK);
+    for (int kk = 0; kk < K; kk += detail::SEMIRING_K_BLOCK) {
+      int k_end = std::min(K, kk + detail::SEMIRING_K_BLOCK);
+      for (int i = row_begin; i < row_end; i++) {
+        int *__restrict c = C + (size_t)i * N;
+        const int *a = A + (size_t)i * K;
+        for (int k = kk; k < k_end; k++) {
+          const int a_val = a[k];
+          if (a_val == zero)
+            continue;
+          const int *__restrict b = B + (size_t)k * N;
+          for (int j = jj; j < j_end; j++)
+            c[j] = S::add(c[j], S::mul(a_val, b[j]));
+        }
+      }
+    }
+  }
+}
+
+// Computes the whole of C using the pool.
+template <typename S>
+void semiring_matmul(const int *A, const int *B, int *C, int M, int N, int K,
+                     SemiringIsa isa = SRISA_AUTO,
+                     ThreadPool &pool = ThreadPool::global()) {
+  pool.parallel_for(0, M, detail::SEMIRING_ROW_GRAIN, [=](int b, int e) {
+    semiring_matmul_block<S>(A, B, C, b, e, N, K, isa);
+  });
+}
+
+// Bit matrix, row-major, 64 columns per word with column 0 in the lowest
+// bit of word 0 of each row. Bits past cols are zero.
+struct BitMatrix {
+  int rows, cols, words;
+  std::vector<uint64_t> bits;
+
+  BitMatrix(int rows_ = 0, int cols_ = 0)
+      : rows(rows_), cols(cols_), words((cols_ + 63) / 64),
+        bits((size_t)rows_ * words, 0) {}
+
+  uint64_t *row(int i) { return bits.data() + (size_t)i * words; }
+  const uint64_t *row(int i) const { return bits.data() + (size_t)i * words; }
+  bool get(int i, int j) const { return (row(i)[j / 64] >> (j % 64)) & 1; }
+  void set(int i, int j) { row(i)[j / 64] |= (uint64_t)1 << (j % 64); }
+};
+
+// Nonzero elements of the row-major M x K matrix A become set bits
+BitMatrix bit_from_dense(const int *A, int M, int K);
+// Set bits become 1, the others 0
+void bit_to_dense(const BitMatrix &A, int *out);
+BitMatrix bit_transpose(const BitMatrix &A);
+
+// C = A * B over (OR, AND): row i of C is the OR of the rows k of B for the
+// set bits k of row i of A, 64 columns per operation.
+void bool_matmul(const BitMatrix &A, const BitMatrix &B, BitMatrix &C,
+                 ThreadPool &pool = ThreadPool::global());
+
+// C[i][j] = number of k with A[i][k] and B[k][j], the popcount of row i of
+// A AND row j of BT, B transposed. C is row-major A.rows x BT.rows.
+void bool_matmul_count(const BitMatrix &A, const BitMatrix &BT, int *C,
+                       ThreadPool &pool = ThreadPool::global());
+
+// n x n min-plus product, e.g. a kernel: c = a * b
+typedef std::function<void(const int *a, const int *b, int *c, int n)>
+    MinPlusProduct;
+
+// All-pairs shortest paths by repeated min-plus squaring. W is the n x n
+// edge weight matrix, SEMIRING_INF where there is no edge; D receives the
+// path lengths, 0 on the diagonal. Squaring doubles the path length
+// covered, so at most ceil(log2(n - 1)) squarings are needed; it stops as
+// soon as D no longer changes. Negative weights are allowed as long as
+// there is no negative cycle. Returns the number of squarings.
+int apsp_min_plus(const int *W, int *D, int n, const MinPlusProduct &product);
+// Same with semiring_matmul<MinPlus>
+int apsp_min_plus(const int *W, int *D, int n, SemiringIsa isa = SRISA_AUTO,
+                  ThreadPool &pool = ThreadPool::global());
+
+// Reflexive transitive closure (reachability) by repeated boolean
+// squaring, as apsp_min_plus(). Returns the number of squarings.
+int transitive_closure(const BitMatrix &A, BitMatrix &R,
+                       ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
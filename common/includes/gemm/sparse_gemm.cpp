@@ -0,0 +1,233 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "sparse_gemm.hpp"
+#include "cpu_gemm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace gemm {
+
+// Ranges per thread of csr_matmul(), so that a range that turns out slower
+// than its estimate does not hold up the others
+static const int PARTS_PER_THREAD = 4;
+
+// Runs per path and density of sparse_calibrate(), the fastest one counting
+static const int CALIBRATE_REPEATS = 3;
+
+double density(const int *data, size_t n) {
+  if (n == 0)
+    return 0;
+  size_t nonzero = 0;
+  for (size_t i = 0; i < n; i++)
+    nonzero += (data[i] != 0);
+  return (double)nonzero / n;
+}
+
+// Counting pass of the conversion: sets csr.row_ptr from the nonzeros of
+// each row of A. Gives up, returning false, once more than limit are seen.
+static bool csr_count(const int *A, int M, int K, size_t limit,
+                      CsrMatrix &csr) {
+  csr.rows = M;
+  csr.cols = K;
+  csr.row_ptr.resize(M + 1);
+  csr.row_ptr[0] = 0;
+  size_t nonzero = 0;
+  for (int i = 0; i < M; i++) {
+    const int *a = A + (size_t)i * K;
+    for (int k = 0; k < K; k++)
+      nonzero += (a[k] != 0);
+    if (nonzero > limit)
+      return false;
+    csr.row_ptr[i + 1] = (int)nonzero;
+  }
+  return true;
+}
+
+// Filling pass: writes the nonzeros of A at the offsets of csr.row_ptr
+static void csr_fill(const int *A, CsrMatrix &csr) {
+  csr.col_idx.resize(csr.row_ptr[csr.rows]);
+  csr.values.resize(csr.row_ptr[csr.rows]);
+  for (int i = 0; i < csr.rows; i++) {
+    const int *a = A + (size_t)i * csr.cols;
+    int p = csr.row_ptr[i];
+    for (int k = 0; k < csr.cols; k++) {
+      if (a[k]) {
+        csr.col_idx[p] = k;
+        csr.values[p++] = a[k];
+      }
+    }
+  }
+}
+
+CsrMatrix csr_from_dense(const int *A, int M, int K) {
+  CsrMatrix csr;
+  csr_count(A, M, K, (size_t)M * K, csr);
+  csr_fill(A, csr);
+  return csr;
+}
+
+BlockSparseMatrix block_sparse_from_dense(const int *A, int M, int K,
+                                          int tile) {
+  BlockSparseMatrix bs;
+  bs.rows = M;
+  bs.cols = K;
+  bs.tile = tile;
+  bs.tile_rows = (M + tile - 1) / tile;
+  bs.tile_cols = (K + tile - 1) / tile;
+  bs.occupancy.assign((bs.tile_rows * bs.tile_cols + 31) / 32, 0);
+  for (int tr = 0; tr < bs.tile_rows; tr++) {
+    for (int tc = 0; tc < bs.tile_cols; tc++) {
+      int i_end = std::min(M, (tr + 1) * tile);
+      int k_end = std::min(K, (tc + 1) * tile);
+      bool any = false;
+      for (int i = tr * tile; i < i_end && !any; i++)
+        for (int k = tc * tile; k < k_end; k++)
+          any |= (A[(size_t)i * K + k] != 0);
+      if (!any)
+        continue;
+      int bit = tr * bs.tile_cols + tc;
+      bs.occupancy[bit / 32] |= 1u << (bit % 32);
+      size_t first = bs.tiles.size();
+      bs.tiles.resize(first + tile * tile, 0);
+      for (int i = tr * tile; i < i_end; i++)
+        for (int k = tc * tile; k < k_end; k++)
+          bs.tiles[first + (i - tr * tile) * tile + (k - tc * tile)] =
+              A[(size_t)i * K + k];
+    }
+  }
+  return bs;
+}
+
+std::vector<int> csr_partition(const CsrMatrix &A, int parts) {
+  // Work before row i is row_ptr[i] + i, which grows with i, so each
+  // boundary is found by binary search on it
+  long long total = (long long)A.nnz() + A.rows;
+  std::vector<int> bounds(parts + 1);
+  bounds[0] = 0;
+  int row = 0;
+  for (int p = 1; p < parts; p++) {
+    long long target = total * p / parts;
+    int lo = row, hi = A.rows;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if ((long long)A.row_ptr[mid] + mid < target)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    bounds[p] = row = lo;
+  }
+  bounds[parts] = A.rows;
+  return bounds;
+}
+
+void csr_matmul_block(const CsrMatrix &A, const int *B, int *C,
+                      int row_begin, int row_end, int N) {
+  for (int i = row_begin; i < row_end; i++) {
+    int *__restrict c = C + (size_t)i * N;
+    memset(c, 0, N * sizeof(int));
+    for (int p = A.row_ptr[i]; p < A.row_ptr[i + 1]; p++) {
+      const int a_val = A.values[p];
+      const int *__restrict b = B + (size_t)A.col_idx[p] * N;
+      for (int j = 0; j < N; j++)
+        c[j] += a_val * b[j];
+    }
+  }
+}
+
+void csr_matmul(const CsrMatrix &A, const int *B, int *C, int N,
+                ThreadPool &pool) {
+  int parts = std::max(1, std::min<int>(A.rows, pool.size() *
+                                                    PARTS_PER_THREAD));
+  std::vector<int> bounds = csr_partition(A, parts);
+  const CsrMatrix *a = &A;
+  const int *bounds_data = bounds.data();
+  pool.parallel_for(0, parts, 1, [=](int b, int e) {
+    for (int p = b; p < e; p++)
+      csr_matmul_block(*a, B, C, bounds_data[p], bounds_data[p + 1], N);
+  });
+}
+
+const char *sparse_path_name(SparsePath path) {
+  return path == SPARSE_CSR ? "CSR" : "dense";
+}
+
+SparsePath sparse_matmul(const int *A, const int *B, int *C, int M, int N,
+                         int K, double threshold, ThreadPool &pool) {
+  size_t n = (size_t)M * K;
+  CsrMatrix csr;
+  if (n == 0 || !csr_count(A, M, K, (size_t)(threshold * n), csr)) {
+    cpu_matmul(A, B, C, M, N, K, pool);
+    return SPARSE_DENSE;
+  }
+  csr_fill(A, csr);
+  csr_matmul(csr, B, C, N, pool);
+  return SPARSE_CSR;
+}
+
+double sparse_calibrate(int n, ThreadPool &pool) {
+  typedef std::chrono::steady_clock Clock;
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> value(-100, 100);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<int> A((size_t)n * n), B((size_t)n * n), C((size_t)n * n);
+  for (size_t i = 0; i < B.size(); i++)
+    B[i] = value(e);
+  // Warm-up, so that the first density does not pay for page faults
+  cpu_matmul(A.data(), B.data(), C.data(), n, n, n, pool);
+  for (int step = 10; step > 0; step--) {
+    double d = step / 10.0;
+    for (size_t i = 0; i < A.size(); i++)
+      A[i] = (unit(e) < d) ? value(e) | 1 : 0;
+    Clock::duration dense = Clock::duration::max();
+    Clock::duration csr = Clock::duration::max();
+    for (int r = 0; r < CALIBRATE_REPEATS; r++) {
+      Clock::time_point t = Clock::now();
+      cpu_matmul(A.data(), B.data(), C.data(), n, n, n, pool);
+      dense = std::min(dense, Clock::now() - t);
+      t = Clock::now();
+      CsrMatrix sparse = csr_from_dense(A.data(), n, n);
+      csr_matmul(sparse, B.data(), C.data(), n, pool);
+      csr = std::min(csr, Clock::now() - t);
+    }
+    if (csr < dense)
+      return d;
+  }
+  return 0;
+}
+} // namespace gemm
@@ -0,0 +1,122 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+// Sparse times dense multiplication on int32 matrices, C = A * B with A
+// M x K sparse and B (K x N) and C (M x N) dense row-major.
+//
+// CSR: A is stored as its nonzeros row by row. Rows of C are split across
+// the pool into parts of about equal nonzeros rather than equal rows, so a
+// few long rows do not leave the other threads idle.
+//
+// Block-sparse: A is cut into tile x tile tiles and only the tiles holding
+// a nonzero are kept, next to an occupancy bitmap with one bit per tile.
+// This is the layout the mmult_block_sparse kernel of loop_reorder reads.
+namespace gemm {
+
+struct CsrMatrix {
+  int rows, cols;
+  std::vector<int> row_ptr; // rows + 1 offsets into col_idx and values
+  std::vector<int> col_idx;
+  std::vector<int> values;
+
+  size_t nnz() const { return values.size(); }
+};
+
+struct BlockSparseMatrix {
+  int rows, cols, tile;
+  int tile_rows, tile_cols; // tiles per column and per row of A
+  // Bit tr * tile_cols + tc, lowest bit of word 0 first, is set when tile
+  // (tr, tc) holds a nonzero
+  std::vector<uint32_t> occupancy;
+  // The occupied tiles in row-major tile order, each tile x tile row-major
+  // and padded with zeros past the edges of A
+  std::vector<int> tiles;
+
+  bool occupied(int tr, int tc) const {
+    int bit = tr * tile_cols + tc;
+    return (occupancy[bit / 32] >> (bit % 32)) & 1;
+  }
+  int tile_count() const { return (int)(tiles.size() / (tile * tile)); }
+};
+
+// Fraction of the n values that are nonzero
+double density(const int *data, size_t n);
+
+CsrMatrix csr_from_dense(const int *A, int M, int K);
+
+BlockSparseMatrix block_sparse_from_dense(const int *A, int M, int K,
+                                          int tile);
+
+// First rows of parts ranges of about equal work, where a row costs its
+// nonzeros plus one; parts + 1 entries from 0 to A.rows
+std::vector<int> csr_partition(const CsrMatrix &A, int parts);
+
+// Computes rows [row_begin, row_end) of C on the calling thread only.
+void csr_matmul_block(const CsrMatrix &A, const int *B, int *C,
+                      int row_begin, int row_end, int N);
+
+// Computes the whole of C using the pool, balanced by csr_partition()
+void csr_matmul(const CsrMatrix &A, const int *B, int *C, int N,
+                ThreadPool &pool = ThreadPool::global());
+
+// Density of A below which sparse_matmul() takes the CSR path: the
+// crossover against cpu_matmul(), conversion included, that sparse_bench
+// measures on an AVX2 host at 1024 x 1024. Hosts where the dense engine
+// does relatively better can pass the result of sparse_calibrate() instead.
+const double SPARSE_DENSITY_THRESHOLD = 0.8;
+
+// Times cpu_matmul() against conversion plus csr_matmul() on n x n random
+// matrices of densities 1.0, 0.9, ... 0.1, best of three runs each, and
+// returns the highest density at which CSR is faster, 0 if it never is.
+double sparse_calibrate(int n = 256, ThreadPool &pool = ThreadPool::global());
+
+enum SparsePath { SPARSE_DENSE, SPARSE_CSR };
+const char *sparse_path_name(SparsePath path);
+
+// Picks the path from the density of A: below threshold A is converted to
+// CSR and csr_matmul() runs, otherwise cpu_matmul(). The scan stops as soon
+// as A is known to be dense enough, and its row counts are reused for the
+// conversion. Returns the path taken.
+SparsePath sparse_matmul(const int *A, const int *B, int *C, int M, int N,
+                         int K, double threshold = SPARSE_DENSITY_THRESHOLD,
+                         ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
@@ -0,0 +1,233 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "strassen.hpp"
+#include "cpu_gemm.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace gemm {
+
+// Rows handed to one pool task by the additions
+static const int ADD_GRAIN = 32;
+
+namespace {
+
+struct View {
+  int *p;
+  int ld;
+  int *at(int r, int c) const { return p + (size_t)r * ld + c; }
+};
+
+struct ConstView {
+  const int *p;
+  int ld;
+  ConstView(const int *p, int ld) : p(p), ld(ld) {}
+  ConstView(const View &v) : p(v.p), ld(v.ld) {}
+  const int *at(int r, int c) const { return p + (size_t)r * ld + c; }
+};
+
+struct Context {
+  const StrassenLeaf &leaf;
+  int crossover;
+  ThreadPool &pool;
+};
+
+// z = x + y or z = x - y on n x n blocks; z may alias x or y
+void add(ConstView x, ConstView y, View z, int n, bool subtract,
+         ThreadPool &pool) {
+  pool.parallel_for(0, n, ADD_GRAIN, [=](int b, int e) {
+    for (int r = b; r < e; r++) {
+      const unsigned *xr = (const unsigned *)x.at(r, 0);
+      const unsigned *yr = (const unsigned *)y.at(r, 0);
+      unsigned *zr = (unsigned *)z.at(r, 0);
+      if (subtract)
+        for (int c = 0; c < n; c++)
+          zr[c] = xr[c] - yr[c];
+      else
+        for (int c = 0; c < n; c++)
+          zr[c] = xr[c] + yr[c];
+    }
+  });
+}
+
+void multiply(ConstView a, ConstView b, View c, int n, int *work,
+              const Context &ctx);
+
+// n odd: C11 = A11 B11 + a12 b21 recursively on the even part, then the
+// last row and column of C directly
+void multiply_peeled(ConstView a, ConstView b, View c, int n, int *work,
+                     const Context &ctx) {
+  int m = n - 1;
+  multiply(a, b, c, m, work, ctx);
+  ctx.pool.parallel_for(0, n, ADD_GRAIN, [=](int rb, int re) {
+    for (int r = rb; r < re; r++) {
+      unsigned *cr = (unsigned *)c.at(r, 0);
+      const unsigned *ar = (const unsigned *)a.at(r, 0);
+      const unsigned *b_last = (const unsigned *)b.at(m, 0);
+      if (r < m) {
+        // rank-1 update of C11 by a12 b21, and the last column
+        unsigned a12 = ar[m];
+        for (int col = 0; col < m; col++)
+          cr[col] += a12 * b_last[col];
+      } else {
+        for (int col = 0; col < m; col++) {
+          unsigned sum = 0;
+          for (int k = 0; k < n; k++)
+            sum += ar[k] * *(const unsigned *)b.at(k, col);
+          cr[col] = sum;
+        }
+      }
+      unsigned sum = 0;
+      for (int k = 0; k < n; k++)
+        sum += ar[k] * *(const unsigned *)b.at(k, m);
+      cr[m] = sum;
+    }
+  });
+}
+
+// Schedule of Boyer, Dumas, Pernet and Zhou for C = A B with two
+// temporaries X and Y; the products of the next level use the workspace
+// after them.
+//   S1 = A21 + A22  S2 = S1 - A11  S3 = A11 - A21  S4 = A12 - S2
+//   T1 = B12 - B11  T2 = B22 - T1  T3 = B22 - B12  T4 = T2 - B21
+//   P1 = A11 B11  P2 = A12 B21  P3 = S4 B22  P4 = A22 T4
+//   P5 = S1 T1    P6 = S2 T2    P7 = S3 T3
+//   C11 = P1 + P2  C12 = P1 + P6 + P5 + P3
+//   C21 = P1 + P6 + P7 - P4  C22 = P1 + P6 + P7 + P5
+void multiply(ConstView a, ConstView b, View c, int n, int *work,
+              const Context &ctx) {
+  if (n <= ctx.crossover) {
+    ctx.leaf(a.p, a.ld, b.p, b.ld, c.p, c.ld, n);
+    return;
+  }
+  if (n & 1) {
+    multiply_peeled(a, b, c, n, work, ctx);
+    return;
+  }
+
+  int h = n / 2;
+  ConstView A11(a.at(0, 0), a.ld), A12(a.at(0, h), a.ld);
+  ConstView A21(a.at(h, 0), a.ld), A22(a.at(h, h), a.ld);
+  ConstView B11(b.at(0, 0), b.ld), B12(b.at(0, h), b.ld);
+  ConstView B21(b.at(h, 0), b.ld), B22(b.at(h, h), b.ld);
+  View C11 = {c.at(0, 0), c.ld}, C12 = {c.at(0, h), c.ld};
+  View C21 = {c.at(h, 0), c.ld}, C22 = {c.at(h, h), c.ld};
+  View X = {work, h}, Y = {work + (size_t)h * h, h};
+  int *next = work + 2 * (size_t)h * h;
+  ThreadPool &pool = ctx.pool;
+
+  add(A11, A21, X, h, true, pool);     // X = S3
+  add(B22, B12, Y, h, true, pool);     // Y = T3
+  multiply(X, Y, C21, h, next, ctx);   // C21 = P7
+  add(A21, A22, X, h, false, pool);    // X = S1
+  add(B12, B11, Y, h, true, pool);     // Y = T1
+  multiply(X, Y, C22, h, next, ctx);   // C22 = P5
+  add(X, A11, X, h, true, pool);       // X = S2
+  add(B22, Y, Y, h, true, pool);       // Y = T2
+  multiply(X, Y, C12, h, next, ctx);   // C12 = P6
+  add(A12, X, X, h, true, pool);       // X = S4
+  multiply(X, B22, C11, h, next, ctx); // C11 = P3
+  multiply(A11, B11, X, h, next, ctx); // X = P1
+  add(X, C12, C12, h, false, pool);    // C12 = U2 = P1 + P6
+  add(C12, C21, C21, h, false, pool);  // C21 = U3 = U2 + P7
+  add(C12, C22, C12, h, false, pool);  // C12 = U4 = U2 + P5
+  add(C21, C22, C22, h, false, pool);  // C22 = U7 = U3 + P5
+  add(C12, C11, C12, h, false, pool);  // C12 = U5 = U4 + P3
+  add(Y, B21, Y, h, true, pool);       // Y = T4
+  multiply(A22, Y, C11, h, next, ctx); // C11 = P4
+  add(C21, C11, C21, h, true, pool);   // C21 = U6 = U3 - P4
+  multiply(A12, B21, C11, h, next, ctx); // C11 = P2
+  add(X, C11, C11, h, false, pool);    // C11 = U1 = P1 + P2
+}
+} // namespace
+
+StrassenLeaf cpu_leaf(ThreadPool &pool) {
+  ThreadPool *p = &pool;
+  return [p](const int *a, int lda, const int *b, int ldb, int *c, int ldc,
+             int n) {
+    p->parallel_for(0, n, 16, [=](int rb, int re) {
+      matmul_block(a, lda, b, ldb, c, ldc, rb, re, n, n);
+    });
+  };
+}
+
+StrassenLeaf tiled_leaf(int tile, int depth, const TileKernel &kernel,
+                        ThreadPool &pool) {
+  ThreadPool *p = &pool;
+  return [=](const int *a, int lda, const int *b, int ldb, int *c, int ldc,
+             int n) {
+    std::vector<int> pa((size_t)n * n), pb((size_t)n * n), pc((size_t)n * n);
+    for (int r = 0; r < n; r++) {
+      std::copy(a + (size_t)r * lda, a + (size_t)r * lda + n,
+                pa.begin() + (size_t)r * n);
+      std::copy(b + (size_t)r * ldb, b + (size_t)r * ldb + n,
+                pb.begin() + (size_t)r * n);
+    }
+    tiled_matmul(pa.data(), pb.data(), pc.data(), n, n, n, tile, depth, kernel,
+                 *p);
+    for (int r = 0; r < n; r++)
+      std::copy(pc.begin() + (size_t)r * n, pc.begin() + (size_t)(r + 1) * n,
+                c + (size_t)r * ldc);
+  };
+}
+
+size_t strassen_workspace(int n, int crossover) {
+  size_t total = 0;
+  while (n > crossover) {
+    if (n & 1) {
+      n--;
+      continue;
+    }
+    n /= 2;
+    total += 2 * (size_t)n * n;
+  }
+  return total;
+}
+
+void strassen_matmul(const int *A, const int *B, int *C, int n, int crossover,
+                     const StrassenLeaf &leaf, int *workspace,
+                     ThreadPool &pool) {
+  crossover = std::max(crossover, 1);
+  std::vector<int> owned;
+  if (!workspace) {
+    owned.resize(std::max<size_t>(strassen_workspace(n, crossover), 1));
+    workspace = owned.data();
+  }
+  Context ctx = {leaf, crossover, pool};
+  View c = {C, n};
+  multiply(ConstView(A, n), ConstView(B, n), c, n, workspace, ctx);
+}
+} // namespace gemm
@@ -0,0 +1,74 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include "tiled_gemm.hpp"
+#include <cstddef>
+#include <functional>
+
+// Strassen-Winograd multiplication of square int32 matrices: 7 half-size
+// products and 15 additions per level instead of 8 products. Recursion stops
+// at `crossover` and hands the products to a leaf, either the blocked CPU
+// kernel or a tile kernel. Sums are computed in unsigned arithmetic, so the
+// result equals classical GEMM bit for bit (both wrap modulo 2^32). Odd
+// sizes are handled by peeling off the last row and column.
+namespace gemm {
+
+// c = a * b for n x n blocks with leading dimensions lda, ldb and ldc
+typedef std::function<void(const int *a, int lda, const int *b, int ldb,
+                           int *c, int ldc, int n)>
+    StrassenLeaf;
+
+// Leaf running matmul_block() over the pool
+StrassenLeaf cpu_leaf(ThreadPool &pool = ThreadPool::global());
+
+// Leaf packing the blocks and running tiled_matmul() with a tile kernel,
+// e.g. lmult on 1024 x 1024 tiles
+StrassenLeaf tiled_leaf(int tile, int depth, const TileKernel &kernel,
+                        ThreadPool &pool = ThreadPool::global());
+
+// Ints of workspace strassen_matmul() needs for n x n, at most 2n^2/3. Only
+// two half-size temporaries are live per level; the rest of the schedule
+// works in the quadrants of C.
+size_t strassen_workspace(int n, int crossover);
+
+// C = A * B for row-major n x n matrices. workspace must hold
+// strassen_workspace(n, crossover) ints, or be null to allocate it here.
+void strassen_matmul(const int *A, const int *B, int *C, int n, int crossover,
+                     const StrassenLeaf &leaf, int *workspace = 0,
+                     ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
@@ -0,0 +1,138 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace gemm {
+
+ThreadPool::ThreadPool(unsigned threads) : m_stop(false) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  // The caller of parallel_for() is the remaining thread
+  for (unsigned i = 1; i < threads; i++)
+    m_threads.push_back(std::thread(&ThreadPool::worker, this));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  for (size_t i = 0; i < m_threads.size(); i++)
+    m_threads[i].join();
+}
+
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::worker() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+      if (m_stop && m_tasks.empty())
+        return;
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+namespace {
+// Shared between the caller and the helpers it queued; helpers that start
+// after the caller has returned find no chunks left and exit.
+struct ForState {
+  std::function<void(int, int)> fn;
+  int begin, end, grain, chunks;
+  std::atomic<int> next;
+  std::atomic<int> done;
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  void run() {
+    int c;
+    while ((c = next.fetch_add(1)) < chunks) {
+      int b = begin + c * grain;
+      fn(b, std::min(end, b + grain));
+      if (done.fetch_add(1) + 1 == chunks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    }
+  }
+};
+} // namespace
+
+void ThreadPool::parallel_for(int begin, int end, int grain,
+                              const std::function<void(int, int)> &fn) {
+  if (end <= begin)
+    return;
+  grain = std::max(1, grain);
+  int chunks = (end - begin + grain - 1) / grain;
+  if (chunks == 1 || m_threads.empty()) {
+    fn(begin, end);
+    return;
+  }
+
+  std::shared_ptr<ForState> state = std::make_shared<ForState>();
+  state->fn = fn;
+  state->begin = begin;
+  state->end = end;
+  state->grain = grain;
+  state->chunks = chunks;
+  state->next = 0;
+  state->done = 0;
+
+  int helpers = std::min<int>(chunks - 1, (int)m_threads.size());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int i = 0; i < helpers; i++)
+      m_tasks.push_back([state] { state->run(); });
+  }
+  m_cv.notify_all();
+
+  state->run();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state] { return state->done == state->chunks; });
+}
+} // namespace gemm
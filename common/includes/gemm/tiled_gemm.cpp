@@ -0,0 +1,82 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "tiled_gemm.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace gemm {
+
+// Copies the rows x cols block at src (leading dimension ld) into a
+// zero-padded tile x tile buffer
+static void pack(const int *src, int ld, int rows, int cols, int tile,
+                 int *dst) {
+  std::fill(dst, dst + tile * tile, 0);
+  for (int r = 0; r < rows; r++)
+    std::copy(src + (size_t)r * ld, src + (size_t)r * ld + cols,
+              dst + r * tile);
+}
+
+void tiled_matmul(const int *A, const int *B, int *C, int M, int N, int K,
+                  int tile, int depth, const TileKernel &kernel,
+                  ThreadPool &pool) {
+  int tiles_m = (M + tile - 1) / tile;
+  int tiles_n = (N + tile - 1) / tile;
+  int tiles = tiles_m * tiles_n;
+  depth = std::max(1, std::min(depth, tiles));
+  int grain = (tiles + depth - 1) / depth;
+
+  pool.parallel_for(0, tiles, grain, [&](int first, int last) {
+    std::vector<int> a(tile * tile), b(tile * tile), c(tile * tile),
+        acc(tile * tile);
+    for (int t = first; t < last; t++) {
+      int i0 = (t / tiles_n) * tile, j0 = (t % tiles_n) * tile;
+      int rows = std::min(tile, M - i0), cols = std::min(tile, N - j0);
+      std::fill(acc.begin(), acc.end(), 0);
+      for (int k0 = 0; k0 < K; k0 += tile) {
+        int inner = std::min(tile, K - k0);
+        pack(A + (size_t)i0 * K + k0, K, rows, inner, tile, a.data());
+        pack(B + (size_t)k0 * N + j0, N, inner, cols, tile, b.data());
+        kernel(a.data(), b.data(), c.data(), tile);
+        for (int i = 0; i < tile * tile; i++)
+          acc[i] += c[i];
+      }
+      for (int r = 0; r < rows; r++)
+        std::copy(acc.begin() + r * tile, acc.begin() + r * tile + cols,
+                  C + (size_t)(i0 + r) * N + j0);
+    }
+  });
+}
+} // namespace gemm
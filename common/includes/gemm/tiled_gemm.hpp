@@ -0,0 +1,56 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <functional>
+
+// Runs a GEMM of any shape on a kernel that only multiplies fixed-size
+// square tiles, such as matmul_partition (16), systolic mmult (32) or
+// loop_reorder mmult (64). Operands are packed into zero-padded tile x tile
+// buffers, the kernel product of each tile pair is accumulated into C.
+namespace gemm {
+
+// c = a * b for contiguous row-major tile x tile buffers
+typedef std::function<void(const int *a, const int *b, int *c, int tile)>
+    TileKernel;
+
+// C = A * B with A M x K, B K x N. Up to `depth` output tiles are in flight
+// at once, each on its own pool thread with its own packing buffers.
+void tiled_matmul(const int *A, const int *B, int *C, int M, int N, int K,
+                  int tile, int depth, const TileKernel &kernel,
+                  ThreadPool &pool = ThreadPool::global());
+} // namespace gemm
@@ -38,6 +38,20 @@ C.
 #include <fstream>
 #endif /*LODEPNG_COMPILE_CPP*/
 
+#ifdef LODEPNG_COMPILE_THREADS
+#include <string.h>
+#include <thread>
+#include <vector>
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+/*SSE2 unfilter for RGB and RGBA scanlines, disable with
+-DLODEPNG_NO_COMPILE_SSE2*/
+#if defined(__SSE2__) && !defined(LODEPNG_NO_COMPILE_SSE2)
+#include <emmintrin.h>
+#include <string.h>
+#define LODEPNG_SSE2
+#endif /*defined(__SSE2__) && !defined(LODEPNG_NO_COMPILE_SSE2)*/
+
 #define VERSION_STRING "20131115"
 
 /*
@@ -2122,19 +2136,20 @@ static unsigned deflateFixed(ucvector *out, size_t *bp, Hash *hash,
   return error;
 }
 
-static unsigned lodepng_deflatev(ucvector *out, const unsigned char *in,
-                                 size_t insize,
-                                 const LodePNGCompressSettings *settings) {
+/*deflate in[datapos..dataend-1] as fixed or dynamic blocks. The last block
+has BFINAL set if final is set, otherwise the data ends with an empty stored
+block so that it ends on a byte boundary and more blocks can be appended*/
+static unsigned deflateRange(ucvector *out, const unsigned char *in,
+                             size_t datapos, size_t dataend,
+                             const LodePNGCompressSettings *settings,
+                             int final) {
   unsigned error = 0;
   size_t i, blocksize, numdeflateblocks;
+  size_t insize = dataend - datapos;
   size_t bp = 0; /*the bit pointer*/
   Hash hash;
 
-  if (settings->btype > 2)
-    return 61;
-  else if (settings->btype == 0)
-    return deflateNoCompression(out, in, insize);
-  else if (settings->btype == 1)
+  if (settings->btype == 1)
     blocksize = insize;
   else /*if(settings->btype == 2)*/
   {
@@ -2152,16 +2167,28 @@ static unsigned lodepng_deflatev(ucvector *out, const unsigned char *in,
     return error;
 
   for (i = 0; i < numdeflateblocks && !error; i++) {
-    int final = i == numdeflateblocks - 1;
-    size_t start = i * blocksize;
+    int last = i == numdeflateblocks - 1;
+    size_t start = datapos + i * blocksize;
     size_t end = start + blocksize;
-    if (end > insize)
-      end = insize;
+    if (end > dataend)
+      end = dataend;
 
     if (settings->btype == 1)
-      error = deflateFixed(out, &bp, &hash, in, start, end, settings, final);
+      error =
+          deflateFixed(out, &bp, &hash, in, start, end, settings, last && final);
     else if (settings->btype == 2)
-      error = deflateDynamic(out, &bp, &hash, in, start, end, settings, final);
+      error = deflateDynamic(out, &bp, &hash, in, start, end, settings,
+                             last && final);
+  }
+
+  if (!error && !final) {
+    /*empty stored block: BFINAL 0, BTYPE 00, pad to the byte, LEN 0, NLEN
+     * 65535*/
+    addBitsToStream(&bp, out, 0, 3);
+    ucvector_push_back(out, 0);
+    ucvector_push_back(out, 0);
+    ucvector_push_back(out, 255);
+    ucvector_push_back(out, 255);
   }
 
   hash_cleanup(&hash);
@@ -2169,6 +2196,76 @@ static unsigned lodepng_deflatev(ucvector *out, const unsigned char *in,
   return error;
 }
 
+#ifdef LODEPNG_COMPILE_THREADS
+/*smallest part given to a thread; smaller inputs are not worth splitting*/
+#define DEFLATE_THREAD_PART 262144
+
+static unsigned numDeflateThreads(unsigned numthreads, size_t insize) {
+  size_t maxparts = insize / DEFLATE_THREAD_PART;
+  if (numthreads == 0)
+    numthreads = std::thread::hardware_concurrency();
+  if (numthreads > maxparts)
+    numthreads = (unsigned)maxparts;
+  return numthreads ? numthreads : 1;
+}
+
+/*deflate the parts of the input on separate threads and append them to out
+in order. Only the last part is final; the others end byte aligned.*/
+static unsigned deflateParallel(ucvector *out, const unsigned char *in,
+                                size_t insize, unsigned numparts,
+                                const LodePNGCompressSettings *settings) {
+  std::vector<ucvector> parts(numparts);
+  std::vector<unsigned> errors(numparts, 0);
+  std::vector<std::thread> threads;
+  size_t partsize = (insize + numparts - 1) / numparts;
+  unsigned error = 0;
+  unsigned i;
+
+  for (i = 0; i < numparts; i++) {
+    ucvector_init_buffer(&parts[i], 0, 0);
+    threads.push_back(std::thread([&, i]() {
+      size_t start = i * partsize;
+      size_t end = start + partsize < insize ? start + partsize : insize;
+      errors[i] = deflateRange(&parts[i], in, start, end, settings,
+                               i == numparts - 1);
+    }));
+  }
+  for (i = 0; i < numparts; i++)
+    threads[i].join();
+
+  for (i = 0; i < numparts; i++) {
+    size_t oldsize = out->size;
+    if (!error)
+      error = errors[i];
+    if (!error && !ucvector_resize(out, oldsize + parts[i].size))
+      error = 83; /*alloc fail*/
+    if (!error)
+      memcpy(out->data + oldsize, parts[i].data, parts[i].size);
+    lodepng_free(parts[i].data);
+  }
+  return error;
+}
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+static unsigned lodepng_deflatev(ucvector *out, const unsigned char *in,
+                                 size_t insize,
+                                 const LodePNGCompressSettings *settings) {
+  if (settings->btype > 2)
+    return 61;
+  else if (settings->btype == 0)
+    return deflateNoCompression(out, in, insize);
+
+#ifdef LODEPNG_COMPILE_THREADS
+  if (settings->numthreads != 1) {
+    unsigned numparts = numDeflateThreads(settings->numthreads, insize);
+    if (numparts > 1)
+      return deflateParallel(out, in, insize, numparts, settings);
+  }
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+  return deflateRange(out, in, 0, insize, settings, 1);
+}
+
 unsigned lodepng_deflate(unsigned char **out, size_t *outsize,
                          const unsigned char *in, size_t insize,
                          const LodePNGCompressSettings *settings) {
@@ -2224,6 +2321,53 @@ static unsigned adler32(const unsigned char *data, unsigned len) {
   return update_adler32(1L, data, len);
 }
 
+#if defined(LODEPNG_COMPILE_ENCODER) && defined(LODEPNG_COMPILE_THREADS)
+/*Return the adler32 of the concatenation of two byte sequences, given the
+adler32 of each and the length of the second*/
+static unsigned combine_adler32(unsigned adler1, unsigned adler2,
+                                size_t len2) {
+  unsigned rem = (unsigned)(len2 % 65521);
+  unsigned s1 = adler1 & 0xffff;
+  unsigned s2 = (unsigned)(((unsigned long long)rem * s1) % 65521);
+  s1 += (adler2 & 0xffff) + 65521 - 1;
+  s2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + 65521 - rem;
+  if (s1 >= 65521)
+    s1 -= 65521;
+  if (s1 >= 65521)
+    s1 -= 65521;
+  if (s2 >= 65521 * 2)
+    s2 -= 65521 * 2;
+  if (s2 >= 65521)
+    s2 -= 65521;
+  return (s2 << 16) | s1;
+}
+
+/*adler32 of the parts computed on separate threads and combined in order*/
+static unsigned adler32Parallel(const unsigned char *data, size_t len,
+                                unsigned numparts) {
+  std::vector<unsigned> sums(numparts, 1);
+  std::vector<std::thread> threads;
+  size_t partsize = (len + numparts - 1) / numparts;
+  unsigned adler = 1;
+  unsigned i;
+
+  for (i = 0; i < numparts; i++) {
+    threads.push_back(std::thread([&, i]() {
+      size_t start = i * partsize;
+      size_t end = start + partsize < len ? start + partsize : len;
+      sums[i] = adler32(data + start, (unsigned)(end - start));
+    }));
+  }
+  for (i = 0; i < numparts; i++) {
+    size_t start = i * partsize;
+    size_t end = start + partsize < len ? start + partsize : len;
+    threads[i].join();
+    adler = i == 0 ? sums[0] : combine_adler32(adler, sums[i], end - start);
+  }
+  return adler;
+}
+#endif /*defined(LODEPNG_COMPILE_ENCODER) && defined(LODEPNG_COMPILE_THREADS)*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2322,7 +2466,13 @@ that's pointing to a non allocated buffer, this'll crash*/
   error = deflate(&deflatedata, &deflatesize, in, insize, settings);
 
   if (!error) {
-    ADLER32 = adler32(in, (unsigned)insize);
+#ifdef LODEPNG_COMPILE_THREADS
+    unsigned numparts = numDeflateThreads(settings->numthreads, insize);
+    if (settings->numthreads != 1 && numparts > 1)
+      ADLER32 = adler32Parallel(in, insize, numparts);
+    else
+#endif /*LODEPNG_COMPILE_THREADS*/
+      ADLER32 = adler32(in, (unsigned)insize);
     for (i = 0; i < deflatesize; i++)
       ucvector_push_back(&outv, deflatedata[i]);
     lodepng_free(deflatedata);
@@ -2387,6 +2537,7 @@ void lodepng_compress_settings_init(LodePNGCompressSettings *settings) {
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->numthreads = 1;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
@@ -2394,7 +2545,7 @@ void lodepng_compress_settings_init(LodePNGCompressSettings *settings) {
 }
 
 const LodePNGCompressSettings lodepng_default_compress_settings = {
-    2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+    2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 1, 0, 0, 0};
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
@@ -4165,6 +4316,116 @@ unsigned lodepng_inspect(unsigned *w, unsigned *h, LodePNGState *state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE2
+/*SSE2 unfilter of 8-bit RGB and RGBA scanlines, bytewidth 3 or 4. Sub and
+Paeth depend on the pixel to the left, so Sub runs a prefix sum over four
+pixels per register and Paeth works on one pixel at a time in 16-bit lanes,
+choosing the predictor without branches. Pixels are loaded and stored with
+memcpy of bytewidth bytes since recon and scanline may overlap.*/
+static __m128i loadPixel(const unsigned char *p, size_t bytewidth) {
+  int v = 0;
+  if (bytewidth == 3)
+    memcpy(&v, p, 3);
+  else
+    memcpy(&v, p, 4);
+  return _mm_cvtsi32_si128(v);
+}
+
+/*load a pixel that is followed by at least 4 - bytewidth more bytes*/
+static __m128i loadPixelPadded(const unsigned char *p, size_t bytewidth) {
+  int v;
+  memcpy(&v, p, 4);
+  return bytewidth == 3 ? _mm_cvtsi32_si128(v & 0xffffff)
+                        : _mm_cvtsi32_si128(v);
+}
+
+static void storePixel(unsigned char *p, __m128i v, size_t bytewidth) {
+  int x = _mm_cvtsi128_si32(v);
+  if (bytewidth == 3)
+    memcpy(p, &x, 3);
+  else
+    memcpy(p, &x, 4);
+}
+
+static void unfilterUpSSE2(unsigned char *recon, const unsigned char *scanline,
+                           const unsigned char *precon, size_t length) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(scanline + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(precon + i));
+    _mm_storeu_si128((__m128i *)(recon + i), _mm_add_epi8(x, b));
+  }
+  for (; i < length; i++)
+    recon[i] = scanline[i] + precon[i];
+}
+
+static void unfilterSubSSE2(unsigned char *recon, const unsigned char *scanline,
+                            size_t bytewidth, size_t length) {
+  /*a holds the last reconstructed pixel in its low bytewidth bytes*/
+  __m128i a = _mm_setzero_si128();
+  size_t step = 4 * bytewidth;
+  size_t i = 0;
+  for (; i + 16 <= length; i += step) {
+    __m128i x = _mm_add_epi8(
+        _mm_loadu_si128((const __m128i *)(scanline + i)), a);
+    if (bytewidth == 4) {
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+      _mm_storeu_si128((__m128i *)(recon + i), x);
+      a = _mm_srli_si128(x, 12);
+    } else {
+      int last;
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+      _mm_storel_epi64((__m128i *)(recon + i), x);
+      last = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+      memcpy(recon + i + 8, &last, 4);
+      a = _mm_and_si128(_mm_srli_si128(x, 9), _mm_cvtsi32_si128(0xffffff));
+    }
+  }
+  for (; i < length; i += bytewidth) {
+    a = _mm_add_epi8(loadPixel(scanline + i, bytewidth), a);
+    storePixel(recon + i, a, bytewidth);
+  }
+}
+
+static void unfilterPaethSSE2(unsigned char *recon,
+                              const unsigned char *scanline,
+                              const unsigned char *precon, size_t bytewidth,
+                              size_t length) {
+  /*a: left, b: above, c: above left, all as 16-bit lanes. For the first
+  pixel a = c = 0, for which the predictor is b as required.*/
+  __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero;
+  size_t i;
+  for (i = 0; i < length; i += bytewidth) {
+    int padded = i + 4 <= length;
+    __m128i b = _mm_unpacklo_epi8(padded ? loadPixelPadded(precon + i, bytewidth)
+                                         : loadPixel(precon + i, bytewidth),
+                                  zero);
+    __m128i p = _mm_sub_epi16(b, c);
+    __m128i q = _mm_sub_epi16(a, c);
+    __m128i r = _mm_add_epi16(p, q);
+    __m128i pa = _mm_max_epi16(p, _mm_sub_epi16(zero, p));
+    __m128i pb = _mm_max_epi16(q, _mm_sub_epi16(zero, q));
+    __m128i pc = _mm_max_epi16(r, _mm_sub_epi16(zero, r));
+    __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    /*a if pa is smallest, else b if pb is, else c*/
+    __m128i usea = _mm_cmpeq_epi16(smallest, pa);
+    __m128i useb = _mm_andnot_si128(usea, _mm_cmpeq_epi16(smallest, pb));
+    __m128i pred = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(usea, a), _mm_and_si128(useb, b)),
+        _mm_andnot_si128(_mm_or_si128(usea, useb), c));
+    __m128i x = _mm_add_epi8(padded ? loadPixelPadded(scanline + i, bytewidth)
+                                    : loadPixel(scanline + i, bytewidth),
+                             _mm_packus_epi16(pred, pred));
+    storePixel(recon + i, x, bytewidth);
+    a = _mm_unpacklo_epi8(x, zero);
+    c = b;
+  }
+}
+#endif /*LODEPNG_SSE2*/
+
 static unsigned unfilterScanline(unsigned char *recon,
                                  const unsigned char *scanline,
                                  const unsigned char *precon, size_t bytewidth,
@@ -4182,6 +4443,22 @@ recon and scanline MAY be the same memory address! precon must be disjoint.
 */
 
   size_t i;
+#ifdef LODEPNG_SSE2
+  if (filterType == 2 && precon) {
+    unfilterUpSSE2(recon, scanline, precon, length);
+    return 0;
+  }
+  if (bytewidth == 3 || bytewidth == 4) {
+    if (filterType == 1 || (filterType == 4 && !precon)) {
+      unfilterSubSSE2(recon, scanline, bytewidth, length);
+      return 0;
+    }
+    if (filterType == 4) {
+      unfilterPaethSSE2(recon, scanline, precon, bytewidth, length);
+      return 0;
+    }
+  }
+#endif /*LODEPNG_SSE2*/
   switch (filterType) {
   case 0:
     for (i = 0; i < length; i++)
@@ -78,6 +78,13 @@ source files with custom allocators.*/
 #ifndef LODEPNG_NO_COMPILE_ALLOCATORS
 #define LODEPNG_COMPILE_ALLOCATORS
 #endif
+/*multithreaded deflate (see numthreads in LodePNGCompressSettings). Needs
+C++11 std::thread, link with -lpthread*/
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#ifndef LODEPNG_NO_COMPILE_THREADS
+#define LODEPNG_COMPILE_THREADS
+#endif
+#endif
 /*compile the C++ version (you can disable the C++ wrapper here even when
  * compiling for C++)*/
 #ifdef __cplusplus
@@ -297,6 +304,11 @@ struct LodePNGCompressSettings /*deflate = compress*/
                          best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit
                             slower. Default: true*/
+  unsigned numthreads; /*split the input in this many parts deflated in
+                         parallel, each ending on a byte boundary so they
+                         concatenate into one stream. Every part starts with an
+                         empty LZ77 window, costing a little compression. 0 uses
+                         all hardware threads. Default: 1*/
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char **, size_t *, const unsigned char *,
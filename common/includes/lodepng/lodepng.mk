@@ -1,3 +1,4 @@
 lodepng_SRCS:=${COMMON_REPO}/common/includes/lodepng/lodepng.cpp
 lodepng_HDRS:=${COMMON_REPO}/common/includes/lodepng/lodepng.h
 lodepng_CXXFLAGS:=-I${COMMON_REPO}/common/includes/lodepng
+lodepng_LDFLAGS:=-lpthread
@@ -34,9 +34,16 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 **********/
 #include "logger.h"
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <mutex>
 #include <stdarg.h>
+#include <stdio.h>
+#include <thread>
 #include <time.h>
 #ifdef WINDOWS
 #include <direct.h>
@@ -122,88 +129,272 @@ string GetFileTitleOnly(const string &s) {
   return temp;
 }
 
-void LogWrapper(int etype, const char *file, int line, const char *desc, ...) {
+namespace {
+
+// Longest record, header and time included; longer ones are truncated
+const size_t LOG_RECORD_BYTES = 1024;
+// Records written per batch
+const size_t LOG_BATCH = 256;
+// Longest time a record waits in the queue while the writer sleeps
+const int LOG_IDLE_MS = 5;
+
+// Bounded lock-free queue of preformatted records, many producers and the
+// writer thread as the only consumer. Each slot's sequence number says whose
+// turn it is: pos for the producer that claims position pos, pos + 1 once
+// the record is published for the consumer, pos + capacity once the
+// consumer has copied it out and the slot is free for the next lap.
+class AsyncLog {
+public:
+  explicit AsyncLog(const LogSettings &settings)
+      : m_echo(settings.echo), m_overflow(settings.overflow), m_file(NULL),
+        m_enqueue(0), m_written(0), m_dropped(0), m_sleeping(false),
+        m_stop(false) {
+    size_t capacity = 2;
+    while (capacity < settings.capacity)
+      capacity <<= 1;
+    m_mask = capacity - 1;
+    m_slots = vector<Slot>(capacity);
+    for (size_t i = 0; i < capacity; i++)
+      m_slots[i].seq.store(i, std::memory_order_relaxed);
+    if (!settings.filename.empty())
+      m_file = fopen(settings.filename.c_str(), "a");
+    m_thread = std::thread(&AsyncLog::run, this);
+  }
 
-  // crop file name from full path
-  string strFileLoc(file);
-  strFileLoc = strFileLoc.substr(strFileLoc.find_last_of("\\/") + 1);
-
-  string strHeader = "";
-  {
-    char header[512];
-    // source
-    switch (etype) {
-    case (sda::etError): {
-      snprintf(header, sizeof(header), "ERROR: [%s:%d]", strFileLoc.c_str(),
-               line);
-      break;
+  ~AsyncLog() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
     }
-    case (sda::etInfo): {
-      snprintf(header, sizeof(header), "INFO: [%s:%d]", strFileLoc.c_str(),
-               line);
-      break;
-    }
-    case (sda::etWarning): {
-      snprintf(header, sizeof(header), "WARN: [%s:%d]", strFileLoc.c_str(),
-               line);
-      break;
+    m_wake.notify_one();
+    m_thread.join();
+    if (m_file)
+      fclose(m_file);
+  }
+
+  // Queues one record. A full queue waits for space if the record is urgent
+  // or the policy is eoBlock, and drops the record otherwise.
+  void push(const char *text, size_t len, bool urgent) {
+    bool wait = urgent || m_overflow == eoBlock;
+    size_t pos = m_enqueue.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+      slot = &m_slots[pos & m_mask];
+      size_t seq = slot->seq.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (m_enqueue.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed))
+          break;
+      } else if (seq < pos) {
+        // full: the slot still holds the record from the previous lap
+        if (!wait) {
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        wake();
+        std::this_thread::yield();
+        pos = m_enqueue.load(std::memory_order_relaxed);
+      } else {
+        pos = m_enqueue.load(std::memory_order_relaxed);
+      }
     }
+    memcpy(slot->text, text, len);
+    slot->len = len;
+    slot->seq.store(pos + 1, std::memory_order_seq_cst);
+    // Waking the writer is a system call, so it is left to its timeout
+    // unless the queue is filling up or the record is an error
+    if (m_sleeping.load(std::memory_order_seq_cst) &&
+        (urgent || pos - m_written.load(std::memory_order_relaxed) >=
+                       (m_mask + 1) / 4))
+      wake();
+  }
+
+  void flush() {
+    size_t target = m_enqueue.load(std::memory_order_acquire);
+    wake();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] {
+      return m_written.load(std::memory_order_acquire) >= target;
+    });
+  }
+
+  size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    size_t len;
+    char text[LOG_RECORD_BYTES];
+  };
+
+  void wake() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+  }
+
+  bool ready(size_t pos) const {
+    return m_slots[pos & m_mask].seq.load(std::memory_order_seq_cst) ==
+           pos + 1;
+  }
+
+  void run() {
+    vector<char> batch;
+    batch.reserve(LOG_BATCH * 128);
+    size_t pos = 0;
+    for (;;) {
+      batch.clear();
+      size_t count = 0;
+      while (count < LOG_BATCH && ready(pos)) {
+        Slot &slot = m_slots[pos & m_mask];
+        batch.insert(batch.end(), slot.text, slot.text + slot.len);
+        slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+        pos++;
+        count++;
+      }
+      if (count) {
+        if (m_echo) {
+          fwrite(batch.data(), 1, batch.size(), stdout);
+          fflush(stdout);
+        }
+        if (m_file) {
+          fwrite(batch.data(), 1, batch.size(), m_file);
+          fflush(m_file);
+        }
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_written.store(pos, std::memory_order_release);
+        }
+        m_done.notify_all();
+        continue;
+      }
+
+      // Nothing published: sleep until the timeout, a filling queue, an
+      // error record or flush() wakes us
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_stop && m_enqueue.load(std::memory_order_acquire) == pos)
+        break;
+      m_sleeping.store(true, std::memory_order_seq_cst);
+      m_wake.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MS),
+                      [&] { return m_stop || ready(pos); });
+      m_sleeping.store(false, std::memory_order_relaxed);
     }
-    strHeader = string(header);
   }
 
-  // time
-  string strTime = "";
-#ifdef ENABLE_LOG_TIME
-  {
-    time_t rawtime;
-    time(&rawtime);
-#ifdef ENABLE_SECURE_API
-    char buffer[64];
-    struct tm timeinfo;
-    localtime_s(&timeinfo, &rawtime);
-    asctime_s(timeinfo, buffer, sizeof(buffer))
-        snprintf(buffer, sizeof(buffer), "TIME: [%s]", asctime(timeinfo));
-    strTime = string(buffer);
-#else
-    char buffer[64];
-    struct tm *timeinfo = localtime(&rawtime);
-    string temp = string(asctime(timeinfo));
-    temp = trim(temp);
-
-    //        strftime(buffer, sizeof(buffer), "TIME: []")
-    snprintf(buffer, sizeof(buffer), "TIME: [%s]", temp.c_str());
-    strTime = string(buffer);
-#endif
+  bool m_echo;
+  LOGOVERFLOW m_overflow;
+  FILE *m_file;
+  size_t m_mask;
+  vector<Slot> m_slots;
+  std::atomic<size_t> m_enqueue;
+  std::atomic<size_t> m_written;
+  std::atomic<size_t> m_dropped;
+  std::atomic<bool> m_sleeping;
+  bool m_stop;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  std::thread m_thread;
+};
+
+std::atomic<AsyncLog *> g_log(NULL);
+std::mutex g_log_lock;
+
+void StopAtExit() { LogStop(); }
+
+// Replaces the backend; g_log_lock must be held
+AsyncLog *StartLocked(const LogSettings &settings) {
+  static bool registered = false;
+  if (!registered) {
+    std::atexit(StopAtExit);
+    registered = true;
   }
-#endif
+  delete g_log.exchange(NULL);
+  AsyncLog *log = new AsyncLog(settings);
+  g_log.store(log, std::memory_order_release);
+  return log;
+}
 
-  // format the message itself
-  string strMsg = "";
-  {
-    char msg[512];
-    va_list args;
-    va_start(args, desc);
-    vsnprintf(msg, sizeof(msg), desc, args);
-    va_end(args);
-    strMsg = string(msg);
+AsyncLog *GetLog() {
+  AsyncLog *log = g_log.load(std::memory_order_acquire);
+  if (log)
+    return log;
+  std::lock_guard<std::mutex> lock(g_log_lock);
+  log = g_log.load(std::memory_order_relaxed);
+  return log ? log : StartLocked(LogSettings());
+}
+
+// asctime() of the current second, cached per thread
+const char *GetLogTime() {
+  static thread_local time_t last = 0;
+  static thread_local char text[32] = "";
+  time_t now = time(NULL);
+  if (now != last) {
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    strftime(text, sizeof(text), "%a %b %e %H:%M:%S %Y", &timeinfo);
+    last = now;
   }
+  return text;
+}
 
-  // combine
-  string strOut =
-      strHeader + string(" ") + strTime + string(" ") + strMsg + string("\n");
+} // namespace
 
-  // display
-  cout << strOut;
+void LogStart(const LogSettings &settings) {
+  std::lock_guard<std::mutex> lock(g_log_lock);
+  StartLocked(settings);
+}
 
-// store
-#ifdef ENABLE_LOG_TOFILE
-  std::ofstream outfile;
-  outfile.open("benchapp.log", std::ios_base::app);
-  outfile << strOut;
-#endif
+void LogStop() {
+  std::lock_guard<std::mutex> lock(g_log_lock);
+  delete g_log.exchange(NULL);
+}
 
-  return;
+void LogFlush() {
+  AsyncLog *log = g_log.load(std::memory_order_acquire);
+  if (log)
+    log->flush();
+}
+
+size_t LogDropped() {
+  AsyncLog *log = g_log.load(std::memory_order_acquire);
+  return log ? log->dropped() : 0;
+}
+
+void LogWrapper(int etype, const char *file, int line, const char *desc, ...) {
+
+  // crop file name from full path
+  const char *name = strrchr(file, '/');
+  const char *backslash = strrchr(name ? name : file, '\\');
+  name = backslash ? backslash + 1 : (name ? name + 1 : file);
+
+  const char *type = "INFO";
+  if (etype == sda::etError)
+    type = "ERROR";
+  else if (etype == sda::etWarning)
+    type = "WARN";
+
+  // header and time, then the message itself
+  char record[LOG_RECORD_BYTES];
+#ifdef ENABLE_LOG_TIME
+  int len = snprintf(record, sizeof(record), "%s: [%s:%d] TIME: [%s] ", type,
+                     name, line, GetLogTime());
+#else
+  int len = snprintf(record, sizeof(record), "%s: [%s:%d]  ", type, name, line);
+#endif
+  if (len < 0)
+    return;
+  if ((size_t)len > sizeof(record) - 2)
+    len = sizeof(record) - 2;
+
+  va_list args;
+  va_start(args, desc);
+  int msg = vsnprintf(record + len, sizeof(record) - 1 - len, desc, args);
+  va_end(args);
+  if (msg > 0)
+    len += std::min<int>(msg, sizeof(record) - 2 - len);
+  record[len++] = '\n';
+
+  GetLog()->push(record, len, etype == sda::etError);
 }
 
 } // namespace sda
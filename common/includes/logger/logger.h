@@ -90,6 +90,38 @@ void PrintPOD(const vector<T> &pod, size_t display_count = 0,
 
 // logging
 void LogWrapper(int etype, const char *file, int line, const char *desc, ...);
+
+// Records are formatted on the calling thread and passed through a lock-free
+// queue to one writer thread, which keeps the log file open and writes in
+// batches. The backend starts with default settings on the first LogWrapper
+// call unless LogStart was called before, and is drained at exit.
+enum LOGOVERFLOW { eoBlock, eoDrop };
+
+struct LogSettings {
+  string filename;      // empty: no log file
+  bool echo;            // also print records on stdout
+  size_t capacity;      // queued records, rounded up to a power of two
+  LOGOVERFLOW overflow; // full queue: wait, or drop the record. Errors wait.
+
+  LogSettings()
+      : filename(
+#ifdef ENABLE_LOG_TOFILE
+            "benchapp.log"
+#endif
+            ),
+        echo(true), capacity(4096), overflow(eoBlock) {
+  }
+};
+
+// Restarts the backend with new settings after draining the current one.
+// LogStart and LogStop must not run concurrently with logging threads.
+void LogStart(const LogSettings &settings = LogSettings());
+// Drains the backend and closes the log file
+void LogStop();
+// Returns once every record logged before the call has been written
+void LogFlush();
+// Records dropped under eoDrop since the backend started
+size_t LogDropped();
 }
 
 #endif /* LOGGER_H_ */
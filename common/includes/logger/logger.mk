@@ -1,3 +1,4 @@
 logger_SRCS:=${COMMON_REPO}/common/includes/logger/logger.cpp
 logger_HDRS:=${COMMON_REPO}/common/includes/logger/logger.h
 logger_CXXFLAGS:=-I${COMMON_REPO}/common/includes/logger
+logger_LDFLAGS:=-lpthread
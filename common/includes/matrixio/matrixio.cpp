@@ -0,0 +1,626 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "matrixio.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+namespace matrixio {
+
+// Chunks per thread, so that uneven lines still balance
+static const int CHUNKS_PER_THREAD = 4;
+
+static void fail(const std::string &file_name, const std::string &what) {
+  printf("ERROR: %s: %s\n", file_name.c_str(), what.c_str());
+  exit(EXIT_FAILURE);
+}
+
+// Whole input file, mapped read-only
+class InputFile {
+public:
+  explicit InputFile(const std::string &file_name)
+      : m_data(nullptr), m_size(0) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+      fail(file_name, "cannot open file");
+    m_size = st.st_size;
+    if (m_size) {
+      void *ptr = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr == MAP_FAILED)
+        fail(file_name, "cannot map file");
+      m_data = (const char *)ptr;
+      madvise(ptr, m_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+  }
+  ~InputFile() {
+    if (m_data)
+      munmap((void *)m_data, m_size);
+  }
+  const char *begin() const { return m_data; }
+  const char *end() const { return m_data + m_size; }
+  size_t size() const { return m_size; }
+
+private:
+  InputFile(const InputFile &);
+  InputFile &operator=(const InputFile &);
+
+  const char *m_data;
+  size_t m_size;
+};
+
+static unsigned thread_count(const LoadOptions &options) {
+  unsigned n = options.threads ? options.threads
+                               : std::thread::hardware_concurrency();
+  return std::max(n, 1u);
+}
+
+// Runs fn(task) for every task in [0, tasks) on up to threads threads
+static void run_parallel(unsigned threads, size_t tasks,
+                         const std::function<void(size_t)> &fn) {
+  std::atomic<size_t> next(0);
+  auto work = [&] {
+    for (size_t t = next++; t < tasks; t = next++)
+      fn(t);
+  };
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < std::min<size_t>(threads, tasks); i++)
+    workers.push_back(std::thread(work));
+  work();
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+// Splits [begin, end) into about parts pieces that each start at a line
+static std::vector<const char *> split_lines(const char *begin,
+                                             const char *end, size_t parts) {
+  std::vector<const char *> cuts(1, begin);
+  size_t step = std::max<size_t>((end - begin) / std::max<size_t>(parts, 1),
+                                 1);
+  const char *p = begin;
+  while (end - p > (ptrdiff_t)step) {
+    const char *nl = (const char *)memchr(p + step, '\n', end - p - step);
+    if (!nl)
+      break;
+    p = nl + 1;
+    cuts.push_back(p);
+  }
+  cuts.push_back(end);
+  return cuts;
+}
+
+static inline bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char *skip_spaces(const char *p, const char *end) {
+  while (p < end && is_space(*p))
+    p++;
+  return p;
+}
+
+// White space up to the CSV delimiter, which may itself be a tab or a space
+static inline const char *skip_spaces(const char *p, const char *end,
+                                      char delimiter) {
+  while (p < end && is_space(*p) && *p != delimiter)
+    p++;
+  return p;
+}
+
+static inline const char *line_end(const char *p, const char *end) {
+  const char *nl = (const char *)memchr(p, '\n', end - p);
+  return nl ? nl : end;
+}
+
+// True when [p, e) holds something besides white space
+static inline bool has_content(const char *p, const char *e) {
+  return skip_spaces(p, e) < e;
+}
+
+// Number of non-blank lines in [begin, end); the comment character (if
+// any) also marks a line to skip
+static size_t count_lines(const char *begin, const char *end,
+                          char comment = 0) {
+  size_t n = 0;
+  for (const char *p = begin; p < end;) {
+    const char *e = line_end(p, end);
+    const char *q = skip_spaces(p, e);
+    if (q < e && *q != comment)
+      n++;
+    p = e + 1;
+  }
+  return n;
+}
+
+// Eight ASCII digits at once: bytes are loaded little-endian into a 64-bit
+// word, checked and combined pairwise (x10, x100, x10000)
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static inline bool load_eight_digits(const char *p, uint64_t &word) {
+  memcpy(&word, p, 8);
+  return (((word & 0xF0F0F0F0F0F0F0F0ULL) |
+           (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+          0x3333333333333333ULL);
+}
+
+static inline uint32_t parse_eight_digits(uint64_t word) {
+  const uint64_t mask = 0x000000FF000000FFULL;
+  const uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+  word -= 0x3030303030303030ULL;
+  word = (word * 10) + (word >> 8);
+  word = (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+  return (uint32_t)word;
+}
+#define MATRIXIO_SWAR 1
+#endif
+
+// Accumulates a run of digits into value, counting them in digits. Only
+// the first 19 digits fit; callers check digits before trusting value.
+static inline const char *scan_digits(const char *p, const char *end,
+                                      uint64_t &value, int &digits) {
+#ifdef MATRIXIO_SWAR
+  uint64_t word;
+  while (end - p >= 8 && load_eight_digits(p, word)) {
+    value = value * 100000000 + parse_eight_digits(word);
+    digits += 8;
+    p += 8;
+  }
+#endif
+  while (p < end && (unsigned)(*p - '0') < 10) {
+    value = value * 10 + (*p - '0');
+    digits++;
+    p++;
+  }
+  return p;
+}
+
+const char *parse_int(const char *p, const char *end, int64_t &value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  uint64_t v = 0;
+  int digits = 0;
+  p = scan_digits(p, end, v, digits);
+  if (digits == 0 || digits > 18)
+    return nullptr;
+  value = negative ? -(int64_t)v : (int64_t)v;
+  return p;
+}
+
+static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                               1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                               1e18, 1e19, 1e20, 1e21, 1e22};
+
+// strtod() on a NUL-terminated copy, for everything the fast path declines
+static const char *parse_double_slow(const char *p, const char *end,
+                                     double &value) {
+  char buf[128];
+  size_t n = std::min<size_t>(end - p, sizeof(buf) - 1);
+  memcpy(buf, p, n);
+  buf[n] = 0;
+  char *stop;
+  value = strtod(buf, &stop);
+  return stop == buf ? nullptr : p + (stop - buf);
+}
+
+const char *parse_double(const char *p, const char *end, double &value) {
+  const char *start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  p = scan_digits(p, end, mantissa, digits);
+  int exponent = 0;
+  if (p < end && *p == '.') {
+    int before = digits;
+    p = scan_digits(p + 1, end, mantissa, digits);
+    exponent = before - digits;
+  }
+  if (digits == 0)
+    return parse_double_slow(start, end, value); // inf, nan, ".e1", ...
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int64_t e;
+    const char *q = parse_int(p + 1, end, e);
+    if (!q || e > 1000 || e < -1000)
+      return parse_double_slow(start, end, value);
+    exponent += (int)e;
+    p = q;
+  }
+  // Exact when the mantissa and the power of ten are both exact doubles
+  if (digits > 19 || mantissa > (1ULL << 53) || exponent < -22 ||
+      exponent > 22)
+    return parse_double_slow(start, end, value);
+  double v = (double)mantissa;
+  v = exponent < 0 ? v / POW10[-exponent] : v * POW10[exponent];
+  value = negative ? -v : v;
+  return p;
+}
+
+template <typename T>
+static inline const char *parse_value(const char *p, const char *end,
+                                      T &value) {
+  if (std::is_integral<T>::value) {
+    int64_t v;
+    p = parse_int(p, end, v);
+    value = (T)v;
+  } else {
+    double v;
+    p = parse_double(p, end, v);
+    value = (T)v;
+  }
+  return p;
+}
+
+template <typename T>
+void load_csv(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options) {
+  InputFile file(file_name);
+  const char *begin = file.begin(), *end = file.end();
+  if (options.header && begin < end)
+    begin = std::min(line_end(begin, end) + 1, end);
+  while (begin < end && !has_content(begin, line_end(begin, end)))
+    begin = std::min(line_end(begin, end) + 1, end);
+  if (begin == end)
+    fail(file_name, "no data");
+
+  // The first line decides the number of columns. A white space
+  // delimiter may be repeated to align the columns, so fields are counted
+  int cols = 1;
+  const char *first_end = line_end(begin, end);
+  if (is_space(options.delimiter)) {
+    cols = 0;
+    for (const char *p = skip_spaces(begin, first_end); p < first_end;
+         p = skip_spaces(p, first_end)) {
+      while (p < first_end && !is_space(*p))
+        p++;
+      cols++;
+    }
+  } else {
+    for (const char *p = begin; p < first_end; p++)
+      cols += *p == options.delimiter;
+  }
+
+  unsigned threads = thread_count(options);
+  std::vector<const char *> cuts =
+      split_lines(begin, end, threads * CHUNKS_PER_THREAD);
+  size_t chunks = cuts.size() - 1;
+  // Pass 1: rows per chunk give each chunk its first row
+  std::vector<size_t> first_row(chunks + 1, 0);
+  run_parallel(threads, chunks, [&](size_t c) {
+    first_row[c + 1] = count_lines(cuts[c], cuts[c + 1]);
+  });
+  for (size_t c = 0; c < chunks; c++)
+    first_row[c + 1] += first_row[c];
+
+  m.rows = (int)first_row[chunks];
+  m.cols = cols;
+  m.data.resize((size_t)m.rows * cols);
+  // Pass 2: parse every chunk into its rows
+  run_parallel(threads, chunks, [&](size_t c) {
+    T *row = m.data.data() + first_row[c] * cols;
+    for (const char *p = cuts[c]; p < cuts[c + 1];) {
+      const char *e = line_end(p, cuts[c + 1]);
+      if (has_content(p, e)) {
+        for (int col = 0; col < cols; col++) {
+          p = skip_spaces(p, e);
+          const char *q = parse_value(p, e, row[col]);
+          if (!q)
+            fail(file_name, "bad number in row " +
+                                std::to_string((row - m.data.data()) / cols));
+          p = skip_spaces(q, e, options.delimiter);
+          if (col + 1 < cols) {
+            if (p == e || *p != options.delimiter)
+              fail(file_name, "expected " + std::to_string(cols) +
+                                  " fields in row " +
+                                  std::to_string((row - m.data.data()) / cols));
+            p++;
+          }
+        }
+        p = skip_spaces(p, e);
+        if (p != e)
+          fail(file_name, "extra fields in row " +
+                              std::to_string((row - m.data.data()) / cols));
+        row += cols;
+      }
+      p = e + 1;
+    }
+  });
+}
+
+template <typename T>
+void load_mtx(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options) {
+  InputFile file(file_name);
+  const char *p = file.begin(), *end = file.end();
+
+  // %%MatrixMarket matrix <format> <field> <symmetry>
+  const char *e = line_end(p, end);
+  std::string banner(p, e);
+  for (size_t i = 0; i < banner.size(); i++)
+    banner[i] = tolower(banner[i]);
+  char object[32], format[32], field[32], symmetry[32];
+  if (sscanf(banner.c_str(), "%%%%matrixmarket %31s %31s %31s %31s", object,
+             format, field, symmetry) != 4 ||
+      strcmp(object, "matrix") != 0)
+    fail(file_name, "not a Matrix Market file");
+  bool coordinate = strcmp(format, "coordinate") == 0;
+  bool pattern = strcmp(field, "pattern") == 0;
+  bool symmetric = strcmp(symmetry, "symmetric") == 0;
+  bool skew = strcmp(symmetry, "skew-symmetric") == 0;
+  if (!coordinate && strcmp(format, "array") != 0)
+    fail(file_name, "unknown format " + std::string(format));
+  if (strcmp(field, "complex") == 0 || strcmp(symmetry, "hermitian") == 0)
+    fail(file_name, "complex matrices are not supported");
+  if (!coordinate && (symmetric || skew))
+    fail(file_name, "symmetric array format is not supported");
+  if (std::is_integral<T>::value && !pattern &&
+      strcmp(field, "integer") != 0)
+    fail(file_name, std::string(field) + " values need a floating-point "
+                                         "matrix");
+
+  // Comments, then the size line
+  for (p = e + 1; p < end; p = line_end(p, end) + 1) {
+    const char *q = skip_spaces(p, line_end(p, end));
+    if (q < line_end(p, end) && *q != '%')
+      break;
+  }
+  if (p >= end)
+    fail(file_name, "missing size line");
+  e = line_end(p, end);
+  int64_t rows, cols, entries = 0;
+  const char *q = parse_int(skip_spaces(p, e), e, rows);
+  q = q ? parse_int(skip_spaces(q, e), e, cols) : nullptr;
+  if (q && coordinate)
+    q = parse_int(skip_spaces(q, e), e, entries);
+  if (!q || skip_spaces(q, e) != e || rows <= 0 || cols <= 0)
+    fail(file_name, "bad size line");
+  m.rows = (int)rows;
+  m.cols = (int)cols;
+  m.data.assign((size_t)rows * cols, T());
+  const char *body = std::min(e + 1, end);
+
+  unsigned threads = thread_count(options);
+  std::vector<const char *> cuts =
+      split_lines(body, end, threads * CHUNKS_PER_THREAD);
+  size_t chunks = cuts.size() - 1;
+  if (coordinate) {
+    // Entries say where they go, so the chunks are independent
+    std::atomic<int64_t> seen(0);
+    run_parallel(threads, chunks, [&](size_t c) {
+      int64_t n = 0;
+      for (const char *p = cuts[c]; p < cuts[c + 1];) {
+        const char *e = line_end(p, cuts[c + 1]);
+        const char *q = skip_spaces(p, e);
+        if (q < e && *q != '%') {
+          int64_t i, j;
+          T v = T(1);
+          q = parse_int(q, e, i);
+          q = q ? parse_int(skip_spaces(q, e), e, j) : nullptr;
+          if (q && !pattern)
+            q = parse_value(skip_spaces(q, e), e, v);
+          if (!q || skip_spaces(q, e) != e || i < 1 || i > rows || j < 1 ||
+              j > cols)
+            fail(file_name, "bad entry: " + std::string(p, e));
+          m.at(i - 1, j - 1) = v;
+          if ((symmetric || skew) && i != j)
+            m.at(j - 1, i - 1) = skew ? -v : v;
+          n++;
+        }
+        p = e + 1;
+      }
+      seen += n;
+    });
+    if (seen != entries)
+      fail(file_name, "expected " + std::to_string(entries) + " entries, found " +
+                          std::to_string((int64_t)seen));
+  } else {
+    // Dense values are listed column by column
+    std::vector<size_t> first(chunks + 1, 0);
+    run_parallel(threads, chunks, [&](size_t c) {
+      first[c + 1] = count_lines(cuts[c], cuts[c + 1], '%');
+    });
+    for (size_t c = 0; c < chunks; c++)
+      first[c + 1] += first[c];
+    if (first[chunks] != (size_t)rows * cols)
+      fail(file_name, "expected " + std::to_string(rows * cols) + " values");
+    run_parallel(threads, chunks, [&](size_t c) {
+      size_t k = first[c];
+      for (const char *p = cuts[c]; p < cuts[c + 1];) {
+        const char *e = line_end(p, cuts[c + 1]);
+        const char *q = skip_spaces(p, e);
+        if (q < e && *q != '%') {
+          q = parse_value(q, e, m.at(k % rows, k / rows));
+          if (!q || skip_spaces(q, e) != e)
+            fail(file_name, "bad value: " + std::string(p, e));
+          k++;
+        }
+        p = e + 1;
+      }
+    });
+  }
+}
+
+template <typename S, typename T>
+static void convert(const char *src, Matrix<T> &m, bool fortran,
+                    unsigned threads) {
+  size_t rows = m.rows, cols = m.cols;
+  size_t chunks = std::max<size_t>(1, threads * CHUNKS_PER_THREAD);
+  size_t per_chunk = (rows + chunks - 1) / chunks;
+  T *dst = m.data.data();
+  run_parallel(threads, chunks, [&](size_t c) {
+    size_t r0 = c * per_chunk, r1 = std::min(rows, r0 + per_chunk);
+    if (r0 >= r1)
+      return;
+    if (std::is_same<S, T>::value && !fortran) {
+      memcpy(dst + r0 * cols, src + r0 * cols * sizeof(S),
+             (r1 - r0) * cols * sizeof(S));
+      return;
+    }
+    for (size_t r = r0; r < r1; r++)
+      for (size_t col = 0; col < cols; col++) {
+        S v;
+        size_t i = fortran ? col * rows + r : r * cols + col;
+        memcpy(&v, src + i * sizeof(S), sizeof(S));
+        dst[r * cols + col] = (T)v;
+      }
+  });
+}
+
+template <typename T>
+void load_npy(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options) {
+  InputFile file(file_name);
+  const unsigned char *u = (const unsigned char *)file.begin();
+  if (file.size() < 10 || memcmp(u, "\x93NUMPY", 6) != 0)
+    fail(file_name, "not a .npy file");
+  size_t header_len, offset;
+  if (u[6] == 1) {
+    header_len = u[8] | (u[9] << 8);
+    offset = 10;
+  } else {
+    if (file.size() < 12)
+      fail(file_name, "not a .npy file");
+    header_len = u[8] | (u[9] << 8) | (u[10] << 16) | ((size_t)u[11] << 24);
+    offset = 12;
+  }
+  if (offset + header_len > file.size())
+    fail(file_name, "truncated header");
+  std::string dict(file.begin() + offset, header_len);
+  const char *data = file.begin() + offset + header_len;
+
+  // {'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }
+  size_t d = dict.find("'descr'");
+  size_t s = dict.find("'shape'");
+  if (d == std::string::npos || s == std::string::npos)
+    fail(file_name, "bad header");
+  d = dict.find('\'', d + 7);
+  std::string descr = dict.substr(d + 1, dict.find('\'', d + 1) - d - 1);
+  bool fortran = dict.find("'fortran_order': True") != std::string::npos;
+  std::vector<int64_t> shape;
+  const char *p = dict.c_str() + dict.find('(', s) + 1;
+  const char *e = dict.c_str() + dict.find(')', s);
+  while (p < e) {
+    p = skip_spaces(p, e);
+    int64_t n;
+    const char *q = parse_int(p, e, n);
+    if (!q)
+      break;
+    shape.push_back(n);
+    p = skip_spaces(q, e);
+    if (p < e && *p == ',')
+      p++;
+  }
+  if (shape.empty() || shape.size() > 2)
+    fail(file_name, "only 1-D and 2-D arrays are supported");
+  m.rows = shape.size() == 2 ? (int)shape[0] : 1;
+  m.cols = (int)shape.back();
+
+  if (descr.size() != 3 || descr[0] == '>')
+    fail(file_name, "unsupported dtype " + descr);
+  char kind = descr[1];
+  int bytes = descr[2] - '0';
+  if (file.size() - (offset + header_len) < (size_t)m.rows * m.cols * bytes)
+    fail(file_name, "truncated data");
+  m.data.resize((size_t)m.rows * m.cols);
+  unsigned threads = thread_count(options);
+  if (kind == 'f' && bytes == 4)
+    convert<float>(data, m, fortran, threads);
+  else if (kind == 'f' && bytes == 8)
+    convert<double>(data, m, fortran, threads);
+  else if (kind == 'i' && bytes == 1)
+    convert<int8_t>(data, m, fortran, threads);
+  else if (kind == 'i' && bytes == 2)
+    convert<int16_t>(data, m, fortran, threads);
+  else if (kind == 'i' && bytes == 4)
+    convert<int32_t>(data, m, fortran, threads);
+  else if (kind == 'i' && bytes == 8)
+    convert<int64_t>(data, m, fortran, threads);
+  else if (kind == 'u' && bytes == 1)
+    convert<uint8_t>(data, m, fortran, threads);
+  else if (kind == 'u' && bytes == 2)
+    convert<uint16_t>(data, m, fortran, threads);
+  else if (kind == 'u' && bytes == 4)
+    convert<uint32_t>(data, m, fortran, threads);
+  else
+    fail(file_name, "unsupported dtype " + descr);
+}
+
+template <typename T>
+void load_matrix(const std::string &file_name, Matrix<T> &m,
+                 const LoadOptions &options) {
+  std::string ext = file_name.substr(file_name.find_last_of('.') + 1);
+  for (size_t i = 0; i < ext.size(); i++)
+    ext[i] = tolower(ext[i]);
+  if (ext == "mtx")
+    load_mtx(file_name, m, options);
+  else if (ext == "npy")
+    load_npy(file_name, m, options);
+  else if (ext == "csv" || ext == "txt")
+    load_csv(file_name, m, options);
+  else
+    fail(file_name, "unknown matrix file extension");
+}
+
+#define MATRIXIO_INSTANTIATE(T)                                                \
+  template void load_mtx<T>(const std::string &, Matrix<T> &,                  \
+                            const LoadOptions &);                              \
+  template void load_npy<T>(const std::string &, Matrix<T> &,                  \
+                            const LoadOptions &);                              \
+  template void load_csv<T>(const std::string &, Matrix<T> &,                  \
+                            const LoadOptions &);                              \
+  template void load_matrix<T>(const std::string &, Matrix<T> &,               \
+                               const LoadOptions &);
+MATRIXIO_INSTANTIATE(int32_t)
+MATRIXIO_INSTANTIATE(float)
+MATRIXIO_INSTANTIATE(double)
+} // namespace matrixio
@@ -0,0 +1,97 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Loaders for matrices stored as Matrix Market (.mtx), NumPy (.npy) or CSV
+// files. The file is mapped and split into chunks at line boundaries, which
+// are parsed in parallel straight into page aligned, row-major storage that
+// can back a CL_MEM_USE_HOST_PTR buffer. Numbers are parsed eight digits at a
+// time with SWAR (SIMD within a register) arithmetic; anything unusual falls
+// back to strtod(). Errors are reported and exit, like the rest of the host
+// helpers. Supported element types are int32_t, float and double.
+namespace matrixio {
+
+template <typename T> struct Matrix {
+  int rows;
+  int cols;
+  std::vector<T, aligned_allocator<T>> data;
+
+  Matrix() : rows(0), cols(0) {}
+  T &at(int r, int c) { return data[(size_t)r * cols + c]; }
+  const T &at(int r, int c) const { return data[(size_t)r * cols + c]; }
+};
+
+// threads == 0 uses std::thread::hardware_concurrency()
+struct LoadOptions {
+  unsigned threads;
+  char delimiter; // CSV only; a space or tab may be repeated to align columns
+  bool header;    // CSV only: skip the first line
+
+  LoadOptions() : threads(0), delimiter(','), header(false) {}
+};
+
+// Coordinate (sparse) or array (dense) Matrix Market file; sparse entries are
+// scattered into a dense matrix, symmetric and skew-symmetric ones mirrored
+template <typename T>
+void load_mtx(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options = LoadOptions());
+
+// 1-D or 2-D .npy array of any little-endian int/float dtype, converted to T
+template <typename T>
+void load_npy(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options = LoadOptions());
+
+// One row per line, every line with the same number of fields
+template <typename T>
+void load_csv(const std::string &file_name, Matrix<T> &m,
+              const LoadOptions &options = LoadOptions());
+
+// Picks the loader from the file extension
+template <typename T>
+void load_matrix(const std::string &file_name, Matrix<T> &m,
+                 const LoadOptions &options = LoadOptions());
+
+// Number parsers used by the loaders. They parse one number starting at p,
+// not reading at or past end, and return the position after it or nullptr.
+const char *parse_int(const char *p, const char *end, int64_t &value);
+const char *parse_double(const char *p, const char *end, double &value);
+} // namespace matrixio
@@ -0,0 +1,4 @@
+matrixio_SRCS:=${COMMON_REPO}/common/includes/matrixio/matrixio.cpp
+matrixio_HDRS:=${COMMON_REPO}/common/includes/matrixio/matrixio.hpp
+matrixio_CXXFLAGS:=-I${COMMON_REPO}/common/includes/matrixio -I${COMMON_REPO}/common/includes/xcl2
+matrixio_LDFLAGS:=-lpthread
@@ -37,6 +37,12 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fstream>
 #include <iostream>
 #include <vector>
+#if !defined(_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //
 // Load file to memory
@@ -56,6 +62,8 @@ static int loadFile2Memory(const char *filename, char **result) {
   *result = new char[size + 1];
   stream.read(*result, size);
   if (!stream) {
+    delete[] *result;
+    *result = 0;
     return -2;
   }
   stream.close();
@@ -63,6 +71,48 @@ static int loadFile2Memory(const char *filename, char **result) {
   return size;
 }
 
+//
+// Map file to memory without copying it. *mapped tells the caller whether to
+// release the result with unmapFile() or with delete[]; when mmap is not
+// available this falls back to loadFile2Memory().
+//
+static int mapFile2Memory(const char *filename, char **result, bool *mapped) {
+  *mapped = false;
+#if !defined(_WINDOWS)
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void *ptr = mmap(0, st.st_size, PROT_READ, flags, fd, 0);
+    if (ptr != MAP_FAILED) {
+      close(fd);
+      madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+      *result = (char *)ptr;
+      *mapped = true;
+      return st.st_size;
+    }
+  }
+  close(fd);
+#endif
+  return loadFile2Memory(filename, result);
+}
+
+static void unmapFile(char *data, int size, bool mapped) {
+#if !defined(_WINDOWS)
+  if (mapped) {
+    munmap(data, size);
+    return;
+  }
+#endif
+  delete[] data;
+}
+
 //
 // Get device version
 //
@@ -184,23 +234,29 @@ int getOclSoftware(oclSoftware &software, const oclHardware &hardware) {
   }
 
   unsigned char *kernelCode = 0;
+  bool mapped = false;
   std::cout << "Loading " << software.mFileName << "\n";
 
-  int size = loadFile2Memory(software.mFileName, (char **)&kernelCode);
+  int size =
+      mapFile2Memory(software.mFileName, (char **)&kernelCode, &mapped);
   if (size < 0) {
     std::cout << "Failed to load kernel\n";
     return -2;
   }
 
+  // The runtime keeps its own copy of the binary or source, so the mapping
+  // can be dropped as soon as the program object exists
+  size_t n = size;
   if (deviceType == CL_DEVICE_TYPE_ACCELERATOR) {
-    size_t n = size;
     software.mProgram =
         clCreateProgramWithBinary(hardware.mContext, 1, &hardware.mDevice, &n,
                                   (const unsigned char **)&kernelCode, 0, &err);
   } else {
+    // A mapping is not NUL terminated, so pass the length explicitly
     software.mProgram = clCreateProgramWithSource(
-        hardware.mContext, 1, (const char **)&kernelCode, 0, &err);
+        hardware.mContext, 1, (const char **)&kernelCode, &n, &err);
   }
+  unmapFile((char *)kernelCode, size, mapped);
   if (!software.mProgram || (err != CL_SUCCESS)) {
     std::cout << oclErrorCode(err) << "\n";
     return -3;
@@ -213,7 +269,6 @@ int getOclSoftware(oclSoftware &software, const oclHardware &hardware) {
     return -4;
   }
 
-  delete[] kernelCode;
   return 0;
 }
 
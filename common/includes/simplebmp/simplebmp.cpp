@@ -33,79 +33,61 @@ THIS SOFTWARE,
 EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 **********/
 #include "simplebmp.h"
+#include <condition_variable>
+#include <mutex>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 
-int writebmp(char *filename, struct bmp_t *bitmap) {
-  // 24 bpp uncompressed
-
-  FILE *fp = fopen(filename, "w+b");
-  if (fp == NULL)
-    return -1;
-
+static void fillheader(struct bmpheader_t *header, uint32_t width,
+                       uint32_t height) {
   // compute dib entries
-  bitmap->header.dibheadersize = 40;
-  bitmap->header.dibwidth = bitmap->width;
-  bitmap->header.dibheight = bitmap->height;
-  bitmap->header.dibplane = 1;
-  bitmap->header.dibdepth = 24;
-  bitmap->header.dibcompression = 0;
-  bitmap->header.dibsize =
-      (bitmap->width) * (bitmap->height) * (bitmap->header.dibdepth / 8);
-  bitmap->header.dibhor = 2835;
-  bitmap->header.dibver = 2835;
-  bitmap->header.dibpal = 0;
-  bitmap->header.dibimportant = 0;
+  header->dibheadersize = 40;
+  header->dibwidth = width;
+  header->dibheight = height;
+  header->dibplane = 1;
+  header->dibdepth = 24;
+  header->dibcompression = 0;
+  header->dibsize = width * height * (header->dibdepth / 8);
+  header->dibhor = 2835;
+  header->dibver = 2835;
+  header->dibpal = 0;
+  header->dibimportant = 0;
 
   // compute header entries
-  bitmap->header.headerB = 'B';
-  bitmap->header.headerM = 'M';
-  bitmap->header.headerpixelsoffset = 54;
-  bitmap->header.headerbmpsize =
-      bitmap->header.dibsize + bitmap->header.headerpixelsoffset;
-  bitmap->header.headerapp0 = 0;
-  bitmap->header.headerapp1 = 0;
+  header->headerB = 'B';
+  header->headerM = 'M';
+  header->headerpixelsoffset = 54;
+  header->headerbmpsize = header->dibsize + header->headerpixelsoffset;
+  header->headerapp0 = 0;
+  header->headerapp1 = 0;
+}
 
+static void writeheader(FILE *fp, struct bmpheader_t *header) {
   // write header
-  fwrite(&(bitmap->header.headerB), 1, 1, fp);
-  fwrite(&(bitmap->header.headerM), 1, 1, fp);
-  fwrite(&(bitmap->header.headerbmpsize), 4, 1, fp);
-  fwrite(&(bitmap->header.headerapp0), 2, 1, fp);
-  fwrite(&(bitmap->header.headerapp1), 2, 1, fp);
-  fwrite(&(bitmap->header.headerpixelsoffset), 4, 1, fp);
+  fwrite(&(header->headerB), 1, 1, fp);
+  fwrite(&(header->headerM), 1, 1, fp);
+  fwrite(&(header->headerbmpsize), 4, 1, fp);
+  fwrite(&(header->headerapp0), 2, 1, fp);
+  fwrite(&(header->headerapp1), 2, 1, fp);
+  fwrite(&(header->headerpixelsoffset), 4, 1, fp);
 
   // write dib header
-  fwrite(&(bitmap->header.dibheadersize), 4, 1, fp);
-  fwrite(&(bitmap->header.dibwidth), 4, 1, fp);
-  fwrite(&(bitmap->header.dibheight), 4, 1, fp);
-  fwrite(&(bitmap->header.dibplane), 2, 1, fp);
-  fwrite(&(bitmap->header.dibdepth), 2, 1, fp);
-  fwrite(&(bitmap->header.dibcompression), 4, 1, fp);
-  fwrite(&(bitmap->header.dibsize), 4, 1, fp);
-  fwrite(&(bitmap->header.dibhor), 4, 1, fp);
-  fwrite(&(bitmap->header.dibver), 4, 1, fp);
-  fwrite(&(bitmap->header.dibpal), 4, 1, fp);
-  fwrite(&(bitmap->header.dibimportant), 4, 1, fp);
-
-  // write pixels
-  fwrite(bitmap->pixels, bitmap->header.dibsize, 1, fp);
-
-  if (ferror(fp))
-    return -1;
-
-  fclose(fp);
-  return 0;
+  fwrite(&(header->dibheadersize), 4, 1, fp);
+  fwrite(&(header->dibwidth), 4, 1, fp);
+  fwrite(&(header->dibheight), 4, 1, fp);
+  fwrite(&(header->dibplane), 2, 1, fp);
+  fwrite(&(header->dibdepth), 2, 1, fp);
+  fwrite(&(header->dibcompression), 4, 1, fp);
+  fwrite(&(header->dibsize), 4, 1, fp);
+  fwrite(&(header->dibhor), 4, 1, fp);
+  fwrite(&(header->dibver), 4, 1, fp);
+  fwrite(&(header->dibpal), 4, 1, fp);
+  fwrite(&(header->dibimportant), 4, 1, fp);
 }
 
-int readbmp(char *filename, struct bmp_t *bitmap) {
-  //-1 file access error
-  //-2 invalid BMP
-  //-3 memory allocation error
-  FILE *fp = fopen(filename, "r+b");
-  if (fp == NULL)
-    return -1;
-
+static int readheader(FILE *fp, struct bmp_t *bitmap) {
   // read header
   fread(&(bitmap->header.headerB), 1, 1, fp);
   fread(&(bitmap->header.headerM), 1, 1, fp);
@@ -163,16 +145,229 @@ int readbmp(char *filename, struct bmp_t *bitmap) {
     return -2;
   if (bitmap->header.dibimportant != 0)
     return -2;
+  return 0;
+}
+
+int writebmp(char *filename, struct bmp_t *bitmap) {
+  // 24 bpp uncompressed
+
+  FILE *fp = fopen(filename, "w+b");
+  if (fp == NULL)
+    return -1;
+
+  fillheader(&(bitmap->header), bitmap->width, bitmap->height);
+  writeheader(fp, &(bitmap->header));
+
+  // write pixels
+  fwrite(bitmap->pixels, bitmap->header.dibsize, 1, fp);
+
+  if (ferror(fp)) {
+    fclose(fp);
+    return -1;
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+int readbmp(char *filename, struct bmp_t *bitmap) {
+  //-1 file access error
+  //-2 invalid BMP
+  //-3 memory allocation error
+  FILE *fp = fopen(filename, "r+b");
+  if (fp == NULL)
+    return -1;
+
+  int err = readheader(fp, bitmap);
+  if (err) {
+    fclose(fp);
+    return err;
+  }
 
   // read pixels
   bitmap->pixels = (uint32_t *)malloc(bitmap->header.dibsize);
-  if (bitmap->pixels == NULL)
+  if (bitmap->pixels == NULL) {
+    fclose(fp);
     return -3;
+  }
   fread(bitmap->pixels, bitmap->header.dibsize, 1, fp);
 
-  if (ferror(fp))
+  if (ferror(fp)) {
+    fclose(fp);
+    return -1;
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+namespace {
+// Two band buffers handed back and forth between the reader thread and the
+// caller. full[i] is set by the reader once buffer i holds a band and cleared
+// by the caller once the callback is done with it.
+struct band_queue_t {
+  std::mutex lock;
+  std::condition_variable cv;
+  uint8_t *buffer[2];
+  uint32_t rows[2];
+  bool full[2];
+  bool failed;
+  bool stop;
+};
+
+void read_bands(FILE *fp, band_queue_t *queue, size_t rowbytes,
+                uint32_t bandrows, uint32_t height) {
+  int slot = 0;
+  for (uint32_t row = 0; row < height; row += bandrows) {
+    {
+      std::unique_lock<std::mutex> guard(queue->lock);
+      queue->cv.wait(guard,
+                     [&] { return !queue->full[slot] || queue->stop; });
+      if (queue->stop)
+        return;
+    }
+    uint32_t rows = height - row < bandrows ? height - row : bandrows;
+    size_t got = fread(queue->buffer[slot], rowbytes, rows, fp);
+    {
+      std::lock_guard<std::mutex> guard(queue->lock);
+      if (got != rows)
+        queue->failed = true;
+      queue->rows[slot] = rows;
+      queue->full[slot] = !queue->failed;
+    }
+    queue->cv.notify_all();
+    if (got != rows)
+      return;
+    slot ^= 1;
+  }
+}
+} // namespace
+
+int readbmp_bands(char *filename, struct bmp_t *bitmap, uint32_t bandrows,
+                  bmp_band_callback callback, void *user) {
+  //-1 file access error
+  //-2 invalid BMP
+  //-3 memory allocation error
+  if (bandrows == 0)
+    return -2;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
     return -1;
 
+  int err = readheader(fp, bitmap);
+  bitmap->pixels = NULL;
+  if (err) {
+    fclose(fp);
+    return err;
+  }
+  if (bitmap->height < bandrows)
+    bandrows = bitmap->height ? bitmap->height : 1;
+
+  size_t rowbytes = (size_t)bitmap->width * 3;
+  band_queue_t queue;
+  queue.buffer[0] = (uint8_t *)malloc(rowbytes * bandrows);
+  queue.buffer[1] = (uint8_t *)malloc(rowbytes * bandrows);
+  if (queue.buffer[0] == NULL || queue.buffer[1] == NULL) {
+    free(queue.buffer[0]);
+    free(queue.buffer[1]);
+    fclose(fp);
+    return -3;
+  }
+  queue.full[0] = queue.full[1] = false;
+  queue.failed = queue.stop = false;
+
+  std::thread reader(read_bands, fp, &queue, rowbytes, bandrows,
+                     bitmap->height);
+
+  int slot = 0;
+  for (uint32_t row = 0; row < bitmap->height && err == 0; row += bandrows) {
+    struct bmp_band_t band;
+    {
+      std::unique_lock<std::mutex> guard(queue.lock);
+      queue.cv.wait(guard, [&] { return queue.full[slot] || queue.failed; });
+      if (!queue.full[slot]) {
+        err = -1;
+        break;
+      }
+      band.firstrow = row;
+      band.rows = queue.rows[slot];
+      band.data = queue.buffer[slot];
+    }
+    err = callback(&band, user);
+    {
+      std::lock_guard<std::mutex> guard(queue.lock);
+      queue.full[slot] = false;
+    }
+    queue.cv.notify_all();
+    slot ^= 1;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.stop = true;
+  }
+  queue.cv.notify_all();
+  reader.join();
+
+  free(queue.buffer[0]);
+  free(queue.buffer[1]);
   fclose(fp);
+  return err;
+}
+
+struct bmp_writer_t {
+  FILE *fp;
+  uint32_t width;
+  uint32_t height;
+  uint32_t written;
+};
+
+int writebmp_begin(char *filename, uint32_t width, uint32_t height,
+                   struct bmp_writer_t **writer) {
+  // 24 bpp uncompressed
+  *writer = NULL;
+  struct bmp_writer_t *w =
+      (struct bmp_writer_t *)malloc(sizeof(struct bmp_writer_t));
+  if (w == NULL)
+    return -3;
+  w->fp = fopen(filename, "w+b");
+  if (w->fp == NULL) {
+    free(w);
+    return -1;
+  }
+  w->width = width;
+  w->height = height;
+  w->written = 0;
+
+  struct bmpheader_t header;
+  fillheader(&header, width, height);
+  writeheader(w->fp, &header);
+  if (ferror(w->fp)) {
+    fclose(w->fp);
+    free(w);
+    return -1;
+  }
+  *writer = w;
   return 0;
 }
+
+int writebmp_band(struct bmp_writer_t *writer, const void *data,
+                  uint32_t rows) {
+  if (rows > writer->height - writer->written)
+    return -2;
+  size_t rowbytes = (size_t)writer->width * 3;
+  if (fwrite(data, rowbytes, rows, writer->fp) != rows)
+    return -1;
+  writer->written += rows;
+  return 0;
+}
+
+int writebmp_end(struct bmp_writer_t *writer) {
+  int err = 0;
+  if (writer->written != writer->height)
+    err = -2;
+  if (fclose(writer->fp) != 0 && err == 0)
+    err = -1;
+  free(writer);
+  return err;
+}
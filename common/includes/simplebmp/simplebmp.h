@@ -39,6 +39,8 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef __SIMPLE_BMP
 #define __SIMPLE_BMP
 
+#include <stdint.h>
+
 struct bmpheader_t {
   // Header
   char headerB;
@@ -76,4 +78,33 @@ int readbmp(char *filename, struct bmp_t *bitmap);
 //-2 invalid BMP
 //-3 memory allocation error
 
+// Incremental access for images too large to hold twice. Rows are in file
+// order (bottom row first for a positive height), width * 3 bytes each.
+struct bmp_band_t {
+  uint32_t firstrow; // index of the band's first row in the file
+  uint32_t rows;
+  const uint8_t *data; // rows * width * 3 bytes, valid during the callback
+};
+
+// Returns 0 to continue, anything else stops reading and is returned by
+// readbmp_bands
+typedef int (*bmp_band_callback)(const struct bmp_band_t *band, void *user);
+
+// Reads the header into bitmap (pixels is left NULL) and then hands the
+// pixels to callback in bands of bandrows rows. Two band buffers alternate:
+// a reader thread fills the next band while callback runs on the current
+// one, so memory stays at two bands and work starts after the first band.
+int readbmp_bands(char *filename, struct bmp_t *bitmap, uint32_t bandrows,
+                  bmp_band_callback callback, void *user);
+
+// Streaming writer: writebmp_begin writes the header of a width x height
+// image, writebmp_band appends rows in file order and writebmp_end checks
+// that all rows arrived and closes the file.
+struct bmp_writer_t;
+int writebmp_begin(char *filename, uint32_t width, uint32_t height,
+                   struct bmp_writer_t **writer);
+int writebmp_band(struct bmp_writer_t *writer, const void *data,
+                  uint32_t rows);
+int writebmp_end(struct bmp_writer_t *writer);
+
 #endif
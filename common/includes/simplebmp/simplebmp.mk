@@ -1,3 +1,4 @@
 simplebmp_SRCS:=${COMMON_REPO}/common/includes/simplebmp/simplebmp.cpp
 simplebmp_HDRS:=${COMMON_REPO}/common/includes/simplebmp/simplebmp.h
 simplebmp_CXXFLAGS:=-I${COMMON_REPO}/common/includes/simplebmp
+simplebmp_LDFLAGS:=-lpthread
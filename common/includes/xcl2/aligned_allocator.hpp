@@ -0,0 +1,285 @@
+/**********
+Copyright (c) 2018, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// When creating a buffer with user pointer (CL_MEM_USE_HOST_PTR), under the
+// hood
+// User ptr is used if and only if it is properly aligned (page aligned). When
+// not
+// aligned, runtime has no choice but to create its own host side buffer that
+// backs
+// user ptr. This in turn implies that all operations that move data to and from
+// device incur an extra memcpy to move data to/from runtime's own host buffer
+// from/to user pointer. So it is recommended to use this allocator if user wish
+// to
+// Create Buffer/Memory Object with CL_MEM_USE_HOST_PTR to align user buffer to
+// the
+// page boundary. It will ensure that user buffer will be used when user create
+// Buffer/Mem Object with CL_MEM_USE_HOST_PTR.
+//
+// The second template argument selects where the pages come from. The default
+// keeps the original 4 KB page aligned allocation. On Linux the policies below
+// add huge pages, which cut TLB misses on large matrices (a 16k x 16k int
+// matrix spans 256k 4 KB pages but only 512 2 MB pages), and NUMA placement.
+// Policies compose, e.g. NumaInterleave<HugePages2M>.
+namespace xcl {
+
+// 4 KB aligned heap memory
+struct PageAligned {
+  static void *allocate(std::size_t bytes) {
+    void *ptr = nullptr;
+#if defined(_WINDOWS)
+    ptr = _aligned_malloc(bytes, 4096);
+    if (ptr == NULL) {
+      std::cout << "Failed to allocate memory" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+#else
+    if (posix_memalign(&ptr, 4096, bytes))
+      throw std::bad_alloc();
+#endif
+    return ptr;
+  }
+  static void deallocate(void *ptr, std::size_t) {
+#if defined(_WINDOWS)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+};
+
+#if defined(__linux__)
+
+namespace detail {
+const std::size_t huge_page_2m = std::size_t(1) << 21;
+
+inline std::size_t round_up(std::size_t bytes, std::size_t page) {
+  return (bytes + page - 1) / page * page;
+}
+
+// Anonymous mapping aligned to 2 MB so that it can be backed by transparent
+// huge pages from its first byte. The length is rounded up to granule, a
+// multiple of 2 MB.
+inline void *map_thp(std::size_t bytes, std::size_t granule = huge_page_2m) {
+  std::size_t len = round_up(bytes, granule);
+  char *raw = (char *)mmap(NULL, len + huge_page_2m, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    throw std::bad_alloc();
+  char *start = (char *)round_up((std::size_t)raw, huge_page_2m);
+  if (start > raw)
+    munmap(raw, start - raw);
+  char *end = raw + len + huge_page_2m;
+  if (end > start + len)
+    munmap(start + len, end - (start + len));
+#ifdef MADV_HUGEPAGE
+  madvise(start, len, MADV_HUGEPAGE);
+#endif
+  return start;
+}
+
+// mbind() without a libnuma dependency
+inline void set_numa_policy(void *ptr, std::size_t bytes, int mode,
+                            unsigned long nodemask) {
+#ifdef SYS_mbind
+  if (syscall(SYS_mbind, ptr, bytes, mode, &nodemask,
+              sizeof(nodemask) * 8, 0) != 0) {
+    static bool warned = false;
+    if (!warned) {
+      std::cerr << "WARNING: mbind failed, using default NUMA placement"
+                << std::endl;
+      warned = true;
+    }
+  }
+#endif
+}
+} // namespace detail
+
+// Transparent huge pages: 2 MB aligned mapping with madvise(MADV_HUGEPAGE).
+// Whether huge pages back it depends on the kernel's THP availability.
+struct TransparentHugePages {
+  static void *allocate(std::size_t bytes) { return detail::map_thp(bytes); }
+  static void deallocate(void *ptr, std::size_t bytes) {
+    munmap(ptr, detail::round_up(bytes, detail::huge_page_2m));
+  }
+};
+
+// Explicit huge pages from the hugetlbfs pool (MAP_HUGETLB) of size
+// 2^Log2PageSize. When the pool is empty this warns once and falls back to
+// transparent huge pages.
+template <int Log2PageSize> struct HugeTLB {
+  static void *allocate(std::size_t bytes) {
+    std::size_t len = detail::round_up(bytes, std::size_t(1) << Log2PageSize);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+    flags |= Log2PageSize << MAP_HUGE_SHIFT;
+#endif
+    void *ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr != MAP_FAILED)
+      return ptr;
+    static bool warned = false;
+    if (!warned) {
+      std::cerr << "WARNING: no " << (1 << (Log2PageSize - 20))
+                << " MB huge pages available (see /proc/sys/vm/nr_hugepages),"
+                << " falling back to transparent huge pages" << std::endl;
+      warned = true;
+    }
+    // Same length as the huge page mapping, so deallocate() needs not know
+    // which one it got
+    return detail::map_thp(bytes, len);
+  }
+  static void deallocate(void *ptr, std::size_t bytes) {
+    std::size_t len = detail::round_up(bytes, std::size_t(1) << Log2PageSize);
+    munmap(ptr, len);
+  }
+};
+typedef HugeTLB<21> HugePages2M;
+typedef HugeTLB<30> HugePages1G;
+
+// Interleaves the pages of every allocation across all NUMA nodes
+template <typename Base = PageAligned> struct NumaInterleave {
+  static void *allocate(std::size_t bytes) {
+    void *ptr = Base::allocate(bytes);
+    detail::set_numa_policy(ptr, bytes, 3 /* MPOL_INTERLEAVE */, ~0UL);
+    return ptr;
+  }
+  static void deallocate(void *ptr, std::size_t bytes) {
+    Base::deallocate(ptr, bytes);
+  }
+};
+
+// Places the pages of every allocation on NUMA node Node
+template <int Node, typename Base = PageAligned> struct NumaBind {
+  static void *allocate(std::size_t bytes) {
+    void *ptr = Base::allocate(bytes);
+    detail::set_numa_policy(ptr, bytes, 2 /* MPOL_BIND */, 1UL << Node);
+    return ptr;
+  }
+  static void deallocate(void *ptr, std::size_t bytes) {
+    Base::deallocate(ptr, bytes);
+  }
+};
+
+#else
+
+// Huge pages and NUMA placement are Linux only; elsewhere they are plain
+// page aligned allocations.
+typedef PageAligned TransparentHugePages;
+typedef PageAligned HugePages2M;
+typedef PageAligned HugePages1G;
+template <typename Base = PageAligned> struct NumaInterleave : Base {};
+template <int Node, typename Base = PageAligned> struct NumaBind : Base {};
+
+#endif
+
+// Zero-fills new memory from one thread per core, each on its own contiguous
+// slice, so that first-touch placement spreads the pages over the nodes the
+// threads run on instead of the node of the allocating thread.
+template <typename Base = PageAligned> struct ParallelFirstTouch {
+  static void *allocate(std::size_t bytes) {
+    char *ptr = (char *)Base::allocate(bytes);
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads < 2 || bytes < (std::size_t(1) << 21)) {
+      memset(ptr, 0, bytes);
+      return ptr;
+    }
+    std::size_t slice = (bytes + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+      std::size_t first = t * slice;
+      if (first >= bytes)
+        break;
+      std::size_t len = std::min(slice, bytes - first);
+      workers.push_back(std::thread([=] { memset(ptr + first, 0, len); }));
+    }
+    for (std::size_t t = 0; t < workers.size(); t++)
+      workers[t].join();
+    return ptr;
+  }
+  static void deallocate(void *ptr, std::size_t bytes) {
+    Base::deallocate(ptr, bytes);
+  }
+};
+} // namespace xcl
+
+template <typename T, typename Policy = xcl::PageAligned>
+struct aligned_allocator {
+  using value_type = T;
+
+  aligned_allocator() {}
+
+  aligned_allocator(const aligned_allocator &) {}
+
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Policy> &) {}
+
+  template <typename U> struct rebind {
+    typedef aligned_allocator<U, Policy> other;
+  };
+
+  T *allocate(std::size_t num) {
+    return reinterpret_cast<T *>(Policy::allocate(num * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t num) {
+    Policy::deallocate(p, num * sizeof(T));
+  }
+};
+
+template <typename T, typename U, typename Policy>
+bool operator==(const aligned_allocator<T, Policy> &,
+                const aligned_allocator<U, Policy> &) {
+  return true;
+}
+
+template <typename T, typename U, typename Policy>
+bool operator!=(const aligned_allocator<T, Policy> &,
+                const aligned_allocator<U, Policy> &) {
+  return false;
+}
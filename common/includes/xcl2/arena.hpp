@@ -0,0 +1,129 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// A bump allocator over one page aligned region per job. Matrices and
+// pack/scratch buffers are carved out with alloc<T>(n), and reset() returns
+// the whole region in O(1) for the next job. Unlike a vector, alloc() does
+// not zero-fill. Because a job of the same shape gets back the same
+// addresses after reset(), CL_MEM_USE_HOST_PTR buffers over them can be
+// pooled by xcl::DeviceSession::buffer() and stay pinned across jobs.
+//
+// Policy is one of the aligned_allocator page policies, e.g.
+// BasicArena<HugePages2M>.
+namespace xcl {
+
+template <typename Policy = PageAligned> class BasicArena {
+public:
+  // Each carved buffer starts on its own page so that it can back a
+  // CL_MEM_USE_HOST_PTR buffer.
+  static const size_t ALIGNMENT = 4096;
+
+  explicit BasicArena(size_t capacity = 0)
+      : m_base(nullptr), m_capacity(0), m_used(0), m_high_water(0) {
+    reserve(capacity);
+  }
+  ~BasicArena() { release(); }
+
+  BasicArena(const BasicArena &) = delete;
+  BasicArena &operator=(const BasicArena &) = delete;
+
+  // Makes sure the region holds at least bytes. Growing replaces the region,
+  // so it is only allowed while nothing is carved out; buffers pooled over
+  // the old region must be released first.
+  void reserve(size_t bytes) {
+    bytes = round_up(bytes);
+    if (bytes <= m_capacity)
+      return;
+    if (m_used) {
+      std::cout << "Arena: cannot grow while " << m_used << " bytes are in use"
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    release();
+    m_base = (char *)Policy::allocate(bytes);
+    m_capacity = bytes;
+  }
+
+  // Bytes needed to carve out count elements of T, including alignment
+  template <typename T> static size_t footprint(size_t count) {
+    return round_up(count * sizeof(T));
+  }
+
+  template <typename T> T *alloc(size_t count) {
+    size_t bytes = footprint<T>(count);
+    if (m_used + bytes > m_capacity) {
+      std::cout << "Arena: out of memory, " << m_used << " + " << bytes
+                << " > " << m_capacity << " bytes" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    T *ptr = reinterpret_cast<T *>(m_base + m_used);
+    m_used += bytes;
+    if (m_used > m_high_water)
+      m_high_water = m_used;
+    return ptr;
+  }
+
+  void reset() { m_used = 0; }
+
+  size_t used() const { return m_used; }
+  size_t capacity() const { return m_capacity; }
+  size_t high_water() const { return m_high_water; }
+
+private:
+  static size_t round_up(size_t bytes) {
+    return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+  void release() {
+    if (m_base)
+      Policy::deallocate(m_base, m_capacity);
+    m_base = nullptr;
+    m_capacity = 0;
+  }
+
+  char *m_base;
+  size_t m_capacity;
+  size_t m_used;
+  size_t m_high_water;
+};
+
+typedef BasicArena<> Arena;
+} // namespace xcl
@@ -0,0 +1,201 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "device_session.hpp"
+#include <sys/stat.h>
+
+namespace xcl {
+
+// 64-bit FNV-1a, only used to tell xclbin images apart
+static uint64_t fnv1a(const unsigned char *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+DeviceSession::DeviceSession(cl_command_queue_properties props)
+    : m_props(props), m_has_device(false), m_program_count(0) {}
+
+DeviceSession &DeviceSession::instance() {
+  static DeviceSession session;
+  return session;
+}
+
+cl::Program DeviceSession::program(const std::string &xclbin_file) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t hash;
+  return program_locked(xclbin_file, &hash);
+}
+
+cl::Program DeviceSession::program_locked(const std::string &xclbin_file,
+                                          uint64_t *hash_out) {
+  // Skip reading the file when it has not changed since the last call
+  struct stat st;
+  bool have_stat = stat(xclbin_file.c_str(), &st) == 0;
+  std::map<std::string, FileStamp>::iterator stamp =
+      m_stamps.find(xclbin_file);
+  if (have_stat && stamp != m_stamps.end() &&
+      stamp->second.mtime == st.st_mtime && stamp->second.size == st.st_size) {
+    std::map<uint64_t, cl::Program>::iterator it =
+        m_programs.find(stamp->second.hash);
+    if (it != m_programs.end()) {
+      *hash_out = it->first;
+      return it->second;
+    }
+  }
+
+  // Map rather than copy the xclbin; the pages are only needed until the
+  // program has been created
+  xcl::MappedFile fileBuf = xcl::map_binary_file(xclbin_file);
+  uint64_t hash = fnv1a(fileBuf.data(), fileBuf.size());
+  *hash_out = hash;
+  if (have_stat) {
+    FileStamp fs = {st.st_mtime, st.st_size, hash};
+    m_stamps[xclbin_file] = fs;
+  }
+  std::map<uint64_t, cl::Program>::iterator it = m_programs.find(hash);
+  if (it != m_programs.end())
+    return it->second;
+
+  cl::Program::Binaries bins = xcl::binaries(fileBuf);
+  cl_int err;
+  cl::Program program;
+  if (m_has_device) {
+    // The device holds a single image, so handles to the old one are stale
+    m_programs.clear();
+    m_kernels.clear();
+    std::cout << "Reprogramming device: "
+              << m_device.getInfo<CL_DEVICE_NAME>() << std::endl;
+    OCL_CHECK(err, program = cl::Program(m_context, {m_device}, bins, NULL,
+                                         &err));
+  } else {
+    auto devices = xcl::get_xil_devices();
+    for (unsigned int i = 0; i < devices.size(); i++) {
+      auto device = devices[i];
+      // Creating Context and Command Queue for selected Device
+      OCL_CHECK(err, m_context = cl::Context(device, NULL, NULL, NULL, &err));
+      OCL_CHECK(err,
+                m_queue = cl::CommandQueue(m_context, device, m_props, &err));
+
+      std::cout << "Trying to program device[" << i
+                << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
+      program = cl::Program(m_context, {device}, bins, NULL, &err);
+      if (err != CL_SUCCESS) {
+        std::cout << "Failed to program device[" << i
+                  << "] with xclbin file!\n";
+      } else {
+        std::cout << "Device[" << i << "]: program successful!\n";
+        m_device = device;
+        m_has_device = true;
+        break; // we break because we found a valid device
+      }
+    }
+    if (!m_has_device) {
+      std::cout << "Failed to program any device found, exit!\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+  m_program_count++;
+  m_programs[hash] = program;
+  return program;
+}
+
+cl::Kernel DeviceSession::kernel(const std::string &xclbin_file,
+                                 const std::string &kernel_name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t hash;
+  cl::Program program = program_locked(xclbin_file, &hash);
+  KernelKey key(hash, std::make_pair(kernel_name, std::this_thread::get_id()));
+  std::map<KernelKey, cl::Kernel>::iterator it = m_kernels.find(key);
+  if (it != m_kernels.end())
+    return it->second;
+
+  cl_int err;
+  OCL_CHECK(err, cl::Kernel krnl(program, kernel_name.c_str(), &err));
+  m_kernels[key] = krnl;
+  return krnl;
+}
+
+cl::Context DeviceSession::context() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_context;
+}
+
+cl::Device DeviceSession::device() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_device;
+}
+
+cl::CommandQueue DeviceSession::queue() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_queue;
+}
+
+size_t DeviceSession::program_count() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_program_count;
+}
+
+cl::Buffer DeviceSession::buffer(void *host_ptr, size_t bytes,
+                                 cl_mem_flags flags) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_has_device) {
+    std::cout << "Failed to create buffer: no device programmed" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  BufferKey key(std::make_pair(host_ptr, bytes), flags);
+  std::map<BufferKey, cl::Buffer>::iterator it = m_buffers.find(key);
+  if (it != m_buffers.end())
+    return it->second;
+  cl_int err;
+  OCL_CHECK(err, cl::Buffer buffer(m_context, flags | CL_MEM_USE_HOST_PTR,
+                                   bytes, host_ptr, &err));
+  m_buffers[key] = buffer;
+  return buffer;
+}
+
+void DeviceSession::release_buffers() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_buffers.clear();
+}
+
+size_t DeviceSession::buffer_count() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_buffers.size();
+}
+} // namespace xcl
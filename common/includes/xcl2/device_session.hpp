@@ -0,0 +1,116 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "xcl2.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <sys/types.h>
+#include <utility>
+
+// A DeviceSession owns the context and command queue of one Xilinx device and
+// programs it at most once per xclbin. Programs are cached by a hash of the
+// xclbin contents and kernels by (xclbin hash, kernel name, calling thread),
+// so repeated calls skip both the device programming and the kernel creation.
+// All member functions may be called concurrently. Each submitting thread gets
+// its own cl::Kernel handle because clSetKernelArg is not thread-safe on a
+// shared kernel object; the command queue itself is shared.
+//
+// The session also pools CL_MEM_USE_HOST_PTR buffers by (host pointer, size,
+// flags). A host region that is reused across jobs, such as an xcl::Arena
+// after reset(), gets the same cl::Buffer back, so the runtime keeps its
+// pinning and mapping instead of redoing them for every new buffer object.
+namespace xcl {
+
+class DeviceSession {
+public:
+  explicit DeviceSession(
+      cl_command_queue_properties props = CL_QUEUE_PROFILING_ENABLE);
+
+  // Process-wide session using the default queue properties.
+  static DeviceSession &instance();
+
+  // Programs the device with xclbin_file unless it already runs that image.
+  cl::Program program(const std::string &xclbin_file);
+  // Returns the calling thread's handle to kernel_name from xclbin_file.
+  cl::Kernel kernel(const std::string &xclbin_file,
+                    const std::string &kernel_name);
+
+  cl::Context context();
+  cl::Device device();
+  cl::CommandQueue queue();
+
+  // Number of times the device has actually been programmed.
+  size_t program_count();
+
+  // Returns the pooled CL_MEM_USE_HOST_PTR buffer over [host_ptr,
+  // host_ptr + bytes), creating it on first use. flags must not include
+  // CL_MEM_USE_HOST_PTR; it is added here. Requires a programmed device.
+  cl::Buffer buffer(void *host_ptr, size_t bytes, cl_mem_flags flags);
+  // Drops pooled buffers. Must be called before the host memory behind them
+  // is freed or reused for a different layout.
+  void release_buffers();
+  size_t buffer_count();
+
+private:
+  struct FileStamp {
+    time_t mtime;
+    off_t size;
+    uint64_t hash;
+  };
+  typedef std::pair<uint64_t, std::pair<std::string, std::thread::id>>
+      KernelKey;
+  typedef std::pair<std::pair<void *, size_t>, cl_mem_flags> BufferKey;
+
+  cl::Program program_locked(const std::string &xclbin_file,
+                             uint64_t *hash_out);
+
+  std::mutex m_mutex;
+  cl_command_queue_properties m_props;
+  bool m_has_device;
+  cl::Device m_device;
+  cl::Context m_context;
+  cl::CommandQueue m_queue;
+  size_t m_program_count;
+  std::map<std::string, FileStamp> m_stamps;
+  std::map<uint64_t, cl::Program> m_programs;
+  std::map<KernelKey, cl::Kernel> m_kernels;
+  std::map<BufferKey, cl::Buffer> m_buffers;
+};
+} // namespace xcl
@@ -0,0 +1,156 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "event_profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+namespace xcl {
+
+static const char *phase_name[3] = {"H2D migrate", "Kernel", "D2H migrate"};
+
+// Length of the union of a set of [start, end] intervals in nanoseconds.
+static cl_ulong interval_union(std::vector<std::pair<cl_ulong, cl_ulong>> &iv) {
+  std::sort(iv.begin(), iv.end());
+  cl_ulong total = 0;
+  size_t i = 0;
+  while (i < iv.size()) {
+    cl_ulong start = iv[i].first;
+    cl_ulong end = iv[i].second;
+    for (i++; i < iv.size() && iv[i].first <= end; i++)
+      end = std::max(end, iv[i].second);
+    total += end - start;
+  }
+  return total;
+}
+
+void EventProfiler::add(const cl::Event &event, Phase phase, double amount) {
+  Record r = {event, phase, amount};
+  m_records.push_back(r);
+}
+
+void EventProfiler::h2d(const cl::Event &event, size_t bytes) {
+  add(event, Phase::H2D, (double)bytes);
+}
+
+void EventProfiler::kernel(const cl::Event &event, double ops) {
+  add(event, Phase::Kernel, ops);
+}
+
+void EventProfiler::d2h(const cl::Event &event, size_t bytes) {
+  add(event, Phase::D2H, (double)bytes);
+}
+
+ProfileSummary EventProfiler::summarize() const {
+  ProfileSummary s = {};
+  std::vector<std::pair<cl_ulong, cl_ulong>> iv[3];
+  cl_ulong first = ~(cl_ulong)0, last = 0;
+  cl_int err;
+
+  for (size_t i = 0; i < m_records.size(); i++) {
+    const Record &r = m_records[i];
+    cl_ulong queued, submit, start, end;
+    OCL_CHECK(err, err = r.event.getProfilingInfo<cl_ulong>(
+                       CL_PROFILING_COMMAND_QUEUED, &queued));
+    OCL_CHECK(err, err = r.event.getProfilingInfo<cl_ulong>(
+                       CL_PROFILING_COMMAND_SUBMIT, &submit));
+    OCL_CHECK(err, err = r.event.getProfilingInfo<cl_ulong>(
+                       CL_PROFILING_COMMAND_START, &start));
+    OCL_CHECK(err, err = r.event.getProfilingInfo<cl_ulong>(
+                       CL_PROFILING_COMMAND_END, &end));
+    (void)submit;
+
+    int p = (int)r.phase;
+    PhaseSummary &ps = s.phase[p];
+    ps.count++;
+    ps.wait_ms += (start - queued) * 1.0e-6;
+    if (r.phase == Phase::Kernel)
+      ps.ops += r.amount;
+    else
+      ps.bytes += r.amount;
+    iv[p].push_back(std::make_pair(start, end));
+    first = std::min(first, start);
+    last = std::max(last, end);
+  }
+  if (m_records.empty())
+    return s;
+
+  for (int p = 0; p < 3; p++) {
+    s.phase[p].busy_ms = interval_union(iv[p]) * 1.0e-6;
+    s.serial_ms += s.phase[p].busy_ms;
+  }
+  s.critical_path_ms = (last - first) * 1.0e-6;
+  if (s.serial_ms > 0)
+    s.overlap_ratio = std::max(0.0, 1.0 - s.critical_path_ms / s.serial_ms);
+
+  const PhaseSummary &h2d = s.phase[(int)Phase::H2D];
+  const PhaseSummary &krn = s.phase[(int)Phase::Kernel];
+  const PhaseSummary &d2h = s.phase[(int)Phase::D2H];
+  // bytes per ms * 1e-6 == GB/s, ops per ms * 1e-6 == GOPS
+  if (h2d.busy_ms > 0)
+    s.h2d_gbps = h2d.bytes / h2d.busy_ms * 1.0e-6;
+  if (d2h.busy_ms > 0)
+    s.d2h_gbps = d2h.bytes / d2h.busy_ms * 1.0e-6;
+  if (krn.busy_ms > 0)
+    s.kernel_gops = krn.ops / krn.busy_ms * 1.0e-6;
+  if (s.critical_path_ms > 0)
+    s.e2e_gops = krn.ops / s.critical_path_ms * 1.0e-6;
+  return s;
+}
+
+void EventProfiler::report(const std::string &name) const {
+  ProfileSummary s = summarize();
+  printf("|-------------------------+-------------------------|\n"
+         "| %-23s |       Busy Time (ms)    |\n"
+         "|-------------------------+-------------------------|\n",
+         name.c_str());
+  for (int p = 0; p < 3; p++) {
+    char label[32];
+    snprintf(label, sizeof(label), "%s (x%zu)", phase_name[p],
+             s.phase[p].count);
+    printf("| %-23s | %21f ms|\n", label, s.phase[p].busy_ms);
+  }
+  printf("|-------------------------+-------------------------|\n");
+  printf("| %-23s | %21f ms|\n", "Critical path", s.critical_path_ms);
+  printf("| %-23s | %21f ms|\n", "Serialized sum", s.serial_ms);
+  printf("| %-23s | %23f |\n", "Overlap ratio", s.overlap_ratio);
+  printf("| %-23s | %18f GB/s|\n", "PCIe H2D", s.h2d_gbps);
+  printf("| %-23s | %18f GB/s|\n", "PCIe D2H", s.d2h_gbps);
+  printf("| %-23s | %18f GOPS|\n", "Kernel", s.kernel_gops);
+  printf("| %-23s | %18f GOPS|\n", "End-to-end", s.e2e_gops);
+  printf("|-------------------------+-------------------------|\n");
+}
+} // namespace xcl
@@ -0,0 +1,96 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "xcl2.hpp"
+#include <string>
+#include <vector>
+
+// Collects the OpenCL profiling timestamps (QUEUED/SUBMIT/START/END) of every
+// host-to-device migrate, kernel launch and device-to-host migrate issued by a
+// run and turns them into an end-to-end breakdown. The command queue must be
+// created with CL_QUEUE_PROFILING_ENABLE. Events are only queried in
+// summarize()/report(), so call those after the queue has been finished.
+namespace xcl {
+
+enum class Phase { H2D = 0, Kernel = 1, D2H = 2 };
+
+struct PhaseSummary {
+  size_t count;        // Number of commands recorded for this phase
+  double busy_ms;      // Union of [START, END] intervals of this phase
+  double wait_ms;      // Sum of (START - QUEUED), time spent waiting in queue
+  double bytes;        // Bytes moved (H2D/D2H) by this phase
+  double ops;          // Arithmetic operations performed (Kernel)
+};
+
+struct ProfileSummary {
+  PhaseSummary phase[3];
+  double critical_path_ms; // First START to last END across all commands
+  double serial_ms;        // Sum of the per-phase busy times
+  double overlap_ratio;    // 1 - critical_path / serial, 0 means no overlap
+  double h2d_gbps;         // Achieved host-to-device bandwidth
+  double d2h_gbps;         // Achieved device-to-host bandwidth
+  double kernel_gops;      // Kernel throughput over kernel busy time
+  double e2e_gops;         // Kernel ops over the critical path
+};
+
+class EventProfiler {
+public:
+  // Records a migrate from the host; bytes is the total size of the buffers.
+  void h2d(const cl::Event &event, size_t bytes);
+  // Records a kernel launch; ops is the number of arithmetic operations
+  // (2 * M * N * K for a multiply-accumulate GEMM).
+  void kernel(const cl::Event &event, double ops);
+  // Records a migrate to the host; bytes is the total size of the buffers.
+  void d2h(const cl::Event &event, size_t bytes);
+
+  void clear() { m_records.clear(); }
+  size_t size() const { return m_records.size(); }
+
+  ProfileSummary summarize() const;
+  // Prints the breakdown in the same table layout used by the host programs.
+  void report(const std::string &name) const;
+
+private:
+  struct Record {
+    cl::Event event;
+    Phase phase;
+    double amount;
+  };
+  void add(const cl::Event &event, Phase phase, double amount);
+  std::vector<Record> m_records;
+};
+} // namespace xcl
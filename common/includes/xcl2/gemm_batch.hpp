@@ -0,0 +1,148 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <vector>
+
+// Packs many independent products C = A * B of one shape, A rows x inner
+// and B inner x cols (row-major int32), into one buffer per operand and an
+// offset table, so that a *_batch_ptr kernel computes all of them in a
+// single launch. Offsets are in elements: problem p reads A at
+// offsets()[3p], B at offsets()[3p + 1] and writes C at offsets()[3p + 2].
+//
+// Operands are copied by add(), so a caller may refill one staging buffer
+// between calls. add_shared_b() shares B instead, e.g. one weight matrix
+// applied to many inputs: a B pointer given to it again is copied once, and
+// must keep its contents until clear(). The kernels keep B on chip while
+// consecutive problems share it, so such problems should be added one after
+// the other. The buffers are page aligned to back CL_MEM_USE_HOST_PTR buffers
+// and are only stable until the next add() or clear().
+namespace xcl {
+
+class GemmBatch {
+public:
+  typedef std::vector<int, aligned_allocator<int>> Buffer;
+
+  GemmBatch(int rows, int inner, int cols, size_t expected_problems = 0)
+      : m_rows(rows), m_inner(inner), m_cols(cols) {
+    m_a.reserve(expected_problems * rows * inner);
+    m_b.reserve(expected_problems * inner * cols);
+    m_c.reserve(expected_problems * rows * cols);
+    m_offsets.reserve(expected_problems * 3);
+    m_dest.reserve(expected_problems);
+  }
+
+  // Adds C = A * B and returns its index. c receives the result on
+  // scatter(); it may be null when the result is read with result().
+  int add(const int *a, const int *b, int *c) {
+    return push(a, append(m_b, b, (size_t)m_inner * m_cols), c);
+  }
+
+  // Like add(), but B is packed once per distinct pointer b and shared by
+  // every problem that passes it
+  int add_shared_b(const int *a, const int *b, int *c) {
+    std::map<const int *, int>::iterator it = m_b_shared.find(b);
+    int offset_b;
+    if (it != m_b_shared.end()) {
+      offset_b = it->second;
+    } else {
+      offset_b = append(m_b, b, (size_t)m_inner * m_cols);
+      m_b_shared[b] = offset_b;
+    }
+    return push(a, offset_b, c);
+  }
+
+  void clear() {
+    m_a.clear();
+    m_b.clear();
+    m_c.clear();
+    m_offsets.clear();
+    m_dest.clear();
+    m_b_shared.clear();
+  }
+
+  int count() const { return (int)m_dest.size(); }
+  // A and B matrices actually packed
+  int a_count() const { return (int)(m_a.size() / ((size_t)m_rows * m_inner)); }
+  int b_count() const { return (int)(m_b.size() / ((size_t)m_inner * m_cols)); }
+
+  int *a() { return m_a.data(); }
+  int *b() { return m_b.data(); }
+  int *c() { return m_c.data(); }
+  int *offsets() { return m_offsets.data(); }
+  size_t a_bytes() const { return m_a.size() * sizeof(int); }
+  size_t b_bytes() const { return m_b.size() * sizeof(int); }
+  size_t c_bytes() const { return m_c.size() * sizeof(int); }
+  size_t offsets_bytes() const { return m_offsets.size() * sizeof(int); }
+
+  const int *result(int problem) const {
+    return m_c.data() + m_offsets[3 * problem + 2];
+  }
+
+  // Copies every result to the c given to add()
+  void scatter() const {
+    size_t bytes = (size_t)m_rows * m_cols * sizeof(int);
+    for (size_t p = 0; p < m_dest.size(); p++)
+      if (m_dest[p])
+        memcpy(m_dest[p], result((int)p), bytes);
+  }
+
+private:
+  static int append(Buffer &buf, const int *src, size_t n) {
+    int offset = (int)buf.size();
+    buf.insert(buf.end(), src, src + n);
+    return offset;
+  }
+
+  int push(const int *a, int offset_b, int *c) {
+    m_offsets.push_back(append(m_a, a, (size_t)m_rows * m_inner));
+    m_offsets.push_back(offset_b);
+    m_offsets.push_back((int)m_c.size());
+    m_c.resize(m_c.size() + (size_t)m_rows * m_cols);
+    m_dest.push_back(c);
+    return (int)m_dest.size() - 1;
+  }
+
+  int m_rows, m_inner, m_cols;
+  Buffer m_a, m_b, m_c, m_offsets;
+  std::vector<int *> m_dest;
+  std::map<const int *, int> m_b_shared;
+};
+} // namespace xcl
@@ -0,0 +1,134 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#if !defined(_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xcl {
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_mapped(false) {}
+
+MappedFile::MappedFile(const std::string &file_name, int hints)
+    : m_data(nullptr), m_size(0), m_mapped(false) {
+  struct stat st;
+  if (stat(file_name.c_str(), &st) != 0) {
+    printf("ERROR: %s xclbin not available please build\n",
+           file_name.c_str());
+    exit(EXIT_FAILURE);
+  }
+  m_size = st.st_size;
+  if (m_size == 0)
+    return;
+
+#if !defined(_WINDOWS)
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (hints & Populate)
+      flags |= MAP_POPULATE;
+#endif
+    void *ptr = mmap(NULL, m_size, PROT_READ, flags, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (ptr != MAP_FAILED) {
+      if (hints & Sequential)
+        madvise(ptr, m_size, MADV_SEQUENTIAL);
+      if (hints & WillNeed)
+        madvise(ptr, m_size, MADV_WILLNEED);
+      m_data = reinterpret_cast<unsigned char *>(ptr);
+      m_mapped = true;
+      return;
+    }
+  }
+#endif
+
+  // Fall back to a single read into a heap buffer
+  std::ifstream bin_file(file_name.c_str(), std::ifstream::binary);
+  m_data = new unsigned char[m_size];
+  bin_file.read(reinterpret_cast<char *>(m_data), m_size);
+  if (!bin_file) {
+    printf("ERROR: failed to read %s\n", file_name.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+
+MappedFile::MappedFile(MappedFile &&other)
+    : m_data(other.m_data), m_size(other.m_size), m_mapped(other.m_mapped) {
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.m_mapped = false;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+  if (this != &other) {
+    release();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_mapped = other.m_mapped;
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_mapped = false;
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { release(); }
+
+void MappedFile::release() {
+  if (m_data == nullptr)
+    return;
+#if !defined(_WINDOWS)
+  if (m_mapped)
+    munmap(m_data, m_size);
+  else
+#endif
+    delete[] m_data;
+  m_data = nullptr;
+}
+
+std::vector<unsigned char> read_file(const std::string &file_name) {
+  MappedFile file(file_name);
+  return std::vector<unsigned char>(file.data(), file.data() + file.size());
+}
+} // namespace xcl
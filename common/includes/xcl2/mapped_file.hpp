@@ -0,0 +1,78 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Whole-file loading for xclbins and other large read-only inputs, kept free
+// of OpenCL so that CPU-only benchmarks can measure it.
+namespace xcl {
+
+// Read-only view of a whole file, unmapped when the object goes out of scope.
+// The pages can be handed straight to cl::Program::Binaries (see binaries()
+// in xcl2.hpp), avoiding the copy of the xclbin into a heap buffer. Hints
+// select MAP_POPULATE (fault every page in up front) and madvise()
+// read-ahead advice. Where mmap is not available the file is read into a
+// heap buffer instead.
+class MappedFile {
+public:
+  enum Hint { None = 0, Populate = 1, Sequential = 2, WillNeed = 4 };
+
+  MappedFile();
+  explicit MappedFile(const std::string &file_name, int hints = Sequential);
+  MappedFile(MappedFile &&other);
+  MappedFile &operator=(MappedFile &&other);
+  ~MappedFile();
+
+  const unsigned char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool is_mapped() const { return m_mapped; }
+
+private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+  void release();
+
+  unsigned char *m_data;
+  size_t m_size;
+  bool m_mapped;
+};
+
+// Reads the whole file into a heap buffer, the copy MappedFile avoids
+std::vector<unsigned char> read_file(const std::string &file_name);
+} // namespace xcl
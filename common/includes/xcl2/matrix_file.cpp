@@ -0,0 +1,302 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "matrix_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xcl {
+
+static const char MATRIX_MAGIC[8] = {'X', 'M', 'A', 'T', 'R', 'I', 'X', 0};
+static const uint32_t MATRIX_VERSION = 1;
+
+size_t dtype_size(DType dtype) {
+  switch (dtype) {
+  case DType::Int8:
+    return 1;
+  case DType::Int16:
+  case DType::Float16:
+  case DType::BFloat16:
+    return 2;
+  case DType::Int32:
+  case DType::Float32:
+    return 4;
+  case DType::Float64:
+    return 8;
+  }
+  return 0;
+}
+
+const char *dtype_name(DType dtype) {
+  switch (dtype) {
+  case DType::Int8:
+    return "int8";
+  case DType::Int16:
+    return "int16";
+  case DType::Int32:
+    return "int32";
+  case DType::Float16:
+    return "fp16";
+  case DType::BFloat16:
+    return "bf16";
+  case DType::Float32:
+    return "fp32";
+  case DType::Float64:
+    return "fp64";
+  }
+  return "unknown";
+}
+
+void MatrixChecksum::update(const void *data, size_t bytes) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  uint64_t sum1 = m_sum1, sum2 = m_sum2;
+  size_t words = bytes / 4;
+  for (size_t i = 0; i < words; i++) {
+    uint32_t w;
+    memcpy(&w, p + i * 4, 4);
+    sum1 += w;
+    sum2 += sum1;
+  }
+  for (size_t i = words * 4; i < bytes; i++) {
+    sum1 += p[i];
+    sum2 += sum1;
+  }
+  m_sum1 = sum1;
+  m_sum2 = sum2;
+}
+
+uint64_t matrix_checksum(const void *data, size_t bytes) {
+  MatrixChecksum sum;
+  sum.update(data, bytes);
+  return sum.value();
+}
+
+static void fail(const std::string &file_name, const char *what) {
+  printf("ERROR: %s: %s\n", file_name.c_str(), what);
+  exit(EXIT_FAILURE);
+}
+
+static bool make_header(MatrixHeader &h, DType dtype, uint64_t rows,
+                        uint64_t cols, Layout layout, uint64_t ld) {
+  uint64_t minor = layout == Layout::RowMajor ? rows : cols;
+  uint64_t major = layout == Layout::RowMajor ? cols : rows;
+  if (ld == 0)
+    ld = major;
+  if (ld < major || dtype_size(dtype) == 0)
+    return false;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+  h.version = MATRIX_VERSION;
+  h.dtype = dtype;
+  h.rows = rows;
+  h.cols = cols;
+  h.ld = ld;
+  h.layout = layout;
+  h.payload_offset = MatrixFile::PAYLOAD_OFFSET;
+  h.payload_bytes = minor * ld * dtype_size(dtype);
+  return true;
+}
+
+MatrixHeader make_matrix_header(DType dtype, uint64_t rows, uint64_t cols,
+                                Layout layout, uint64_t ld) {
+  MatrixHeader h;
+  if (!make_header(h, dtype, rows, cols, layout, ld)) {
+    printf("ERROR: invalid matrix shape\n");
+    exit(EXIT_FAILURE);
+  }
+  return h;
+}
+
+// Reads the header from fd and checks it against a file of file_size bytes
+static MatrixHeader read_header(int fd, const std::string &file_name,
+                                uint64_t file_size) {
+  MatrixHeader h;
+  if (file_size < MatrixFile::PAYLOAD_OFFSET ||
+      pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+      memcmp(h.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC)) != 0)
+    fail(file_name, "not a matrix file");
+  if (h.version != MATRIX_VERSION)
+    fail(file_name, "unsupported matrix file version");
+  uint64_t minor = h.layout == Layout::RowMajor ? h.rows : h.cols;
+  if (dtype_size(h.dtype) == 0 ||
+      h.payload_offset != MatrixFile::PAYLOAD_OFFSET ||
+      h.payload_bytes != minor * h.ld * dtype_size(h.dtype) ||
+      file_size < MatrixFile::PAYLOAD_OFFSET + h.payload_bytes)
+    fail(file_name, "corrupt header");
+  return h;
+}
+
+MatrixHeader read_matrix_header(const std::string &file_name) {
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+    fail(file_name, "cannot open matrix file");
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    fail(file_name, "cannot open matrix file");
+  MatrixHeader h = read_header(fd, file_name, st.st_size);
+  close(fd);
+  return h;
+}
+
+void write_matrix_header(int fd, const MatrixHeader &header) {
+  char page[MatrixFile::PAYLOAD_OFFSET];
+  memset(page, 0, sizeof(page));
+  memcpy(page, &header, sizeof(header));
+  if (pwrite(fd, page, sizeof(page), 0) != (ssize_t)sizeof(page)) {
+    printf("ERROR: cannot write matrix header\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+MatrixFile::MatrixFile()
+    : m_base(nullptr), m_mapped_bytes(0), m_writable(false),
+      m_committed(true) {
+  memset(&m_header, 0, sizeof(m_header));
+}
+
+MatrixFile::MatrixFile(MatrixFile &&other)
+    : m_name(other.m_name), m_header(other.m_header), m_base(other.m_base),
+      m_mapped_bytes(other.m_mapped_bytes), m_writable(other.m_writable),
+      m_committed(other.m_committed) {
+  other.m_base = nullptr;
+  other.m_mapped_bytes = 0;
+  other.m_committed = true;
+}
+
+MatrixFile &MatrixFile::operator=(MatrixFile &&other) {
+  if (this != &other) {
+    release();
+    m_name = other.m_name;
+    m_header = other.m_header;
+    m_base = other.m_base;
+    m_mapped_bytes = other.m_mapped_bytes;
+    m_writable = other.m_writable;
+    m_committed = other.m_committed;
+    other.m_base = nullptr;
+    other.m_mapped_bytes = 0;
+    other.m_committed = true;
+  }
+  return *this;
+}
+
+MatrixFile::~MatrixFile() { release(); }
+
+void MatrixFile::release() {
+  if (!m_base)
+    return;
+  if (m_writable && !m_committed)
+    commit();
+  munmap(m_base, m_mapped_bytes);
+  m_base = nullptr;
+  m_mapped_bytes = 0;
+}
+
+MatrixFile MatrixFile::open(const std::string &file_name, bool verify) {
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+    fail(file_name, "cannot open matrix file");
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    fail(file_name, "cannot open matrix file");
+
+  MatrixFile file;
+  file.m_name = file_name;
+  file.m_header = read_header(fd, file_name, st.st_size);
+  const MatrixHeader &h = file.m_header;
+
+  // Copy-on-write, so that the runtime may pin the pages read-write
+  file.m_mapped_bytes = PAYLOAD_OFFSET + h.payload_bytes;
+  void *ptr = mmap(NULL, file.m_mapped_bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED)
+    fail(file_name, "cannot map matrix file");
+  file.m_base = reinterpret_cast<char *>(ptr);
+  madvise(file.payload(), h.payload_bytes, MADV_SEQUENTIAL);
+
+  if (verify && matrix_checksum(file.payload(), h.payload_bytes) != h.checksum)
+    fail(file_name, "checksum mismatch");
+  return file;
+}
+
+MatrixFile MatrixFile::create(const std::string &file_name, DType dtype,
+                              uint64_t rows, uint64_t cols, Layout layout,
+                              uint64_t ld) {
+  MatrixFile file;
+  file.m_name = file_name;
+  if (!make_header(file.m_header, dtype, rows, cols, layout, ld))
+    fail(file_name, "invalid matrix shape");
+  const MatrixHeader &h = file.m_header;
+
+  int fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    fail(file_name, "cannot create matrix file");
+  file.m_mapped_bytes = PAYLOAD_OFFSET + h.payload_bytes;
+  if (ftruncate(fd, file.m_mapped_bytes) != 0)
+    fail(file_name, "cannot size matrix file");
+  void *ptr = mmap(NULL, file.m_mapped_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED)
+    fail(file_name, "cannot map matrix file");
+  file.m_base = reinterpret_cast<char *>(ptr);
+  file.m_writable = true;
+  file.m_committed = false;
+  return file;
+}
+
+void MatrixFile::commit() {
+  if (!m_writable)
+    return;
+  m_header.checksum = matrix_checksum(payload(), m_header.payload_bytes);
+  memset(m_base, 0, PAYLOAD_OFFSET);
+  memcpy(m_base, &m_header, sizeof(m_header));
+  if (msync(m_base, m_mapped_bytes, MS_SYNC) != 0)
+    fail(m_name, "cannot write matrix file");
+  m_committed = true;
+}
+
+void MatrixFile::check_dtype(DType dtype) const {
+  if (dtype != m_header.dtype) {
+    printf("ERROR: %s: holds %s, not %s\n", m_name.c_str(),
+           dtype_name(m_header.dtype), dtype_name(dtype));
+    exit(EXIT_FAILURE);
+  }
+}
+} // namespace xcl
@@ -0,0 +1,184 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Binary matrix container that is loaded by mapping it, without parsing or
+// copying.
+//
+//   offset 0     MatrixHeader (little-endian), zero padded to 4 KB
+//   offset 4096  payload: rows x cols elements with leading dimension ld,
+//                row-major (ld >= cols) or column-major (ld >= rows)
+//
+// Because the payload starts on a page boundary of the mapping, data() can be
+// handed directly to a CL_MEM_USE_HOST_PTR buffer. The header carries a
+// checksum of the payload, verified on open unless asked not to.
+namespace xcl {
+
+enum class DType : uint32_t {
+  Int8 = 1,
+  Int16 = 2,
+  Int32 = 3,
+  Float16 = 4,
+  BFloat16 = 5,
+  Float32 = 6,
+  Float64 = 7
+};
+
+enum class Layout : uint32_t { RowMajor = 0, ColMajor = 1 };
+
+size_t dtype_size(DType dtype);
+const char *dtype_name(DType dtype);
+
+// Maps element types to their DType
+template <typename T> struct DTypeOf;
+template <> struct DTypeOf<int8_t> { static const DType value = DType::Int8; };
+template <> struct DTypeOf<int16_t> {
+  static const DType value = DType::Int16;
+};
+template <> struct DTypeOf<int32_t> {
+  static const DType value = DType::Int32;
+};
+template <> struct DTypeOf<float> {
+  static const DType value = DType::Float32;
+};
+template <> struct DTypeOf<double> {
+  static const DType value = DType::Float64;
+};
+
+struct MatrixHeader {
+  char magic[8]; // "XMATRIX\0"
+  uint32_t version;
+  DType dtype;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t ld; // in elements
+  Layout layout;
+  uint32_t reserved;
+  uint64_t payload_offset;
+  uint64_t payload_bytes;
+  uint64_t checksum; // matrix_checksum() of the payload
+};
+
+// Fletcher style checksum over 32-bit words, modulo 2^64
+uint64_t matrix_checksum(const void *data, size_t bytes);
+
+// The same checksum computed piece by piece, for payloads that are written
+// in parts. Every part but the last must be a multiple of 4 bytes.
+class MatrixChecksum {
+public:
+  MatrixChecksum() : m_sum1(0), m_sum2(0) {}
+  void update(const void *data, size_t bytes);
+  uint64_t value() const { return (m_sum2 << 32) ^ m_sum1; }
+
+private:
+  uint64_t m_sum1, m_sum2;
+};
+
+// Header for a new matrix; checksum is left 0. ld = 0 means packed.
+MatrixHeader make_matrix_header(DType dtype, uint64_t rows, uint64_t cols,
+                                Layout layout = Layout::RowMajor,
+                                uint64_t ld = 0);
+// Reads and validates the header of file_name without mapping the payload
+MatrixHeader read_matrix_header(const std::string &file_name);
+// Writes header to the first page of an open file descriptor
+void write_matrix_header(int fd, const MatrixHeader &header);
+
+class MatrixFile {
+public:
+  static const size_t PAYLOAD_OFFSET = 4096;
+
+  MatrixFile();
+  MatrixFile(MatrixFile &&other);
+  MatrixFile &operator=(MatrixFile &&other);
+  // Files opened with create() are committed here if not done before
+  ~MatrixFile();
+
+  // Maps an existing file. The mapping is private: writes through data()
+  // stay in memory and never reach the file.
+  static MatrixFile open(const std::string &file_name, bool verify = true);
+  // Creates file_name sized for the matrix and maps it shared. Fill data(),
+  // then commit() or let the destructor do it. ld = 0 means packed.
+  static MatrixFile create(const std::string &file_name, DType dtype,
+                           uint64_t rows, uint64_t cols,
+                           Layout layout = Layout::RowMajor, uint64_t ld = 0);
+
+  // Computes the checksum, writes the header and flushes the file
+  void commit();
+
+  const MatrixHeader &header() const { return m_header; }
+  uint64_t rows() const { return m_header.rows; }
+  uint64_t cols() const { return m_header.cols; }
+  uint64_t ld() const { return m_header.ld; }
+  Layout layout() const { return m_header.layout; }
+  DType dtype() const { return m_header.dtype; }
+  size_t payload_bytes() const { return m_header.payload_bytes; }
+  void *payload() const { return m_base + PAYLOAD_OFFSET; }
+
+  // Typed view of the payload; exits when T does not match the dtype
+  template <typename T> T *data() const {
+    check_dtype(DTypeOf<T>::value);
+    return reinterpret_cast<T *>(payload());
+  }
+
+private:
+  MatrixFile(const MatrixFile &);
+  MatrixFile &operator=(const MatrixFile &);
+  void check_dtype(DType dtype) const;
+  void release();
+
+  std::string m_name;
+  MatrixHeader m_header;
+  char *m_base;
+  size_t m_mapped_bytes;
+  bool m_writable;
+  bool m_committed;
+};
+
+// Writes a packed matrix from memory in one call
+template <typename T>
+void save_matrix(const std::string &file_name, const T *data, uint64_t rows,
+                 uint64_t cols, Layout layout = Layout::RowMajor) {
+  MatrixFile file = MatrixFile::create(file_name, DTypeOf<T>::value, rows,
+                                       cols, layout);
+  memcpy(file.data<T>(), data, (size_t)rows * cols * sizeof(T));
+  file.commit();
+}
+} // namespace xcl
@@ -72,25 +72,15 @@ std::vector<cl::Device> get_devices(const std::string &vendor_name) {
 
 std::vector<cl::Device> get_xil_devices() { return get_devices("Xilinx"); }
 
+MappedFile map_binary_file(const std::string &xclbin_file_name, int hints) {
+  std::cout << "INFO: Mapping " << xclbin_file_name << std::endl;
+  return MappedFile(xclbin_file_name, hints);
+}
+
 std::vector<unsigned char>
 read_binary_file(const std::string &xclbin_file_name) {
   std::cout << "INFO: Reading " << xclbin_file_name << std::endl;
-  FILE *fp;
-  if ((fp = fopen(xclbin_file_name.c_str(), "r")) == NULL) {
-    printf("ERROR: %s xclbin not available please build\n",
-           xclbin_file_name.c_str());
-    exit(EXIT_FAILURE);
-  }
-  // Loading XCL Bin into char buffer
-  std::cout << "Loading: '" << xclbin_file_name.c_str() << "'\n";
-  std::ifstream bin_file(xclbin_file_name.c_str(), std::ifstream::binary);
-  bin_file.seekg(0, bin_file.end);
-  auto nb = bin_file.tellg();
-  bin_file.seekg(0, bin_file.beg);
-  std::vector<unsigned char> buf;
-  buf.resize(nb);
-  bin_file.read(reinterpret_cast<char *>(buf.data()), nb);
-  return buf;
+  return read_file(xclbin_file_name);
 }
 
 bool is_emulation() {
@@ -54,62 +54,28 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <CL/cl_ext_xilinx.h>
 #include <fstream>
 #include <iostream>
-// When creating a buffer with user pointer (CL_MEM_USE_HOST_PTR), under the
-// hood
-// User ptr is used if and only if it is properly aligned (page aligned). When
-// not
-// aligned, runtime has no choice but to create its own host side buffer that
-// backs
-// user ptr. This in turn implies that all operations that move data to and from
-// device incur an extra memcpy to move data to/from runtime's own host buffer
-// from/to user pointer. So it is recommended to use this allocator if user wish
-// to
-// Create Buffer/Memory Object with CL_MEM_USE_HOST_PTR to align user buffer to
-// the
-// page boundary. It will ensure that user buffer will be used when user create
-// Buffer/Mem Object with CL_MEM_USE_HOST_PTR.
-template <typename T> struct aligned_allocator {
-  using value_type = T;
-
-  aligned_allocator() {}
-
-  aligned_allocator(const aligned_allocator &) {}
-
-  template <typename U> aligned_allocator(const aligned_allocator<U> &) {}
-
-  T *allocate(std::size_t num) {
-    void *ptr = nullptr;
-
-#if defined(_WINDOWS)
-    {
-      ptr = _aligned_malloc(num * sizeof(T), 4096);
-      if (ptr == NULL) {
-        std::cout << "Failed to allocate memory" << std::endl;
-        exit(EXIT_FAILURE);
-      }
-    }
-#else
-    {
-      if (posix_memalign(&ptr, 4096, num * sizeof(T)))
-        throw std::bad_alloc();
-    }
-#endif
-    return reinterpret_cast<T *>(ptr);
-  }
-  void deallocate(T *p, std::size_t num) {
-#if defined(_WINDOWS)
-    _aligned_free(p);
-#else
-    free(p);
-#endif
-  }
-};
+#include "aligned_allocator.hpp"
+#include "mapped_file.hpp"
 
 namespace xcl {
+// The pages of file as the binary of a cl::Program
+inline cl::Program::Binaries binaries(const MappedFile &file) {
+  return {{file.data(), file.size()}};
+}
+
 std::vector<cl::Device> get_xil_devices();
 std::vector<cl::Device> get_devices(const std::string &vendor_name);
+// Copies the whole xclbin into a heap buffer. Deprecated: map_binary_file()
+// returns the same bytes without the copy and the extra resident memory
+// (see xclbin_load_bench in cpp_kernels/host_benchmarks).
+#if defined(__GNUC__)
+__attribute__((deprecated("use map_binary_file()")))
+#endif
 std::vector<unsigned char>
 read_binary_file(const std::string &xclbin_file_name);
+// Maps the xclbin instead of copying it, see MappedFile.
+MappedFile map_binary_file(const std::string &xclbin_file_name,
+                           int hints = MappedFile::Sequential);
 bool is_emulation();
 bool is_hw_emulation();
 bool is_xpr_device(const char *device_name);
@@ -1,4 +1,4 @@
-xcl2_SRCS:=${COMMON_REPO}/common/includes/xcl2/xcl2.cpp
-xcl2_HDRS:=${COMMON_REPO}/common/includes/xcl2/xcl2.hpp
+xcl2_SRCS:=${COMMON_REPO}/common/includes/xcl2/xcl2.cpp ${COMMON_REPO}/common/includes/xcl2/event_profiler.cpp ${COMMON_REPO}/common/includes/xcl2/device_session.cpp ${COMMON_REPO}/common/includes/xcl2/mapped_file.cpp ${COMMON_REPO}/common/includes/xcl2/matrix_file.cpp
+xcl2_HDRS:=${COMMON_REPO}/common/includes/xcl2/xcl2.hpp ${COMMON_REPO}/common/includes/xcl2/aligned_allocator.hpp ${COMMON_REPO}/common/includes/xcl2/arena.hpp ${COMMON_REPO}/common/includes/xcl2/gemm_batch.hpp ${COMMON_REPO}/common/includes/xcl2/event_profiler.hpp ${COMMON_REPO}/common/includes/xcl2/device_session.hpp ${COMMON_REPO}/common/includes/xcl2/mapped_file.hpp ${COMMON_REPO}/common/includes/xcl2/matrix_file.hpp
 
 xcl2_CXXFLAGS:=-I${COMMON_REPO}/common/includes/xcl2
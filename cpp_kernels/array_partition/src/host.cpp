@@ -38,7 +38,15 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 // OpenCL utility layer include
 #include "xcl2.hpp"
+#include "device_session.hpp"
+#include "event_profiler.hpp"
+#include "gemm_batch.hpp"
+#include "bitpack.hpp"
+#include "float_gemm.hpp"
+#include "gf2_gemm.hpp"
+#include "quant_gemm.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <random>
 #include <vector>
@@ -46,6 +54,7 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 using std::default_random_engine;
 using std::generate;
 using std::uniform_int_distribution;
+using std::uniform_real_distribution;
 using std::vector;
 
 void matmul(int *C, int *A, int *B, int M) {
@@ -65,8 +74,15 @@ int gen_random() {
   return dist(e);
 }
 
+// Fractions for the floating-point modes, which bf16 and fp16 round
+float gen_fraction() {
+  static default_random_engine e;
+  static uniform_real_distribution<float> dist(0, 1);
+
+  return dist(e);
+}
+
 void print(int *data, int columns, int rows) {
-  vector<int> out(columns * rows);
   for (int r = 0; r < 10; r++) {
     for (int c = 0; c < 10; c++) {
       printf("%4d ", data[r * columns + c]);
@@ -90,14 +106,309 @@ void verify(vector<int, aligned_allocator<int>> &gold,
   }
 }
 
+// Floating-point results may round differently from gold: they pass within
+// the relative error of two fp32 sums over columns terms
+void verify(vector<float, aligned_allocator<float>> &gold,
+            vector<float, aligned_allocator<float>> &output, int columns) {
+  gemm::FloatError error =
+      gemm::float_error(gold.data(), output.data(), output.size());
+  double tolerance = gemm::float_tolerance(columns);
+  printf("Max relative error %g (%u ULP), tolerance %g\n", error.max_rel,
+         error.max_ulp, tolerance);
+  if (error.max_rel > tolerance) {
+    printf("Mismatch %zu: gold: %f device: %f\n", error.worst,
+           gold[error.worst], output[error.worst]);
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Problems of the batch mode: every BATCH_SHARING consecutive problems
+// apply the same B to their own A, as one weight matrix to many inputs
+static const int BATCH_PROBLEMS = 4096;
+static const int BATCH_SHARING = 4;
+// Problems timed one enqueueTask each, for the comparison
+static const int SINGLE_PROBLEMS = 256;
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+// Batch mode: BATCH_PROBLEMS independent 16 x 16 products, first launched
+// one per enqueueTask of matmul_partition with a migration in and out each,
+// then packed by xcl::GemmBatch into one launch of
+// matmul_partition_batch_ptr. Reports problems per second of both.
+static int run_batch(const std::string &binaryFile) {
+  static const int size = 16;
+  const int elements = size * size;
+  cl_int err;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel single = session.kernel(binaryFile, "matmul_partition");
+  cl::Kernel batched =
+      session.kernel(binaryFile, "matmul_partition_batch_ptr");
+  cl::CommandQueue q = session.queue();
+
+  vector<int> A(BATCH_PROBLEMS * elements);
+  vector<int> B(BATCH_PROBLEMS / BATCH_SHARING * elements);
+  vector<int> gold(BATCH_PROBLEMS * elements, 0);
+  vector<int> C(BATCH_PROBLEMS * elements, 0);
+  generate(begin(A), end(A), gen_random);
+  generate(begin(B), end(B), gen_random);
+  for (int p = 0; p < BATCH_PROBLEMS; p++)
+    matmul(&gold[p * elements], &A[p * elements],
+           &B[p / BATCH_SHARING * elements], size);
+
+  // One launch per problem, through one set of staging buffers
+  vector<int, aligned_allocator<int>> stage_a(elements), stage_b(elements);
+  vector<int, aligned_allocator<int>> stage_c(elements);
+  cl::Buffer buffer_a = session.buffer(stage_a.data(), elements * sizeof(int),
+                                       CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b = session.buffer(stage_b.data(), elements * sizeof(int),
+                                       CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c = session.buffer(stage_c.data(), elements * sizeof(int),
+                                       CL_MEM_WRITE_ONLY);
+  OCL_CHECK(err, err = single.setArg(0, buffer_a));
+  OCL_CHECK(err, err = single.setArg(1, buffer_b));
+  OCL_CHECK(err, err = single.setArg(2, buffer_c));
+  OCL_CHECK(err, err = single.setArg(3, size));
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  for (int p = 0; p < SINGLE_PROBLEMS; p++) {
+    std::copy(&A[p * elements], &A[(p + 1) * elements], stage_a.begin());
+    std::copy(&B[p / BATCH_SHARING * elements],
+              &B[(p / BATCH_SHARING + 1) * elements], stage_b.begin());
+    OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                    0 /* 0 means from host*/));
+    OCL_CHECK(err, err = q.enqueueTask(single));
+    OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                       {buffer_c}, CL_MIGRATE_MEM_OBJECT_HOST));
+    OCL_CHECK(err, err = q.finish());
+    std::copy(stage_c.begin(), stage_c.end(), &C[p * elements]);
+  }
+  double single_s = seconds_since(t);
+  for (int i = 0; i < SINGLE_PROBLEMS * elements; i++) {
+    if (C[i] != gold[i]) {
+      printf("Mismatch %d: gold: %d device: %d\n", i, gold[i], C[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // All problems in one launch
+  std::fill(begin(C), end(C), 0);
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
+  t = std::chrono::steady_clock::now();
+  xcl::GemmBatch batch(size, size, size, BATCH_PROBLEMS);
+  for (int p = 0; p < BATCH_PROBLEMS; p++)
+    batch.add_shared_b(&A[p * elements], &B[p / BATCH_SHARING * elements],
+                       &C[p * elements]);
+  cl::Buffer batch_a = session.buffer(batch.a(), batch.a_bytes(),
+                                      CL_MEM_READ_ONLY);
+  cl::Buffer batch_b = session.buffer(batch.b(), batch.b_bytes(),
+                                      CL_MEM_READ_ONLY);
+  cl::Buffer batch_c = session.buffer(batch.c(), batch.c_bytes(),
+                                      CL_MEM_WRITE_ONLY);
+  cl::Buffer batch_offsets = session.buffer(
+      batch.offsets(), batch.offsets_bytes(), CL_MEM_READ_ONLY);
+  OCL_CHECK(err, err = batched.setArg(0, batch_a));
+  OCL_CHECK(err, err = batched.setArg(1, batch_b));
+  OCL_CHECK(err, err = batched.setArg(2, batch_c));
+  OCL_CHECK(err, err = batched.setArg(3, batch_offsets));
+  OCL_CHECK(err, err = batched.setArg(4, size));
+  OCL_CHECK(err, err = batched.setArg(5, batch.count()));
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                     {batch_a, batch_b, batch_offsets},
+                     0 /* 0 means from host*/, NULL, &write_event));
+  std::vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(batched, &write_wait, &kernel_event));
+  std::vector<cl::Event> kernel_wait(1, kernel_event);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({batch_c},
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  &kernel_wait, &read_event));
+  OCL_CHECK(err, err = q.finish());
+  batch.scatter();
+  double batch_s = seconds_since(t);
+  profiler.h2d(write_event,
+               batch.a_bytes() + batch.b_bytes() + batch.offsets_bytes());
+  profiler.kernel(kernel_event, 2.0 * size * size * size * batch.count());
+  profiler.d2h(read_event, batch.c_bytes());
+  for (int i = 0; i < BATCH_PROBLEMS * elements; i++) {
+    if (C[i] != gold[i]) {
+      printf("Mismatch %d: gold: %d device: %d\n", i, gold[i], C[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("%d problems, %d A and %d shared B packed\n", batch.count(),
+         batch.a_count(), batch.b_count());
+  printf("|-----------------+----------+--------------+--------------|\n"
+         "| Launch          | Problems |    Time (ms) |   Problems/s |\n"
+         "|-----------------+----------+--------------+--------------|\n");
+  printf("| %-15s | %8d | %12.3f | %12.0f |\n", "one per problem",
+         SINGLE_PROBLEMS, single_s * 1000, SINGLE_PROBLEMS / single_s);
+  printf("| %-15s | %8d | %12.3f | %12.0f |\n", "batched", BATCH_PROBLEMS,
+         batch_s * 1000, BATCH_PROBLEMS / batch_s);
+  printf("|-----------------+----------+--------------+--------------|\n");
+  printf("Batch speedup: %.2fx\n",
+         (BATCH_PROBLEMS / batch_s) / (SINGLE_PROBLEMS / single_s));
+  profiler.report("matmul_partition_batch_ptr");
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  printf("TEST PASSED\n\n");
+  return EXIT_SUCCESS;
+}
+
+// Bits per row of matmul_partition_gf2, and the size of the gf2 mode
+#define GF2_SIZE 512
+
+// Host to device bandwidth the bitpack mode compares its encoder against,
+// as in bitpack_bench
+#define BITPACK_LINK_GBPS 12.0
+
+// Runs one launch of kernel, its arguments set, and records it in profiler
+static void run_profiled(cl::CommandQueue &q, cl::Kernel &kernel,
+                         const vector<cl::Memory> &in,
+                         const vector<cl::Memory> &out, size_t in_bytes,
+                         size_t out_bytes, double ops,
+                         xcl::EventProfiler &profiler) {
+  cl_int err;
+  cl::Event write_event, kernel_event, read_event;
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                     in, 0 /* 0 means from host*/, NULL, &write_event));
+  vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(kernel, &write_wait, &kernel_event));
+  vector<cl::Event> kernel_wait(1, kernel_event);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                     out, CL_MIGRATE_MEM_OBJECT_HOST, &kernel_wait,
+                     &read_event));
+  OCL_CHECK(err, err = q.finish());
+  profiler.h2d(write_event, in_bytes);
+  profiler.kernel(kernel_event, ops);
+  profiler.d2h(read_event, out_bytes);
+}
+
+// GF(2) mode: a GF2_SIZE x GF2_SIZE product of random bit matrices on
+// matmul_partition_gf2, one 512-bit row per beat, checked against
+// gemm::gf2_matmul(). Its throughput, counting an AND and a XOR as the
+// multiply and add of int GEMM, is compared with matmul_partition on 16 x 16
+// ints.
+static int run_gf2(const std::string &binaryFile) {
+  const int n = GF2_SIZE;
+  const int words = n / 64;
+  const size_t bytes = (size_t)n * words * sizeof(uint64_t);
+  static const int size = 16;
+  const int elements = size * size;
+  cl_int err;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel gf2 = session.kernel(binaryFile, "matmul_partition_gf2");
+  cl::Kernel single = session.kernel(binaryFile, "matmul_partition");
+  cl::CommandQueue q = session.queue();
+
+  // Rows of n bits are whole 64-bit words of a BitMatrix, which on the
+  // little-endian host is the layout of the kernel rows
+  default_random_engine e;
+  uniform_int_distribution<uint64_t> word;
+  gemm::BitMatrix A(n, n), B(n, n), gold;
+  for (size_t i = 0; i < A.bits.size(); i++) {
+    A.bits[i] = word(e);
+    B.bits[i] = word(e);
+  }
+  gemm::gf2_matmul(A, B, gold);
+  vector<uint64_t, aligned_allocator<uint64_t>> rows_a(A.bits.begin(),
+                                                       A.bits.end());
+  vector<uint64_t, aligned_allocator<uint64_t>> rows_b(B.bits.begin(),
+                                                       B.bits.end());
+  vector<uint64_t, aligned_allocator<uint64_t>> rows_c(rows_a.size());
+  cl::Buffer buffer_a =
+      session.buffer(rows_a.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b =
+      session.buffer(rows_b.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c =
+      session.buffer(rows_c.data(), bytes, CL_MEM_WRITE_ONLY);
+  OCL_CHECK(err, err = gf2.setArg(0, buffer_a));
+  OCL_CHECK(err, err = gf2.setArg(1, buffer_b));
+  OCL_CHECK(err, err = gf2.setArg(2, buffer_c));
+  OCL_CHECK(err, err = gf2.setArg(3, n));
+  xcl::EventProfiler gf2_profiler;
+  run_profiled(q, gf2, {buffer_a, buffer_b}, {buffer_c}, 2 * bytes, bytes,
+               2.0 * n * n * n, gf2_profiler);
+  if (!std::equal(rows_c.begin(), rows_c.end(), gold.bits.begin())) {
+    printf("Mismatch in the GF(2) product\n");
+    return EXIT_FAILURE;
+  }
+
+  vector<int, aligned_allocator<int>> int_a(elements), int_b(elements);
+  vector<int, aligned_allocator<int>> int_c(elements);
+  generate(begin(int_a), end(int_a), gen_random);
+  generate(begin(int_b), end(int_b), gen_random);
+  cl::Buffer buffer_int_a = session.buffer(
+      int_a.data(), elements * sizeof(int), CL_MEM_READ_ONLY);
+  cl::Buffer buffer_int_b = session.buffer(
+      int_b.data(), elements * sizeof(int), CL_MEM_READ_ONLY);
+  cl::Buffer buffer_int_c = session.buffer(
+      int_c.data(), elements * sizeof(int), CL_MEM_WRITE_ONLY);
+  OCL_CHECK(err, err = single.setArg(0, buffer_int_a));
+  OCL_CHECK(err, err = single.setArg(1, buffer_int_b));
+  OCL_CHECK(err, err = single.setArg(2, buffer_int_c));
+  OCL_CHECK(err, err = single.setArg(3, size));
+  xcl::EventProfiler int_profiler;
+  run_profiled(q, single, {buffer_int_a, buffer_int_b}, {buffer_int_c},
+               2 * elements * sizeof(int), elements * sizeof(int),
+               2.0 * size * size * size, int_profiler);
+
+  xcl::ProfileSummary gf2_summary = gf2_profiler.summarize();
+  xcl::ProfileSummary int_summary = int_profiler.summarize();
+  printf("|--------------------------+-----------+------------+----------|\n"
+         "| Kernel                   |      Size |  Kernel ms |    GOP/s |\n"
+         "|--------------------------+-----------+------------+----------|\n");
+  printf("| %-24s | %4d x %-3d | %10.4f | %8.2f |\n", "matmul_partition",
+         size, size, int_summary.phase[(int)xcl::Phase::Kernel].busy_ms,
+         int_summary.kernel_gops);
+  printf("| %-24s | %4d x %-3d | %10.4f | %8.2f |\n", "matmul_partition_gf2",
+         n, n, gf2_summary.phase[(int)xcl::Phase::Kernel].busy_ms,
+         gf2_summary.kernel_gops);
+  printf("|--------------------------+-----------+------------+----------|\n");
+  gf2_profiler.report("matmul_partition_gf2");
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  printf("TEST PASSED\n\n");
+  return EXIT_SUCCESS;
+}
+
 // This example illustrates how to use array partitioning attributes in HLS
 // kernels for FPGA devices using matmul.
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cout << "Usage: " << argv[0] << " <XCLBIN File>" << std::endl;
+  if (argc != 2 && argc != 3) {
+    std::cout << "Usage: " << argv[0]
+              << " <XCLBIN File> [int8|int16|fp32|bf16|fp16|bitpack|batch|"
+                 "gf2]"
+              << std::endl;
     return EXIT_FAILURE;
   }
   std::string binaryFile = argv[1];
+  // "int8" and "int16" run matmul_partition_int8/_int16, which read A and B
+  // packed four or two operands per word and accumulate in int32. "fp32",
+  // "bf16" and "fp16" run matmul_partition_fp32/_bf16/_fp16, which
+  // accumulate in fp32. "bitpack" runs matmul_partition_bitpack, which
+  // reads A and B bit-packed to the width of their value range. "batch"
+  // compares one launch per small problem with one batched launch. "gf2"
+  // runs matmul_partition_gf2 on 512 x 512 bit matrices.
+  std::string mode = (argc == 3) ? argv[2] : "";
+  if (mode == "batch")
+    return run_batch(binaryFile);
+  if (mode == "gf2")
+    return run_gf2(binaryFile);
+  bool fp = (mode == "fp32" || mode == "bf16" || mode == "fp16");
+  bool bitpack = (mode == "bitpack");
+  if (argc == 3 && mode != "int8" && mode != "int16" && !fp && !bitpack) {
+    printf("Unknown mode %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  bool quant = !mode.empty() && !fp && !bitpack;
+  bool half = (mode == "bf16" || mode == "fp16");
+  gemm::QuantWidth width =
+      (mode == "int16") ? gemm::QUANT_INT16 : gemm::QUANT_INT8;
+  std::string kernel_name =
+      mode.empty() ? "matmul_partition" : "matmul_partition_" + mode;
   static const int columns = 16;
   static const int rows = 16;
   cl_int err;
@@ -112,6 +423,31 @@ int main(int argc, char **argv) {
   generate(begin(A), end(A), gen_random);
   generate(begin(B), end(B), gen_random);
 
+  // Floating-point operands. The 16-bit types are stored as their raw bit
+  // patterns, the layout the kernels read, and gold is computed from the
+  // rounded values.
+  vector<float, aligned_allocator<float>> float_a(columns * rows);
+  vector<float, aligned_allocator<float>> float_b(columns * rows);
+  vector<uint16_t, aligned_allocator<uint16_t>> half_a(columns * rows);
+  vector<uint16_t, aligned_allocator<uint16_t>> half_b(columns * rows);
+  vector<float, aligned_allocator<float>> float_gold(columns * rows, 0);
+  vector<float, aligned_allocator<float>> float_c(columns * rows, 0);
+  gemm::bf16 *bf16_a = reinterpret_cast<gemm::bf16 *>(half_a.data());
+  gemm::bf16 *bf16_b = reinterpret_cast<gemm::bf16 *>(half_b.data());
+  gemm::fp16 *fp16_a = reinterpret_cast<gemm::fp16 *>(half_a.data());
+  gemm::fp16 *fp16_b = reinterpret_cast<gemm::fp16 *>(half_b.data());
+  if (fp) {
+    generate(begin(float_a), end(float_a), gen_fraction);
+    generate(begin(float_b), end(float_b), gen_fraction);
+    if (mode == "bf16") {
+      gemm::convert(float_a.data(), bf16_a, float_a.size());
+      gemm::convert(float_b.data(), bf16_b, float_b.size());
+    } else if (mode == "fp16") {
+      gemm::convert(float_a.data(), fp16_a, float_a.size());
+      gemm::convert(float_b.data(), fp16_b, float_b.size());
+    }
+  }
+
   printf("A:\n");
   print(A.data(), columns, rows);
   printf("B:\n");
@@ -119,54 +455,98 @@ int main(int argc, char **argv) {
 
     clock_t t;
   t = clock(); 
-  matmul(gold.data(), A.data(), B.data(), columns);
+  // The floating-point types use the vectorized CPU engine
+  if (mode == "bf16")
+    gemm::float_matmul(bf16_a, bf16_b, float_gold.data(), rows, columns,
+                       columns);
+  else if (mode == "fp16")
+    gemm::float_matmul(fp16_a, fp16_b, float_gold.data(), rows, columns,
+                       columns);
+  else if (fp)
+    gemm::float_matmul(float_a.data(), float_b.data(), float_gold.data(),
+                       rows, columns, columns);
+  else
+    matmul(gold.data(), A.data(), B.data(), columns);
   t = clock() - t;
   double time_taken_s = ((double)t)/CLOCKS_PER_SEC; // in seconds
   double time_taken_ms = time_taken_s*1000; // in seconds
   
-  printf("Gold:\n");
-  print(gold.data(), columns, rows);
-  auto devices = xcl::get_xil_devices();
-
-  // read_binary_file() is a utility API which will load the binaryFile
-  // and will return the pointer to file buffer.
-  auto fileBuf = xcl::read_binary_file(binaryFile);
-  cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
-  int valid_device = 0;
-  for (unsigned int i = 0; i < devices.size(); i++) {
-    auto device = devices[i];
-    // Creating Context and Command Queue for selected Device
-    OCL_CHECK(err, context = cl::Context(device, NULL, NULL, NULL, &err));
-    OCL_CHECK(err, q = cl::CommandQueue(context, device,
-                                        CL_QUEUE_PROFILING_ENABLE, &err));
-
-    std::cout << "Trying to program device[" << i
-              << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
-    program = cl::Program(context, {device}, bins, NULL, &err);
-    if (err != CL_SUCCESS) {
-      std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
-    } else {
-      std::cout << "Device[" << i << "]: program successful!\n";
-      valid_device++;
-      break; // we break because we found a valid device
-    }
-  }
-  if (valid_device == 0) {
-    std::cout << "Failed to program any device found, exit!\n";
-    exit(EXIT_FAILURE);
+  if (!fp) {
+    printf("Gold:\n");
+    print(gold.data(), columns, rows);
   }
+  // The device session programs the device once per xclbin and caches the
+  // program and kernel handles for later calls.
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  program = session.program(binaryFile);
+  context = session.context();
+  q = session.queue();
 
   // compute the size of array in bytes
   size_t array_size_bytes = columns * rows * sizeof(int);
+  // Packed operands: A by rows and B by columns, along K
+  int words = gemm::quant_words(columns, width);
+  vector<uint32_t, aligned_allocator<uint32_t>> packed_a(rows * words);
+  vector<uint32_t, aligned_allocator<uint32_t>> packed_b(words * columns);
+  if (quant) {
+    if (!gemm::quant_fits(A.data(), A.size(), width) ||
+        !gemm::quant_fits(B.data(), B.size(), width)) {
+      printf("Inputs do not fit %s\n", mode.c_str());
+      return EXIT_FAILURE;
+    }
+    gemm::quant_pack_rows(A.data(), packed_a.data(), rows, columns, width);
+    gemm::quant_pack_cols(B.data(), packed_b.data(), rows, columns, width);
+  }
+  // Bit-packed operands, each at the width its min/max scan allows: 4 bits
+  // for the 0..10 of gen_random
+  std::chrono::steady_clock::time_point pack_start =
+      std::chrono::steady_clock::now();
+  gemm::BitPacking packing_a = gemm::bitpack_choose(A.data(), A.size());
+  gemm::BitPacking packing_b = gemm::bitpack_choose(B.data(), B.size());
+  vector<uint32_t, aligned_allocator<uint32_t>> bits_a(
+      gemm::bitpack_words(A.size(), packing_a.width));
+  vector<uint32_t, aligned_allocator<uint32_t>> bits_b(
+      gemm::bitpack_words(B.size(), packing_b.width));
+  if (bitpack) {
+    gemm::bitpack_encode(A.data(), A.size(), packing_a, bits_a.data());
+    gemm::bitpack_encode(B.data(), B.size(), packing_b, bits_b.data());
+    double pack_gbps = 2 * array_size_bytes / seconds_since(pack_start) * 1e-9;
+    printf("A packed to %d bits, B to %d bits, at %.2f GB/s; packing pays "
+           "above %.2f GB/s on a %.0f GB/s link\n",
+           packing_a.width, packing_b.width, pack_gbps,
+           gemm::bitpack_break_even(std::max(packing_a.width, packing_b.width),
+                                    BITPACK_LINK_GBPS),
+           BITPACK_LINK_GBPS);
+  }
+  size_t input_bytes =
+      quant ? packed_a.size() * sizeof(uint32_t)
+            : half ? half_a.size() * sizeof(uint16_t) : array_size_bytes;
+  size_t input_a_bytes =
+      bitpack ? bits_a.size() * sizeof(uint32_t) : input_bytes;
+  size_t input_b_bytes =
+      bitpack ? bits_b.size() * sizeof(uint32_t) : input_bytes;
+  void *input_a = quant ? (void *)packed_a.data()
+                        : half ? (void *)half_a.data()
+                               : fp ? (void *)float_a.data()
+                                    : bitpack ? (void *)bits_a.data()
+                                              : (void *)A.data();
+  void *input_b = quant ? (void *)packed_b.data()
+                        : half ? (void *)half_b.data()
+                               : fp ? (void *)float_b.data()
+                                    : bitpack ? (void *)bits_b.data()
+                                              : (void *)B.data();
   OCL_CHECK(err,
             cl::Buffer buffer_a(context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
-                                array_size_bytes, A.data(), &err));
+                                input_a_bytes, input_a, &err));
   OCL_CHECK(err,
             cl::Buffer buffer_b(context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
-                                array_size_bytes, B.data(), &err));
+                                input_b_bytes, input_b, &err));
   OCL_CHECK(err, cl::Buffer buffer_c(context,
                                      CL_MEM_USE_HOST_PTR | CL_MEM_WRITE_ONLY,
-                                     array_size_bytes, C.data(), &err));
+                                     array_size_bytes,
+                                     fp ? (void *)float_c.data()
+                                        : (void *)C.data(),
+                                     &err));
 
 
 
@@ -175,18 +555,40 @@ int main(int argc, char **argv) {
   uint64_t nstimestart, nstimeend;
 
   OCL_CHECK(err, matmul_partition_kernel =
-                     cl::Kernel(program, "matmul_partition", &err));
+                     cl::Kernel(program, kernel_name.c_str(), &err));
 
   OCL_CHECK(err, err = matmul_partition_kernel.setArg(0, buffer_a));
   OCL_CHECK(err, err = matmul_partition_kernel.setArg(1, buffer_b));
   OCL_CHECK(err, err = matmul_partition_kernel.setArg(2, buffer_c));
   OCL_CHECK(err, err = matmul_partition_kernel.setArg(3, columns));
+  if (bitpack) {
+    OCL_CHECK(err, err = matmul_partition_kernel.setArg(4, packing_a.width));
+    OCL_CHECK(err, err = matmul_partition_kernel.setArg(5, packing_a.base));
+    OCL_CHECK(err, err = matmul_partition_kernel.setArg(6, packing_b.width));
+    OCL_CHECK(err, err = matmul_partition_kernel.setArg(7, packing_b.base));
+  }
 
-  OCL_CHECK(err, err = q.enqueueTask(matmul_partition_kernel, NULL, &event));
+  // Time every phase of the functional run: inputs in, kernel, result out
+  xcl::EventProfiler profiler;
+  cl::Event write_event, read_event;
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                  0 /* 0 means from host*/,
+                                                  NULL, &write_event));
+  std::vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(matmul_partition_kernel, &write_wait,
+                                     &event));
+  std::vector<cl::Event> kernel_wait(1, event);
   OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_c},
-                                                  CL_MIGRATE_MEM_OBJECT_HOST));
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  &kernel_wait, &read_event));
                                               
   q.finish();
+  profiler.h2d(write_event, input_a_bytes + input_b_bytes);
+  profiler.kernel(event, 2.0 * columns * columns * rows);
+  profiler.d2h(read_event, array_size_bytes);
+  if (fp)
+    verify(float_gold, float_c, columns);
+  else
     verify(gold, C);
 // Launch the kernel and get profile data (stop-start)
   double fpga_exec_time_s=0;
@@ -215,6 +617,7 @@ int main(int argc, char **argv) {
   printf("|-------------------------+-------------------------|\n");
   printf("| Speedup:  %23f                                    | \n", time_taken_ms/avg_fpga_exec_time);
   printf("|-------------------------+-------------------------|\n");
+  profiler.report(kernel_name);
   printf("Note: Wall Clock Time is meaningful for real hardware execution "
          "only, not for emulation.\n");
   printf("Please refer to profile summary for kernel execution time for "
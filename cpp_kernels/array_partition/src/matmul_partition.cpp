@@ -46,6 +46,439 @@ Description:
 
 // TRIPCOUNT identifiers
 const unsigned int c_dim = MAX_SIZE;
+const unsigned int c_batch = 1024;
+
+// Operand lanes of a 32-bit word in the packed kernels below: four int8 or
+// two int16, lowest k in the lowest bits
+template <int BITS> static int lane(int word, int l) {
+  return (int)((unsigned int)word << (32 - BITS * (l + 1))) >> (32 - BITS);
+}
+
+static float bits_float(unsigned int bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Element types of the floating-point kernels below: the type read from
+// global memory and its value in fp32, which accumulates all of them. bf16
+// and fp16 are raw bit patterns; their products are exact in fp32.
+struct fp32_elem {
+  typedef float storage;
+  static float value(float x) { return x; }
+};
+struct bf16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    return bits_float((unsigned int)x << 16);
+  }
+};
+struct fp16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    unsigned int exp = (x >> 10) & 0x1f;
+    unsigned int mant = x & 0x3ff;
+    float mag = (exp == 0) ? mant * 5.9604645e-8f // subnormal, mant * 2^-24
+                : (exp == 0x1f)
+                    ? bits_float(0x7f800000 | (mant ? 0x400000 : 0) |
+                                 (mant << 13))
+                    : bits_float(((exp + 112) << 23) | (mant << 13));
+    return (x & 0x8000) ? -mag : mag;
+  }
+};
+
+// matmul_partition on packed operands. in1 holds A packed by rows and in2 B
+// packed by columns, both along K: word w of a row of A, and row w of B,
+// hold k = lanes * w .. lanes * w + lanes - 1. Each step of arraypart2 then
+// does 32 / BITS multiply-adds per column, accumulated in int32.
+template <int BITS>
+static void matmul_packed(int *in1, int *in2, int *out_r, int size) {
+  const int lanes = 32 / BITS;
+  const int words = (size + lanes - 1) / lanes;
+
+  // Local buffers to hold input data
+  int A[MAX_SIZE][MAX_SIZE * BITS / 32];
+  int B[MAX_SIZE * BITS / 32][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+  int temp_sum[MAX_SIZE];
+
+// partitioning Array B and C
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+// Read data from global memory and write into local buffer for in1
+read_A:
+  for (int itr = 0, i = 0, j = 0; itr < size * words; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim*BITS/32 max = c_dim*c_dim*BITS/32
+    if (j == words) {
+      j = 0;
+      i++;
+    }
+    A[i][j] = in1[itr];
+  }
+
+// Read data from global memory and write into local buffer for in2
+read_B:
+  for (int itr = 0, i = 0, j = 0; itr < words * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim*BITS/32 max = c_dim*c_dim*BITS/32
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    B[i][j] = in2[itr];
+  }
+
+// Same loop nest as matmul_partition, over words of K instead of single k
+arraypart1:
+  for (int row = 0; row < size; row++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+  arraypart2:
+    for (int w = 0; w < words; w++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*BITS/32 max = c_dim*BITS/32
+    arraypart3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+        int result = (w == 0) ? 0 : temp_sum[j];
+        for (int l = 0; l < lanes; l++) {
+#pragma HLS UNROLL
+          result += lane<BITS>(A[row][w], l) * lane<BITS>(B[w][j], l);
+        }
+        temp_sum[j] = result;
+        if (w == words - 1)
+          C[row][j] = result;
+      }
+    }
+  }
+
+// Write results from local buffer to global memory for out
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
+// Log2 of the elements per 32-bit word of the bit-packed kernels below, for
+// widths of 1, 2, 4, 8 or 32 bits
+static int lanes_log2(int width) {
+  switch (width) {
+  case 1:
+    return 5;
+  case 2:
+    return 4;
+  case 4:
+    return 3;
+  case 8:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// matmul_partition on bit-packed operands (see
+// common/includes/gemm/bitpack.hpp): element itr of A is base1 plus bits
+// width1 * (itr % lanes) upwards of word itr / lanes of in1, and likewise
+// for B. read_A and read_B take one element per iteration from a word
+// register refilled every lanes elements, reading 32 / width times fewer
+// words than matmul_partition. The loop nest is that of matmul_partition.
+static void matmul_unpack(int *in1, int *in2, int *out_r, int size,
+                          int width1, int base1, int width2, int base2) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+  int temp_sum[MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+  const int shift1 = lanes_log2(width1);
+  const int shift2 = lanes_log2(width2);
+  const unsigned int mask1 = (width1 == 32) ? ~0u : (1u << width1) - 1;
+  const unsigned int mask2 = (width2 == 32) ? ~0u : (1u << width2) - 1;
+  unsigned int word1 = 0, word2 = 0;
+
+read_A:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    if ((itr & ((1 << shift1) - 1)) == 0)
+      word1 = in1[itr >> shift1];
+    A[i][j] = base1 + (int)(word1 & mask1);
+    word1 = (width1 == 32) ? 0 : word1 >> width1;
+  }
+
+read_B:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    if ((itr & ((1 << shift2) - 1)) == 0)
+      word2 = in2[itr >> shift2];
+    B[i][j] = base2 + (int)(word2 & mask2);
+    word2 = (width2 == 32) ? 0 : word2 >> width2;
+  }
+
+arraypart1:
+  for (int row = 0; row < size; row++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+  arraypart2:
+    for (int col = 0; col < size; col++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+    arraypart3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+        int result = (col == 0) ? 0 : temp_sum[j];
+        result += A[row][col] * B[col][j];
+        temp_sum[j] = result;
+        if (col == size - 1)
+          C[row][j] = result;
+      }
+    }
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
+// matmul_partition on floating-point operands with fp32 accumulation. As
+// in matmul_partition, successive iterations of arraypart3 update different
+// temp_sum[j], which keeps the latency of the floating-point adder off the
+// pipelined path.
+template <typename E>
+static void matmul_typed(const typename E::storage *in1,
+                         const typename E::storage *in2, float *out_r,
+                         int size) {
+  typename E::storage A[MAX_SIZE][MAX_SIZE];
+  typename E::storage B[MAX_SIZE][MAX_SIZE];
+  float C[MAX_SIZE][MAX_SIZE];
+  float temp_sum[MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+read_A:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    A[i][j] = in1[itr];
+  }
+
+read_B:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    B[i][j] = in2[itr];
+  }
+
+arraypart1:
+  for (int row = 0; row < size; row++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+  arraypart2:
+    for (int col = 0; col < size; col++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+      float a = E::value(A[row][col]);
+    arraypart3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+        float result = (col == 0) ? 0 : temp_sum[j];
+        result += a * E::value(B[col][j]);
+        temp_sum[j] = result;
+        if (col == size - 1)
+          C[row][j] = result;
+      }
+    }
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
+// Semirings of the kernels below: zero() is the identity of add() and
+// absorbs mul(). PlusTimes is the product of matmul_partition, MinPlus gives
+// shortest and MaxPlus longest paths, with INT_MAX / -INT_MAX as "no path"
+// (see common/includes/gemm/semiring_gemm.hpp).
+#define SEMIRING_INF 0x7fffffff
+// a + b saturated to [-SEMIRING_INF, SEMIRING_INF], so that a long finite
+// path does not wrap
+static int semiring_add_sat(int a, int b) {
+#pragma HLS INLINE
+  long long sum = (long long)a + b;
+  return (sum > SEMIRING_INF) ? SEMIRING_INF
+         : (sum < -SEMIRING_INF) ? -SEMIRING_INF
+                                 : (int)sum;
+}
+struct PlusTimes {
+  static int zero() { return 0; }
+  static int add(int a, int b) { return a + b; }
+  static int mul(int a, int b) { return a * b; }
+};
+struct MinPlus {
+  static int zero() { return SEMIRING_INF; }
+  static int add(int a, int b) { return a < b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == SEMIRING_INF || b == SEMIRING_INF) ? SEMIRING_INF
+                                                    : semiring_add_sat(a, b);
+  }
+};
+struct MaxPlus {
+  static int zero() { return -SEMIRING_INF; }
+  static int add(int a, int b) { return a > b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == -SEMIRING_INF || b == -SEMIRING_INF) ? -SEMIRING_INF
+                                                      : semiring_add_sat(a, b);
+  }
+};
+
+// Epilogue of writeC, selected at run time: C = alpha * A * B + beta * C,
+// then by flags + bias[j], ReLU, and requantization to int8 by a rounding
+// right shift and saturation, computed by epilogue() of
+// common/includes/gemm/epilogue_core.hpp like the host reference. The
+// identity leaves writeC a plain copy.
+#include "../../../common/includes/gemm/epilogue_core.hpp"
+using gemm::EPI_BIAS;
+using gemm::epilogue;
+using gemm::epilogue_args;
+using gemm::epilogue_identity;
+
+// One problem of the batched, semiring and epilogue kernels below, through
+// local buffers of the caller so that B can stay on chip from one problem to
+// the next: read_B is skipped unless load_b. The loop nest is that of
+// matmul_partition, with the multiply-add taken from the semiring S and epi
+// applied in writeC, bias holding size values when epi has EPI_BIAS.
+template <typename S>
+static void matmul_one(int *in1, int *in2, int *out_r, int size, bool load_b,
+                       int A[MAX_SIZE][MAX_SIZE], int B[MAX_SIZE][MAX_SIZE],
+                       int C[MAX_SIZE][MAX_SIZE], const int *bias = 0,
+                       const epilogue_args &epi = epilogue_identity) {
+#pragma HLS INLINE
+  int temp_sum[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+read_A:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    A[i][j] = in1[itr];
+  }
+
+  int bias_r[MAX_SIZE];
+  if (epi.flags & EPI_BIAS) {
+  read_bias:
+    for (int j = 0; j < size; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+      bias_r[j] = bias[j];
+    }
+  }
+
+  if (load_b) {
+  read_B:
+    for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+      if (j == size) {
+        j = 0;
+        i++;
+      }
+      B[i][j] = in2[itr];
+    }
+  }
+
+arraypart1:
+  for (int row = 0; row < size; row++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+  arraypart2:
+    for (int col = 0; col < size; col++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+    arraypart3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+        int result = (col == 0) ? S::zero() : temp_sum[j];
+        result = S::add(result, S::mul(A[row][col], B[col][j]));
+        temp_sum[j] = result;
+        if (col == size - 1)
+          C[row][j] = result;
+      }
+    }
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim*c_dim max = c_dim*c_dim
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = epilogue(epi, C[i][j], epi.beta ? out_r[itr] : 0,
+                          (epi.flags & EPI_BIAS) ? bias_r[j] : 0);
+  }
+}
+
+// matmul_partition over the semiring S
+template <typename S>
+static void matmul_semiring(int *in1, int *in2, int *out_r, int size) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+
+  matmul_one<S>(in1, in2, out_r, size, true, A, B, C);
+}
+
+// Bits per row of the GF(2) kernel, and rows of B it adds per cycle
+#define GF2_MAX_SIZE 512
+#define GF2_K_LANES 8
+const unsigned int c_gf2 = GF2_MAX_SIZE;
+const unsigned int c_gf2_steps = GF2_MAX_SIZE / GF2_K_LANES;
+
+// One row of a GF(2) matrix, column j in bit j % 32 of word j / 32: one
+// 512-bit beat of the memory port
+struct row512 {
+  unsigned int word[GF2_MAX_SIZE / 32];
+};
+
+static row512 row_xor(row512 a, const row512 &b) {
+  for (int w = 0; w < GF2_MAX_SIZE / 32; w++) {
+#pragma HLS UNROLL
+    a.word[w] ^= b.word[w];
+  }
+  return a;
+}
 
 extern "C" {
 // Matrix multiplication kernel
@@ -116,4 +549,204 @@ writeC:
     out_r[itr] = C[i][j];
   }
 }
+
+// int8 operands, four per word: a quarter of the transfers of
+// matmul_partition for A and B
+void matmul_partition_int8(int *in1, int *in2, int *out_r, int size) {
+  matmul_packed<8>(in1, in2, out_r, size);
+}
+
+// int16 operands, two per word
+void matmul_partition_int16(int *in1, int *in2, int *out_r, int size) {
+  matmul_packed<16>(in1, in2, out_r, size);
+}
+
+// fp32 operands and result
+void matmul_partition_fp32(float *in1, float *in2, float *out_r, int size) {
+  matmul_typed<fp32_elem>(in1, in2, out_r, size);
+}
+
+// bf16 operands, half the transfers of matmul_partition_fp32 for A and B,
+// fp32 result
+void matmul_partition_bf16(unsigned short *in1, unsigned short *in2,
+                           float *out_r, int size) {
+  matmul_typed<bf16_elem>(in1, in2, out_r, size);
+}
+
+// fp16 operands, fp32 result
+void matmul_partition_fp16(unsigned short *in1, unsigned short *in2,
+                           float *out_r, int size) {
+  matmul_typed<fp16_elem>(in1, in2, out_r, size);
+}
+
+// Bit-packed operands of width1 and width2 bits offset by base1 and base2,
+// int32 result
+void matmul_partition_bitpack(int *in1, int *in2, int *out_r, int size,
+                              int width1, int base1, int width2, int base2) {
+  matmul_unpack(in1, in2, out_r, size, width1, base1, width2, base2);
+}
+
+// A batch of independent size x size products in one launch. Problem p
+// reads A at in1 + p * stride1 and B at in2 + p * stride2 and writes C at
+// out_r + p * stride_out, strides in elements. A stride2 of 0 applies one B
+// to the whole batch, which is then read once.
+void matmul_partition_batch(int *in1, int *in2, int *out_r, int size,
+                            int batch, int stride1, int stride2,
+                            int stride_out) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+
+batch_loop:
+  for (int p = 0; p < batch; p++) {
+#pragma HLS LOOP_TRIPCOUNT min = 1 max = c_batch
+    matmul_one<PlusTimes>(in1 + p * stride1, in2 + p * stride2,
+                          out_r + p * stride_out, size,
+                          p == 0 || stride2 != 0, A, B, C);
+  }
+}
+
+// A batch of independent size x size products in one launch, placed by a
+// table of element offsets, three per problem: A in in1, B in in2 and C in
+// out_r (see common/includes/xcl2/gemm_batch.hpp). B is read again only
+// when its offset differs from that of the previous problem.
+void matmul_partition_batch_ptr(int *in1, int *in2, int *out_r,
+                                const int *offsets, int size, int batch) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+
+  int last_b = -1;
+batch_loop:
+  for (int p = 0; p < batch; p++) {
+#pragma HLS LOOP_TRIPCOUNT min = 1 max = c_batch
+    int offset_a = offsets[3 * p];
+    int offset_b = offsets[3 * p + 1];
+    int offset_c = offsets[3 * p + 2];
+    matmul_one<PlusTimes>(in1 + offset_a, in2 + offset_b, out_r + offset_c,
+                          size, offset_b != last_b, A, B, C);
+    last_b = offset_b;
+  }
+}
+
+// Shortest paths: min over k of in1[i][k] + in2[k][j], INT_MAX for no path
+void matmul_partition_minplus(int *in1, int *in2, int *out_r, int size) {
+  matmul_semiring<MinPlus>(in1, in2, out_r, size);
+}
+
+// Longest paths: max over k of in1[i][k] + in2[k][j], -INT_MAX for no path
+void matmul_partition_maxplus(int *in1, int *in2, int *out_r, int size) {
+  matmul_semiring<MaxPlus>(in1, in2, out_r, size);
+}
+
+// matmul_partition with an epilogue fused into writeC, selected at run
+// time: out_r = alpha * in1 * in2 + beta * out_r, then by flags + bias[j]
+// (size values), ReLU and requantization to int8 by a rounding right shift
+// of shift bits. out_r is read back only when beta is not 0.
+void matmul_partition_epilogue(int *in1, int *in2, int *out_r,
+                               const int *bias, int size, int alpha, int beta,
+                               int flags, int shift) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+
+  epilogue_args epi = {alpha, beta, flags, shift};
+  matmul_one<PlusTimes>(in1, in2, out_r, size, true, A, B, C, bias, epi);
+}
+
+// Boolean product over (OR, AND) on bit-packed operands: in1 holds the rows
+// of A, bit k of word i for A[i][k], and in2 the rows of B the same way.
+// Row i of C, written to out_r[i], is the OR of the rows k of B for the set
+// bits k of row i of A, so each step of arraypart2 handles a whole row of B
+// at once.
+void matmul_partition_bool(int *in1, int *in2, int *out_r, int size) {
+  unsigned int rowsA[MAX_SIZE];
+  unsigned int rowsB[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = rowsB dim = 1 complete
+
+read_A:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+    rowsA[i] = in1[i];
+  }
+
+read_B:
+  for (int k = 0; k < size; k++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+    rowsB[k] = in2[k];
+  }
+
+  unsigned int j_mask = (size >= 32) ? ~0u : (1u << size) - 1;
+arraypart1:
+  for (int row = 0; row < size; row++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_dim max = c_dim
+    unsigned int result = 0;
+  arraypart2:
+    for (int k = 0; k < MAX_SIZE; k++) {
+      bool set = k < size && ((rowsA[row] >> k) & 1);
+      result |= set ? rowsB[k] : 0;
+    }
+    out_r[row] = result & j_mask;
+  }
+}
+
+// C = A * B over GF(2) on bit rows of up to 512 columns: in1 holds the rows
+// of A and in2 the rows of B, one beat per row, and out_r receives the rows
+// of C. Row i of C is the XOR of the rows k of B for the set bits k of row i
+// of A. B is partitioned cyclically so that GF2_K_LANES of its rows are read
+// in each cycle of gf2_rows2, which then does 8 x 512 AND/XOR operations
+// instead of the 16 multiply-adds of a step of arraypart2.
+void matmul_partition_gf2(const row512 *in1, const row512 *in2,
+                          row512 *out_r, int size) {
+  row512 B[GF2_MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = B cyclic factor = 8 dim = 1
+
+gf2_read_B:
+  for (int k = 0; k < size; k++) {
+#pragma HLS PIPELINE II = 1
+#pragma HLS LOOP_TRIPCOUNT min = c_gf2 max = c_gf2
+    B[k] = in2[k];
+  }
+
+  // Columns past size are cleared from the rows of C
+  row512 j_mask;
+  for (int w = 0; w < GF2_MAX_SIZE / 32; w++) {
+#pragma HLS UNROLL
+    int bits = size - 32 * w;
+    j_mask.word[w] = (bits >= 32) ? ~0u : (bits <= 0) ? 0 : (1u << bits) - 1;
+  }
+
+gf2_rows1:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_gf2 max = c_gf2
+    row512 a = in1[i];
+    row512 c = {};
+  gf2_rows2:
+    for (int k0 = 0; k0 < size; k0 += GF2_K_LANES) {
+#pragma HLS PIPELINE II = 1
+#pragma HLS LOOP_TRIPCOUNT min = c_gf2_steps max = c_gf2_steps
+      // GF2_K_LANES divides 32, so the bits never straddle a word
+      unsigned int bits = a.word[k0 / 32] >> (k0 % 32);
+      for (int l = 0; l < GF2_K_LANES; l++) {
+#pragma HLS UNROLL
+        if (((bits >> l) & 1) && k0 + l < size)
+          c = row_xor(c, B[k0 + l]);
+      }
+    }
+    for (int w = 0; w < GF2_MAX_SIZE / 32; w++) {
+#pragma HLS UNROLL
+      c.word[w] &= j_mask.word[w];
+    }
+    out_r[i] = c;
+  }
+}
 }
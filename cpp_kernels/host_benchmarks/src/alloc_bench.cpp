@@ -0,0 +1,167 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Allocator policy benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Allocates the matrices with aligned_allocator under each page policy:
+4 KB pages, transparent huge pages, explicit 2 MB and 1 GB huge pages, NUMA
+interleave and parallel first-touch. For each policy it reports the time to
+allocate and fill the inputs, a blocked transpose in GB/s and the CPU engine
+GEMM in GOPS. Results are checked against the 4 KB page run.
+Explicit huge pages need a pool, e.g. echo 64 > /proc/sys/vm/nr_hugepages;
+without one the policy falls back to transparent huge pages.
+Usage: ./alloc_bench [transpose size] [GEMM size]
+*/
+
+#include "aligned_allocator.hpp"
+#include "cpu_gemm.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int TRANSPOSE_BLOCK = 32;
+static const int TRANSPOSE_REPEAT = 5;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// Rows of the input are split across the pool; each task transposes
+// TRANSPOSE_BLOCK x TRANSPOSE_BLOCK blocks of its band
+static void transpose(const int *in, int *out, int n) {
+  gemm::ThreadPool::global().parallel_for(
+      0, n / TRANSPOSE_BLOCK, 1, [=](int first, int last) {
+        for (int bi = first * TRANSPOSE_BLOCK; bi < last * TRANSPOSE_BLOCK;
+             bi += TRANSPOSE_BLOCK)
+          for (int bj = 0; bj < n; bj += TRANSPOSE_BLOCK)
+            for (int i = bi; i < bi + TRANSPOSE_BLOCK; i++)
+              for (int j = bj; j < bj + TRANSPOSE_BLOCK; j++)
+                out[(size_t)j * n + i] = in[(size_t)i * n + j];
+      });
+}
+
+struct Result {
+  double fill_ms;
+  double transpose_gbps;
+  double gemm_gops;
+  long long checksum;
+};
+
+template <typename Policy> static Result run(int tn, int gn) {
+  typedef std::vector<int, aligned_allocator<int, Policy> > Matrix;
+  Result r;
+
+  Clock::time_point t = Clock::now();
+  Matrix in((size_t)tn * tn), out((size_t)tn * tn);
+  for (size_t i = 0; i < in.size(); i++)
+    in[i] = (int)(i % 1021);
+  Matrix A((size_t)gn * gn), B((size_t)gn * gn), C((size_t)gn * gn);
+  for (size_t i = 0; i < A.size(); i++) {
+    A[i] = (int)(i % 7);
+    B[i] = (int)(i % 5);
+  }
+  r.fill_ms = seconds_since(t) * 1000;
+
+  // Warm up once, then time the repeats
+  transpose(in.data(), out.data(), tn);
+  t = Clock::now();
+  for (int i = 0; i < TRANSPOSE_REPEAT; i++)
+    transpose(in.data(), out.data(), tn);
+  double sec = seconds_since(t) / TRANSPOSE_REPEAT;
+  r.transpose_gbps = 2.0 * in.size() * sizeof(int) / sec * 1e-9;
+
+  t = Clock::now();
+  gemm::cpu_matmul(A.data(), B.data(), C.data(), gn, gn, gn);
+  sec = seconds_since(t);
+  r.gemm_gops = 2.0 * gn * gn * gn / sec * 1e-9;
+
+  r.checksum = 0;
+  for (size_t i = 0; i < out.size(); i += 97)
+    r.checksum += out[i] * (long long)(i % 13);
+  for (size_t i = 0; i < C.size(); i++)
+    r.checksum += C[i];
+  return r;
+}
+
+int main(int argc, char **argv) {
+  int tn = argc > 1 ? atoi(argv[1]) : 4096;
+  int gn = argc > 2 ? atoi(argv[2]) : 1024;
+  if (tn <= 0 || tn % TRANSPOSE_BLOCK || gn <= 0) {
+    printf("Transpose size must be a positive multiple of %d\n",
+           TRANSPOSE_BLOCK);
+    return EXIT_FAILURE;
+  }
+
+  struct Case {
+    const char *name;
+    Result (*run)(int, int);
+  };
+  const Case cases[] = {
+      {"4 KB pages", run<xcl::PageAligned>},
+      {"transparent huge pages", run<xcl::TransparentHugePages>},
+      {"2 MB huge pages", run<xcl::HugePages2M>},
+      {"1 GB huge pages", run<xcl::HugePages1G>},
+      {"NUMA interleave", run<xcl::NumaInterleave<> >},
+      {"interleave + 2 MB pages", run<xcl::NumaInterleave<xcl::HugePages2M> >},
+      {"parallel first-touch", run<xcl::ParallelFirstTouch<> >},
+  };
+  const int num_cases = sizeof(cases) / sizeof(cases[0]);
+
+  printf("Transpose %d x %d, GEMM %d x %d x %d, %u threads\n", tn, tn, gn,
+         gn, gn, gemm::ThreadPool::global().size());
+  printf("|-------------------------+-----------+----------------+--------------|\n"
+         "| Policy                  |      Fill |      Transpose |         GEMM |\n"
+         "|-------------------------+-----------+----------------+--------------|\n");
+  long long gold = 0;
+  for (int c = 0; c < num_cases; c++) {
+    Result r = cases[c].run(tn, gn);
+    if (c == 0)
+      gold = r.checksum;
+    else if (r.checksum != gold) {
+      printf("Mismatch under %s\n", cases[c].name);
+      return EXIT_FAILURE;
+    }
+    printf("| %-23s | %6.1f ms | %9.2f GB/s | %7.2f GOPS |\n", cases[c].name,
+           r.fill_ms, r.transpose_gbps, r.gemm_gops);
+  }
+  printf("|-------------------------+-----------+----------------+--------------|\n");
+  printf("TEST PASSED\n");
+  return EXIT_SUCCESS;
+}
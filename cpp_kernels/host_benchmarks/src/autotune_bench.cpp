@@ -0,0 +1,228 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Autotuner benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Registers every matrix multiplication design of this repository with
+gemm::Autotuner: the CPU engine plus the matmul_partition, systolic_array,
+loop_reorder and lmult kernels compiled for the host for int32, and the
+quantized and floating-point CPU engines, on their best and scalar paths,
+for the other dtypes. Each kernel is tried with its tile sizes and several
+pipeline depths. Winners go to a tuning cache, so a second run only
+dispatches.
+Usage: ./autotune_bench [tuning cache file]
+*/
+
+#include "autotune.hpp"
+#include "cpu_gemm.hpp"
+#include "float_gemm.hpp"
+#include "quant_gemm.hpp"
+#include "stand_in_kernels.h"
+#include "tiled_gemm.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using gemm::Variant;
+
+typedef std::chrono::steady_clock Clock;
+
+static Variant tiled_variant(const std::string &name,
+                             const std::vector<int> &tiles,
+                             const gemm::TileKernel &kernel) {
+  Variant v;
+  v.name = name;
+  v.dtypes = {"int32"};
+  v.tiles = tiles;
+  v.depths = {1, 2, 4};
+  v.max_dim = 0;
+  v.run = [kernel](const void *A, const void *B, void *C, int M, int N,
+                   int K, int tile, int depth, const std::string &) {
+    gemm::tiled_matmul((const int *)A, (const int *)B, (int *)C, M, N, K,
+                       tile, depth, kernel);
+  };
+  return v;
+}
+
+static Variant quant_variant(const std::string &name, gemm::QuantIsa isa) {
+  Variant v;
+  v.name = name;
+  v.dtypes = {"int8", "int16"};
+  v.tiles = {0};
+  v.depths = {1};
+  v.max_dim = 0;
+  v.run = [isa](const void *A, const void *B, void *C, int M, int N, int K,
+                int, int, const std::string &dtype) {
+    gemm::quant_matmul(
+        (const uint32_t *)A, (const uint32_t *)B, (int *)C, M, N, K,
+        dtype == "int8" ? gemm::QUANT_INT8 : gemm::QUANT_INT16, isa);
+  };
+  return v;
+}
+
+static Variant float_variant(const std::string &name, gemm::FloatIsa isa) {
+  Variant v;
+  v.name = name;
+  v.dtypes = {"fp32", "bf16", "fp16"};
+  v.tiles = {0};
+  v.depths = {1};
+  v.max_dim = 0;
+  v.run = [isa](const void *A, const void *B, void *C, int M, int N, int K,
+                int, int, const std::string &dtype) {
+    if (dtype == "bf16")
+      gemm::float_matmul((const gemm::bf16 *)A, (const gemm::bf16 *)B,
+                         (float *)C, M, N, K, isa);
+    else if (dtype == "fp16")
+      gemm::float_matmul((const gemm::fp16 *)A, (const gemm::fp16 *)B,
+                         (float *)C, M, N, K, isa);
+    else
+      gemm::float_matmul((const float *)A, (const float *)B, (float *)C, M,
+                         N, K, isa);
+  };
+  return v;
+}
+
+int main(int argc, char **argv) {
+  std::string cache = argc > 1 ? argv[1] : "gemm_tuning.cache";
+  gemm::Autotuner tuner(cache);
+  tuner.set_verbose(true);
+
+  Variant cpu;
+  cpu.name = "cpu_engine";
+  cpu.dtypes = {"int32"};
+  cpu.tiles = {0};
+  cpu.depths = {1};
+  cpu.max_dim = 0;
+  cpu.run = [](const void *A, const void *B, void *C, int M, int N, int K,
+               int, int, const std::string &) {
+    gemm::cpu_matmul((const int *)A, (const int *)B, (int *)C, M, N, K);
+  };
+  tuner.add(cpu);
+  // The scalar paths are also the references of the dispatch check below
+  Variant quant_scalar = quant_variant("cpu_quant_scalar", gemm::QISA_SCALAR);
+  Variant float_scalar = float_variant("cpu_float_scalar", gemm::FISA_SCALAR);
+  tuner.add(quant_variant("cpu_quant", gemm::QISA_AUTO));
+  tuner.add(quant_scalar);
+  tuner.add(float_variant("cpu_float", gemm::FISA_AUTO));
+  tuner.add(float_scalar);
+
+  tuner.add(tiled_variant(
+      "matmul_partition", {8, PARTITION_MAX_SIZE},
+      [](const int *a, const int *b, int *c, int tile) {
+        matmul_partition(const_cast<int *>(a), const_cast<int *>(b), c, tile);
+      }));
+  tuner.add(tiled_variant("systolic_array", {16, SYSTOLIC_MAX_SIZE},
+                          [](const int *a, const int *b, int *c, int tile) {
+                            mmult_systolic(a, b, c, tile, tile, tile);
+                          }));
+  tuner.add(tiled_variant("loop_reorder", {32, LOOP_REORDER_MAX_SIZE},
+                          [](const int *a, const int *b, int *c, int tile) {
+                            mmult_loop_reorder(a, b, c, tile);
+                          }));
+  // lmult streams rows of A against a transposed B tile
+  tuner.add(tiled_variant(
+      "lmult", {LMULT_SIZE}, [](const int *a, const int *b, int *c, int tile) {
+        std::vector<int> tb((size_t)tile * tile);
+        for (int r = 0; r < tile; r++)
+          for (int col = 0; col < tile; col++)
+            tb[(size_t)col * tile + r] = b[(size_t)r * tile + col];
+        for (int r = 0; r < tile; r++)
+          lmult(c + (size_t)r * tile, const_cast<int *>(a) + (size_t)r * tile,
+                tb.data());
+      }));
+
+  const gemm::Shape shapes[] = {{16, 16, 16, "int32"},
+                                {32, 32, 32, "int32"},
+                                {64, 64, 64, "int32"},
+                                {200, 300, 150, "int32"},
+                                {512, 512, 512, "int32"},
+                                {1024, 1024, 1024, "int32"},
+                                {64, 64, 64, "int8"},
+                                {256, 256, 256, "int16"},
+                                {64, 64, 64, "fp32"},
+                                {256, 256, 256, "bf16"},
+                                {128, 128, 128, "fp16"}};
+  const int num_shapes = sizeof(shapes) / sizeof(shapes[0]);
+
+  printf("Tuning (cache: %s)\n", cache.c_str());
+  for (int s = 0; s < num_shapes; s++) {
+    printf("%d x %d x %d %s\n", shapes[s].M, shapes[s].N, shapes[s].K,
+           shapes[s].dtype.c_str());
+    tuner.tune(shapes[s]);
+  }
+  tuner.set_verbose(false);
+
+  // Every shape is cached now, so this only measures dispatch plus the run
+  printf("|-----------------------+------------------+------+-------+--------------|\n"
+         "| Shape                 | Variant          | Tile | Depth |   Throughput |\n"
+         "|-----------------------+------------------+------+-------+--------------|\n");
+  for (int s = 0; s < num_shapes; s++) {
+    int M = shapes[s].M, N = shapes[s].N, K = shapes[s].K;
+    const std::string &dtype = shapes[s].dtype;
+    std::vector<uint32_t> A, B;
+    gemm::make_operands(shapes[s], A, B);
+    // int32 or float results
+    std::vector<uint32_t> C((size_t)M * N), gold((size_t)M * N);
+    bool floating = gemm::dtype_is_float(dtype);
+    const Variant &ref =
+        floating ? float_scalar : (dtype == "int32") ? cpu : quant_scalar;
+    ref.run(A.data(), B.data(), gold.data(), M, N, K, 0, 1, dtype);
+
+    Clock::time_point t = Clock::now();
+    tuner.matmul(A.data(), B.data(), C.data(), M, N, K, dtype);
+    double sec = std::chrono::duration<double>(Clock::now() - t).count();
+    bool ok = floating ? gemm::float_error((const float *)gold.data(),
+                                           (const float *)C.data(), C.size())
+                                 .max_rel <= gemm::float_tolerance(K)
+                       : (C == gold);
+    if (!ok) {
+      printf("Mismatch for %d x %d x %d %s\n", M, N, K, dtype.c_str());
+      return EXIT_FAILURE;
+    }
+    gemm::TuneResult r = tuner.tune(shapes[s]);
+    char shape[32];
+    snprintf(shape, sizeof(shape), "%dx%dx%d %s", M, N, K, dtype.c_str());
+    printf("| %-21s | %-16s | %4d | %5d | %7.3f GOPS |\n", shape,
+           r.variant.c_str(), r.tile, r.depth, 2.0 * M * N * K / sec * 1e-9);
+  }
+  printf("|-----------------------+------------------+------+-------+--------------|\n");
+  printf("TEST PASSED\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Batched small-GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Runs many independent 16 x 16 (matmul_partition) and 32 x 32 (systolic
+mmult) products with the kernels compiled for the host, in three ways:
+  - one kernel call per problem, each through staging buffers as a host
+    does with one enqueueTask and a migration in and out per problem,
+  - one call of the *_batch kernel on problems laid out at a fixed stride,
+  - one call of the *_batch_ptr kernel on problems packed by
+    xcl::GemmBatch (common/includes/xcl2/gemm_batch.hpp), every four
+    problems sharing one B.
+Every result is checked against a CPU product. The device is not modeled
+beyond a fixed cost per launch, given in microseconds, which is added to
+the measured host time once per launch; problems per second are reported
+with and without it.
+Usage: ./batch_bench [problems] [launch overhead us]
+*/
+
+#include "gemm_batch.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Consecutive problems applying the same B, as one weight matrix to many
+// inputs
+const int SHARING = 4;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static void reference(const int *a, const int *b, int *c, int n) {
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      int sum = 0;
+      for (int k = 0; k < n; k++)
+        sum += a[i * n + k] * b[k * n + j];
+      c[i * n + j] = sum;
+    }
+}
+
+// The problems of one kernel: A of each, one B per SHARING problems
+struct Problems {
+  int n, count;
+  std::vector<int> A, B, gold;
+
+  Problems(int n_, int count_) : n(n_), count(count_) {
+    int elements = n * n;
+    A.resize((size_t)count * elements);
+    B.resize((size_t)(count / SHARING) * elements);
+    gold.resize((size_t)count * elements);
+    std::default_random_engine e(n);
+    std::uniform_int_distribution<int> d(0, 10);
+    for (size_t i = 0; i < A.size(); i++)
+      A[i] = d(e);
+    for (size_t i = 0; i < B.size(); i++)
+      B[i] = d(e);
+    for (int p = 0; p < count; p++)
+      reference(a(p), b(p), &gold[(size_t)p * elements], n);
+  }
+  const int *a(int p) const { return &A[(size_t)p * n * n]; }
+  const int *b(int p) const { return &B[(size_t)(p / SHARING) * n * n]; }
+};
+
+// Calls of one kernel through the three interfaces. single(a, b, c) runs
+// one problem, strided(a, b, c, count, stride_a, stride_b, stride_c) and
+// indexed(a, b, c, offsets, count) a batch.
+struct Kernels {
+  const char *name;
+  void (*single)(const int *, const int *, int *, int);
+  void (*strided)(const int *, const int *, int *, int, int, int, int, int);
+  void (*indexed)(const int *, const int *, int *, const int *, int, int);
+};
+
+static void partition_single(const int *a, const int *b, int *c, int n) {
+  matmul_partition((int *)a, (int *)b, c, n);
+}
+static void partition_strided(const int *a, const int *b, int *c, int n,
+                              int count, int sa, int sb, int sc) {
+  matmul_partition_batch((int *)a, (int *)b, c, n, count, sa, sb, sc);
+}
+static void partition_indexed(const int *a, const int *b, int *c,
+                              const int *offsets, int n, int count) {
+  matmul_partition_batch_ptr((int *)a, (int *)b, c, offsets, n, count);
+}
+static void systolic_single(const int *a, const int *b, int *c, int n) {
+  mmult_systolic(a, b, c, n, n, n);
+}
+static void systolic_strided(const int *a, const int *b, int *c, int n,
+                             int count, int sa, int sb, int sc) {
+  mmult_batch(a, b, c, n, n, n, count, sa, sb, sc);
+}
+static void systolic_indexed(const int *a, const int *b, int *c,
+                             const int *offsets, int n, int count) {
+  mmult_batch_ptr(a, b, c, offsets, n, n, n, count);
+}
+
+struct Timing {
+  double seconds;
+  int launches;
+};
+
+static void print_row(const char *kernel, const char *launch, int problems,
+                      Timing t, double overhead_s) {
+  double with_overhead = t.seconds + t.launches * overhead_s;
+  printf("| %-16s | %-15s | %8d | %8d | %10.3f ms | %12.0f | %12.0f |\n",
+         kernel, launch, problems, t.launches, t.seconds * 1000,
+         problems / t.seconds, problems / with_overhead);
+}
+
+static bool run(const Kernels &k, int n, int count, double overhead_s) {
+  Problems pr(n, count);
+  const size_t elements = (size_t)n * n;
+  std::vector<int> C((size_t)count * elements);
+  bool match = true;
+
+  // One call per problem, through staging buffers
+  std::vector<int> stage_a(elements), stage_b(elements), stage_c(elements);
+  Clock::time_point t = Clock::now();
+  for (int p = 0; p < count; p++) {
+    memcpy(stage_a.data(), pr.a(p), elements * sizeof(int));
+    memcpy(stage_b.data(), pr.b(p), elements * sizeof(int));
+    k.single(stage_a.data(), stage_b.data(), stage_c.data(), n);
+    memcpy(&C[p * elements], stage_c.data(), elements * sizeof(int));
+  }
+  Timing single = {seconds_since(t), count};
+  match = (C == pr.gold) && match;
+
+  // Strided batch: each group of SHARING problems applies its B with a
+  // B stride of 0, one launch per group. The groups' A and C are already
+  // contiguous, so nothing is copied.
+  std::fill(C.begin(), C.end(), 0);
+  t = Clock::now();
+  for (int p = 0; p < count; p += SHARING)
+    k.strided(pr.a(p), pr.b(p), &C[p * elements], n, SHARING, (int)elements,
+              0, (int)elements);
+  Timing grouped = {seconds_since(t), count / SHARING};
+  match = (C == pr.gold) && match;
+
+  // Strided batch over all problems in one launch, with B copied out to
+  // one matrix per problem
+  std::vector<int> B_all(count * elements);
+  for (int p = 0; p < count; p++)
+    memcpy(&B_all[p * elements], pr.b(p), elements * sizeof(int));
+  std::fill(C.begin(), C.end(), 0);
+  t = Clock::now();
+  k.strided(pr.A.data(), B_all.data(), C.data(), n, count, (int)elements,
+            (int)elements, (int)elements);
+  Timing strided = {seconds_since(t), 1};
+  match = (C == pr.gold) && match;
+
+  // Indexed batch packed by xcl::GemmBatch, including the packing and the
+  // scatter of the results
+  std::fill(C.begin(), C.end(), 0);
+  t = Clock::now();
+  xcl::GemmBatch batch(n, n, n, count);
+  for (int p = 0; p < count; p++)
+    batch.add_shared_b(pr.a(p), pr.b(p), &C[p * elements]);
+  k.indexed(batch.a(), batch.b(), batch.c(), batch.offsets(), n,
+            batch.count());
+  batch.scatter();
+  Timing indexed = {seconds_since(t), 1};
+  match = (C == pr.gold) && match;
+  if (!match)
+    printf("Mismatch (%s)\n", k.name);
+
+  print_row(k.name, "one per problem", count, single, overhead_s);
+  print_row(k.name, "per shared B", count, grouped, overhead_s);
+  print_row(k.name, "strided", count, strided, overhead_s);
+  print_row(k.name, "GemmBatch", count, indexed, overhead_s);
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int count = (argc > 1) ? atoi(argv[1]) : 4096;
+  double overhead_us = (argc > 2) ? atof(argv[2]) : 30.0;
+  count = (count + SHARING - 1) / SHARING * SHARING;
+
+  printf("%d problems per kernel, %.1f us per launch\n", count, overhead_us);
+  printf("|------------------+-----------------+----------+----------+"
+         "---------------+--------------+--------------|\n"
+         "| Kernel           | Launch          | Problems | Launches |"
+         "     Host time |   Problems/s | Incl. launch |\n"
+         "|------------------+-----------------+----------+----------+"
+         "---------------+--------------+--------------|\n");
+  const Kernels partition = {"matmul_partition", partition_single,
+                             partition_strided, partition_indexed};
+  const Kernels systolic = {"systolic mmult", systolic_single,
+                            systolic_strided, systolic_indexed};
+  bool match = run(partition, PARTITION_MAX_SIZE, count, overhead_us * 1e-6);
+  match = run(systolic, SYSTOLIC_MAX_SIZE, count, overhead_us * 1e-6) && match;
+  printf("|------------------+-----------------+----------+----------+"
+         "---------------+--------------+--------------|\n");
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
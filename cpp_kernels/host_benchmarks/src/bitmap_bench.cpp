@@ -0,0 +1,202 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Bitmap I/O benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Writes a 24-bit BMP with an odd width, so that every row is padded, and
+reads it back with BitmapInterface and with the former read(fd, pixel, 3)
+per pixel loop. Writing is compared the same way. Checks the unpacked
+pixels match and that writeBitmapFile() reproduces the input byte for byte.
+Usage: ./bitmap_bench [width height]
+*/
+
+#include "bitmap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static const char *INPUT = "bitmap_bench.bmp";
+
+static void put32(unsigned char *p, unsigned int v) { memcpy(p, &v, 4); }
+
+static size_t write_test_bmp(int width, int height) {
+  int stride = (width * 3 + 3) & ~3;
+  size_t size = 54 + (size_t)stride * height;
+  std::vector<unsigned char> file(size, 0);
+  file[0] = 'B';
+  file[1] = 'M';
+  put32(&file[2], size);
+  put32(&file[10], 54);
+  put32(&file[14], 40);
+  put32(&file[18], width);
+  put32(&file[22], height);
+  file[26] = 1;  // planes
+  file[28] = 24; // bits per pixel
+  put32(&file[34], (unsigned int)(size - 54));
+  std::default_random_engine e(5);
+  for (int r = 0; r < height; r++)
+    for (int i = 0; i < width * 3; i++)
+      file[54 + (size_t)r * stride + i] = e() & 0xFF;
+  FILE *f = fopen(INPUT, "wb");
+  fwrite(file.data(), 1, size, f);
+  fclose(f);
+  return size;
+}
+
+// The former implementation: one read() of 3 bytes per pixel. Unlike the
+// original it skips the row padding, so that the pixels can be compared.
+static std::vector<int> naive_read(int width, int height) {
+  std::vector<int> image((size_t)width * height, 0);
+  int fd = open(INPUT, O_RDONLY);
+  lseek(fd, 54, SEEK_SET);
+  int pad = ((width * 3 + 3) & ~3) - width * 3;
+  for (int r = 0; r < height; r++) {
+    for (int c = 0; c < width; c++)
+      if (read(fd, &image[(size_t)r * width + c], 3) != 3)
+        break;
+    lseek(fd, pad, SEEK_CUR);
+  }
+  close(fd);
+  return image;
+}
+
+static void naive_write(const std::vector<int> &image, int width, int height) {
+  int fd = open("naive_output.bmp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  unsigned char header[54] = {0};
+  if (write(fd, header, 54) != 54)
+    return;
+  const char zero[4] = {0, 0, 0, 0};
+  int pad = ((width * 3 + 3) & ~3) - width * 3;
+  for (int r = 0; r < height; r++) {
+    for (int c = 0; c < width; c++)
+      if (write(fd, &image[(size_t)r * width + c], 3) != 3)
+        break;
+    if (pad && write(fd, zero, pad) != pad)
+      break;
+  }
+  close(fd);
+}
+
+static std::vector<unsigned char> slurp(const char *name) {
+  std::vector<unsigned char> data;
+  FILE *f = fopen(name, "rb");
+  if (!f)
+    return data;
+  unsigned char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  return data;
+}
+
+int main(int argc, char **argv) {
+  int width = argc > 2 ? atoi(argv[1]) : 1921;
+  int height = argc > 2 ? atoi(argv[2]) : 1080;
+  if (width <= 0 || height <= 0) {
+    printf("Usage: %s [width height]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  double mb = write_test_bmp(width, height) / 1e6;
+  printf("%d x %d 24-bit bitmap, %.1f MB\n", width, height, mb);
+
+  Clock::time_point t = Clock::now();
+  std::vector<int> gold = naive_read(width, height);
+  double naive_read_s = seconds_since(t);
+
+  BitmapInterface bmp(INPUT);
+  t = Clock::now();
+  if (!bmp.readBitmapFile())
+    return EXIT_FAILURE;
+  double read_s = seconds_since(t);
+
+  bool match = bmp.numPixels() == gold.size() &&
+               memcmp(bmp.bitmap(), gold.data(), gold.size() * sizeof(int)) == 0;
+  if (!match)
+    printf("Unpacked pixels differ from the per-pixel reads\n");
+
+  t = Clock::now();
+  naive_write(gold, width, height);
+  double naive_write_s = seconds_since(t);
+  t = Clock::now();
+  bmp.writeBitmapFile();
+  double write_s = seconds_since(t);
+  if (slurp("output.bmp") != slurp(INPUT)) {
+    printf("output.bmp differs from the input\n");
+    match = false;
+  }
+
+  // Zero-copy view: no unpacking at all
+  BitmapInterface view(INPUT);
+  t = Clock::now();
+  view.readBitmapFile(false);
+  double view_s = seconds_since(t);
+  if (memcmp(view.pixelRows() + (size_t)(height - 1) * view.getRowStride(),
+             slurp(INPUT).data() + 54 +
+                 (size_t)(height - 1) * view.getRowStride(),
+             width * 3) != 0) {
+    printf("Zero-copy view differs from the file\n");
+    match = false;
+  }
+
+  printf("|-------------------------+---------------+---------------+----------|\n"
+         "| Operation               |  3-byte calls |      Bulk I/O |  Speedup |\n"
+         "|-------------------------+---------------+---------------+----------|\n");
+  printf("| %-23s | %8.1f MB/s | %8.1f MB/s | %7.1fx |\n", "Read + unpack", mb / naive_read_s,
+         mb / read_s, naive_read_s / read_s);
+  printf("| %-23s | %8.1f MB/s | %8.1f MB/s | %7.1fx |\n", "Pack + write", mb / naive_write_s,
+         mb / write_s, naive_write_s / write_s);
+  printf("| %-23s | %13s | %8.1f MB/s | %8s |\n", "Zero-copy view", "", mb / view_s, "");
+  printf("|-------------------------+---------------+---------------+----------|\n");
+
+  remove(INPUT);
+  remove("output.bmp");
+  remove("naive_output.bmp");
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
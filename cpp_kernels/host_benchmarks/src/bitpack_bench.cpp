@@ -0,0 +1,243 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Bit-packed transport benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Encodes size x size matrices whose values span 1, 2, 4, 8 and more bits
+with gemm::bitpack_choose() and gemm::bitpack_encode(), with the scalar and
+AVX2 paths on the threads of the CPU engine, and checks that they decode to
+the input. Reports the time of the min/max scan and the encoding, the bytes
+sent, and the effective bandwidth of int32 elements delivered over a link of
+the given bandwidth, encoding included, against sending them as they are.
+The break-even column is the encoder throughput packing needs to win
+(gemm::bitpack_break_even()).
+Then runs end to end on the CPU: the operands of the bitpack kernels
+(matmul_partition, mmult of loop_reorder and the systolic mmult, compiled
+for the host) are
+scanned, encoded and copied to a separate buffer standing in for device
+memory, and the result is checked against the int32 kernels.
+Usage: ./bitpack_bench [size] [link GB/s]
+*/
+
+#include "bitpack.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Encodings timed per measurement, for a stable time on small inputs
+const int REPEATS = 5;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static std::vector<int> random_matrix(size_t n, int lo, int hi,
+                                      unsigned seed) {
+  std::vector<int> m(n);
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> d(lo, hi);
+  for (size_t i = 0; i < n; i++)
+    m[i] = d(e);
+  return m;
+}
+
+// Value ranges of the inputs: spans of 1, 2, 4, 8 and 16 bits, offset so
+// that the base matters
+static const int SPAN_BITS[] = {1, 2, 4, 8, 16};
+
+static bool bench_encoder(int n, double link) {
+  size_t elements = (size_t)n * n;
+  double raw_bytes = elements * sizeof(int);
+  printf("Encoder, %d x %d, %u threads, link at %.1f GB/s\n", n, n,
+         gemm::ThreadPool::global().size(), link);
+  printf("|-------+--------+--------+-------------+-------------+"
+         "-------------+-------------+---------------+---------|\n"
+         "| Range |  Width | Path   | Scan+encode |  Throughput |"
+         "  Break-even |        Sent |     Effective | Speedup |\n"
+         "|-------+--------+--------+-------------+-------------+"
+         "-------------+-------------+---------------+---------|\n");
+  bool match = true;
+  for (int bits : SPAN_BITS) {
+    std::vector<int> data =
+        random_matrix(elements, -5, -5 + (1 << bits) - 1, bits);
+    const gemm::BitPackIsa isas[] = {gemm::BPISA_SCALAR, gemm::BPISA_AVX2};
+    for (gemm::BitPackIsa isa : isas) {
+      if (gemm::bitpack_isa(isa) != isa)
+        continue; // not supported by this CPU
+      gemm::BitPacking packing = gemm::bitpack_choose(data.data(), elements);
+      std::vector<uint32_t> words(
+          gemm::bitpack_words(elements, packing.width));
+      Clock::time_point t = Clock::now();
+      for (int r = 0; r < REPEATS; r++) {
+        packing = gemm::bitpack_choose(data.data(), elements, isa);
+        gemm::bitpack_encode(data.data(), elements, packing, words.data(),
+                             isa);
+      }
+      double encode_s = seconds_since(t) / REPEATS;
+
+      std::vector<int> decoded(elements);
+      gemm::bitpack_decode(words.data(), elements, packing, decoded.data());
+      if (decoded != data) {
+        printf("Mismatch (%d-bit range, %s)\n", bits,
+               gemm::bitpack_isa_name(isa));
+        match = false;
+      }
+      // Time to deliver the elements: encoding plus the packed bytes over
+      // the link, against the int32 bytes over the link
+      double sent = words.size() * sizeof(uint32_t);
+      double packed_s = encode_s + sent / (link * 1e9);
+      double raw_s = raw_bytes / (link * 1e9);
+      printf("| %5d | %6d | %-6s | %8.3f ms | %6.2f GB/s | %6.2f GB/s |"
+             " %8.2f MB | %8.2f GB/s | %6.2fx |\n",
+             bits, packing.width, gemm::bitpack_isa_name(isa),
+             encode_s * 1000, raw_bytes / encode_s * 1e-9,
+             gemm::bitpack_break_even(packing.width, link),
+             sent / (1024.0 * 1024.0), raw_bytes / packed_s * 1e-9,
+             raw_s / packed_s);
+    }
+  }
+  printf("|-------+--------+--------+-------------+-------------+"
+         "-------------+-------------+---------------+---------|\n");
+  return match;
+}
+
+// Scans and encodes one operand into the buffer standing in for device
+// memory, as the host does before enqueueMigrateMemObjects
+static gemm::BitPacking send(const std::vector<int> &data,
+                             std::vector<uint32_t> &device) {
+  gemm::BitPacking packing = gemm::bitpack_choose(data.data(), data.size());
+  std::vector<uint32_t> words(
+      gemm::bitpack_words(data.size(), packing.width));
+  gemm::bitpack_encode(data.data(), data.size(), packing, words.data());
+  device.assign(words.begin(), words.end());
+  return packing;
+}
+
+// One bitpack kernel against its int32 version on size x size operands
+// spanning bits bits. kernel takes (A, B, C, packing of A, packing of B).
+template <typename Kernel, typename Reference>
+static bool check_kernel(const char *name, int size, int bits, Kernel kernel,
+                         Reference reference) {
+  size_t elements = (size_t)size * size;
+  std::vector<int> A = random_matrix(elements, -3, -3 + (1 << bits) - 1, 1);
+  std::vector<int> B = random_matrix(elements, 7, 7 + (1 << bits) - 1, 2);
+  std::vector<int> gold(elements), C(elements);
+  reference(A.data(), B.data(), gold.data());
+
+  std::vector<uint32_t> device_a, device_b;
+  gemm::BitPacking packing_a = send(A, device_a);
+  gemm::BitPacking packing_b = send(B, device_b);
+  kernel((int *)device_a.data(), (int *)device_b.data(), C.data(), packing_a,
+         packing_b);
+
+  bool match = (C == gold);
+  if (!match)
+    printf("Mismatch (%s, %d-bit range)\n", name, bits);
+  size_t raw = 2 * elements * sizeof(int);
+  size_t sent = (device_a.size() + device_b.size()) * sizeof(uint32_t);
+  printf("| %-24s | %4d | %5d | %6d | %9zu B | %9zu B | %6.2fx | %-5s |\n",
+         name, size, bits, packing_a.width, raw, sent, (double)raw / sent,
+         match ? "yes" : "NO");
+  return match;
+}
+
+static bool check_kernels() {
+  printf("End to end on the CPU, bitpack kernels against int32\n");
+  printf("|--------------------------+------+-------+--------+-------------+"
+         "-------------+---------+-------|\n"
+         "| Kernel                   | Size | Range |  Width |       int32 |"
+         "        Sent |   Ratio | Match |\n"
+         "|--------------------------+------+-------+--------+-------------+"
+         "-------------+---------+-------|\n");
+  bool match = true;
+  for (int bits : SPAN_BITS) {
+    int size = PARTITION_MAX_SIZE;
+    match = check_kernel(
+                "matmul_partition_bitpack", size, bits,
+                [&](int *a, int *b, int *c, gemm::BitPacking pa,
+                    gemm::BitPacking pb) {
+                  matmul_partition_bitpack(a, b, c, size, pa.width, pa.base,
+                                           pb.width, pb.base);
+                },
+                [&](int *a, int *b, int *c) {
+                  matmul_partition(a, b, c, size);
+                }) &&
+            match;
+    // An odd size leaves a partly filled word at the end of the matrix
+    size = LOOP_REORDER_MAX_SIZE - 3;
+    match = check_kernel(
+                "mmult_bitpack", size, bits,
+                [&](int *a, int *b, int *c, gemm::BitPacking pa,
+                    gemm::BitPacking pb) {
+                  mmult_bitpack(a, b, c, size, pa.width, pa.base, pb.width,
+                                pb.base);
+                },
+                [&](int *a, int *b, int *c) {
+                  mmult_loop_reorder(a, b, c, size);
+                }) &&
+            match;
+    size = SYSTOLIC_MAX_SIZE - 1;
+    match = check_kernel(
+                "mmult_bitpack (systolic)", size, bits,
+                [&](int *a, int *b, int *c, gemm::BitPacking pa,
+                    gemm::BitPacking pb) {
+                  mmult_systolic_bitpack(a, b, c, size, size, size, pa.width,
+                                         pa.base, pb.width, pb.base);
+                },
+                [&](int *a, int *b, int *c) {
+                  mmult_systolic(a, b, c, size, size, size);
+                }) &&
+            match;
+  }
+  printf("|--------------------------+------+-------+--------+-------------+"
+         "-------------+---------+-------|\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 1024;
+  double link = (argc > 2) ? atof(argv[2]) : 12.0;
+  bool match = bench_encoder(n, link);
+  match = check_kernels() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
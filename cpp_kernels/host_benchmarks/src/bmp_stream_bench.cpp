@@ -0,0 +1,196 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Streaming BMP benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Writes a large 24-bit BMP band by band with writebmp_begin/band/end and
+processes it twice: after readbmp() has loaded the whole image, and band by
+band with readbmp_bands(), where the next band is read while the current one
+is processed. Reports the time until processing can start, the total time
+and the pixel memory held by each, and checks both see the same pixels and
+that the band writer produces the same file as writebmp().
+Usage: ./bmp_stream_bench [width height band_rows]
+*/
+
+#include "simplebmp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static char INPUT[] = "bmp_stream_bench.bmp";
+static char REFERENCE[] = "bmp_stream_reference.bmp";
+
+// Stand-in for the consumer of the pixels (e.g. converting rows to matrix
+// tiles): a luma sum weighted by row, so the order of the rows matters.
+static uint64_t process_rows(const uint8_t *data, uint32_t first_row,
+                             uint32_t rows, uint32_t width) {
+  uint64_t sum = 0;
+  for (uint32_t r = 0; r < rows; r++) {
+    const uint8_t *p = data + (size_t)r * width * 3;
+    uint32_t luma = 0;
+    for (uint32_t c = 0; c < width; c++)
+      luma += 29 * p[3 * c] + 150 * p[3 * c + 1] + 77 * p[3 * c + 2];
+    sum += (uint64_t)luma * (first_row + r + 1);
+  }
+  return sum;
+}
+
+struct consumer_t {
+  uint32_t width;
+  uint64_t sum;
+  uint32_t next_row;
+  Clock::time_point start;
+  double first_band_s;
+};
+
+static int on_band(const struct bmp_band_t *band, void *user) {
+  consumer_t *c = (consumer_t *)user;
+  if (band->firstrow == 0)
+    c->first_band_s = seconds_since(c->start);
+  if (band->firstrow != c->next_row)
+    return -2;
+  c->sum += process_rows(band->data, band->firstrow, band->rows, c->width);
+  c->next_row += band->rows;
+  return 0;
+}
+
+static std::vector<unsigned char> slurp(const char *name) {
+  std::vector<unsigned char> data;
+  FILE *f = fopen(name, "rb");
+  if (!f)
+    return data;
+  unsigned char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  return data;
+}
+
+int main(int argc, char **argv) {
+  uint32_t width = argc > 2 ? atoi(argv[1]) : 8192;
+  uint32_t height = argc > 2 ? atoi(argv[2]) : 4096;
+  uint32_t band_rows = argc > 3 ? atoi(argv[3]) : 64;
+  // simplebmp stores rows without padding
+  if (width == 0 || height == 0 || band_rows == 0 || (width * 3) % 4) {
+    printf("Usage: %s [width height band_rows], width a multiple of 4\n",
+           argv[0]);
+    return EXIT_FAILURE;
+  }
+  size_t row_bytes = (size_t)width * 3;
+  double mb = row_bytes * height / 1e6;
+  printf("%u x %u 24-bit bitmap, %.1f MB, bands of %u rows\n", width, height,
+         mb, band_rows);
+
+  // Band writer: only one band of pixels exists at a time
+  double band_write_s = 0.0;
+  Clock::time_point t;
+  struct bmp_writer_t *writer;
+  if (writebmp_begin(INPUT, width, height, &writer) != 0)
+    return EXIT_FAILURE;
+  std::vector<uint8_t> band(row_bytes * band_rows);
+  std::default_random_engine e(3);
+  for (uint32_t row = 0; row < height; row += band_rows) {
+    uint32_t rows = height - row < band_rows ? height - row : band_rows;
+    for (size_t i = 0; i < rows * row_bytes; i++)
+      band[i] = e() & 0xFF;
+    t = Clock::now();
+    if (writebmp_band(writer, band.data(), rows) != 0)
+      return EXIT_FAILURE;
+    band_write_s += seconds_since(t);
+  }
+  t = Clock::now();
+  if (writebmp_end(writer) != 0)
+    return EXIT_FAILURE;
+  band_write_s += seconds_since(t);
+
+  // Whole image: nothing can be processed before the last byte is read
+  struct bmp_t bitmap;
+  t = Clock::now();
+  if (readbmp(INPUT, &bitmap) != 0)
+    return EXIT_FAILURE;
+  double full_first_s = seconds_since(t);
+  uint64_t gold = process_rows((const uint8_t *)bitmap.pixels, 0, height, width);
+  double full_s = seconds_since(t);
+
+  t = Clock::now();
+  if (writebmp(REFERENCE, &bitmap) != 0)
+    return EXIT_FAILURE;
+  double full_write_s = seconds_since(t);
+  free(bitmap.pixels);
+
+  consumer_t consumer = {width, 0, 0, Clock::now(), 0.0};
+  struct bmp_t header;
+  int err = readbmp_bands(INPUT, &header, band_rows, on_band, &consumer);
+  double band_s = seconds_since(consumer.start);
+
+  bool match = err == 0 && consumer.next_row == height && consumer.sum == gold;
+  if (!match)
+    printf("Banded read differs from readbmp() (error %d)\n", err);
+  if (slurp(INPUT) != slurp(REFERENCE)) {
+    printf("Band writer output differs from writebmp()\n");
+    match = false;
+  }
+
+  printf("|-------------------------+---------------+---------------+----------|\n"
+         "| Operation               |       readbmp | readbmp_bands |  Speedup |\n"
+         "|-------------------------+---------------+---------------+----------|\n");
+  printf("| %-23s | %10.2f ms | %10.2f ms | %7.1fx |\n", "Time to first pixels",
+         full_first_s * 1e3, consumer.first_band_s * 1e3,
+         full_first_s / consumer.first_band_s);
+  printf("| %-23s | %10.2f ms | %10.2f ms | %7.1fx |\n", "Read + process", full_s * 1e3,
+         band_s * 1e3, full_s / band_s);
+  printf("| %-23s | %10.1f MB | %10.1f MB | %7.1fx |\n", "Pixel memory", mb,
+         2 * row_bytes * band_rows / 1e6, mb / (2 * row_bytes * band_rows / 1e6));
+  printf("| %-23s | %10.2f ms | %10.2f ms | %8s |\n", "Write", full_write_s * 1e3,
+         band_write_s * 1e3, "");
+  printf("|-------------------------+---------------+---------------+----------|\n");
+
+  remove(INPUT);
+  remove(REFERENCE);
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
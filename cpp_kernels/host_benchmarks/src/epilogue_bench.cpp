@@ -0,0 +1,281 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Fused epilogue benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Applies the epilogues of common/includes/gemm/epilogue.hpp (alpha/beta
+scaling, bias, ReLU, int8 requantization) to the product of the CPU engine,
+fused with gemm::cpu_matmul_epilogue() and unfused as a second pass over C
+with gemm::epilogue_rows(), and checks both against a scalar reference. A
+square product is compute-bound; with a short K the pass over C is a large
+share of the work. Then runs the *_epilogue kernels of array_partition,
+systolic_array and large_matrix_mult, compiled for the host, against the
+same reference and times them against the plain kernel plus a host pass.
+Usage: ./epilogue_bench [size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Kernel calls timed per measurement
+const int KERNEL_REPEATS = 50;
+// Runs of the CPU engine per measurement, the fastest counts
+const int CPU_REPEATS = 3;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+struct Case {
+  const char *name;
+  int alpha, beta, flags, shift;
+};
+
+// Products of values in [-10, 10] over K terms are about 33 * sqrt(K), so
+// the requantizing cases shift them into int8 for K up to a few thousand
+static const Case CASES[] = {
+    {"alpha, beta", 3, -2, 0, 0},
+    {"bias, ReLU", 1, 0, gemm::EPI_BIAS | gemm::EPI_RELU, 0},
+    {"requantize", 1, 0, gemm::EPI_REQUANT, 4},
+    {"all", 2, 1, gemm::EPI_BIAS | gemm::EPI_RELU | gemm::EPI_REQUANT, 5},
+};
+
+static gemm::Epilogue make_epilogue(const Case &c, const int *bias) {
+  gemm::Epilogue e;
+  e.alpha = c.alpha;
+  e.beta = c.beta;
+  e.flags = c.flags;
+  e.shift = c.shift;
+  e.bias = bias;
+  return e;
+}
+
+static std::vector<int> random_ints(size_t n, int lo, int hi, unsigned seed) {
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> dist(lo, hi);
+  std::vector<int> v(n);
+  for (size_t i = 0; i < n; i++)
+    v[i] = dist(e);
+  return v;
+}
+
+// Element by element reference of C = epilogue(A * B, C_in)
+static std::vector<int> reference(const gemm::Epilogue &e,
+                                  const std::vector<int> &A,
+                                  const std::vector<int> &B,
+                                  const std::vector<int> &c_in, int M, int N,
+                                  int K) {
+  std::vector<int> C((size_t)M * N);
+  for (int i = 0; i < M; i++)
+    for (int j = 0; j < N; j++) {
+      int acc = 0;
+      for (int k = 0; k < K; k++)
+        acc += A[(size_t)i * K + k] * B[(size_t)k * N + j];
+      C[(size_t)i * N + j] =
+          gemm::epilogue_apply(e, acc, c_in[(size_t)i * N + j], e.bias[j]);
+    }
+  return C;
+}
+
+static bool bench_cpu(int M, int N, int K) {
+  std::vector<int> A = random_ints((size_t)M * K, -10, 10, 1);
+  std::vector<int> B = random_ints((size_t)K * N, -10, 10, 2);
+  std::vector<int> c_in = random_ints((size_t)M * N, -100, 100, 3);
+  std::vector<int> bias = random_ints(N, -200, 200, 4);
+  std::vector<int> acc((size_t)M * N), C((size_t)M * N);
+
+  Clock::time_point t = Clock::now();
+  gemm::cpu_matmul(A.data(), B.data(), acc.data(), M, N, K);
+  double plain_s = seconds_since(t);
+
+  printf("CPU engine, %d x %d x %d, %u threads, plain GEMM %.2f ms\n", M, N,
+         K, gemm::ThreadPool::global().size(), plain_s * 1000);
+  printf("|-------------+-------------+-------------+---------+-------|\n"
+         "| Epilogue    |     Unfused |       Fused | Speedup | Match |\n"
+         "|-------------+-------------+-------------+---------+-------|\n");
+  bool match = true;
+  for (const Case &c : CASES) {
+    gemm::Epilogue e = make_epilogue(c, bias.data());
+    std::vector<int> gold = reference(e, A, B, c_in, M, N, K);
+
+    double unfused_s = 1e30, fused_s = 1e30;
+    bool ok = true;
+    for (int r = 0; r < CPU_REPEATS; r++) {
+      C = c_in;
+      t = Clock::now();
+      gemm::cpu_matmul(A.data(), B.data(), acc.data(), M, N, K);
+      gemm::epilogue_rows(e, acc.data(), C.data(), M, N);
+      unfused_s = std::min(unfused_s, seconds_since(t));
+      ok = ok && (C == gold);
+
+      C = c_in;
+      t = Clock::now();
+      gemm::cpu_matmul_epilogue(A.data(), B.data(), C.data(), M, N, K, e);
+      fused_s = std::min(fused_s, seconds_since(t));
+      ok = ok && (C == gold);
+    }
+    match = match && ok;
+
+    printf("| %-11s | %8.2f ms | %8.2f ms | %6.2fx | %-5s |\n", c.name,
+           unfused_s * 1000, fused_s * 1000, unfused_s / fused_s,
+           ok ? "yes" : "NO");
+  }
+  printf("|-------------+-------------+-------------+---------+-------|\n");
+  return match;
+}
+
+// A kernel with its epilogue arguments, and the plain kernel it extends
+struct KernelCase {
+  const char *name;
+  int M, N, K;
+  void (*fused)(const std::vector<int> &, const std::vector<int> &,
+                std::vector<int> &, const gemm::Epilogue &);
+  void (*plain)(const std::vector<int> &, const std::vector<int> &,
+                std::vector<int> &);
+};
+
+static void partition_fused(const std::vector<int> &A,
+                            const std::vector<int> &B, std::vector<int> &C,
+                            const gemm::Epilogue &e) {
+  matmul_partition_epilogue((int *)A.data(), (int *)B.data(), C.data(),
+                            e.bias, PARTITION_MAX_SIZE, e.alpha, e.beta,
+                            e.flags, e.shift);
+}
+static void partition_plain(const std::vector<int> &A,
+                            const std::vector<int> &B, std::vector<int> &C) {
+  matmul_partition((int *)A.data(), (int *)B.data(), C.data(),
+                   PARTITION_MAX_SIZE);
+}
+static void systolic_fused(const std::vector<int> &A,
+                           const std::vector<int> &B, std::vector<int> &C,
+                           const gemm::Epilogue &e) {
+  const int n = SYSTOLIC_MAX_SIZE;
+  mmult_epilogue(A.data(), B.data(), C.data(), e.bias, n, n, n, e.alpha,
+                 e.beta, e.flags, e.shift);
+}
+static void systolic_plain(const std::vector<int> &A,
+                           const std::vector<int> &B, std::vector<int> &C) {
+  const int n = SYSTOLIC_MAX_SIZE;
+  mmult_systolic(A.data(), B.data(), C.data(), n, n, n);
+}
+
+// lmult computes one row of C against the transposed B, so B is passed
+// transposed
+static std::vector<int> lmult_tb;
+static void lmult_fused(const std::vector<int> &A, const std::vector<int> &,
+                        std::vector<int> &C, const gemm::Epilogue &e) {
+  lmult_epilogue(C.data(), (int *)A.data(), lmult_tb.data(), e.bias, e.alpha,
+                 e.beta, e.flags, e.shift);
+}
+static void lmult_plain(const std::vector<int> &A, const std::vector<int> &,
+                        std::vector<int> &C) {
+  lmult(C.data(), (int *)A.data(), lmult_tb.data());
+}
+
+static bool bench_kernels() {
+  const KernelCase kernels[] = {
+      {"matmul_partition", PARTITION_MAX_SIZE, PARTITION_MAX_SIZE,
+       PARTITION_MAX_SIZE, partition_fused, partition_plain},
+      {"mmult (systolic)", SYSTOLIC_MAX_SIZE, SYSTOLIC_MAX_SIZE,
+       SYSTOLIC_MAX_SIZE, systolic_fused, systolic_plain},
+      {"lmult", 1, LMULT_SIZE, LMULT_SIZE, lmult_fused, lmult_plain},
+  };
+  const Case &all = CASES[sizeof(CASES) / sizeof(CASES[0]) - 1];
+  printf("Kernels, epilogue \"%s\"\n", all.name);
+  printf("|------------------+--------------+--------------+---------+-------|"
+         "\n"
+         "| Kernel           | Kernel+pass  |        Fused | Speedup | Match |"
+         "\n"
+         "|------------------+--------------+--------------+---------+-------|"
+         "\n");
+  bool match = true;
+  for (const KernelCase &k : kernels) {
+    std::vector<int> A = random_ints((size_t)k.M * k.K, -10, 10, 5);
+    std::vector<int> B = random_ints((size_t)k.K * k.N, -10, 10, 6);
+    std::vector<int> c_in = random_ints((size_t)k.M * k.N, -100, 100, 7);
+    std::vector<int> bias = random_ints(k.N, -200, 200, 8);
+    std::vector<int> acc((size_t)k.M * k.N), C((size_t)k.M * k.N);
+    gemm::Epilogue e = make_epilogue(all, bias.data());
+    std::vector<int> gold = reference(e, A, B, c_in, k.M, k.N, k.K);
+    lmult_tb.assign((size_t)k.N * k.K, 0);
+    if (k.M == 1)
+      for (int r = 0; r < k.K; r++)
+        for (int c = 0; c < k.N; c++)
+          lmult_tb[(size_t)c * k.K + r] = B[(size_t)r * k.N + c];
+
+    // Unfused: the plain kernel, then the host pass over its result
+    Clock::time_point t = Clock::now();
+    for (int r = 0; r < KERNEL_REPEATS; r++) {
+      C = c_in;
+      k.plain(A, B, acc);
+      gemm::epilogue_rows(e, acc.data(), C.data(), k.M, k.N);
+    }
+    double unfused_s = seconds_since(t) / KERNEL_REPEATS;
+    bool ok = (C == gold);
+
+    t = Clock::now();
+    for (int r = 0; r < KERNEL_REPEATS; r++) {
+      C = c_in;
+      k.fused(A, B, C, e);
+    }
+    double fused_s = seconds_since(t) / KERNEL_REPEATS;
+    ok = ok && (C == gold);
+    match = match && ok;
+    printf("| %-16s | %9.2f us | %9.2f us | %6.2fx | %-5s |\n", k.name,
+           unfused_s * 1e6, fused_s * 1e6, unfused_s / fused_s,
+           ok ? "yes" : "NO");
+  }
+  printf("|------------------+--------------+--------------+---------+-------|"
+         "\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 1024;
+  bool match = bench_cpu(n, n, n);
+  match = bench_cpu(8 * n, n, 16) && match;
+  match = bench_kernels() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,291 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Floating-point GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Multiplies random fractions with the int32 CPU engine, for reference, and
+with gemm::float_matmul() on fp32, bf16 and fp16 operands, on every
+instruction set the CPU supports. Checks every result against a double
+precision product of the same rounded operands within the tolerance of an
+fp32 sum, and reports time, GFLOPS and the largest error.
+Then runs the floating-point kernels (matmul_partition, the systolic mmult,
+mmult of loop_reorder and lmult, compiled for the host), checks them the
+same way, and reports the bytes of A and B they read.
+Usage: ./float_bench [size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "float_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Rows of C computed with each lmult variant; every row reads all of B
+const int LMULT_ROWS = 32;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static std::vector<float> random_fractions(size_t n, unsigned seed) {
+  std::vector<float> m(n);
+  std::default_random_engine e(seed);
+  std::uniform_real_distribution<float> d(0, 1);
+  for (size_t i = 0; i < n; i++)
+    m[i] = d(e);
+  return m;
+}
+
+// Operands of type T and their values in fp32, after rounding
+template <typename T> struct Operand {
+  std::vector<T> data;
+  std::vector<float> value;
+  Operand(const std::vector<float> &src) : data(src.size()), value(src.size()) {
+    gemm::convert(src.data(), data.data(), src.size());
+    for (size_t i = 0; i < src.size(); i++)
+      value[i] = gemm::to_float(data[i]);
+  }
+};
+
+// The first rows rows of the product in double precision, rounded to fp32.
+// With transposed_b, row j of B is column j.
+static void reference(const std::vector<float> &A, const std::vector<float> &B,
+                      std::vector<float> &C, int rows, int N, int K,
+                      bool transposed_b) {
+  std::vector<double> row(N);
+  for (int i = 0; i < rows; i++) {
+    std::fill(row.begin(), row.end(), 0.0);
+    for (int k = 0; k < K; k++) {
+      double a = A[(size_t)i * K + k];
+      for (int j = 0; j < N; j++)
+        row[j] += a * (transposed_b ? B[(size_t)j * K + k]
+                                    : B[(size_t)k * N + j]);
+    }
+    for (int j = 0; j < N; j++)
+      C[(size_t)i * N + j] = (float)row[j];
+  }
+}
+
+// Within the tolerance of an fp32 sum over K terms
+static bool close(const std::vector<float> &gold, const std::vector<float> &out,
+                  size_t n, int K, const char *name,
+                  gemm::FloatError *error) {
+  *error = gemm::float_error(gold.data(), out.data(), n);
+  if (error->max_rel > gemm::float_tolerance(K)) {
+    printf("Mismatch (%s) %zu: gold: %f result: %f\n", name, error->worst,
+           gold[error->worst], out[error->worst]);
+    return false;
+  }
+  return true;
+}
+
+static void print_row(const char *name, double seconds, double ops,
+                      size_t bytes, double base_s, const char *error) {
+  printf("| %-20s | %10.2f ms | %7.2f GFLOPS | %8.2f MB | %7.2fx | %-12s |\n",
+         name, seconds * 1000, ops / seconds * 1e-9,
+         bytes / (1024.0 * 1024.0), base_s / seconds, error);
+}
+
+template <typename T>
+static bool bench_type(const char *type, const std::vector<float> &a,
+                       const std::vector<float> &b, int n, double base_s) {
+  Operand<T> A(a), B(b);
+  std::vector<float> gold((size_t)n * n), C((size_t)n * n);
+  reference(A.value, B.value, gold, n, n, n, false);
+  double ops = 2.0 * n * n * n;
+  size_t bytes = 2 * A.data.size() * sizeof(T);
+
+  bool match = true;
+  const gemm::FloatIsa isas[] = {gemm::FISA_SCALAR, gemm::FISA_AVX2,
+                                 gemm::FISA_AVX512};
+  for (gemm::FloatIsa isa : isas) {
+    if (gemm::float_isa(isa) != isa)
+      continue; // not supported by this CPU
+    char name[64];
+    snprintf(name, sizeof(name), "%s, %s", type, gemm::float_isa_name(isa));
+    Clock::time_point t = Clock::now();
+    gemm::float_matmul(A.data.data(), B.data.data(), C.data(), n, n, n, isa);
+    double seconds = seconds_since(t);
+    gemm::FloatError error;
+    match = close(gold, C, C.size(), n, name, &error) && match;
+    char error_text[32];
+    snprintf(error_text, sizeof(error_text), "%u ULP", error.max_ulp);
+    print_row(name, seconds, ops, bytes, base_s, error_text);
+  }
+  return match;
+}
+
+// The CPU engine on every type
+static bool bench_engine(int n) {
+  std::vector<float> a = random_fractions((size_t)n * n, 1);
+  std::vector<float> b = random_fractions((size_t)n * n, 2);
+  double ops = 2.0 * n * n * n;
+
+  printf("CPU engine, %d x %d x %d, %u threads\n", n, n, n,
+         gemm::ThreadPool::global().size());
+  printf("|----------------------+---------------+----------------+"
+         "-------------+----------+--------------|\n"
+         "| Engine               |          Time |     Throughput |"
+         "      A + B |  Speedup |    Max error |\n"
+         "|----------------------+---------------+----------------+"
+         "-------------+----------+--------------|\n");
+  // int32 on the 0..10 inputs of the examples, as the baseline
+  std::vector<int> int_a(a.size()), int_b(b.size()), int_c(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    int_a[i] = (int)(a[i] * 11);
+    int_b[i] = (int)(b[i] * 11);
+  }
+  Clock::time_point t = Clock::now();
+  gemm::cpu_matmul(int_a.data(), int_b.data(), int_c.data(), n, n, n);
+  double base_s = seconds_since(t);
+  print_row("int32", base_s, ops, 2 * int_a.size() * sizeof(int), base_s,
+            "exact");
+
+  bool match = bench_type<float>("fp32", a, b, n, base_s);
+  match = bench_type<gemm::bf16>("bf16", a, b, n, base_s) && match;
+  match = bench_type<gemm::fp16>("fp16", a, b, n, base_s) && match;
+  printf("|----------------------+---------------+----------------+"
+         "-------------+----------+--------------|\n");
+  return match;
+}
+
+// One kernel on square size x size operands of type T, of which the first
+// rows rows of C are computed. kernel takes (A, B, C) with B transposed if
+// transposed_b.
+template <typename T, typename Kernel>
+static bool check_kernel(const char *name, const char *type, int size,
+                         int rows, Kernel kernel, bool transposed_b) {
+  Operand<T> A(random_fractions((size_t)size * size, 3));
+  Operand<T> B(random_fractions((size_t)size * size, 4));
+  std::vector<float> gold((size_t)size * size), C((size_t)size * size);
+  reference(A.value, B.value, gold, rows, size, size, transposed_b);
+  kernel(A.data.data(), B.data.data(), C.data());
+
+  char label[64];
+  snprintf(label, sizeof(label), "%s_%s", name, type);
+  gemm::FloatError error;
+  bool match = close(gold, C, (size_t)rows * size, size, label, &error);
+  // lmult reads its row of A once per call and all of B
+  size_t calls = (rows == size) ? 1 : rows;
+  size_t bytes = ((size_t)rows * size + calls * (size_t)size * size) *
+                 sizeof(T);
+  printf("| %-24s | %6d | %11.1f KB | %8u ULP | %-6s |\n", label, size,
+         bytes / 1024.0, error.max_ulp, match ? "yes" : "NO");
+  return match;
+}
+
+// The kernels of one type; T is float or the 16-bit storage the kernels
+// declare, which holds the same bits as gemm::bf16 and gemm::fp16
+template <typename T, typename Storage>
+static bool check_type(const char *type,
+                       void (*partition)(Storage *, Storage *, float *, int),
+                       void (*systolic)(const Storage *, const Storage *,
+                                        float *, int, int, int),
+                       void (*reorder)(const Storage *, const Storage *,
+                                       float *, int),
+                       void (*large)(float *, Storage *, Storage *)) {
+  bool match = true;
+  int size = PARTITION_MAX_SIZE;
+  match = check_kernel<T>("matmul_partition", type, size, size,
+                          [&](T *a, T *b, float *c) {
+                            partition((Storage *)a, (Storage *)b, c, size);
+                          },
+                          false) &&
+          match;
+  // One less than the array, so that the edges are exercised
+  size = SYSTOLIC_FLOAT_MAX_SIZE - 1;
+  match = check_kernel<T>("mmult_systolic", type, size, size,
+                          [&](T *a, T *b, float *c) {
+                            systolic((Storage *)a, (Storage *)b, c, size,
+                                     size, size);
+                          },
+                          false) &&
+          match;
+  size = LOOP_REORDER_MAX_SIZE - 3;
+  match = check_kernel<T>("mmult", type, size, size,
+                          [&](T *a, T *b, float *c) {
+                            reorder((Storage *)a, (Storage *)b, c, size);
+                          },
+                          false) &&
+          match;
+  // One lmult call per row of C, against the transposed B
+  match = check_kernel<T>("lmult", type, LMULT_SIZE, LMULT_ROWS,
+                          [&](T *a, T *tb, float *c) {
+                            for (int r = 0; r < LMULT_ROWS; r++)
+                              large(c + r * LMULT_SIZE,
+                                    (Storage *)a + r * LMULT_SIZE,
+                                    (Storage *)tb);
+                          },
+                          true) &&
+          match;
+  return match;
+}
+
+static bool check_kernels() {
+  printf("Floating-point kernels, bytes of A and B read\n");
+  printf("|--------------------------+--------+----------------+"
+         "--------------+--------|\n"
+         "| Kernel                   |   Size |          A + B |"
+         "    Max error | Match  |\n"
+         "|--------------------------+--------+----------------+"
+         "--------------+--------|\n");
+  bool match = check_type<float>("fp32", matmul_partition_fp32,
+                                 mmult_systolic_fp32, mmult_fp32, lmult_fp32);
+  match = check_type<gemm::bf16>("bf16", matmul_partition_bf16,
+                                 mmult_systolic_bf16, mmult_bf16,
+                                 lmult_bf16) &&
+          match;
+  match = check_type<gemm::fp16>("fp16", matmul_partition_fp16,
+                                 mmult_systolic_fp16, mmult_fp16,
+                                 lmult_fp16) &&
+          match;
+  printf("|--------------------------+--------+----------------+"
+         "--------------+--------|\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 1024;
+  bool match = bench_engine(n);
+  match = check_kernels() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
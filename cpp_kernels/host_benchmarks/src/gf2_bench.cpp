@@ -0,0 +1,180 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  GF(2) GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Multiplies random binary matrices over GF(2) with the int CPU engine of
+common/includes/gemm/cpu_gemm.hpp (result taken mod 2), with one XOR of a
+row of B per set bit of A on bit matrices, and with the Method of Four
+Russians of common/includes/gemm/gf2_gemm.hpp on its scalar and AVX2 paths.
+Throughput is given in GOP/s-equivalent, 2 * n^3 operations per product as
+for int GEMM. The boolean product of the same method is checked against
+gemm::bool_matmul(), and matmul_partition_gf2 of array_partition, compiled
+for the host, against the engine on 512 x 512.
+Usage: ./gf2_bench [max size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "gf2_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static gemm::BitMatrix random_bits(int n, unsigned seed) {
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<uint64_t> word;
+  gemm::BitMatrix M(n, n);
+  for (int i = 0; i < n; i++)
+    for (int w = 0; w < M.words; w++)
+      M.row(i)[w] = word(e);
+  // Bits past the last column stay zero
+  if (n % 64)
+    for (int i = 0; i < n; i++)
+      M.row(i)[M.words - 1] &= ((uint64_t)1 << (n % 64)) - 1;
+  return M;
+}
+
+static double gops(int n, double s) { return 2.0 * n * n * n / s * 1e-9; }
+
+static bool bench_size(int n) {
+  gemm::BitMatrix A = random_bits(n, n), B = random_bits(n, n + 1), C;
+  std::vector<int> dense_a((size_t)n * n), dense_b((size_t)n * n);
+  std::vector<int> dense_c((size_t)n * n);
+  gemm::bit_to_dense(A, dense_a.data());
+  gemm::bit_to_dense(B, dense_b.data());
+
+  Clock::time_point t = Clock::now();
+  gemm::cpu_matmul(dense_a.data(), dense_b.data(), dense_c.data(), n, n, n);
+  double int_s = seconds_since(t);
+  for (size_t i = 0; i < dense_c.size(); i++)
+    dense_c[i] &= 1;
+  gemm::BitMatrix gold = gemm::bit_from_dense(dense_c.data(), n, n);
+
+  t = Clock::now();
+  gemm::gf2_matmul_naive(A, B, C);
+  double naive_s = seconds_since(t);
+  bool match = (C.bits == gold.bits);
+
+  double m4r_s[2] = {0, 0};
+  const gemm::Gf2Isa paths[] = {gemm::GF2ISA_SCALAR, gemm::GF2ISA_AVX2};
+  for (int p = 0; p < 2; p++) {
+    if (gemm::gf2_isa(paths[p]) != paths[p])
+      continue;
+    t = Clock::now();
+    gemm::gf2_matmul(A, B, C, paths[p]);
+    m4r_s[p] = seconds_since(t);
+    match = match && (C.bits == gold.bits);
+  }
+  double best_s = m4r_s[1] ? m4r_s[1] : m4r_s[0];
+
+  printf("| %5d | %8.2f ms | %7.2f | %8.2f ms | %8.2f ms | %8.2f ms |"
+         " %8.1f | %7.1fx | %-5s |\n",
+         n, int_s * 1000, gops(n, int_s), naive_s * 1000, m4r_s[0] * 1000,
+         m4r_s[1] * 1000, gops(n, best_s), int_s / best_s,
+         match ? "yes" : "NO");
+  return match;
+}
+
+static bool bench_bool(int n) {
+  // Sparse rows, so the boolean product is not all ones
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> percent(0, 99);
+  gemm::BitMatrix A(n, n), B(n, n), gold, C;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      if (percent(e) < 1)
+        A.set(i, j);
+      if (percent(e) < 1)
+        B.set(i, j);
+    }
+  gemm::bool_matmul(A, B, gold);
+  gemm::bool_matmul_m4r(A, B, C);
+  return C.bits == gold.bits;
+}
+
+static bool bench_kernel() {
+  const int n = GF2_MAX_SIZE;
+  gemm::BitMatrix A = random_bits(n, 1), B = random_bits(n, 2), gold;
+  gemm::gf2_matmul(A, B, gold);
+  // 512 columns are 8 whole words of a BitMatrix, the layout of row512 on
+  // a little-endian host
+  std::vector<row512> in1(n), in2(n), out(n);
+  memcpy(in1.data(), A.bits.data(), n * sizeof(row512));
+  memcpy(in2.data(), B.bits.data(), n * sizeof(row512));
+  Clock::time_point t = Clock::now();
+  matmul_partition_gf2(in1.data(), in2.data(), out.data(), n);
+  double s = seconds_since(t);
+  bool match = memcmp(out.data(), gold.bits.data(), n * sizeof(row512)) == 0;
+  printf("matmul_partition_gf2, %d x %d on the host: %.2f ms, %s\n", n, n,
+         s * 1000, match ? "match" : "MISMATCH");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int max_n = (argc > 1) ? atoi(argv[1]) : 2048;
+  printf("GF(2), %u threads, 64 elements in %d bytes as int, 8 as bits\n",
+         gemm::ThreadPool::global().size(), (int)(64 * sizeof(int)));
+  printf("|-------+-------------+---------+-------------+-------------+"
+         "-------------+----------+----------+-------|\n"
+         "|  Size |  int engine |  GOP/s  |  XOR of row |  M4R scalar |"
+         "    M4R AVX2 | GOP/s eq |  Speedup | Match |\n"
+         "|-------+-------------+---------+-------------+-------------+"
+         "-------------+----------+----------+-------|\n");
+  bool match = true;
+  for (int n = 256; n <= max_n; n *= 2)
+    match = bench_size(n) && match;
+  // An odd size, for the partial group and word
+  match = bench_size(1000) && match;
+  printf("|-------+-------------+---------+-------------+-------------+"
+         "-------------+----------+----------+-------|\n");
+  bool bool_ok = bench_bool(1000);
+  printf("Boolean Four Russians product: %s\n",
+         bool_ok ? "match" : "MISMATCH");
+  match = match && bool_ok;
+  match = bench_kernel() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
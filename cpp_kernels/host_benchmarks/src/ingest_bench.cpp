@@ -0,0 +1,297 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Matrix ingestion benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Writes CSV (int and float, comma, tab and space separated), Matrix Market
+and .npy test files, then loads
+each with the parallel matrixio loaders and with a naive fscanf()/fread()
+loop. Reports load throughput in MB/s and checks both give the same matrix.
+Usage: ./ingest_bench [size]
+*/
+
+#include "matrixio.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static double file_mb(const std::string &name) {
+  struct stat st;
+  stat(name.c_str(), &st);
+  return st.st_size / 1e6;
+}
+
+// width pads the fields, as in a column-aligned space separated file
+static void write_csv_int(const char *name, int n, char delimiter = ',',
+                          int width = 0) {
+  std::default_random_engine e(1);
+  FILE *f = fopen(name, "w");
+  for (int r = 0; r < n; r++)
+    for (int c = 0; c < n; c++)
+      fprintf(f, "%*d%c", width, (int)(e() % 200001) - 100000,
+              c + 1 < n ? delimiter : '\n');
+  fclose(f);
+}
+
+static void write_csv_float(const char *name, int n) {
+  std::default_random_engine e(2);
+  std::uniform_real_distribution<float> dist(-1000, 1000);
+  FILE *f = fopen(name, "w");
+  for (int r = 0; r < n; r++)
+    for (int c = 0; c < n; c++)
+      fprintf(f, "%.6g%c", dist(e), c + 1 < n ? ',' : '\n');
+  fclose(f);
+}
+
+// Each (row, column) pair appears once, about 1/8 of the matrix is filled
+static void write_mtx(const char *name, int n) {
+  std::default_random_engine e(3);
+  std::uniform_real_distribution<double> dist(-1, 1);
+  FILE *f = fopen(name, "w");
+  fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n");
+  fprintf(f, "%% generated by ingest_bench\n");
+  long entries = 0;
+  for (int c = 0; c < n; c++)
+    for (int r = (int)(e() % 8); r < n; r += 8)
+      entries++;
+  fprintf(f, "%d %d %ld\n", n, n, entries);
+  e.seed(3);
+  for (int c = 0; c < n; c++)
+    for (int r = (int)(e() % 8); r < n; r += 8)
+      fprintf(f, "%d %d %.10e\n", r + 1, c + 1, dist(e));
+  fclose(f);
+}
+
+static void write_npy(const char *name, int n) {
+  char header[128];
+  int len = snprintf(header, sizeof(header),
+                     "{'descr': '<f4', 'fortran_order': False, "
+                     "'shape': (%d, %d), }",
+                     n, n);
+  // Pad with spaces so that the data starts at a multiple of 64 bytes
+  int total = (10 + len + 1 + 63) / 64 * 64;
+  memset(header + len, ' ', total - 10 - len - 1);
+  header[total - 10 - 1] = '\n';
+  FILE *f = fopen(name, "wb");
+  fwrite("\x93NUMPY\x01\x00", 1, 8, f);
+  unsigned short hl = total - 10;
+  fwrite(&hl, 2, 1, f);
+  fwrite(header, 1, total - 10, f);
+  std::default_random_engine e(4);
+  std::uniform_real_distribution<float> dist(-1, 1);
+  for (size_t i = 0; i < (size_t)n * n; i++) {
+    float v = dist(e);
+    fwrite(&v, sizeof(v), 1, f);
+  }
+  fclose(f);
+}
+
+// format is "%d," for commas, "%d" when white space separates the fields
+static void naive_csv(const char *name, matrixio::Matrix<int> &m, int n,
+                      const char *format = "%d,") {
+  FILE *f = fopen(name, "r");
+  m.rows = m.cols = n;
+  m.data.resize((size_t)n * n);
+  for (size_t i = 0; i < m.data.size(); i++)
+    if (fscanf(f, format, &m.data[i]) != 1)
+      break;
+  fclose(f);
+}
+
+static void naive_csv(const char *name, matrixio::Matrix<float> &m, int n) {
+  FILE *f = fopen(name, "r");
+  m.rows = m.cols = n;
+  m.data.resize((size_t)n * n);
+  for (size_t i = 0; i < m.data.size(); i++)
+    if (fscanf(f, "%f,", &m.data[i]) != 1)
+      break;
+  fclose(f);
+}
+
+static void naive_mtx(const char *name, matrixio::Matrix<double> &m) {
+  FILE *f = fopen(name, "r");
+  char line[256];
+  do {
+    if (!fgets(line, sizeof(line), f))
+      break;
+  } while (line[0] == '%');
+  long entries;
+  sscanf(line, "%d %d %ld", &m.rows, &m.cols, &entries);
+  m.data.assign((size_t)m.rows * m.cols, 0);
+  for (long k = 0; k < entries; k++) {
+    int r, c;
+    double v;
+    if (fscanf(f, "%d %d %lf", &r, &c, &v) != 3)
+      break;
+    m.at(r - 1, c - 1) = v;
+  }
+  fclose(f);
+}
+
+static void naive_npy(const char *name, matrixio::Matrix<float> &m, int n) {
+  FILE *f = fopen(name, "rb");
+  unsigned char pre[10];
+  if (fread(pre, 1, 10, f) == 10)
+    fseek(f, pre[8] | (pre[9] << 8), SEEK_CUR);
+  m.rows = m.cols = n;
+  m.data.resize((size_t)n * n);
+  for (size_t i = 0; i < m.data.size(); i++)
+    if (fread(&m.data[i], sizeof(float), 1, f) != 1)
+      break;
+  fclose(f);
+}
+
+template <typename T>
+static bool same(const matrixio::Matrix<T> &a, const matrixio::Matrix<T> &b) {
+  if (a.rows != b.rows || a.cols != b.cols)
+    return false;
+  for (size_t i = 0; i < a.data.size(); i++) {
+    double x = a.data[i], y = b.data[i];
+    // strtof() rounds once, parsing to double and narrowing may round twice
+    if (x != y && std::fabs(x - y) > 1e-6 * std::fabs(y))
+      return false;
+  }
+  return true;
+}
+
+static void report(const char *name, const char *file, double naive_s,
+                   double fast_s) {
+  double mb = file_mb(file);
+  printf("| %-14s | %7.1f MB | %7.1f MB/s | %7.1f MB/s | %7.1fx |\n", name,
+         mb, mb / naive_s, mb / fast_s, naive_s / fast_s);
+}
+
+// Loads file with both loaders, reports and checks them
+template <typename T, typename Naive, typename Fast>
+static bool run(const char *name, const char *file, Naive naive, Fast fast) {
+  matrixio::Matrix<T> a, b;
+  Clock::time_point t = Clock::now();
+  naive(a);
+  double naive_s = seconds_since(t);
+  t = Clock::now();
+  fast(b);
+  double fast_s = seconds_since(t);
+  report(name, file, naive_s, fast_s);
+  if (!same(a, b)) {
+    printf("Mismatch loading %s\n", file);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 2048;
+  if (n <= 0) {
+    printf("Usage: %s [size]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  printf("Writing %d x %d test files\n", n, n);
+  write_csv_int("ingest_int.csv", n);
+  write_csv_int("ingest_int.tsv", n, '\t');
+  write_csv_int("ingest_int.txt", n, ' ', 8);
+  write_csv_float("ingest_float.csv", n);
+  write_mtx("ingest.mtx", n);
+  write_npy("ingest.npy", n);
+
+  printf("|----------------+------------+--------------+--------------+----------|\n"
+         "| Format         |       Size | fscanf/fread |     matrixio |  Speedup |\n"
+         "|----------------+------------+--------------+--------------+----------|\n");
+  bool match = true;
+  match &= run<int>(
+      "CSV int32", "ingest_int.csv",
+      [&](matrixio::Matrix<int> &m) { naive_csv("ingest_int.csv", m, n); },
+      [](matrixio::Matrix<int> &m) {
+        matrixio::load_csv("ingest_int.csv", m);
+      });
+  match &= run<int>(
+      "TSV int32", "ingest_int.tsv",
+      [&](matrixio::Matrix<int> &m) {
+        naive_csv("ingest_int.tsv", m, n, "%d");
+      },
+      [](matrixio::Matrix<int> &m) {
+        matrixio::LoadOptions options;
+        options.delimiter = '\t';
+        matrixio::load_csv("ingest_int.tsv", m, options);
+      });
+  match &= run<int>(
+      "Spaced int32", "ingest_int.txt",
+      [&](matrixio::Matrix<int> &m) {
+        naive_csv("ingest_int.txt", m, n, "%d");
+      },
+      [](matrixio::Matrix<int> &m) {
+        matrixio::LoadOptions options;
+        options.delimiter = ' ';
+        matrixio::load_csv("ingest_int.txt", m, options);
+      });
+  match &= run<float>(
+      "CSV float", "ingest_float.csv",
+      [&](matrixio::Matrix<float> &m) {
+        naive_csv("ingest_float.csv", m, n);
+      },
+      [](matrixio::Matrix<float> &m) {
+        matrixio::load_csv("ingest_float.csv", m);
+      });
+  match &= run<double>(
+      "Matrix Market", "ingest.mtx",
+      [](matrixio::Matrix<double> &m) { naive_mtx("ingest.mtx", m); },
+      [](matrixio::Matrix<double> &m) { matrixio::load_mtx("ingest.mtx", m); });
+  match &= run<float>(
+      "NPY float32", "ingest.npy",
+      [&](matrixio::Matrix<float> &m) { naive_npy("ingest.npy", m, n); },
+      [](matrixio::Matrix<float> &m) { matrixio::load_npy("ingest.npy", m); });
+  printf("|----------------+------------+--------------+--------------+----------|\n");
+
+  remove("ingest_int.csv");
+  remove("ingest_int.tsv");
+  remove("ingest_int.txt");
+  remove("ingest_float.csv");
+  remove("ingest.mtx");
+  remove("ingest.npy");
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
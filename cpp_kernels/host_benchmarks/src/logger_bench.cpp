@@ -0,0 +1,221 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Logger benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Measures the cost of one LogInfo() call with the asynchronous backend of
+common/includes/logger, from one and from several threads, with a queue
+that waits when full and with one that drops records, against the former
+LogWrapper, which opened the log file once per call, and against formatting
+the record alone. Console echo is off for all of them. Checks that every record reaches the file when the queue
+waits.
+Usage: ./logger_bench [calls per thread]
+*/
+
+#include "logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdarg.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// CPU time of the calling thread, which unlike wall time excludes the writer
+// thread and other producers when they share a core
+static double thread_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *LOG_FILE = "logger_bench.log";
+
+// The former LogWrapper without the console output: string building,
+// asctime() and an ofstream opened for every record
+static void legacy_log(int line, const char *desc, ...) {
+  char header[512];
+  snprintf(header, sizeof(header), "INFO: [%s:%d]", "logger_bench.cpp", line);
+  string strHeader(header);
+  time_t rawtime;
+  time(&rawtime);
+  string temp(asctime(localtime(&rawtime)));
+  temp = sda::trim(temp);
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "TIME: [%s]", temp.c_str());
+  string strTime(buffer);
+  char msg[512];
+  va_list args;
+  va_start(args, desc);
+  vsnprintf(msg, sizeof(msg), desc, args);
+  va_end(args);
+  string strOut = strHeader + " " + strTime + " " + string(msg) + "\n";
+  std::ofstream outfile;
+  outfile.open(LOG_FILE, std::ios_base::app);
+  outfile << strOut;
+}
+
+// What every backend pays before queueing: formatting the same record
+static double format_seconds(size_t calls) {
+  char record[1024];
+  size_t sum = 0;
+  double begin = thread_seconds();
+  for (size_t i = 0; i < calls; i++) {
+    int len = snprintf(record, sizeof(record), "%s: [%s:%d] TIME: [%s] ",
+                       "INFO", "logger_bench.cpp", __LINE__,
+                       "Mon Oct 19 12:00:00 2026");
+    sum += snprintf(record + len, sizeof(record) - len,
+                    "tile %zu of thread %u done, %.3f GOPS", i, 0u, 1.5 * i);
+  }
+  double s = thread_seconds() - begin;
+  return sum ? s : 0;
+}
+
+static size_t count_lines() {
+  FILE *f = fopen(LOG_FILE, "r");
+  if (!f)
+    return 0;
+  size_t lines = 0;
+  int c;
+  while ((c = fgetc(f)) != EOF)
+    lines += c == '\n';
+  fclose(f);
+  return lines;
+}
+
+struct Result {
+  double call_ns;  // average CPU time inside LogInfo()
+  double total_ms; // until everything is written
+  size_t dropped;
+  size_t lines;
+};
+
+static Result run_async(unsigned threads, size_t calls, sda::LOGOVERFLOW policy,
+                        size_t capacity) {
+  remove(LOG_FILE);
+  sda::LogSettings settings;
+  settings.filename = LOG_FILE;
+  settings.echo = false;
+  settings.capacity = capacity;
+  settings.overflow = policy;
+  sda::LogStart(settings);
+
+  std::vector<double> busy(threads);
+  std::vector<std::thread> workers;
+  Clock::time_point start = Clock::now();
+  for (unsigned t = 0; t < threads; t++)
+    workers.push_back(std::thread([&, t] {
+      double begin = thread_seconds();
+      for (size_t i = 0; i < calls; i++)
+        LogInfo("tile %zu of thread %u done, %.3f GOPS", i, t, 1.5 * i);
+      busy[t] = thread_seconds() - begin;
+    }));
+  for (unsigned t = 0; t < threads; t++)
+    workers[t].join();
+  sda::LogFlush();
+
+  Result r;
+  r.total_ms = seconds_since(start) * 1e3;
+  double sum = 0;
+  for (unsigned t = 0; t < threads; t++)
+    sum += busy[t];
+  r.call_ns = sum / (threads * calls) * 1e9;
+  r.dropped = sda::LogDropped();
+  sda::LogStop();
+  r.lines = count_lines();
+  return r;
+}
+
+int main(int argc, char **argv) {
+  size_t calls = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+  if (calls == 0) {
+    printf("Usage: %s [calls per thread]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  unsigned threads = std::thread::hardware_concurrency();
+  threads = threads < 4 ? 4 : threads;
+
+  remove(LOG_FILE);
+  size_t legacy_calls = calls / 10 ? calls / 10 : 1;
+  Clock::time_point t = Clock::now();
+  double cpu = thread_seconds();
+  for (size_t i = 0; i < legacy_calls; i++)
+    legacy_log(__LINE__, "tile %zu of thread %u done, %.3f GOPS", i, 0u, 1.5 * i);
+  double legacy_cpu = thread_seconds() - cpu;
+  double legacy_s = seconds_since(t);
+  bool match = count_lines() == legacy_calls;
+
+  double format_s = format_seconds(calls);
+  Result one = run_async(1, calls, sda::eoBlock, 4096);
+  Result many = run_async(threads, calls, sda::eoBlock, 4096);
+  Result drop = run_async(threads, calls, sda::eoDrop, 1024);
+  match = match && one.lines == calls && many.lines == threads * calls &&
+          drop.lines + drop.dropped == threads * calls;
+  if (!match)
+    printf("Log file does not hold the expected records\n");
+
+  printf("|-----------------------------+------------+-------------+------------|\n"
+         "| Backend                     |  ns / call | Written (ms)|    Dropped |\n"
+         "|-----------------------------+------------+-------------+------------|\n");
+  printf("| %-27s | %10.0f | %11.1f | %10s |\n", "Per-call ofstream, 1 thread",
+         legacy_cpu / legacy_calls * 1e9, legacy_s * 1e3 * calls / legacy_calls, "-");
+  printf("| %-27s | %10.0f | %11s | %10s |\n", "snprintf() only, 1 thread",
+         format_s / calls * 1e9, "-", "-");
+  printf("| %-27s | %10.0f | %11.1f | %10zu |\n", "Async, block, 1 thread", one.call_ns,
+         one.total_ms, one.dropped);
+  char name[64];
+  snprintf(name, sizeof(name), "Async, block, %u threads", threads);
+  printf("| %-27s | %10.0f | %11.1f | %10zu |\n", name, many.call_ns, many.total_ms,
+         many.dropped);
+  snprintf(name, sizeof(name), "Async, drop, %u threads", threads);
+  printf("| %-27s | %10.0f | %11.1f | %10zu |\n", name, drop.call_ns, drop.total_ms,
+         drop.dropped);
+  printf("|-----------------------------+------------+-------------+------------|\n");
+  printf("%zu calls per thread; the per-call ofstream ran %zu and is scaled.\n",
+         calls, legacy_calls);
+
+  remove(LOG_FILE);
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
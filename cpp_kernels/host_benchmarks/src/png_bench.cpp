@@ -0,0 +1,226 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  PNG encode/decode benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Renders a matrix as an RGB heatmap and encodes it with lodepng using one
+deflate thread and using all hardware threads, checking that both decode to
+the input. Then times decoding of images whose rows all use one filter type,
+stored without compression so that the unfilter rather than inflate
+dominates. The Makefile also builds png_bench_scalar
+with -DLODEPNG_NO_COMPILE_SSE2 so the decode rows can be compared.
+Usage: ./png_bench [width height]
+*/
+
+#include "lodepng.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// A smooth field with some noise, coloured blue -> red like a result heatmap
+static std::vector<unsigned char> heatmap(unsigned width, unsigned height,
+                                          unsigned channels) {
+  std::vector<unsigned char> image((size_t)width * height * channels);
+  std::default_random_engine e(11);
+  std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+  for (unsigned y = 0; y < height; y++)
+    for (unsigned x = 0; x < width; x++) {
+      float v = 0.5f + 0.25f * std::sin(x * 0.01f) * std::cos(y * 0.013f) +
+                0.2f * ((float)(x ^ y) / (width | height)) + noise(e);
+      v = v < 0 ? 0 : (v > 1 ? 1 : v);
+      unsigned char *p = &image[((size_t)y * width + x) * channels];
+      p[0] = (unsigned char)(255 * v);
+      p[1] = (unsigned char)(255 * (1 - std::fabs(2 * v - 1)));
+      p[2] = (unsigned char)(255 * (1 - v));
+      if (channels == 4)
+        p[3] = (unsigned char)(128 + 127 * v);
+    }
+  return image;
+}
+
+// Encodes with the given deflate threads and filter strategy; filter >= 0
+// forces that filter type on every row (5 cycles through all of them)
+static std::vector<unsigned char> encode(const std::vector<unsigned char> &image,
+                                         unsigned width, unsigned height,
+                                         unsigned channels, unsigned threads,
+                                         int filter, bool stored = false) {
+  LodePNGState state;
+  lodepng_state_init(&state);
+  LodePNGColorType type = channels == 4 ? LCT_RGBA : LCT_RGB;
+  state.info_raw.colortype = type;
+  state.info_png.color.colortype = type;
+  state.encoder.auto_convert = LAC_NO;
+  state.encoder.zlibsettings.numthreads = threads;
+  if (stored)
+    state.encoder.zlibsettings.btype = 0;
+  std::vector<unsigned char> filters;
+  if (filter >= 0) {
+    filters.resize(height);
+    for (unsigned y = 0; y < height; y++)
+      filters[y] = filter < 5 ? filter : y % 5;
+    state.encoder.filter_strategy = LFS_PREDEFINED;
+    state.encoder.predefined_filters = filters.data();
+  }
+  unsigned char *out = 0;
+  size_t outsize = 0;
+  unsigned error =
+      lodepng_encode(&out, &outsize, image.data(), width, height, &state);
+  std::vector<unsigned char> png;
+  if (!error)
+    png.assign(out, out + outsize);
+  else
+    printf("Encode error %u: %s\n", error, lodepng_error_text(error));
+  free(out);
+  lodepng_state_cleanup(&state);
+  return png;
+}
+
+static bool decodes_to(const std::vector<unsigned char> &png,
+                       const std::vector<unsigned char> &image,
+                       unsigned channels) {
+  unsigned char *out = 0;
+  unsigned w, h;
+  unsigned error = lodepng_decode_memory(&out, &w, &h, png.data(), png.size(),
+                                         channels == 4 ? LCT_RGBA : LCT_RGB, 8);
+  bool ok = !error && (size_t)w * h * channels == image.size() &&
+            memcmp(out, image.data(), image.size()) == 0;
+  free(out);
+  return ok;
+}
+
+static double decode_seconds(const std::vector<unsigned char> &png,
+                             unsigned channels, int repeats) {
+  double best = 1e30;
+  for (int r = 0; r < repeats; r++) {
+    unsigned char *out = 0;
+    unsigned w, h;
+    Clock::time_point t = Clock::now();
+    lodepng_decode_memory(&out, &w, &h, png.data(), png.size(),
+                          channels == 4 ? LCT_RGBA : LCT_RGB, 8);
+    double s = seconds_since(t);
+    best = s < best ? s : best;
+    free(out);
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  unsigned width = argc > 2 ? atoi(argv[1]) : 2048;
+  unsigned height = argc > 2 ? atoi(argv[2]) : 2048;
+  if (width == 0 || height == 0) {
+    printf("Usage: %s [width height]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+#ifdef LODEPNG_NO_COMPILE_SSE2
+  const char *unfilter = "scalar";
+#else
+  const char *unfilter = "SSE2";
+#endif
+  // At least 4 parts, so the multi-part stream is checked on any machine
+  unsigned threads = std::thread::hardware_concurrency();
+  threads = threads < 4 ? 4 : threads;
+  std::vector<unsigned char> image = heatmap(width, height, 3);
+  double mb = image.size() / 1e6;
+  printf("%u x %u RGB heatmap, %.1f MB, %s unfilter\n", width,
+         height, mb, unfilter);
+
+  Clock::time_point t = Clock::now();
+  std::vector<unsigned char> serial = encode(image, width, height, 3, 1, -1);
+  double serial_s = seconds_since(t);
+  t = Clock::now();
+  std::vector<unsigned char> parallel =
+      encode(image, width, height, 3, threads, -1);
+  double parallel_s = seconds_since(t);
+
+  bool match = !serial.empty() && !parallel.empty() &&
+               decodes_to(serial, image, 3) && decodes_to(parallel, image, 3);
+  if (!match)
+    printf("Encoded images do not decode to the input\n");
+
+  // Every filter type, including both SIMD pixel widths, must round trip
+  for (unsigned channels = 3; channels <= 4; channels++) {
+    std::vector<unsigned char> small = heatmap(1021, 67, channels);
+    for (int filter = 0; filter <= 5; filter++)
+      if (!decodes_to(encode(small, 1021, 67, channels, 1, filter), small,
+                      channels)) {
+        printf("Filter %d with %u channels does not round trip\n", filter,
+               channels);
+        match = false;
+      }
+  }
+
+  printf("|-------------------------+---------------+---------------+----------|\n"
+         "| Encode                  |     1 thread  |  %2u threads   |  Speedup |\n"
+         "|-------------------------+---------------+---------------+----------|\n",
+         threads);
+  printf("| %-23s | %8.1f MB/s | %8.1f MB/s | %7.1fx |\n", "Throughput",
+         mb / serial_s, mb / parallel_s, serial_s / parallel_s);
+  printf("| %-23s | %10.2f MB | %10.2f MB | %7.3fx |\n", "PNG size",
+         serial.size() / 1e6, parallel.size() / 1e6,
+         (double)parallel.size() / serial.size());
+  printf("|-------------------------+---------------+---------------+----------|\n");
+
+  static const char *names[] = {"None", "Sub", "Up", "Average", "Paeth"};
+  printf("|-------------------------+---------------+---------------|\n"
+         "| Decode stored, all rows |           RGB |          RGBA |\n"
+         "|-------------------------+---------------+---------------|\n");
+  std::vector<unsigned char> rgba = heatmap(width, height, 4);
+  for (int filter = 0; filter < 5; filter++) {
+    std::vector<unsigned char> rgb_png =
+        encode(image, width, height, 3, 1, filter, true);
+    std::vector<unsigned char> rgba_png =
+        encode(rgba, width, height, 4, 1, filter, true);
+    printf("| %-23s | %8.1f MB/s | %8.1f MB/s |\n", names[filter],
+           mb / decode_seconds(rgb_png, 3, 3),
+           rgba.size() / 1e6 / decode_seconds(rgba_png, 4, 3));
+  }
+  printf("|-------------------------+---------------+---------------|\n");
+
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,252 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Quantized int8/int16 GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Multiplies the 0..10 inputs of the examples with the int32 CPU engine and
+with gemm::quant_matmul() on int16 and int8 operands, on every instruction
+set the CPU supports, and checks that all results are identical. Reports
+time, GOPS and the bytes of A and B each one reads.
+Then runs the packed kernels (matmul_partition, mmult of loop_reorder and
+lmult, compiled for the host) on full-range int8 and int16 operands, checks
+them against a reference, and reports the bytes of A and B they read next
+to those of their int32 versions.
+Usage: ./quant_bench [size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "quant_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Rows of C computed with each lmult variant; every row reads all of B
+const int LMULT_ROWS = 32;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static std::vector<int> random_matrix(size_t n, int lo, int hi,
+                                      unsigned seed) {
+  std::vector<int> m(n);
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> d(lo, hi);
+  for (size_t i = 0; i < n; i++)
+    m[i] = d(e);
+  return m;
+}
+
+static bool same(const std::vector<int> &gold, const std::vector<int> &out,
+                 const char *name) {
+  for (size_t i = 0; i < gold.size(); i++) {
+    if (out[i] != gold[i]) {
+      printf("Mismatch (%s) %zu: gold: %d result: %d\n", name, i, gold[i],
+             out[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void print_row(const char *name, double seconds, double ops,
+                      size_t bytes, double base_s) {
+  printf("| %-26s | %10.2f ms | %8.2f GOPS | %8.2f MB | %7.2fx |\n", name,
+         seconds * 1000, ops / seconds * 1e-9, bytes / (1024.0 * 1024.0),
+         base_s / seconds);
+}
+
+// The CPU engine on the inputs of the examples
+static bool bench_engine(int n) {
+  std::vector<int> A = random_matrix((size_t)n * n, 0, 10, 1);
+  std::vector<int> B = random_matrix((size_t)n * n, 0, 10, 2);
+  std::vector<int> gold((size_t)n * n), C((size_t)n * n);
+  double ops = 2.0 * n * n * n;
+
+  printf("CPU engine, %d x %d x %d, %u threads\n", n, n, n,
+         gemm::ThreadPool::global().size());
+  printf("|----------------------------+---------------+---------------+"
+         "-------------+----------|\n"
+         "| Engine                     |          Time |    Throughput |"
+         "      A + B |  Speedup |\n"
+         "|----------------------------+---------------+---------------+"
+         "-------------+----------|\n");
+  Clock::time_point t = Clock::now();
+  gemm::cpu_matmul(A.data(), B.data(), gold.data(), n, n, n);
+  double base_s = seconds_since(t);
+  print_row("int32", base_s, ops, 2 * A.size() * sizeof(int), base_s);
+
+  bool match = true;
+  const gemm::QuantWidth widths[] = {gemm::QUANT_INT16, gemm::QUANT_INT8};
+  const gemm::QuantIsa isas[] = {gemm::QISA_SCALAR, gemm::QISA_AVX2,
+                                 gemm::QISA_AVX512_VNNI};
+  for (gemm::QuantWidth width : widths) {
+    int words = gemm::quant_words(n, width);
+    std::vector<uint32_t> packed_a((size_t)n * words);
+    std::vector<uint32_t> packed_b((size_t)words * n);
+    gemm::quant_pack_rows(A.data(), packed_a.data(), n, n, width);
+    gemm::quant_pack_cols(B.data(), packed_b.data(), n, n, width);
+    size_t bytes = 2 * packed_a.size() * sizeof(uint32_t);
+
+    for (gemm::QuantIsa isa : isas) {
+      if (gemm::quant_isa(isa) != isa)
+        continue; // not supported by this CPU
+      char name[64];
+      snprintf(name, sizeof(name), "int%d, %s", (int)width,
+               gemm::quant_isa_name(isa));
+      t = Clock::now();
+      gemm::quant_matmul(packed_a.data(), packed_b.data(), C.data(), n, n, n,
+                         width, isa);
+      print_row(name, seconds_since(t), ops, bytes, base_s);
+      match = same(gold, C, name) && match;
+    }
+  }
+  printf("|----------------------------+---------------+---------------+"
+         "-------------+----------|\n");
+  return match;
+}
+
+// Classical product, wrapping modulo 2^32 like the kernels. With
+// transposed_b, row j of B is column j.
+static void reference(const std::vector<int> &A, const std::vector<int> &B,
+                      std::vector<int> &C, int rows, int size,
+                      bool transposed_b) {
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < size; j++) {
+      uint32_t sum = 0;
+      for (int k = 0; k < size; k++)
+        sum += (uint32_t)A[(size_t)i * size + k] *
+               (uint32_t)(transposed_b ? B[(size_t)j * size + k]
+                                       : B[(size_t)k * size + j]);
+      C[(size_t)i * size + j] = (int)sum;
+    }
+  }
+}
+
+// One packed kernel on square size x size operands of the full range of
+// width, of which the first rows rows of C are computed. kernel takes
+// (A, B, C) packed as described in stand_in_kernels.h.
+template <typename Kernel>
+static bool check_kernel(const char *name, int size, int rows,
+                         gemm::QuantWidth width, Kernel kernel,
+                         bool transposed_b) {
+  int hi = (1 << (width - 1)) - 1;
+  std::vector<int> A = random_matrix((size_t)size * size, -hi - 1, hi, 3);
+  std::vector<int> B = random_matrix((size_t)size * size, -hi - 1, hi, 4);
+  std::vector<int> gold((size_t)size * size), C((size_t)size * size);
+  int words = gemm::quant_words(size, width);
+  std::vector<uint32_t> packed_a((size_t)size * words);
+  std::vector<uint32_t> packed_b((size_t)words * size);
+  gemm::quant_pack_rows(A.data(), packed_a.data(), size, size, width);
+  if (transposed_b)
+    gemm::quant_pack_rows(B.data(), packed_b.data(), size, size, width);
+  else
+    gemm::quant_pack_cols(B.data(), packed_b.data(), size, size, width);
+
+  reference(A, B, gold, rows, size, transposed_b);
+  kernel((int *)packed_a.data(), (int *)packed_b.data(), C.data());
+
+  char label[64];
+  snprintf(label, sizeof(label), "%s_int%d", name, (int)width);
+  bool match = same(gold, C, label);
+  // lmult reads its row of A once per call and all of B
+  size_t calls = (rows == size) ? 1 : rows;
+  size_t int32_bytes = (size_t)rows * size * sizeof(int) +
+                       calls * (size_t)size * size * sizeof(int);
+  size_t packed_bytes = (size_t)rows * words * sizeof(uint32_t) +
+                        calls * (size_t)size * words * sizeof(uint32_t);
+  printf("| %-26s | %6d | %11.1f KB | %11.1f KB | %-6s |\n", label, size,
+         int32_bytes / 1024.0, packed_bytes / 1024.0, match ? "yes" : "NO");
+  return match;
+}
+
+static bool check_kernels() {
+  printf("Packed kernels on full-range operands, bytes of A and B read\n");
+  printf("|----------------------------+--------+----------------+"
+         "----------------+--------|\n"
+         "| Kernel                     |   Size |          int32 |"
+         "         packed | Match  |\n"
+         "|----------------------------+--------+----------------+"
+         "----------------+--------|\n");
+  bool match = true;
+  const gemm::QuantWidth widths[] = {gemm::QUANT_INT8, gemm::QUANT_INT16};
+  for (gemm::QuantWidth width : widths) {
+    bool int8 = (width == gemm::QUANT_INT8);
+    int size = PARTITION_MAX_SIZE;
+    match = check_kernel("matmul_partition", size, size, width,
+                         [&](int *a, int *b, int *c) {
+                           (int8 ? matmul_partition_int8
+                                 : matmul_partition_int16)(a, b, c, size);
+                         },
+                         false) &&
+            match;
+    // An odd size leaves a partly filled word at the end of every row
+    size = LOOP_REORDER_MAX_SIZE - 3;
+    match = check_kernel("mmult", size, size, width,
+                         [&](int *a, int *b, int *c) {
+                           (int8 ? mmult_int8 : mmult_int16)(a, b, c, size);
+                         },
+                         false) &&
+            match;
+    // One lmult call per row of C, against the transposed B
+    int words = gemm::quant_words(LMULT_SIZE, width);
+    match = check_kernel("lmult", LMULT_SIZE, LMULT_ROWS, width,
+                         [&](int *a, int *tb, int *c) {
+                           for (int r = 0; r < LMULT_ROWS; r++)
+                             (int8 ? lmult_int8 : lmult_int16)(
+                                 c + r * LMULT_SIZE, a + r * words, tb);
+                         },
+                         true) &&
+            match;
+  }
+  printf("|----------------------------+--------+----------------+"
+         "----------------+--------|\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 1024;
+  bool match = bench_engine(n);
+  match = check_kernels() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,438 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Semiring GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Times the min-plus and max-plus products of the semiring engine of
+common/includes/gemm/semiring_gemm.hpp on its scalar and AVX2 paths against
+a naive triple loop, and the boolean products on bit matrices against the
+int32 engine. Then solves all-pairs shortest paths and reachability of a
+random graph by repeated squaring and checks them against Floyd-Warshall.
+Last, the semiring kernels of array_partition and systolic_array, compiled
+for the host, are checked against the engine, and mmult_minplus drives the
+shortest paths of a 32 node graph. Engine and kernels are also checked on
+weights near +-INT_MAX, whose sums must saturate at the sentinels.
+Usage: ./semiring_bench [size]
+*/
+
+#include "semiring_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Edges of the random graphs per node, on average
+const int GRAPH_DEGREE = 4;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+template <typename S>
+static void naive_matmul(const int *A, const int *B, int *C, int n) {
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      int c = S::zero();
+      for (int k = 0; k < n; k++)
+        c = S::add(c, S::mul(A[i * n + k], B[k * n + j]));
+      C[i * n + j] = c;
+    }
+}
+
+// n x n weights, 1 to 9 on about GRAPH_DEGREE edges per row and the zero
+// of S elsewhere
+template <typename S>
+static std::vector<int> random_graph(int n, unsigned seed) {
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> node(0, n - 1), weight(1, 9);
+  std::vector<int> W((size_t)n * n, S::zero());
+  for (int i = 0; i < n; i++)
+    for (int d = 0; d < GRAPH_DEGREE; d++)
+      W[(size_t)i * n + node(e)] = weight(e);
+  return W;
+}
+
+template <typename S>
+static bool bench_product(const char *name, int n) {
+  // Dense, so every term counts: the zero only on a few elements
+  std::vector<int> A = random_graph<S>(n, n), B = random_graph<S>(n, n + 1);
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> weight(1, 1000);
+  for (size_t i = 0; i < A.size(); i++) {
+    if (i % 7)
+      A[i] = weight(e);
+    if (i % 5)
+      B[i] = weight(e);
+  }
+  std::vector<int> gold((size_t)n * n), C((size_t)n * n);
+  Clock::time_point t = Clock::now();
+  naive_matmul<S>(A.data(), B.data(), gold.data(), n);
+  double naive_s = seconds_since(t);
+
+  bool match = true;
+  const gemm::SemiringIsa paths[] = {gemm::SRISA_SCALAR, gemm::SRISA_AVX2};
+  for (gemm::SemiringIsa requested : paths) {
+    gemm::SemiringIsa isa = gemm::semiring_isa(requested);
+    if (isa != requested)
+      continue;
+    t = Clock::now();
+    gemm::semiring_matmul<S>(A.data(), B.data(), C.data(), n, n, n, isa);
+    double s = seconds_since(t);
+    bool ok = (C == gold);
+    match = match && ok;
+    printf("| %-8s | %-6s | %9.2f ms | %9.2f ms | %7.2f | %6.2fx | %-5s |\n",
+           name, gemm::semiring_isa_name(isa), naive_s * 1000, s * 1000,
+           2.0 * n * n * n / s * 1e-9, naive_s / s, ok ? "yes" : "NO");
+  }
+  return match;
+}
+
+static bool bench_engine(int n) {
+  printf("Engine, %d x %d, %u threads\n", n, n,
+         gemm::ThreadPool::global().size());
+  printf("|----------+--------+--------------+--------------+---------+"
+         "---------+-------|\n"
+         "| Semiring | Path   |  Naive loop  |       Engine |  Gop/s  |"
+         " Speedup | Match |\n"
+         "|----------+--------+--------------+--------------+---------+"
+         "---------+-------|\n");
+  bool match = bench_product<gemm::MinPlus>("min-plus", n);
+  match = bench_product<gemm::MaxPlus>("max-plus", n) && match;
+  printf("|----------+--------+--------------+--------------+---------+"
+         "---------+-------|\n");
+  return match;
+}
+
+// Reference for weights whose sums overflow int: the sums in 64 bits,
+// clamped to +-SEMIRING_INF
+template <typename S>
+static void wide_matmul(const int *A, const int *B, int *C, int n) {
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      int c = S::zero();
+      for (int k = 0; k < n; k++) {
+        int a = A[i * n + k], b = B[k * n + j];
+        if (a == S::zero() || b == S::zero())
+          continue;
+        long long sum = (long long)a + b;
+        sum = std::min<long long>(sum, gemm::SEMIRING_INF);
+        sum = std::max<long long>(sum, -gemm::SEMIRING_INF);
+        c = S::add(c, (int)sum);
+      }
+      C[i * n + j] = c;
+    }
+}
+
+// n x n weights of either sign between INT_MAX / 2 and INT_MAX - 1 in
+// magnitude, and the zero of S on every seventh
+template <typename S>
+static std::vector<int> large_weights(int n, unsigned seed) {
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> weight(INT_MAX / 2, INT_MAX - 1);
+  std::vector<int> W((size_t)n * n);
+  for (size_t i = 0; i < W.size(); i++)
+    W[i] = (i % 7 == 0) ? S::zero() : (i % 2) ? weight(e) : -weight(e);
+  return W;
+}
+
+template <typename S>
+static bool check_saturation(const char *name,
+                             void (*partition)(int *, int *, int *, int),
+                             void (*systolic)(const int *, const int *,
+                                              int *, int, int, int)) {
+  const int np = PARTITION_MAX_SIZE, ns = SYSTOLIC_MAX_SIZE;
+  std::vector<int> A = large_weights<S>(ns, 11), B = large_weights<S>(ns, 12);
+  std::vector<int> gold(ns * ns), C(ns * ns);
+  wide_matmul<S>(A.data(), B.data(), gold.data(), ns);
+  bool match = true;
+  const gemm::SemiringIsa paths[] = {gemm::SRISA_SCALAR, gemm::SRISA_AVX2};
+  for (gemm::SemiringIsa requested : paths) {
+    gemm::SemiringIsa isa = gemm::semiring_isa(requested);
+    if (isa != requested)
+      continue;
+    gemm::semiring_matmul<S>(A.data(), B.data(), C.data(), ns, ns, ns, isa);
+    printf("| %-8s | %-16s | %-5s |\n", name, gemm::semiring_isa_name(isa),
+           C == gold ? "yes" : "NO");
+    match = match && (C == gold);
+  }
+  systolic(A.data(), B.data(), C.data(), ns, ns, ns);
+  printf("| %-8s | %-16s | %-5s |\n", name, "systolic_array",
+         C == gold ? "yes" : "NO");
+  match = match && (C == gold);
+
+  std::vector<int> Ap = large_weights<S>(np, 13);
+  std::vector<int> Bp = large_weights<S>(np, 14);
+  std::vector<int> gold_p(np * np), C_p(np * np);
+  wide_matmul<S>(Ap.data(), Bp.data(), gold_p.data(), np);
+  partition(Ap.data(), Bp.data(), C_p.data(), np);
+  printf("| %-8s | %-16s | %-5s |\n", name, "array_partition",
+         C_p == gold_p ? "yes" : "NO");
+  return match && (C_p == gold_p);
+}
+
+static bool bench_saturation() {
+  printf("Weights near +-INT_MAX, sums saturated\n");
+  printf("|----------+------------------+-------|\n"
+         "| Semiring | Path             | Match |\n"
+         "|----------+------------------+-------|\n");
+  bool match = check_saturation<gemm::MinPlus>(
+      "min-plus", matmul_partition_minplus, mmult_minplus);
+  match = check_saturation<gemm::MaxPlus>("max-plus", matmul_partition_maxplus,
+                                          mmult_maxplus) &&
+          match;
+  printf("|----------+------------------+-------|\n");
+  return match;
+}
+
+static bool bench_bool(int n) {
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<int> A((size_t)n * n), B((size_t)n * n);
+  for (size_t i = 0; i < A.size(); i++) {
+    A[i] = percent(e) < 5;
+    B[i] = percent(e) < 5;
+  }
+  std::vector<int> count((size_t)n * n), C((size_t)n * n);
+  Clock::time_point t = Clock::now();
+  gemm::semiring_matmul<gemm::PlusTimes>(A.data(), B.data(), count.data(), n,
+                                         n, n);
+  double dense_s = seconds_since(t);
+
+  gemm::BitMatrix bA = gemm::bit_from_dense(A.data(), n, n);
+  gemm::BitMatrix bB = gemm::bit_from_dense(B.data(), n, n);
+  gemm::BitMatrix bBT = gemm::bit_transpose(bB), bC(n, n);
+  t = Clock::now();
+  gemm::bool_matmul(bA, bB, bC);
+  double or_s = seconds_since(t);
+  gemm::bit_to_dense(bC, C.data());
+  bool or_ok = true;
+  for (size_t i = 0; i < C.size(); i++)
+    or_ok = or_ok && (C[i] == (count[i] != 0));
+
+  t = Clock::now();
+  gemm::bool_matmul_count(bA, bBT, C.data());
+  double count_s = seconds_since(t);
+  bool count_ok = (C == count);
+
+  printf("Boolean, %d x %d, 5%% of bits set\n", n, n);
+  printf("|-----------------------+--------------+---------+-------|\n"
+         "| Product               |         Time | Speedup | Match |\n"
+         "|-----------------------+--------------+---------+-------|\n");
+  printf("| %-21s | %9.2f ms | %6.2fx | %-5s |\n", "int32 engine",
+         dense_s * 1000, 1.0, "-");
+  printf("| %-21s | %9.2f ms | %6.2fx | %-5s |\n", "bit rows, OR of B",
+         or_s * 1000, dense_s / or_s, or_ok ? "yes" : "NO");
+  printf("| %-21s | %9.2f ms | %6.2fx | %-5s |\n", "bit rows, popcount",
+         count_s * 1000, dense_s / count_s, count_ok ? "yes" : "NO");
+  printf("|-----------------------+--------------+---------+-------|\n");
+  return or_ok && count_ok;
+}
+
+static std::vector<int> floyd_warshall(const std::vector<int> &W, int n) {
+  std::vector<int> D(W);
+  for (int i = 0; i < n; i++)
+    D[(size_t)i * n + i] = std::min(D[(size_t)i * n + i], 0);
+  for (int k = 0; k < n; k++)
+    for (int i = 0; i < n; i++) {
+      const int d_ik = D[(size_t)i * n + k];
+      if (d_ik == gemm::SEMIRING_INF)
+        continue;
+      int *d_i = &D[(size_t)i * n];
+      const int *d_k = &D[(size_t)k * n];
+      for (int j = 0; j < n; j++)
+        d_i[j] = gemm::MinPlus::add(d_i[j], gemm::MinPlus::mul(d_ik, d_k[j]));
+    }
+  return D;
+}
+
+static bool bench_apsp(int n) {
+  std::vector<int> W = random_graph<gemm::MinPlus>(n, 2 * n);
+  Clock::time_point t = Clock::now();
+  std::vector<int> gold = floyd_warshall(W, n);
+  double fw_s = seconds_since(t);
+
+  printf("Graph, %d nodes, %d edges per node\n", n, GRAPH_DEGREE);
+  printf("|-------------------------+-----------+--------------+-------|\n"
+         "| Algorithm               | Squarings |         Time | Match |\n"
+         "|-------------------------+-----------+--------------+-------|\n");
+  printf("| %-23s | %9s | %9.2f ms | %-5s |\n", "Floyd-Warshall", "-",
+         fw_s * 1000, "-");
+  bool match = true;
+  std::vector<int> D((size_t)n * n);
+  const gemm::SemiringIsa paths[] = {gemm::SRISA_SCALAR, gemm::SRISA_AVX2};
+  for (gemm::SemiringIsa requested : paths) {
+    gemm::SemiringIsa isa = gemm::semiring_isa(requested);
+    if (isa != requested)
+      continue;
+    t = Clock::now();
+    int squarings = gemm::apsp_min_plus(W.data(), D.data(), n, isa);
+    double s = seconds_since(t);
+    bool ok = (D == gold);
+    match = match && ok;
+    char name[32];
+    snprintf(name, sizeof(name), "min-plus x2, %s",
+             gemm::semiring_isa_name(isa));
+    printf("| %-23s | %9d | %9.2f ms | %-5s |\n", name, squarings, s * 1000,
+           ok ? "yes" : "NO");
+  }
+
+  gemm::BitMatrix adjacency(n, n), R;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (W[(size_t)i * n + j] != gemm::SEMIRING_INF)
+        adjacency.set(i, j);
+  t = Clock::now();
+  int squarings = gemm::transitive_closure(adjacency, R);
+  double closure_s = seconds_since(t);
+  bool ok = true;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      ok = ok && (R.get(i, j) == (gold[(size_t)i * n + j] !=
+                                  gemm::SEMIRING_INF));
+  match = match && ok;
+  printf("| %-23s | %9d | %9.2f ms | %-5s |\n", "reachability, bit x2",
+         squarings, closure_s * 1000, ok ? "yes" : "NO");
+  printf("|-------------------------+-----------+--------------+-------|\n");
+  return match;
+}
+
+static void report(const char *kernel, bool ok, bool &match) {
+  printf("| %-24s | %-5s |\n", kernel, ok ? "yes" : "NO");
+  match = match && ok;
+}
+
+static bool bench_kernels() {
+  const int np = PARTITION_MAX_SIZE, ns = SYSTOLIC_MAX_SIZE;
+  bool match = true;
+  printf("Kernels\n");
+  printf("|--------------------------+-------|\n"
+         "| Kernel                   | Match |\n"
+         "|--------------------------+-------|\n");
+
+  std::vector<int> A = random_graph<gemm::MinPlus>(ns, 3);
+  std::vector<int> B = random_graph<gemm::MinPlus>(ns, 4);
+  std::vector<int> gold(ns * ns), C(ns * ns);
+  gemm::semiring_matmul<gemm::MinPlus>(A.data(), B.data(), gold.data(), ns,
+                                       ns, ns);
+  mmult_minplus(A.data(), B.data(), C.data(), ns, ns, ns);
+  report("mmult_minplus", C == gold, match);
+  std::vector<int> Ap(A.begin(), A.begin() + np * np);
+  std::vector<int> Bp(B.begin(), B.begin() + np * np);
+  std::vector<int> gold_p(np * np), C_p(np * np);
+  gemm::semiring_matmul<gemm::MinPlus>(Ap.data(), Bp.data(), gold_p.data(),
+                                       np, np, np);
+  matmul_partition_minplus(Ap.data(), Bp.data(), C_p.data(), np);
+  report("matmul_partition_minplus", C_p == gold_p, match);
+
+  A = random_graph<gemm::MaxPlus>(ns, 5);
+  B = random_graph<gemm::MaxPlus>(ns, 6);
+  gemm::semiring_matmul<gemm::MaxPlus>(A.data(), B.data(), gold.data(), ns,
+                                       ns, ns);
+  mmult_maxplus(A.data(), B.data(), C.data(), ns, ns, ns);
+  report("mmult_maxplus", C == gold, match);
+  Ap.assign(A.begin(), A.begin() + np * np);
+  Bp.assign(B.begin(), B.begin() + np * np);
+  gemm::semiring_matmul<gemm::MaxPlus>(Ap.data(), Bp.data(), gold_p.data(),
+                                       np, np, np);
+  matmul_partition_maxplus(Ap.data(), Bp.data(), C_p.data(), np);
+  report("matmul_partition_maxplus", C_p == gold_p, match);
+
+  // Boolean: one word per row or column, 32 and 16 bits of it used
+  std::default_random_engine e(7);
+  std::uniform_int_distribution<int> percent(0, 99);
+  gemm::BitMatrix bA(ns, ns), bB(ns, ns), bC(ns, ns);
+  for (int i = 0; i < ns; i++)
+    for (int j = 0; j < ns; j++) {
+      if (percent(e) < 10)
+        bA.set(i, j);
+      if (percent(e) < 10)
+        bB.set(i, j);
+    }
+  gemm::bool_matmul(bA, bB, bC);
+  gemm::BitMatrix bBT = gemm::bit_transpose(bB);
+  std::vector<unsigned int> rows_a(ns), cols_b(ns), rows_c(ns);
+  for (int i = 0; i < ns; i++) {
+    rows_a[i] = (unsigned int)bA.row(i)[0];
+    cols_b[i] = (unsigned int)bBT.row(i)[0];
+  }
+  mmult_bool(rows_a.data(), cols_b.data(), rows_c.data(), ns, ns, ns);
+  bool ok = true;
+  for (int i = 0; i < ns; i++)
+    ok = ok && (rows_c[i] == (unsigned int)bC.row(i)[0]);
+  report("mmult_bool", ok, match);
+
+  // The leading np x np corner of the same matrices
+  const uint64_t mask = ((uint64_t)1 << np) - 1;
+  gemm::BitMatrix cA(np, np), cB(np, np), cC(np, np);
+  std::vector<int> in1(np), in2(np), out(np);
+  for (int i = 0; i < np; i++) {
+    cA.row(i)[0] = bA.row(i)[0] & mask;
+    cB.row(i)[0] = bB.row(i)[0] & mask;
+    in1[i] = (int)cA.row(i)[0];
+    in2[i] = (int)cB.row(i)[0];
+  }
+  gemm::bool_matmul(cA, cB, cC);
+  matmul_partition_bool(in1.data(), in2.data(), out.data(), np);
+  ok = true;
+  for (int i = 0; i < np; i++)
+    ok = ok && (out[i] == (int)cC.row(i)[0]);
+  report("matmul_partition_bool", ok, match);
+
+  // Shortest paths with the kernel as the product
+  std::vector<int> W = random_graph<gemm::MinPlus>(ns, 8), D(ns * ns);
+  gemm::MinPlusProduct kernel = [](const int *a, const int *b, int *c,
+                                   int n) { mmult_minplus(a, b, c, n, n, n); };
+  gemm::apsp_min_plus(W.data(), D.data(), ns, kernel);
+  report("APSP on mmult_minplus", D == floyd_warshall(W, ns), match);
+  printf("|--------------------------+-------|\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 512;
+  bool match = bench_engine(n);
+  match = bench_bool(2 * n) && match;
+  match = bench_apsp(n) && match;
+  match = bench_kernels() && match;
+  match = bench_saturation() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,206 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+/*  Sparse times dense benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Multiplies a size x size A of decreasing density by a dense B with the
+dense CPU engine, with the CSR engine of common/includes/gemm/sparse_gemm.hpp
+(conversion timed apart) and with gemm::sparse_matmul(), which picks one of
+the two from the density of A, and checks that the results are identical.
+The header shows the crossover gemm::sparse_calibrate() measures on this
+host next to the default threshold.
+Then runs mmult and mmult_block_sparse of loop_reorder, compiled for the
+host, on a 64 x 64 A with a growing share of empty 8 x 8 tiles, and reports
+the bytes of A each reads.
+Usage: ./sparse_bench [size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "sparse_gemm.hpp"
+#include "stand_in_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Kernel calls timed per measurement of the block-sparse kernel
+const int KERNEL_REPEATS = 200;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static const double DENSITIES[] = {1.0, 0.9, 0.8, 0.7, 0.5,  0.3,
+                                   0.2, 0.1, 0.05, 0.01, 0.001};
+static const double EMPTY_TILES[] = {0.0, 0.5, 0.75, 0.9, 0.97};
+
+static bool bench_cpu(int n) {
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> value(-100, 100);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<int> A((size_t)n * n), B((size_t)n * n);
+  std::vector<int> gold((size_t)n * n), C((size_t)n * n);
+  for (size_t i = 0; i < B.size(); i++)
+    B[i] = value(e);
+
+  printf("CPU, %d x %d, %u threads, density threshold %g, calibrated %g\n",
+         n, n, gemm::ThreadPool::global().size(),
+         gemm::SPARSE_DENSITY_THRESHOLD, gemm::sparse_calibrate());
+  printf("|---------+------------+------------+------------+-------+"
+         "------------+---------+-------|\n"
+         "| Density |      Dense |     To CSR |   CSR SpMM | Auto  |"
+         "  Auto time | Speedup | Match |\n"
+         "|---------+------------+------------+------------+-------+"
+         "------------+---------+-------|\n");
+  bool match = true;
+  for (double d : DENSITIES) {
+    for (size_t i = 0; i < A.size(); i++)
+      A[i] = (unit(e) < d) ? value(e) | 1 : 0;
+
+    Clock::time_point t = Clock::now();
+    gemm::cpu_matmul(A.data(), B.data(), gold.data(), n, n, n);
+    double dense_s = seconds_since(t);
+
+    t = Clock::now();
+    gemm::CsrMatrix csr = gemm::csr_from_dense(A.data(), n, n);
+    double convert_s = seconds_since(t);
+    t = Clock::now();
+    gemm::csr_matmul(csr, B.data(), C.data(), n);
+    double csr_s = seconds_since(t);
+    bool ok = (C == gold);
+
+    t = Clock::now();
+    gemm::SparsePath path =
+        gemm::sparse_matmul(A.data(), B.data(), C.data(), n, n, n);
+    double auto_s = seconds_since(t);
+    ok = ok && (C == gold);
+    match = match && ok;
+
+    printf("| %6.1f%% | %7.2f ms | %7.2f ms | %7.2f ms | %-5s | %7.2f ms |"
+           " %6.2fx | %-5s |\n",
+           d * 100, dense_s * 1000, convert_s * 1000, csr_s * 1000,
+           gemm::sparse_path_name(path), auto_s * 1000, dense_s / auto_s,
+           ok ? "yes" : "NO");
+  }
+  printf("|---------+------------+------------+------------+-------+"
+         "------------+---------+-------|\n");
+  return match;
+}
+
+static double time_kernel(void (*call)(void *), void *arg) {
+  Clock::time_point t = Clock::now();
+  for (int r = 0; r < KERNEL_REPEATS; r++)
+    call(arg);
+  return seconds_since(t) / KERNEL_REPEATS;
+}
+
+struct KernelArgs {
+  const int *a, *b, *tiles;
+  const unsigned int *occupancy;
+  int *c;
+  int n;
+};
+
+static void call_dense(void *p) {
+  KernelArgs *k = (KernelArgs *)p;
+  mmult_loop_reorder(k->a, k->b, k->c, k->n);
+}
+
+static void call_sparse(void *p) {
+  KernelArgs *k = (KernelArgs *)p;
+  mmult_block_sparse(k->tiles, k->b, k->c, k->occupancy, k->n);
+}
+
+static bool bench_kernel() {
+  const int n = LOOP_REORDER_MAX_SIZE;
+  const int tile = BLOCK_SPARSE_TILE;
+  const int tiles = n / tile;
+  std::default_random_engine e(n);
+  std::uniform_int_distribution<int> value(1, 10);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<int> A(n * n), B(n * n), gold(n * n), C(n * n);
+  for (size_t i = 0; i < B.size(); i++)
+    B[i] = value(e);
+
+  printf("Kernels, %d x %d, %d x %d tiles\n", n, n, tile, tile);
+  printf("|-------------+-------+------------+------------+------------+"
+         "--------------+---------+-------|\n"
+         "| Empty tiles | Tiles |    A bytes |      mmult |    A bytes |"
+         " block_sparse | Speedup | Match |\n"
+         "|-------------+-------+------------+------------+------------+"
+         "--------------+---------+-------|\n");
+  bool match = true;
+  for (double empty : EMPTY_TILES) {
+    for (int tr = 0; tr < tiles; tr++)
+      for (int tc = 0; tc < tiles; tc++) {
+        bool keep = unit(e) >= empty;
+        for (int i = tr * tile; i < (tr + 1) * tile; i++)
+          for (int k = tc * tile; k < (tc + 1) * tile; k++)
+            A[i * n + k] = keep ? value(e) : 0;
+      }
+    gemm::BlockSparseMatrix bs =
+        gemm::block_sparse_from_dense(A.data(), n, n, tile);
+
+    KernelArgs args = {A.data(), B.data(), bs.tiles.data(),
+                       bs.occupancy.data(), gold.data(), n};
+    double dense_s = time_kernel(call_dense, &args);
+    args.c = C.data();
+    double sparse_s = time_kernel(call_sparse, &args);
+    bool ok = (C == gold);
+    match = match && ok;
+
+    size_t sparse_bytes = (bs.tiles.size() + bs.occupancy.size()) * 4;
+    printf("| %10.0f%% | %5d | %8zu B | %7.2f us | %8zu B | %9.2f us |"
+           " %6.2fx | %-5s |\n",
+           empty * 100, bs.tile_count(), A.size() * sizeof(int),
+           dense_s * 1e6, sparse_bytes, sparse_s * 1e6, dense_s / sparse_s,
+           ok ? "yes" : "NO");
+  }
+  printf("|-------------+-------+------------+------------+------------+"
+         "--------------+---------+-------|\n");
+  return match;
+}
+
+int main(int argc, char **argv) {
+  int n = (argc > 1) ? atoi(argv[1]) : 1024;
+  bool match = bench_cpu(n);
+  match = bench_kernel() && match;
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,162 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+// Kernels of the other examples compiled for the host, used as stand-ins for
+// the device by the benchmarks in this directory. The three kernels named
+// mmult are renamed at compile time (see Makefile) so they can be linked
+// into one executable.
+#pragma once
+
+extern "C" {
+// array_partition, square matrices up to 16 x 16
+void matmul_partition(int *in1, int *in2, int *out_r, int size);
+// systolic_array, up to 32 x 32
+void mmult_systolic(const int *a, const int *b, int *c, int a_row, int a_col,
+                    int b_col);
+// loop_reorder, square matrices up to 64 x 64
+void mmult_loop_reorder(const int *in1, const int *in2, int *out_r,
+                        int size);
+// large_matrix_mult, one row of a 1024-wide product against transposed B
+void lmult(int *c, int *a, int *b);
+
+// The same kernels on operands packed along K, four int8 or two int16 per
+// word (see common/includes/gemm/quant_gemm.hpp): in1 holds A packed by rows,
+// in2 B packed by columns, and lmult takes the row of A and the transposed B
+// both packed by rows. mmult_int8 and mmult_int16 come from loop_reorder.
+void matmul_partition_int8(int *in1, int *in2, int *out_r, int size);
+void matmul_partition_int16(int *in1, int *in2, int *out_r, int size);
+void mmult_int8(const int *in1, const int *in2, int *out_r, int size);
+void mmult_int16(const int *in1, const int *in2, int *out_r, int size);
+void lmult_int8(int *c, int *a, int *b);
+void lmult_int16(int *c, int *a, int *b);
+
+// The same kernels on fp32, bf16 and fp16 operands with fp32 accumulation
+// and results. bf16 and fp16 are raw bit patterns, as in
+// common/includes/gemm/float_gemm.hpp.
+void matmul_partition_fp32(float *in1, float *in2, float *out_r, int size);
+void matmul_partition_bf16(unsigned short *in1, unsigned short *in2,
+                           float *out_r, int size);
+void matmul_partition_fp16(unsigned short *in1, unsigned short *in2,
+                           float *out_r, int size);
+void mmult_fp32(const float *in1, const float *in2, float *out_r, int size);
+void mmult_bf16(const unsigned short *in1, const unsigned short *in2,
+                float *out_r, int size);
+void mmult_fp16(const unsigned short *in1, const unsigned short *in2,
+                float *out_r, int size);
+void lmult_fp32(float *c, float *a, float *b);
+void lmult_bf16(float *c, unsigned short *a, unsigned short *b);
+void lmult_fp16(float *c, unsigned short *a, unsigned short *b);
+// The systolic ones, renamed like mmult_systolic, up to 16 x 16
+void mmult_systolic_fp32(const float *a, const float *b, float *c, int a_row,
+                         int a_col, int b_col);
+void mmult_systolic_bf16(const unsigned short *a, const unsigned short *b,
+                         float *c, int a_row, int a_col, int b_col);
+void mmult_systolic_fp16(const unsigned short *a, const unsigned short *b,
+                         float *c, int a_row, int a_col, int b_col);
+
+// matmul_partition, mmult of loop_reorder and the systolic mmult (renamed
+// like mmult_systolic) on bit-packed operands (see
+// common/includes/gemm/bitpack.hpp), int32 result
+void matmul_partition_bitpack(int *in1, int *in2, int *out_r, int size,
+                              int width1, int base1, int width2, int base2);
+void mmult_bitpack(const int *in1, const int *in2, int *out_r, int size,
+                   int width1, int base1, int width2, int base2);
+void mmult_systolic_bitpack(const int *a, const int *b, int *c, int a_row,
+                            int a_col, int b_col, int width1, int base1,
+                            int width2, int base2);
+
+// matmul_partition and the systolic mmult over a batch of independent
+// problems in one call, placed by element strides or by a table of element
+// offsets (see common/includes/xcl2/gemm_batch.hpp)
+void matmul_partition_batch(int *in1, int *in2, int *out_r, int size,
+                            int batch, int stride1, int stride2,
+                            int stride_out);
+void matmul_partition_batch_ptr(int *in1, int *in2, int *out_r,
+                                const int *offsets, int size, int batch);
+void mmult_batch(const int *a, const int *b, int *c, int a_row, int a_col,
+                 int b_col, int batch, int stride_a, int stride_b,
+                 int stride_c);
+void mmult_batch_ptr(const int *a, const int *b, int *c, const int *offsets,
+                     int a_row, int a_col, int b_col, int batch);
+
+// mmult of loop_reorder on block-sparse A: the occupied 8 x 8 tiles of A and
+// their occupancy bitmap (see common/includes/gemm/sparse_gemm.hpp)
+void mmult_block_sparse(const int *in1, const int *in2, int *out_r,
+                        const unsigned int *occupancy, int size);
+
+// matmul_partition and the systolic mmult over the (min, +) and (max, +)
+// semirings, SEMIRING_INF for no path (see
+// common/includes/gemm/semiring_gemm.hpp), and over (OR, AND) on bit rows:
+// matmul_partition_bool takes the rows of A and B, mmult_bool the rows of A
+// and the columns of B, one word each
+void matmul_partition_minplus(int *in1, int *in2, int *out_r, int size);
+void matmul_partition_maxplus(int *in1, int *in2, int *out_r, int size);
+void matmul_partition_bool(int *in1, int *in2, int *out_r, int size);
+void mmult_minplus(const int *a, const int *b, int *c, int a_row, int a_col,
+                   int b_col);
+void mmult_maxplus(const int *a, const int *b, int *c, int a_row, int a_col,
+                   int b_col);
+void mmult_bool(const unsigned int *a, const unsigned int *b, unsigned int *c,
+                int a_row, int a_col, int b_col);
+
+// matmul_partition over GF(2) on bit rows of up to 512 columns, one row512
+// per row of A, B and C, column j in bit j % 32 of word j / 32
+struct row512 {
+  unsigned int word[16];
+};
+void matmul_partition_gf2(const row512 *in1, const row512 *in2,
+                          row512 *out_r, int size);
+
+// matmul_partition, the systolic mmult and lmult with an epilogue fused into
+// writeC: C = alpha * A * B + beta * C, then by flags bias, ReLU and int8
+// requantization (see common/includes/gemm/epilogue.hpp)
+void matmul_partition_epilogue(int *in1, int *in2, int *out_r,
+                               const int *bias, int size, int alpha, int beta,
+                               int flags, int shift);
+void mmult_epilogue(const int *a, const int *b, int *c, const int *bias,
+                    int a_row, int a_col, int b_col, int alpha, int beta,
+                    int flags, int shift);
+void lmult_epilogue(int *c, int *a, int *b, const int *bias, int alpha,
+                    int beta, int flags, int shift);
+}
+
+// Fixed sizes of the kernels above
+const int PARTITION_MAX_SIZE = 16;
+const int SYSTOLIC_MAX_SIZE = 32;
+const int SYSTOLIC_FLOAT_MAX_SIZE = 16;
+const int LOOP_REORDER_MAX_SIZE = 64;
+const int BLOCK_SPARSE_TILE = 8;
+const int GF2_MAX_SIZE = 512;
+const int LMULT_SIZE = 1024;
@@ -0,0 +1,157 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Strassen-Winograd benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Compares gemm::strassen_matmul() with the classical blocked CPU engine on
+square int32 problems at several crossovers, checking that the results are
+identical. Then runs the same recursion with the lmult kernel compiled for
+the host as the leaf, against tiling the whole problem with lmult.
+Usage: ./strassen_bench [largest size]
+*/
+
+#include "cpu_gemm.hpp"
+#include "stand_in_kernels.h"
+#include "strassen.hpp"
+#include "tiled_gemm.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// Small values keep every intermediate sum inside int32, so the classical
+// kernel's signed arithmetic is well defined
+static std::vector<int> random_matrix(int n, unsigned seed) {
+  std::vector<int> m((size_t)n * n);
+  std::default_random_engine e(seed);
+  std::uniform_int_distribution<int> d(-64, 64);
+  for (size_t i = 0; i < m.size(); i++)
+    m[i] = d(e);
+  return m;
+}
+
+static void lmult_tile(const int *a, const int *b, int *c, int tile) {
+  std::vector<int> tb((size_t)tile * tile);
+  for (int r = 0; r < tile; r++)
+    for (int col = 0; col < tile; col++)
+      tb[(size_t)col * tile + r] = b[(size_t)r * tile + col];
+  for (int r = 0; r < tile; r++)
+    lmult(c + (size_t)r * tile, const_cast<int *>(a) + (size_t)r * tile,
+          tb.data());
+}
+
+int main(int argc, char **argv) {
+  int largest = argc > 1 ? atoi(argv[1]) : 2048;
+  if (largest < 256) {
+    printf("Usage: %s [largest size >= 256]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  bool match = true;
+  gemm::StrassenLeaf cpu = gemm::cpu_leaf();
+
+  printf("|-------+-----------+-------------+-------------+----------+-----------|\n"
+         "|  Size | Crossover |   Classical |    Strassen |  Speedup | Workspace |\n"
+         "|-------+-----------+-------------+-------------+----------+-----------|\n");
+  for (int n = 512; n <= largest; n *= 2) {
+    // One odd size per run exercises the peeling
+    int sizes[2] = {n, n + 1};
+    for (int s = 0; s < (n == 512 ? 2 : 1); s++) {
+      int size = sizes[s];
+      std::vector<int> A = random_matrix(size, 1), B = random_matrix(size, 2);
+      std::vector<int> gold((size_t)size * size), C((size_t)size * size);
+      Clock::time_point t = Clock::now();
+      gemm::cpu_matmul(A.data(), B.data(), gold.data(), size, size, size);
+      double classical_s = seconds_since(t);
+      double gops = 2.0 * size * size * size * 1e-9;
+
+      for (int crossover = 128; crossover <= 512; crossover *= 2) {
+        if (crossover >= size)
+          continue;
+        std::vector<int> work(gemm::strassen_workspace(size, crossover) + 1);
+        memset(C.data(), 0, C.size() * sizeof(int));
+        t = Clock::now();
+        gemm::strassen_matmul(A.data(), B.data(), C.data(), size, crossover,
+                              cpu, work.data());
+        double strassen_s = seconds_since(t);
+        bool same = C == gold;
+        match = match && same;
+        printf("| %5d | %9d | %6.2f GOPS | %6.2f GOPS | %7.2fx | %6.1f MB |%s\n",
+               size, crossover, gops / classical_s, gops / strassen_s,
+               classical_s / strassen_s, work.size() * 4 / 1e6,
+               same ? "" : " MISMATCH");
+      }
+    }
+  }
+  printf("|-------+-----------+-------------+-------------+----------+-----------|\n");
+
+  // lmult leaves: seven 1024 x 1024 tile products instead of eight
+  int n = 2 * LMULT_SIZE;
+  std::vector<int> A = random_matrix(n, 3), B = random_matrix(n, 4);
+  std::vector<int> gold((size_t)n * n), C((size_t)n * n);
+  Clock::time_point t = Clock::now();
+  gemm::tiled_matmul(A.data(), B.data(), gold.data(), n, n, n, LMULT_SIZE, 1,
+                     lmult_tile);
+  double tiled_s = seconds_since(t);
+  int leaves = 0;
+  gemm::StrassenLeaf lmult_leaf =
+      gemm::tiled_leaf(LMULT_SIZE, 1, lmult_tile);
+  gemm::StrassenLeaf counted = [&](const int *a, int lda, const int *b,
+                                   int ldb, int *c, int ldc, int size) {
+    leaves++;
+    lmult_leaf(a, lda, b, ldb, c, ldc, size);
+  };
+  t = Clock::now();
+  gemm::strassen_matmul(A.data(), B.data(), C.data(), n, LMULT_SIZE, counted);
+  double strassen_s = seconds_since(t);
+  bool same = C == gold;
+  match = match && same;
+  printf("%d x %d with lmult tiles: %d tile products in %.2f s, Strassen %d "
+         "leaves in %.2f s (%.2fx)%s\n",
+         n, n, 8, tiled_s, leaves, strassen_s, tiled_s / strassen_s,
+         same ? "" : " MISMATCH");
+
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,184 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  xclbin loading benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Loads a file of xclbin size the two ways common/includes/xcl2 offers: copied
+into a heap buffer, as the deprecated xcl::read_binary_file() does, and
+mapped with xcl::MappedFile, as xcl::map_binary_file() does, with and
+without MAP_POPULATE. Each load runs in a child process that then reads
+every byte, as clCreateProgramWithBinary does, so that its peak resident set
+(ru_maxrss) covers one load only. Reports the load time, the load plus read
+time and the peak RSS above that of an idle child, and checks the bytes.
+The file is read once before, so every path finds it in the page cache as
+it is right after a build.
+Usage: ./xclbin_load_bench [size in MB]
+*/
+
+#include "mapped_file.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *FILE_NAME = "xclbin_load_bench.tmp";
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+enum Path { PATH_IDLE, PATH_COPY, PATH_MAP, PATH_POPULATE };
+
+// What a child sends back through its pipe
+struct Report {
+  double load_s;
+  double total_s;
+  uint64_t sum;
+};
+
+static uint64_t checksum(const unsigned char *data, size_t n) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i += 64)
+    sum = sum * 31 + data[i];
+  return sum;
+}
+
+static Report load(Path path) {
+  Report r = {0, 0, 0};
+  Clock::time_point t = Clock::now();
+  if (path == PATH_COPY) {
+    std::vector<unsigned char> buf = xcl::read_file(FILE_NAME);
+    r.load_s = seconds_since(t);
+    r.sum = checksum(buf.data(), buf.size());
+  } else if (path != PATH_IDLE) {
+    int hints = xcl::MappedFile::Sequential;
+    if (path == PATH_POPULATE)
+      hints |= xcl::MappedFile::Populate;
+    xcl::MappedFile file(FILE_NAME, hints);
+    r.load_s = seconds_since(t);
+    r.sum = checksum(file.data(), file.size());
+  }
+  r.total_s = seconds_since(t);
+  return r;
+}
+
+// Runs load(path) in a child; returns its report and peak RSS in KB
+static Report run_child(Path path, long &maxrss_kb) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    exit(EXIT_FAILURE);
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Report r = load(path);
+    ssize_t n = write(fds[1], &r, sizeof(r));
+    _exit(n == (ssize_t)sizeof(r) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  close(fds[1]);
+  Report r = {0, 0, 0};
+  if (read(fds[0], &r, sizeof(r)) != (ssize_t)sizeof(r))
+    r.sum = ~(uint64_t)0;
+  close(fds[0]);
+  int status;
+  struct rusage usage;
+  wait4(pid, &status, 0, &usage);
+  maxrss_kb = usage.ru_maxrss;
+  return r;
+}
+
+int main(int argc, char **argv) {
+  size_t mb = (argc > 1) ? atoi(argv[1]) : 64;
+  size_t size = mb << 20;
+
+  // Written in chunks, so that the parent stays small before the forks
+  {
+    FILE *f = fopen(FILE_NAME, "wb");
+    if (!f) {
+      perror(FILE_NAME);
+      return EXIT_FAILURE;
+    }
+    std::vector<unsigned char> chunk(1 << 20);
+    uint32_t x = 12345;
+    for (size_t done = 0; done < size; done += chunk.size()) {
+      for (size_t i = 0; i < chunk.size(); i++) {
+        x = x * 1103515245 + 12345;
+        chunk[i] = (unsigned char)(x >> 24);
+      }
+      fwrite(chunk.data(), 1, chunk.size(), f);
+    }
+    fclose(f);
+  }
+  long idle_kb;
+  run_child(PATH_IDLE, idle_kb);
+  long warm_kb;
+  uint64_t gold = run_child(PATH_COPY, warm_kb).sum;
+
+  const Path paths[] = {PATH_COPY, PATH_MAP, PATH_POPULATE};
+  const char *names[] = {"copy (read_binary_file)", "map (map_binary_file)",
+                         "map, MAP_POPULATE"};
+  bool match = true;
+  printf("xclbin of %zu MB, idle child %ld KB resident\n", mb, idle_kb);
+  printf("|-------------------------+------------+-------------+"
+         "-------------+-------|\n"
+         "| Path                    |       Load | Load + read |"
+         "  Peak RSS + | Match |\n"
+         "|-------------------------+------------+-------------+"
+         "-------------+-------|\n");
+  for (int p = 0; p < 3; p++) {
+    long kb;
+    Report r = run_child(paths[p], kb);
+    bool ok = (r.sum == gold);
+    match = match && ok;
+    printf("| %-23s | %7.2f ms | %8.2f ms | %8.1f MB | %-5s |\n", names[p],
+           r.load_s * 1000, r.total_s * 1000, (kb - idle_kb) / 1024.0,
+           ok ? "yes" : "NO");
+  }
+  printf("|-------------------------+------------+-------------+"
+         "-------------+-------|\n");
+  remove(FILE_NAME);
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  CPU + device co-execution benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Compares the throughput of one 1024x1024 multiplication computed by
+  - the multithreaded CPU engine alone,
+  - the device alone,
+  - both at once, with the rows of C split by gemm::SplitScheduler.
+No xclbin is needed: the lmult kernel source is compiled for the host and
+called row by row on a dedicated thread as a stand-in for the device.
+Build and run with "make bench".
+*/
+
+#include "coexec.hpp"
+#include "cpu_gemm.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+extern "C" void lmult(int *c, int *a, int *b);
+
+// Must match BUFFER_SIZE in large_mult.cpp
+const int columns = 1024;
+const int rows = 1024;
+const int ARRAY_SIZE = rows * columns;
+const int COEXEC_ROUND_ROWS = 64;
+
+typedef std::chrono::steady_clock Clock;
+
+int gen_random() {
+  static std::default_random_engine e;
+  static std::uniform_int_distribution<int> dist(0, 10);
+
+  return dist(e);
+}
+
+void transpose(int *transpose, int *original) {
+  for (int r = 0; r < columns; r++) {
+    for (int c = 0; c < columns; c++) {
+      transpose[c * columns + r] = original[r * columns + c];
+    }
+  }
+}
+
+void verify(const std::vector<int> &gold, const std::vector<int> &output,
+            const char *name) {
+  for (int i = 0; i < ARRAY_SIZE; i++) {
+    if (output[i] != gold[i]) {
+      printf("Mismatch (%s) %d: gold: %d result: %d\n", name, i, gold[i],
+             output[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void print_row(const char *name, double seconds) {
+  double gops = 2.0 * rows * columns * columns / seconds * 1.0e-9;
+  printf("| %-23s | %11f ms | %9f GOPS |\n", name, seconds * 1000, gops);
+}
+
+int main() {
+  std::vector<int> A(ARRAY_SIZE), B(ARRAY_SIZE), tB(ARRAY_SIZE);
+  std::vector<int> gold(ARRAY_SIZE), C(ARRAY_SIZE);
+  for (int i = 0; i < ARRAY_SIZE; i++) {
+    A[i] = gen_random();
+    B[i] = gen_random();
+  }
+  transpose(tB.data(), B.data());
+
+  gemm::RowEngine cpu_engine = [&](int row_begin, int row_end) {
+    gemm::cpu_matmul_rows(A.data(), B.data(), C.data(), row_begin, row_end,
+                          columns, columns);
+  };
+  // One kernel call computes one row of C from one row of A and all of tB
+  gemm::RowEngine device_engine = [&](int row_begin, int row_end) {
+    for (int r = row_begin; r < row_end; r++)
+      lmult(&C[r * columns], &A[r * columns], tB.data());
+  };
+
+  // CPU engine alone; its result is the reference for the other two runs
+  Clock::time_point t = Clock::now();
+  cpu_engine(0, rows);
+  double cpu_s = std::chrono::duration<double>(Clock::now() - t).count();
+  gold = C;
+
+  // Stand-in device alone
+  std::fill(C.begin(), C.end(), 0);
+  t = Clock::now();
+  device_engine(0, rows);
+  double device_s = std::chrono::duration<double>(Clock::now() - t).count();
+  verify(gold, C, "device");
+
+  // Both, split adaptively per round
+  std::fill(C.begin(), C.end(), 0);
+  gemm::SplitScheduler scheduler;
+  gemm::CoexecStats stats = gemm::coexecute(rows, COEXEC_ROUND_ROWS,
+                                            cpu_engine, device_engine,
+                                            scheduler);
+  verify(gold, C, "co-execution");
+
+  printf("|-------------------------+----------------+----------------|\n"
+         "| Engine                  |      Wall time |     Throughput |\n"
+         "|-------------------------+----------------+----------------|\n");
+  print_row("CPU engine", cpu_s);
+  print_row("Stand-in device", device_s);
+  print_row("CPU + device", stats.total_s);
+  printf("|-------------------------+----------------+----------------|\n");
+  printf("Threads: %u, rounds: %d, rows CPU/device: %d/%d, "
+         "final device share: %f\n",
+         gemm::ThreadPool::global().size(), stats.rounds, stats.cpu_rows,
+         stats.device_rows, stats.device_share);
+  printf("TEST PASSED\n");
+  return EXIT_SUCCESS;
+}
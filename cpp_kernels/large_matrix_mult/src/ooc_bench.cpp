@@ -0,0 +1,166 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Out-of-core GEMM benchmark
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Writes A (M x K, row-major) and B (K x N, column-major) as matrix files,
+multiplies them with out_of_core_matmul() into a C file and checks the
+result: the C checksum, plus sampled elements against dot products of the
+mapped inputs. Runs the CPU engine with pread(), O_DIRECT and mmap input,
+and the lmult kernel compiled for the host as a stand-in for the device
+(needs K = 1024 and N a multiple of 1024).
+Usage: ./ooc_bench [M N K] [directory for the matrix files]
+*/
+
+#include "cpu_gemm.hpp"
+#include "matrix_file.hpp"
+#include "out_of_core.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+extern "C" void lmult(int *c, int *a, int *b);
+
+// Must match BUFFER_SIZE in large_mult.cpp
+const int LMULT_SIZE = 1024;
+const int SAMPLES = 4096;
+
+int gen_random() {
+  static std::default_random_engine e;
+  static std::uniform_int_distribution<int> dist(0, 10);
+
+  return dist(e);
+}
+
+// lmult computes one row of C against 1024 columns of B; rows of the tile
+// are spread over the pool like compute units of a device
+static void lmult_engine(const int *a, const int *b, int *c, int ldc,
+                         int rows, int, int K) {
+  gemm::ThreadPool::global().parallel_for(0, rows, 1, [=](int first,
+                                                          int last) {
+    for (int r = first; r < last; r++)
+      lmult(c + (size_t)r * ldc, const_cast<int *>(a) + (size_t)r * K,
+            const_cast<int *>(b));
+  });
+}
+
+static bool check(const std::string &a_file, const std::string &b_file,
+                  const std::string &c_file) {
+  xcl::MatrixFile A = xcl::MatrixFile::open(a_file, false);
+  xcl::MatrixFile B = xcl::MatrixFile::open(b_file, false);
+  // Verifies the checksum written by the out-of-core driver
+  xcl::MatrixFile C = xcl::MatrixFile::open(c_file);
+  int M = A.rows(), K = A.cols(), N = B.cols();
+  std::default_random_engine e(7);
+  for (int s = 0; s < SAMPLES; s++) {
+    int r = e() % M, col = e() % N;
+    const int *a = A.data<int>() + (size_t)r * K;
+    const int *b = B.data<int>() + (size_t)col * K;
+    int sum = 0;
+    for (int k = 0; k < K; k++)
+      sum += a[k] * b[k];
+    int got = C.data<int>()[(size_t)r * N + col];
+    if (got != sum) {
+      printf("Mismatch C[%d][%d]: gold: %d result: %d\n", r, col, sum, got);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int M = 4096, N = 2048, K = 1024;
+  if (argc >= 4) {
+    M = atoi(argv[1]);
+    N = atoi(argv[2]);
+    K = atoi(argv[3]);
+  }
+  std::string dir = argc == 2 ? argv[1] : argc >= 5 ? argv[4] : ".";
+  if (M <= 0 || N <= 0 || K <= 0) {
+    printf("Usage: %s [M N K] [directory]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::string a_file = dir + "/ooc_A.xmat", b_file = dir + "/ooc_B.xmat";
+  std::string c_file = dir + "/ooc_C.xmat";
+
+  printf("Writing %d x %d A and %d x %d B to %s\n", M, K, K, N, dir.c_str());
+  write_ooc_inputs(a_file, b_file, M, N, K, gen_random);
+
+  struct Case {
+    const char *name;
+    bool direct, map, lmult;
+  };
+  const Case cases[] = {{"CPU, pread", false, false, false},
+                        {"CPU, O_DIRECT", true, false, false},
+                        {"CPU, mmap", false, true, false},
+                        {"lmult stand-in, pread", false, false, true}};
+  bool lmult_fits = K == LMULT_SIZE && N % LMULT_SIZE == 0;
+
+  // Read and write bandwidths are over the busy time of the reader and the
+  // writer thread, throughput is over the whole run
+  printf("|-------------------------+-------------+-------------+--------------+---------+----------|\n"
+         "| Engine, input           |        Read |       Write |   Throughput |   Total |  Buffers |\n"
+         "|-------------------------+-------------+-------------+--------------+---------+----------|\n");
+  bool match = true;
+  for (const Case &c : cases) {
+    if (c.lmult && !lmult_fits)
+      continue;
+    OutOfCoreConfig config;
+    config.direct_io = c.direct;
+    config.use_mmap = c.map;
+    if (c.lmult)
+      config.panel_cols = LMULT_SIZE;
+    PanelEngine engine = c.lmult ? PanelEngine(lmult_engine) : cpu_panel_engine();
+    OutOfCoreStats s = out_of_core_matmul(a_file, b_file, c_file, config,
+                                          engine);
+    printf("| %-23s | %6.2f GB/s | %6.2f GB/s | %7.2f GOPS | %5.2f s | %5.1f MB |\n",
+           c.name, s.bytes_read / std::max(s.read_s, 1e-9) * 1e-9,
+           s.bytes_written / std::max(s.write_s, 1e-9) * 1e-9,
+           s.ops / s.total_s * 1e-9, s.total_s,
+           s.buffer_bytes / (1024.0 * 1024.0));
+    match = match && check(a_file, b_file, c_file);
+  }
+  printf("|-------------------------+-------------+-------------+--------------+---------+----------|\n");
+  remove(a_file.c_str());
+  remove(b_file.c_str());
+  remove(c_file.c_str());
+
+  printf("TEST %s\n", (match ? "PASSED" : "FAILED"));
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
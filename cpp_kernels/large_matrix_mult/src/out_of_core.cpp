@@ -0,0 +1,349 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#include "out_of_core.h"
+#include "aligned_allocator.hpp"
+#include "cpu_gemm.hpp"
+#include "matrix_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static void io_fail(const std::string &file_name, const char *what) {
+  printf("ERROR: %s: %s\n", file_name.c_str(), what);
+  exit(EXIT_FAILURE);
+}
+
+// Single producer, single consumer ring of equally sized page aligned
+// buffers. The producer fills the buffer from acquire() and hands it over
+// with push(); the consumer reads front() and gives it back with pop().
+// With mmap'd inputs the slots only hold pointers into the mapping.
+class PanelRing {
+public:
+  PanelRing(size_t slots, size_t bytes, bool allocate)
+      : m_ptrs(slots, nullptr), m_owned(allocate), m_bytes(bytes), m_head(0),
+        m_tail(0) {
+    if (allocate)
+      for (size_t i = 0; i < slots; i++)
+        m_ptrs[i] = (int *)xcl::PageAligned::allocate(bytes);
+  }
+  ~PanelRing() {
+    if (m_owned)
+      for (size_t i = 0; i < m_ptrs.size(); i++)
+        xcl::PageAligned::deallocate(m_ptrs[i], m_bytes);
+  }
+
+  size_t held_bytes() const { return m_owned ? m_ptrs.size() * m_bytes : 0; }
+
+  int *&acquire() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_head - m_tail < m_ptrs.size(); });
+    return m_ptrs[m_head % m_ptrs.size()];
+  }
+  void push() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_head++;
+    m_cv.notify_all();
+  }
+  int *front() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_head > m_tail; });
+    return m_ptrs[m_tail % m_ptrs.size()];
+  }
+  void pop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tail++;
+    m_cv.notify_all();
+  }
+
+private:
+  std::vector<int *> m_ptrs;
+  bool m_owned;
+  size_t m_bytes;
+  size_t m_head, m_tail;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+};
+
+// Read side of one input file: pread(), optionally through an O_DIRECT
+// descriptor, or a private read-only mapping
+class PanelSource {
+public:
+  PanelSource(const std::string &file_name, const OutOfCoreConfig &config)
+      : m_name(file_name), m_fd(-1), m_direct_fd(-1), m_map(nullptr),
+        m_map_bytes(0) {
+    m_fd = open(file_name.c_str(), O_RDONLY);
+    if (m_fd < 0)
+      io_fail(file_name, "cannot open matrix file");
+    struct stat st;
+    fstat(m_fd, &st);
+    if (config.use_mmap) {
+      m_map_bytes = st.st_size;
+      void *ptr = mmap(NULL, m_map_bytes, PROT_READ, MAP_PRIVATE, m_fd, 0);
+      if (ptr == MAP_FAILED)
+        io_fail(file_name, "cannot map matrix file");
+      m_map = (char *)ptr;
+      return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#ifdef O_DIRECT
+    if (config.direct_io) {
+      m_direct_fd = open(file_name.c_str(), O_RDONLY | O_DIRECT);
+      if (m_direct_fd < 0)
+        printf("WARNING: %s: O_DIRECT not supported, using buffered reads\n",
+               file_name.c_str());
+    }
+#endif
+  }
+  ~PanelSource() {
+    if (m_map)
+      munmap(m_map, m_map_bytes);
+    if (m_direct_fd >= 0)
+      close(m_direct_fd);
+    close(m_fd);
+  }
+
+  // Makes [offset, offset + bytes) of the file available at *dst. Copies
+  // into the slot buffer, or points the slot into the mapping and starts
+  // read-ahead on it.
+  void read(int *&dst, size_t offset, size_t bytes) {
+    if (m_map) {
+      dst = (int *)(m_map + offset);
+      madvise(m_map + (offset & ~(size_t)4095), bytes + (offset & 4095),
+              MADV_WILLNEED);
+      return;
+    }
+    // O_DIRECT needs page aligned offsets and lengths; tails go buffered
+    bool direct = m_direct_fd >= 0 && offset % 4096 == 0;
+    size_t direct_bytes = direct ? bytes / 4096 * 4096 : 0;
+    read_range(direct ? m_direct_fd : m_fd, (char *)dst, offset, direct_bytes);
+    read_range(m_fd, (char *)dst + direct_bytes, offset + direct_bytes,
+               bytes - direct_bytes);
+  }
+
+  // Drops the pages of a consumed panel from a mapping
+  void release(const int *src, size_t bytes) {
+    if (!m_map)
+      return;
+    size_t offset = (const char *)src - m_map;
+    size_t begin = (offset + 4095) & ~(size_t)4095;
+    size_t end = (offset + bytes) & ~(size_t)4095;
+    if (end > begin)
+      madvise(m_map + begin, end - begin, MADV_DONTNEED);
+  }
+
+private:
+  void read_range(int fd, char *dst, size_t offset, size_t bytes) {
+    while (bytes) {
+      ssize_t n = pread(fd, dst, bytes, offset);
+      if (n <= 0)
+        io_fail(m_name, "read failed");
+      dst += n;
+      offset += n;
+      bytes -= n;
+    }
+  }
+
+  std::string m_name;
+  int m_fd, m_direct_fd;
+  char *m_map;
+  size_t m_map_bytes;
+};
+
+OutOfCoreStats out_of_core_matmul(const std::string &a_file,
+                                  const std::string &b_file,
+                                  const std::string &c_file,
+                                  const OutOfCoreConfig &config,
+                                  const PanelEngine &engine) {
+  xcl::MatrixHeader ha = xcl::read_matrix_header(a_file);
+  xcl::MatrixHeader hb = xcl::read_matrix_header(b_file);
+  if (ha.dtype != xcl::DType::Int32 || ha.layout != xcl::Layout::RowMajor ||
+      ha.ld != ha.cols)
+    io_fail(a_file, "A must be a packed row-major int32 matrix");
+  if (hb.dtype != xcl::DType::Int32 || hb.layout != xcl::Layout::ColMajor ||
+      hb.ld != hb.rows)
+    io_fail(b_file, "B must be a packed column-major int32 matrix");
+  if (ha.cols != hb.rows)
+    io_fail(b_file, "inner dimensions of A and B differ");
+  const int M = ha.rows, K = ha.cols, N = hb.cols;
+  const int PR = config.panel_rows, PC = config.panel_cols;
+  const int a_panels = (M + PR - 1) / PR, b_panels = (N + PC - 1) / PC;
+
+  OutOfCoreStats stats;
+  memset(&stats, 0, sizeof(stats));
+  stats.ops = 2.0 * M * N * K;
+  Clock::time_point start = Clock::now();
+
+  PanelSource a_src(a_file, config), b_src(b_file, config);
+  bool copy = !config.use_mmap;
+  PanelRing a_ring(2, (size_t)PR * K * sizeof(int), copy);
+  PanelRing b_ring(std::max(config.read_ahead, 1), (size_t)PC * K * sizeof(int), copy);
+  PanelRing c_ring(2, (size_t)PR * N * sizeof(int), true);
+  stats.buffer_bytes =
+      a_ring.held_bytes() + b_ring.held_bytes() + c_ring.held_bytes();
+
+  int c_fd = open(c_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (c_fd < 0)
+    io_fail(c_file, "cannot create matrix file");
+  xcl::MatrixHeader hc = xcl::make_matrix_header(xcl::DType::Int32, M, N);
+  if (ftruncate(c_fd, xcl::MatrixFile::PAYLOAD_OFFSET + hc.payload_bytes))
+    io_fail(c_file, "cannot size matrix file");
+
+  // Reader: A panel i, then all B panels, for every i
+  std::thread reader([&] {
+    for (int i = 0; i < a_panels; i++) {
+      int rows = std::min(PR, M - i * PR);
+      size_t bytes = (size_t)rows * K * sizeof(int);
+      int *&a = a_ring.acquire();
+      Clock::time_point t = Clock::now();
+      a_src.read(a, ha.payload_offset + (size_t)i * PR * K * sizeof(int),
+                 bytes);
+      stats.read_s += seconds_since(t);
+      stats.bytes_read += bytes;
+      a_ring.push();
+      for (int j = 0; j < b_panels; j++) {
+        int cols = std::min(PC, N - j * PC);
+        bytes = (size_t)cols * K * sizeof(int);
+        int *&b = b_ring.acquire();
+        t = Clock::now();
+        b_src.read(b, hb.payload_offset + (size_t)j * PC * K * sizeof(int),
+                   bytes);
+        stats.read_s += seconds_since(t);
+        stats.bytes_read += bytes;
+        b_ring.push();
+      }
+    }
+  });
+
+  // Writer: C row panels in order, checksummed as they go
+  xcl::MatrixChecksum checksum;
+  std::thread writer([&] {
+    for (int i = 0; i < a_panels; i++) {
+      int rows = std::min(PR, M - i * PR);
+      size_t bytes = (size_t)rows * N * sizeof(int);
+      const char *c = (const char *)c_ring.front();
+      Clock::time_point t = Clock::now();
+      checksum.update(c, bytes);
+      size_t offset = hc.payload_offset + (size_t)i * PR * N * sizeof(int);
+      for (size_t done = 0; done < bytes;) {
+        ssize_t n = pwrite(c_fd, c + done, bytes - done, offset + done);
+        if (n <= 0)
+          io_fail(c_file, "write failed");
+        done += n;
+      }
+      stats.write_s += seconds_since(t);
+      stats.bytes_written += bytes;
+      c_ring.pop();
+    }
+  });
+
+  // Compute on the calling thread
+  for (int i = 0; i < a_panels; i++) {
+    int rows = std::min(PR, M - i * PR);
+    const int *a = a_ring.front();
+    int *c = c_ring.acquire();
+    for (int j = 0; j < b_panels; j++) {
+      int cols = std::min(PC, N - j * PC);
+      const int *b = b_ring.front();
+      Clock::time_point t = Clock::now();
+      engine(a, b, c + (size_t)j * PC, N, rows, cols, K);
+      stats.compute_s += seconds_since(t);
+      b_src.release(b, (size_t)cols * K * sizeof(int));
+      b_ring.pop();
+    }
+    a_src.release(a, (size_t)rows * K * sizeof(int));
+    a_ring.pop();
+    c_ring.push();
+  }
+  reader.join();
+  writer.join();
+
+  hc.checksum = checksum.value();
+  xcl::write_matrix_header(c_fd, hc);
+  close(c_fd);
+  stats.total_s = seconds_since(start);
+  return stats;
+}
+
+PanelEngine cpu_panel_engine() {
+  return [](const int *a, const int *b, int *c, int ldc, int rows, int cols,
+            int K) {
+    // The CPU engine wants B row-major: transpose the column panel into a
+    // K x cols block and compute a rows x cols tile
+    static thread_local std::vector<int> block, tile;
+    block.resize((size_t)K * cols);
+    tile.resize((size_t)rows * cols);
+    for (int col = 0; col < cols; col++)
+      for (int k = 0; k < K; k++)
+        block[(size_t)k * cols + col] = b[(size_t)col * K + k];
+    gemm::cpu_matmul(a, block.data(), tile.data(), rows, cols, K);
+    for (int r = 0; r < rows; r++)
+      memcpy(c + (size_t)r * ldc, &tile[(size_t)r * cols], cols * sizeof(int));
+  };
+}
+
+void write_ooc_inputs(const std::string &a_file, const std::string &b_file,
+                      int M, int N, int K, const std::function<int()> &gen) {
+  xcl::MatrixFile a = xcl::MatrixFile::create(a_file, xcl::DType::Int32, M, K);
+  int *pa = a.data<int>();
+  for (size_t i = 0; i < (size_t)M * K; i++)
+    pa[i] = gen();
+  a.commit();
+  xcl::MatrixFile b = xcl::MatrixFile::create(b_file, xcl::DType::Int32, K, N,
+                                              xcl::Layout::ColMajor);
+  int *pb = b.data<int>();
+  for (size_t i = 0; i < (size_t)K * N; i++)
+    pb[i] = gen();
+  b.commit();
+}
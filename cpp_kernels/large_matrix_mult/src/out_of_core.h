@@ -0,0 +1,95 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Out-of-core C = A * B for int32 matrices stored in matrix files (see
+// matrix_file.hpp) that need not fit in host memory. A must be row-major and
+// B column-major, so that a panel of A rows and a panel of B columns are
+// each one contiguous range of their file. C is written row-major.
+//
+// A reader thread streams the panels in compute order, A row panel i
+// followed by every B column panel, up to read_ahead B panels ahead of the
+// compute. A writer thread stores finished C row panels in order while the
+// next panel is computed. Memory is bounded by two A panels, read_ahead B
+// panels and two C row panels.
+
+struct OutOfCoreConfig {
+  int panel_rows; // rows of A and C per panel
+  int panel_cols; // columns of B per panel
+  int read_ahead; // B panels read ahead of the compute, at least 1
+  bool direct_io; // read with O_DIRECT, bypassing the page cache
+  bool use_mmap;  // map the inputs instead of pread()
+
+  OutOfCoreConfig()
+      : panel_rows(256), panel_cols(1024), read_ahead(2), direct_io(false),
+        use_mmap(false) {}
+};
+
+// c = a * b for one tile. a is rows x K (row-major), b holds cols columns of
+// B of K elements each, c is rows x cols with leading dimension ldc.
+typedef std::function<void(const int *a, const int *b, int *c, int ldc,
+                           int rows, int cols, int K)>
+    PanelEngine;
+
+struct OutOfCoreStats {
+  double bytes_read;
+  double bytes_written;
+  double read_s;    // reader thread busy time
+  double compute_s; // time spent in the engine
+  double write_s;   // writer thread busy time
+  double total_s;
+  double ops; // 2 * M * N * K
+  size_t buffer_bytes; // host memory held in panel buffers
+};
+
+OutOfCoreStats out_of_core_matmul(const std::string &a_file,
+                                  const std::string &b_file,
+                                  const std::string &c_file,
+                                  const OutOfCoreConfig &config,
+                                  const PanelEngine &engine);
+
+// Engine running on the multithreaded CPU engine
+PanelEngine cpu_panel_engine();
+
+// Writes out-of-core inputs filled with gen(): A as M x K row-major and B as
+// K x N column-major. They are written through shared mappings, so they need
+// not fit in memory either.
+void write_ooc_inputs(const std::string &a_file, const std::string &b_file,
+                      int M, int N, int K, const std::function<int()> &gen);
@@ -44,6 +44,17 @@ performance.
 *******************************************************************************/
 // OpenCL utility layer include
 #include "xcl2.hpp"
+#include "bitpack.hpp"
+#include "device_session.hpp"
+#include "event_profiler.hpp"
+#include "float_gemm.hpp"
+#include "quant_gemm.hpp"
+#include "sparse_gemm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <random>
 #include <vector>
 
 // Array Size to access
@@ -52,6 +63,13 @@ performance.
 // Maximum Array Size
 #define MAX_SIZE 64
 
+// Tile size of mmult_block_sparse, TILE in mmult.cpp
+#define SPARSE_TILE 8
+
+// Host to device bandwidth the bitpack mode compares its encoder against,
+// as in bitpack_bench
+#define BITPACK_LINK_GBPS 12.0
+
 // Software implementation of Matrix Multiplication
 // The inputs are of the size (DATA_SIZE x DATA_SIZE)
 void m_softwareGold(
@@ -70,13 +88,64 @@ void m_softwareGold(
   }
 }
 
+// Compares the device results to the software ones: exactly for integers
+int verify(const int *sw, const int *hw, int n) {
+  for (int i = 0; i < n; i++) {
+    if (hw[i] != sw[i]) {
+      std::cout << "Error: Result mismatch" << std::endl;
+      std::cout << "i = " << i << " CPU result = " << sw[i]
+                << " Device result = " << hw[i] << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Floating-point results may round differently: they pass within the
+// relative error of two fp32 sums over DATA_SIZE terms
+int verify(const float *sw, const float *hw, int n) {
+  gemm::FloatError error = gemm::float_error(sw, hw, n);
+  double tolerance = gemm::float_tolerance(DATA_SIZE);
+  printf("Max relative error %g (%u ULP), tolerance %g\n", error.max_rel,
+         error.max_ulp, tolerance);
+  if (error.max_rel > tolerance) {
+    std::cout << "Error: Result mismatch" << std::endl;
+    std::cout << "i = " << error.worst << " CPU result = " << sw[error.worst]
+              << " Device result = " << hw[error.worst] << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cout << "Usage: " << argv[0] << " <XCLBIN File>" << std::endl;
+  if (argc != 2 && argc != 3) {
+    std::cout << "Usage: " << argv[0]
+              << " <XCLBIN File> [int8|int16|fp32|bf16|fp16|bitpack|sparse]"
+              << std::endl;
     return EXIT_FAILURE;
   }
 
   std::string binaryFile = argv[1];
+  // "int8" and "int16" run mmult_int8/_int16, which read A and B packed four
+  // or two operands per word and accumulate in int32. "fp32", "bf16" and
+  // "fp16" run mmult_fp32/_bf16/_fp16, which accumulate in fp32. "bitpack"
+  // runs mmult_bitpack, which reads A and B bit-packed to the width of their
+  // value range. "sparse" runs mmult_block_sparse on an A with most of its
+  // tiles empty, sending only the occupied ones.
+  std::string mode = (argc == 3) ? argv[2] : "";
+  bool fp = (mode == "fp32" || mode == "bf16" || mode == "fp16");
+  bool bitpack = (mode == "bitpack");
+  bool sparse = (mode == "sparse");
+  if (argc == 3 && mode != "int8" && mode != "int16" && !fp && !bitpack &&
+      !sparse) {
+    std::cout << "Unknown mode " << mode << std::endl;
+    return EXIT_FAILURE;
+  }
+  bool quant = !mode.empty() && !fp && !bitpack && !sparse;
+  gemm::QuantWidth width =
+      (mode == "int16") ? gemm::QUANT_INT16 : gemm::QUANT_INT8;
+  std::string kernel_name =
+      mode.empty() ? "mmult" : sparse ? "mmult_block_sparse" : "mmult_" + mode;
 
   // Allocate Memory in Host Memory
   if (DATA_SIZE > MAX_SIZE) {
@@ -97,96 +166,231 @@ int main(int argc, char **argv) {
   std::vector<int, aligned_allocator<int>> source_hw_results(matrix_size_bytes);
   std::vector<int, aligned_allocator<int>> source_sw_results(matrix_size_bytes);
 
-  // Create the test data and Software Result
+  // Create the test data and Software Result. The packed modes fold the
+  // data into the operand range, and bitpack into 4 bits.
+  int range = quant ? 1 << (width - 1) : bitpack ? 16 : INT_MAX;
   for (int i = 0; i < DATA_SIZE * DATA_SIZE; i++) {
-    source_in1[i] = i;
-    source_in2[i] = i * i;
+    source_in1[i] = i % range;
+    source_in2[i] = (i * i) % range;
     source_sw_results[i] = 0;
     source_hw_results[i] = 0;
   }
+  // The sparse mode empties three tiles of A out of four
+  if (sparse) {
+    for (int i = 0; i < DATA_SIZE; i++)
+      for (int k = 0; k < DATA_SIZE; k++)
+        if ((i / SPARSE_TILE * 7 + k / SPARSE_TILE * 3) % 4 != 0)
+          source_in1[i * DATA_SIZE + k] = 0;
+  }
 
-  // OPENCL HOST CODE AREA START
-  auto devices = xcl::get_xil_devices();
-  // read_binary_file() is a utility API which will load the binaryFile
-  // and will return the pointer to file buffer.
-  auto fileBuf = xcl::read_binary_file(binaryFile);
-  cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
-  int valid_device = 0;
-  for (unsigned int i = 0; i < devices.size(); i++) {
-    auto device = devices[i];
-    // Creating Context and Command Queue for selected Device
-    OCL_CHECK(err, context = cl::Context(device, NULL, NULL, NULL, &err));
-    OCL_CHECK(err, q = cl::CommandQueue(context, device,
-                                        CL_QUEUE_PROFILING_ENABLE, &err));
-
-    std::cout << "Trying to program device[" << i
-              << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
-    cl::Program program(context, {device}, bins, NULL, &err);
-    if (err != CL_SUCCESS) {
-      std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
-    } else {
-      std::cout << "Device[" << i << "]: program successful!\n";
-      OCL_CHECK(err, krnl_loop_reorder = cl::Kernel(program, "mmult", &err));
-      valid_device++;
-      break; // we break because we found a valid device
+  // Packed operands: A by rows and B by columns, along K
+  int words = gemm::quant_words(DATA_SIZE, width);
+  std::vector<uint32_t, aligned_allocator<uint32_t>> packed_in1(DATA_SIZE *
+                                                                words);
+  std::vector<uint32_t, aligned_allocator<uint32_t>> packed_in2(words *
+                                                                DATA_SIZE);
+  if (quant) {
+    gemm::quant_pack_rows(source_in1.data(), packed_in1.data(), DATA_SIZE,
+                          DATA_SIZE, width);
+    gemm::quant_pack_cols(source_in2.data(), packed_in2.data(), DATA_SIZE,
+                          DATA_SIZE, width);
+  }
+
+  // Floating-point operands: fractions in [0, 1), which bf16 and fp16 round,
+  // so the software result is computed from the rounded values. The 16-bit
+  // types are stored as their raw bit patterns, the layout the kernels read.
+  std::vector<float, aligned_allocator<float>> float_in1(DATA_SIZE *
+                                                         DATA_SIZE);
+  std::vector<float, aligned_allocator<float>> float_in2(DATA_SIZE *
+                                                         DATA_SIZE);
+  std::vector<uint16_t, aligned_allocator<uint16_t>> half_in1(DATA_SIZE *
+                                                              DATA_SIZE);
+  std::vector<uint16_t, aligned_allocator<uint16_t>> half_in2(DATA_SIZE *
+                                                              DATA_SIZE);
+  std::vector<float, aligned_allocator<float>> float_hw_results(DATA_SIZE *
+                                                                DATA_SIZE);
+  std::vector<float, aligned_allocator<float>> float_sw_results(DATA_SIZE *
+                                                                DATA_SIZE);
+  gemm::bf16 *bf16_in1 = reinterpret_cast<gemm::bf16 *>(half_in1.data());
+  gemm::bf16 *bf16_in2 = reinterpret_cast<gemm::bf16 *>(half_in2.data());
+  gemm::fp16 *fp16_in1 = reinterpret_cast<gemm::fp16 *>(half_in1.data());
+  gemm::fp16 *fp16_in2 = reinterpret_cast<gemm::fp16 *>(half_in2.data());
+  if (fp) {
+    std::mt19937 rng(DATA_SIZE);
+    std::uniform_real_distribution<float> fraction(0, 1);
+    for (int i = 0; i < DATA_SIZE * DATA_SIZE; i++) {
+      float_in1[i] = fraction(rng);
+      float_in2[i] = fraction(rng);
+    }
+    if (mode == "bf16") {
+      gemm::convert(float_in1.data(), bf16_in1, float_in1.size());
+      gemm::convert(float_in2.data(), bf16_in2, float_in2.size());
+    } else if (mode == "fp16") {
+      gemm::convert(float_in1.data(), fp16_in1, float_in1.size());
+      gemm::convert(float_in2.data(), fp16_in2, float_in2.size());
     }
   }
-  if (valid_device == 0) {
-    std::cout << "Failed to program any device found, exit!\n";
-    exit(EXIT_FAILURE);
+  bool half = (mode == "bf16" || mode == "fp16");
+
+  // Bit-packed operands, each at the width its min/max scan allows
+  const size_t elements = DATA_SIZE * DATA_SIZE;
+  std::chrono::steady_clock::time_point pack_start =
+      std::chrono::steady_clock::now();
+  gemm::BitPacking packing1 = gemm::bitpack_choose(source_in1.data(), elements);
+  gemm::BitPacking packing2 = gemm::bitpack_choose(source_in2.data(), elements);
+  std::vector<uint32_t, aligned_allocator<uint32_t>> bits_in1(
+      gemm::bitpack_words(elements, packing1.width));
+  std::vector<uint32_t, aligned_allocator<uint32_t>> bits_in2(
+      gemm::bitpack_words(elements, packing2.width));
+  if (bitpack) {
+    gemm::bitpack_encode(source_in1.data(), elements, packing1,
+                         bits_in1.data());
+    gemm::bitpack_encode(source_in2.data(), elements, packing2,
+                         bits_in2.data());
+    double pack_s = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - pack_start)
+                        .count();
+    printf("A packed to %d bits, B to %d bits, at %.2f GB/s; packing pays "
+           "above %.2f GB/s on a %.0f GB/s link\n",
+           packing1.width, packing2.width,
+           2 * elements * sizeof(int) / pack_s * 1e-9,
+           gemm::bitpack_break_even(std::max(packing1.width, packing2.width),
+                                    BITPACK_LINK_GBPS),
+           BITPACK_LINK_GBPS);
   }
 
+  // Block-sparse A: the occupied tiles and their bitmap
+  gemm::BlockSparseMatrix block_in1 = gemm::block_sparse_from_dense(
+      source_in1.data(), DATA_SIZE, DATA_SIZE, SPARSE_TILE);
+  std::vector<int, aligned_allocator<int>> tiles_in1(block_in1.tiles.begin(),
+                                                     block_in1.tiles.end());
+  std::vector<uint32_t, aligned_allocator<uint32_t>> occupancy_in1(
+      block_in1.occupancy.begin(), block_in1.occupancy.end());
+  if (sparse)
+    std::cout << "A has " << block_in1.tile_count() << " of "
+              << block_in1.tile_rows * block_in1.tile_cols
+              << " tiles occupied" << std::endl;
+
+  size_t input_bytes =
+      quant ? packed_in1.size() * sizeof(uint32_t)
+            : half ? half_in1.size() * sizeof(uint16_t) : matrix_size_bytes;
+  size_t input1_bytes =
+      bitpack ? bits_in1.size() * sizeof(uint32_t)
+              : sparse ? tiles_in1.size() * sizeof(int) : input_bytes;
+  size_t input2_bytes =
+      bitpack ? bits_in2.size() * sizeof(uint32_t) : input_bytes;
+  void *input1 = quant ? (void *)packed_in1.data()
+                       : half ? (void *)half_in1.data()
+                              : fp ? (void *)float_in1.data()
+                                   : bitpack ? (void *)bits_in1.data()
+                                             : (void *)source_in1.data();
+  if (sparse)
+    input1 = tiles_in1.data();
+  void *input2 = quant ? (void *)packed_in2.data()
+                       : half ? (void *)half_in2.data()
+                              : fp ? (void *)float_in2.data()
+                                   : bitpack ? (void *)bits_in2.data()
+                                             : (void *)source_in2.data();
+  void *output =
+      fp ? (void *)float_hw_results.data() : (void *)source_hw_results.data();
+
+  // OPENCL HOST CODE AREA START
+  // The device session programs the device once per xclbin and caches the
+  // program and kernel handles for later calls.
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  krnl_loop_reorder = session.kernel(binaryFile, kernel_name);
+  context = session.context();
+  q = session.queue();
+
   // Allocate Buffer in Global Memory
   OCL_CHECK(err, cl::Buffer buffer_in1(
                      context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
-                     matrix_size_bytes, source_in1.data(), &err));
+                     input1_bytes, input1, &err));
   OCL_CHECK(err, cl::Buffer buffer_in2(
                      context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
-                     matrix_size_bytes, source_in2.data(), &err));
+                     input2_bytes, input2, &err));
+  OCL_CHECK(err, cl::Buffer buffer_occupancy(
+                     context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
+                     occupancy_in1.size() * sizeof(uint32_t),
+                     occupancy_in1.data(), &err));
   OCL_CHECK(err, cl::Buffer buffer_output(
                      context, CL_MEM_USE_HOST_PTR | CL_MEM_WRITE_ONLY,
-                     matrix_size_bytes, source_hw_results.data(), &err));
+                     matrix_size_bytes, output, &err));
 
   int size = DATA_SIZE;
 
   OCL_CHECK(err, err = krnl_loop_reorder.setArg(0, buffer_in1));
   OCL_CHECK(err, err = krnl_loop_reorder.setArg(1, buffer_in2));
   OCL_CHECK(err, err = krnl_loop_reorder.setArg(2, buffer_output));
-  OCL_CHECK(err, err = krnl_loop_reorder.setArg(3, size));
+  if (sparse) {
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(3, buffer_occupancy));
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(4, size));
+  } else {
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(3, size));
+  }
+  if (bitpack) {
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(4, packing1.width));
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(5, packing1.base));
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(6, packing2.width));
+    OCL_CHECK(err, err = krnl_loop_reorder.setArg(7, packing2.base));
+  }
+
+  // Time every phase of the functional run: inputs in, kernel, result out
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
 
   // Copy input data to device global memory
-  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_in1, buffer_in2},
-                                                  0 /* 0 means from host*/));
+  std::vector<cl::Memory> inputs = {buffer_in1, buffer_in2};
+  if (sparse)
+    inputs.push_back(buffer_occupancy);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(inputs,
+                                                  0 /* 0 means from host*/,
+                                                  NULL, &write_event));
 
   // Launch the Kernel
-  OCL_CHECK(err, err = q.enqueueTask(krnl_loop_reorder));
+  OCL_CHECK(err, err = q.enqueueTask(krnl_loop_reorder, NULL, &kernel_event));
   q.finish();
 
   // Copy Result from Device Global Memory to Host Local Memory
   OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_output},
-                                                  CL_MIGRATE_MEM_OBJECT_HOST));
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  NULL, &read_event));
   q.finish();
+  profiler.h2d(write_event,
+               input1_bytes + input2_bytes +
+                   (sparse ? occupancy_in1.size() * sizeof(uint32_t) : 0));
+  // The block-sparse kernel only multiplies the occupied tiles
+  profiler.kernel(kernel_event,
+                  sparse ? 2.0 * tiles_in1.size() * DATA_SIZE
+                         : 2.0 * DATA_SIZE * DATA_SIZE * DATA_SIZE);
+  profiler.d2h(read_event, matrix_size_bytes);
 
   // OPENCL HOST CODE AREA END
 
-  // Compute Software Results
+  // Compute Software Results, with the vectorized CPU engine for the
+  // floating-point types
   clock_t t;
   t = clock(); 
-  m_softwareGold(source_in1, source_in2, source_sw_results);
+  if (mode == "bf16")
+    gemm::float_matmul(bf16_in1, bf16_in2, float_sw_results.data(), DATA_SIZE,
+                       DATA_SIZE, DATA_SIZE);
+  else if (mode == "fp16")
+    gemm::float_matmul(fp16_in1, fp16_in2, float_sw_results.data(), DATA_SIZE,
+                       DATA_SIZE, DATA_SIZE);
+  else if (fp)
+    gemm::float_matmul(float_in1.data(), float_in2.data(),
+                       float_sw_results.data(), DATA_SIZE, DATA_SIZE,
+                       DATA_SIZE);
+  else
+    m_softwareGold(source_in1, source_in2, source_sw_results);
   t = clock() - t;
   double time_taken_s = ((double)t)/CLOCKS_PER_SEC; // in seconds
   double time_taken_ms = time_taken_s*1000; // in seconds
   // Compare the results of the Device to the simulation
-  int match = 0;
-  for (int i = 0; i < DATA_SIZE * DATA_SIZE; i++) {
-    if (source_hw_results[i] != source_sw_results[i]) {
-      std::cout << "Error: Result mismatch" << std::endl;
-      std::cout << "i = " << i << " CPU result = " << source_sw_results[i]
-                << " Device result = " << source_hw_results[i] << std::endl;
-      match = 1;
-      break;
-    }
-  }
+  int match = fp ? verify(float_sw_results.data(), float_hw_results.data(),
+                          DATA_SIZE * DATA_SIZE)
+                 : verify(source_sw_results.data(), source_hw_results.data(),
+                          DATA_SIZE * DATA_SIZE);
 // Launch the kernel and get profile data (stop-start)
   cl::Event event;
   uint64_t nstimestart, nstimeend;
@@ -216,6 +420,7 @@ int main(int argc, char **argv) {
   printf("|-------------------------+-------------------------|\n");
   printf("| Speedup:  %23f                                    | \n", time_taken_ms/avg_fpga_exec_time);
   printf("|-------------------------+-------------------------|\n");
+  profiler.report(kernel_name);
   printf("Note: Wall Clock Time is meaningful for real hardware execution "
          "only, not for emulation.\n");
   printf("Please refer to profile summary for kernel execution time for "
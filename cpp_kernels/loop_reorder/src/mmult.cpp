@@ -74,8 +74,371 @@ below]
 // TRIPCOUNT indentifier
 const unsigned int c_size = MAX_SIZE;
 
+// Tiles of the block-sparse kernel below, TILE x TILE elements of A
+#define TILE 8
+#define MAX_TILES (MAX_SIZE / TILE)
+const unsigned int c_tiles = MAX_TILES;
+
+// Operand lanes of a 32-bit word in the packed kernels below: four int8 or
+// two int16, lowest k in the lowest bits
+template <int BITS> static int lane(int word, int l) {
+  return (int)((unsigned int)word << (32 - BITS * (l + 1))) >> (32 - BITS);
+}
+
+static float bits_float(unsigned int bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Element types of the floating-point kernels below: the type read from
+// global memory and its value in fp32, which accumulates all of them. bf16
+// and fp16 are raw bit patterns; their products are exact in fp32.
+struct fp32_elem {
+  typedef float storage;
+  static float value(float x) { return x; }
+};
+struct bf16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    return bits_float((unsigned int)x << 16);
+  }
+};
+struct fp16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    unsigned int exp = (x >> 10) & 0x1f;
+    unsigned int mant = x & 0x3ff;
+    float mag = (exp == 0) ? mant * 5.9604645e-8f // subnormal, mant * 2^-24
+                : (exp == 0x1f)
+                    ? bits_float(0x7f800000 | (mant ? 0x400000 : 0) |
+                                 (mant << 13))
+                    : bits_float(((exp + 112) << 23) | (mant << 13));
+    return (x & 0x8000) ? -mag : mag;
+  }
+};
+
+// mmult on packed operands. in1 holds A packed by rows and in2 B packed by
+// columns, both along K: word w of a row of A, and row w of B, hold
+// k = lanes * w .. lanes * w + lanes - 1. Each step of lreorder2 then does
+// 32 / BITS multiply-adds per column, accumulated in int32.
+template <int BITS>
+static void mmult_packed(const int *in1, const int *in2, int *out_r,
+                         int size) {
+  const int lanes = 32 / BITS;
+  const int words = (size + lanes - 1) / lanes;
+
+  // Local memory to store input and output matrices
+  int A[MAX_SIZE][MAX_SIZE * BITS / 32];
+  int B[MAX_SIZE * BITS / 32][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+  int temp_sum[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+// Burst read for matrix A
+readA:
+  for (int itr = 0, i = 0, j = 0; itr < size * words; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size*BITS/32 max = c_size*c_size*BITS/32
+    if (j == words) {
+      j = 0;
+      i++;
+    }
+    A[i][j] = in1[itr];
+  }
+
+// Burst read for matrix B
+readB:
+  for (int itr = 0, i = 0, j = 0; itr < words * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size*BITS/32 max = c_size*c_size*BITS/32
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    B[i][j] = in2[itr];
+  }
+
+// Same reordered loop nest as mmult, over words of K instead of single k
+lreorder1:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+  lreorder2:
+    for (int w = 0; w < words; w++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*BITS/32 max = c_size*BITS/32
+    lreorder3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+        int result = (w == 0) ? 0 : temp_sum[j];
+        for (int l = 0; l < lanes; l++) {
+#pragma HLS UNROLL
+          result += lane<BITS>(A[i][w], l) * lane<BITS>(B[w][j], l);
+        }
+        temp_sum[j] = result;
+        if (w == words - 1)
+          C[i][j] = result;
+      }
+    }
+  }
+
+// Burst write from matrix C
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
+// Log2 of the elements per 32-bit word of the bit-packed kernels below, for
+// widths of 1, 2, 4, 8 or 32 bits
+static int lanes_log2(int width) {
+  switch (width) {
+  case 1:
+    return 5;
+  case 2:
+    return 4;
+  case 4:
+    return 3;
+  case 8:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// mmult on bit-packed operands (see common/includes/gemm/bitpack.hpp):
+// element itr of A is base1 plus bits width1 * (itr % lanes) upwards of word
+// itr / lanes of in1, and likewise for B. readA and readB take one element
+// per iteration from a word register refilled every lanes elements, so they
+// keep II=1 while reading 32 / width times fewer words than mmult. The loop
+// nest is that of mmult.
+static void mmult_unpack(const int *in1, const int *in2, int *out_r, int size,
+                         int width1, int base1, int width2, int base2) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+  int temp_sum[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+  const int shift1 = lanes_log2(width1);
+  const int shift2 = lanes_log2(width2);
+  const unsigned int mask1 = (width1 == 32) ? ~0u : (1u << width1) - 1;
+  const unsigned int mask2 = (width2 == 32) ? ~0u : (1u << width2) - 1;
+  unsigned int word1 = 0, word2 = 0;
+
+readA:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    if ((itr & ((1 << shift1) - 1)) == 0)
+      word1 = in1[itr >> shift1];
+    A[i][j] = base1 + (int)(word1 & mask1);
+    word1 = (width1 == 32) ? 0 : word1 >> width1;
+  }
+
+readB:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    if ((itr & ((1 << shift2) - 1)) == 0)
+      word2 = in2[itr >> shift2];
+    B[i][j] = base2 + (int)(word2 & mask2);
+    word2 = (width2 == 32) ? 0 : word2 >> width2;
+  }
+
+lreorder1:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+  lreorder2:
+    for (int k = 0; k < size; k++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+    lreorder3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+        int result = (k == 0) ? 0 : temp_sum[j];
+        result += A[i][k] * B[k][j];
+        temp_sum[j] = result;
+        if (k == size - 1)
+          C[i][j] = result;
+      }
+    }
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
+// mmult on floating-point operands with fp32 accumulation. The reordered
+// loop nest is what lets this pipeline at II=1 as well: consecutive
+// iterations of lreorder3 update different temp_sum[j], so the latency of
+// the floating-point adder is not on a loop-carried path.
+template <typename E>
+static void mmult_typed(const typename E::storage *in1,
+                        const typename E::storage *in2, float *out_r,
+                        int size) {
+  typename E::storage A[MAX_SIZE][MAX_SIZE];
+  typename E::storage B[MAX_SIZE][MAX_SIZE];
+  float C[MAX_SIZE][MAX_SIZE];
+  float temp_sum[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+readA:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    A[i][j] = in1[itr];
+  }
+
+readB:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    B[i][j] = in2[itr];
+  }
+
+lreorder1:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+  lreorder2:
+    for (int k = 0; k < size; k++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+      float a = E::value(A[i][k]);
+    lreorder3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+        float result = (k == 0) ? 0 : temp_sum[j];
+        result += a * E::value(B[k][j]);
+        temp_sum[j] = result;
+        if (k == size - 1)
+          C[i][j] = result;
+      }
+    }
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
 // Computes matrix multiply
 // C = AxB, where A, B and C are square matrices of dimension (sizexsize)
+// mmult on block-sparse A (see common/includes/gemm/sparse_gemm.hpp). A is
+// cut into TILE x TILE tiles, tiles = size / TILE rounded up per side, and
+// bit tr * tiles + tc of occupancy is set when tile (tr, tc) has a nonzero.
+// in1 holds only those tiles, in row-major tile order, each row-major and
+// padded with zeros past size. Empty tiles are neither read nor multiplied:
+// lsparse2 steps over the tiles of k in the tile row of i and skips the
+// empty ones, so the work follows the occupied tiles.
+static void mmult_sparse(const int *in1, const int *in2, int *out_r,
+                         const unsigned int *occupancy, int size) {
+  int A[MAX_SIZE][MAX_SIZE];
+  int B[MAX_SIZE][MAX_SIZE];
+  int C[MAX_SIZE][MAX_SIZE];
+  int temp_sum[MAX_SIZE];
+  unsigned int occ[(MAX_TILES * MAX_TILES + 31) / 32];
+#pragma HLS ARRAY_PARTITION variable = B dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = C dim = 2 complete
+#pragma HLS ARRAY_PARTITION variable = temp_sum dim = 1 complete
+
+  const int tiles = (size + TILE - 1) / TILE;
+
+readOcc:
+  for (int w = 0; w < (tiles * tiles + 31) / 32; w++) {
+#pragma HLS LOOP_TRIPCOUNT min = 1 max = (c_tiles*c_tiles+31)/32
+    occ[w] = occupancy[w];
+  }
+
+readA:
+  for (int t = 0, pos = 0; t < tiles * tiles; t++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_tiles*c_tiles max = c_tiles*c_tiles
+    if (!((occ[t / 32] >> (t % 32)) & 1))
+      continue;
+    int i0 = (t / tiles) * TILE;
+    int k0 = (t % tiles) * TILE;
+  readTile:
+    for (int e = 0; e < TILE * TILE; e++, pos++)
+      A[i0 + e / TILE][k0 + e % TILE] = in1[pos];
+  }
+
+readB:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    B[i][j] = in2[itr];
+  }
+
+lsparse1:
+  for (int i = 0; i < size; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+    int tr = i / TILE;
+  clear:
+    for (int j = 0; j < MAX_SIZE; j++)
+      temp_sum[j] = 0;
+  lsparse2:
+    for (int tc = 0; tc < tiles; tc++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_tiles max = c_tiles
+      int bit = tr * tiles + tc;
+      if (!((occ[bit / 32] >> (bit % 32)) & 1))
+        continue;
+      int k_end = (size - tc * TILE < TILE) ? size - tc * TILE : TILE;
+    lsparse3:
+      for (int kk = 0; kk < k_end; kk++) {
+#pragma HLS LOOP_TRIPCOUNT min = TILE max = TILE
+        int k = tc * TILE + kk;
+      lreorder3:
+        for (int j = 0; j < MAX_SIZE; j++)
+          temp_sum[j] += A[i][k] * B[k][j];
+      }
+    }
+  store:
+    for (int j = 0; j < MAX_SIZE; j++)
+      C[i][j] = temp_sum[j];
+  }
+
+writeC:
+  for (int itr = 0, i = 0, j = 0; itr < size * size; itr++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == size) {
+      j = 0;
+      i++;
+    }
+    out_r[itr] = C[i][j];
+  }
+}
+
 extern "C" {
 void mmult(const int *in1, // Read-Only Matrix 1
            const int *in2, // Read-Only Matrix 2
@@ -176,4 +539,46 @@ writeC:
     out_r[itr] = C[i][j];
   }
 }
+
+// int8 operands, four per word: a quarter of the transfers of mmult for A
+// and B
+void mmult_int8(const int *in1, const int *in2, int *out_r, int size) {
+  mmult_packed<8>(in1, in2, out_r, size);
+}
+
+// int16 operands, two per word
+void mmult_int16(const int *in1, const int *in2, int *out_r, int size) {
+  mmult_packed<16>(in1, in2, out_r, size);
+}
+
+// fp32 operands and result
+void mmult_fp32(const float *in1, const float *in2, float *out_r, int size) {
+  mmult_typed<fp32_elem>(in1, in2, out_r, size);
+}
+
+// bf16 operands, half the transfers of mmult_fp32 for A and B, fp32 result
+void mmult_bf16(const unsigned short *in1, const unsigned short *in2,
+                float *out_r, int size) {
+  mmult_typed<bf16_elem>(in1, in2, out_r, size);
+}
+
+// fp16 operands, fp32 result
+void mmult_fp16(const unsigned short *in1, const unsigned short *in2,
+                float *out_r, int size) {
+  mmult_typed<fp16_elem>(in1, in2, out_r, size);
+}
+
+// Bit-packed operands of width1 and width2 bits offset by base1 and base2,
+// int32 result
+void mmult_bitpack(const int *in1, const int *in2, int *out_r, int size,
+                   int width1, int base1, int width2, int base2) {
+  mmult_unpack(in1, in2, out_r, size, width1, base1, width2, base2);
+}
+
+// Block-sparse A: only the TILE x TILE tiles of A flagged in occupancy are
+// read and multiplied, int32 result
+void mmult_block_sparse(const int *in1, const int *in2, int *out_r,
+                        const unsigned int *occupancy, int size) {
+  mmult_sparse(in1, in2, out_r, occupancy, size);
+}
 }
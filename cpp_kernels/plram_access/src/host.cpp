@@ -48,6 +48,8 @@ memory resources managed by the Vitis memory subsystem.
 
 // OpenCL utility layer include
 #include "xcl2.hpp"
+#include "device_session.hpp"
+#include "event_profiler.hpp"
 #include <algorithm>
 #include <stdlib.h>
 #include <vector>
@@ -88,36 +90,12 @@ void mmult_fpga(
   cl::Context context;
   cl::Kernel kernel;
   cl_int err;
-  // The get_xil_devices will return vector of Xilinx Devices
-  auto devices = xcl::get_xil_devices();
-  // read_binary_file() is a utility API which will load the binaryFile
-  // and will return the pointer to file buffer.
-  auto fileBuf = xcl::read_binary_file(binaryFile);
-  cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
-  int valid_device = 0;
-  for (unsigned int i = 0; i < devices.size(); i++) {
-    auto device = devices[i];
-    // Creating Context and Command Queue for selected Device
-    OCL_CHECK(err, context = cl::Context(device, NULL, NULL, NULL, &err));
-    OCL_CHECK(err, q = cl::CommandQueue(context, device,
-                                        CL_QUEUE_PROFILING_ENABLE, &err));
-
-    std::cout << "Trying to program device[" << i
-              << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
-    cl::Program program(context, {device}, bins, NULL, &err);
-    if (err != CL_SUCCESS) {
-      std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
-    } else {
-      std::cout << "Device[" << i << "]: program successful!\n";
-      OCL_CHECK(err, kernel = cl::Kernel(program, "mmult", &err));
-      valid_device++;
-      break; // we break because we found a valid device
-    }
-  }
-  if (valid_device == 0) {
-    std::cout << "Failed to program any device found, exit!\n";
-    exit(EXIT_FAILURE);
-  }
+  // The device session programs the device once per xclbin and caches the
+  // program and kernel handles for later calls.
+  static xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  kernel = session.kernel(binaryFile, "mmult");
+  context = session.context();
+  q = session.queue();
 
   cl::Buffer buffer_in1(context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_ONLY,
                         matrix_size_bytes, source_in1.data(), &err);
@@ -148,14 +126,23 @@ void mmult_fpga(
   kernel.setArg(narg++, a_col);
   kernel.setArg(narg++, b_col);
 
+  // Time every phase of the functional run: inputs in, kernel, result out
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
   q.enqueueMigrateMemObjects({buffer_in1, buffer_in2},
-                             0 /* 0 means from host*/);
+                             0 /* 0 means from host*/, NULL, &write_event);
 
   // Launch the kernel
-  q.enqueueTask(kernel);
+  std::vector<cl::Event> write_wait(1, write_event);
+  q.enqueueTask(kernel, &write_wait, &kernel_event);
 
-  q.enqueueMigrateMemObjects({buffer_output}, CL_MIGRATE_MEM_OBJECT_HOST);
+  std::vector<cl::Event> kernel_wait(1, kernel_event);
+  q.enqueueMigrateMemObjects({buffer_output}, CL_MIGRATE_MEM_OBJECT_HOST,
+                             &kernel_wait, &read_event);
   q.finish();
+  profiler.h2d(write_event, 2 * matrix_size_bytes);
+  profiler.kernel(kernel_event, 2.0 * a_row * a_col * b_col);
+  profiler.d2h(read_event, matrix_size_bytes);
 
   // Launch the kernel and get profile data (stop-start)
   cl::Event event;
@@ -182,6 +169,7 @@ void mmult_fpga(
          "|-------------------------+-------------------------|\n");
   printf("| %-23s | %21f ms|\n", "FPGA", avg_fpga_exec_time);
   printf("|-------------------------+-------------------------|\n");
+  profiler.report("mmult");
   printf("Note: Wall Clock Time is meaningful for real hardware execution "
          "only, not for emulation.\n");
   printf("Please refer to profile summary for kernel execution time for "
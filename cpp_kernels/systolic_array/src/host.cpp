@@ -44,6 +44,15 @@ Description:
 
 *******************************************************************************/
 #include "xcl2.hpp"
+#include "bitpack.hpp"
+#include "device_session.hpp"
+#include "event_profiler.hpp"
+#include "float_gemm.hpp"
+#include "gemm_batch.hpp"
+#include "semiring_gemm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
 #include <vector>
 
 // Array Size to access
@@ -70,13 +79,501 @@ void m_softwareGold(
   }
 }
 
+// Problems of the batch mode: every BATCH_SHARING consecutive problems
+// apply the same B to their own A, as one weight matrix to many inputs
+#define BATCH_PROBLEMS 4096
+#define BATCH_SHARING 4
+// Problems timed one enqueueTask each, for the comparison
+#define SINGLE_PROBLEMS 256
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+// C = A * B for DATA_SIZE x DATA_SIZE matrices at raw pointers
+static void matmul(const int *a, const int *b, int *c) {
+  for (int i = 0; i < DATA_SIZE; i++)
+    for (int j = 0; j < DATA_SIZE; j++) {
+      int sum = 0;
+      for (int k = 0; k < DATA_SIZE; k++)
+        sum += a[i * DATA_SIZE + k] * b[k * DATA_SIZE + j];
+      c[i * DATA_SIZE + j] = sum;
+    }
+}
+
+static bool check(const std::vector<int> &gold, const std::vector<int> &out,
+                  size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (out[i] != gold[i]) {
+      std::cout << "Error: Result mismatch" << std::endl;
+      std::cout << "i = " << i << " CPU result = " << gold[i]
+                << " Device result = " << out[i] << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Batch mode: BATCH_PROBLEMS independent DATA_SIZE x DATA_SIZE products,
+// first launched one per enqueueTask of mmult with a migration in and out
+// each, then packed by xcl::GemmBatch into one launch of mmult_batch_ptr.
+// Reports problems per second of both.
+static int run_batch(const std::string &binaryFile) {
+  const int elements = DATA_SIZE * DATA_SIZE;
+  const size_t bytes = elements * sizeof(int);
+  cl_int err;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel single = session.kernel(binaryFile, "mmult");
+  cl::Kernel batched = session.kernel(binaryFile, "mmult_batch_ptr");
+  cl::CommandQueue q = session.queue();
+
+  std::default_random_engine engine;
+  std::uniform_int_distribution<int> dist(0, 9);
+  std::vector<int> A(BATCH_PROBLEMS * elements);
+  std::vector<int> B(BATCH_PROBLEMS / BATCH_SHARING * elements);
+  std::vector<int> gold(BATCH_PROBLEMS * elements);
+  std::vector<int> C(BATCH_PROBLEMS * elements, 0);
+  for (size_t i = 0; i < A.size(); i++)
+    A[i] = dist(engine);
+  for (size_t i = 0; i < B.size(); i++)
+    B[i] = dist(engine);
+  for (int p = 0; p < BATCH_PROBLEMS; p++)
+    matmul(&A[p * elements], &B[p / BATCH_SHARING * elements],
+           &gold[p * elements]);
+
+  // One launch per problem, through one set of staging buffers
+  std::vector<int, aligned_allocator<int>> stage_a(elements);
+  std::vector<int, aligned_allocator<int>> stage_b(elements);
+  std::vector<int, aligned_allocator<int>> stage_c(elements);
+  cl::Buffer buffer_a =
+      session.buffer(stage_a.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b =
+      session.buffer(stage_b.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c =
+      session.buffer(stage_c.data(), bytes, CL_MEM_WRITE_ONLY);
+  int size = DATA_SIZE;
+  OCL_CHECK(err, err = single.setArg(0, buffer_a));
+  OCL_CHECK(err, err = single.setArg(1, buffer_b));
+  OCL_CHECK(err, err = single.setArg(2, buffer_c));
+  OCL_CHECK(err, err = single.setArg(3, size));
+  OCL_CHECK(err, err = single.setArg(4, size));
+  OCL_CHECK(err, err = single.setArg(5, size));
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  for (int p = 0; p < SINGLE_PROBLEMS; p++) {
+    std::copy(&A[p * elements], &A[(p + 1) * elements], stage_a.begin());
+    std::copy(&B[p / BATCH_SHARING * elements],
+              &B[(p / BATCH_SHARING + 1) * elements], stage_b.begin());
+    OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                    0 /* 0 means from host*/));
+    OCL_CHECK(err, err = q.enqueueTask(single));
+    OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                       {buffer_c}, CL_MIGRATE_MEM_OBJECT_HOST));
+    OCL_CHECK(err, err = q.finish());
+    std::copy(stage_c.begin(), stage_c.end(), &C[p * elements]);
+  }
+  double single_s = seconds_since(t);
+  if (!check(gold, C, SINGLE_PROBLEMS * elements))
+    return EXIT_FAILURE;
+
+  // All problems in one launch
+  std::fill(C.begin(), C.end(), 0);
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
+  t = std::chrono::steady_clock::now();
+  xcl::GemmBatch batch(DATA_SIZE, DATA_SIZE, DATA_SIZE, BATCH_PROBLEMS);
+  for (int p = 0; p < BATCH_PROBLEMS; p++)
+    batch.add_shared_b(&A[p * elements], &B[p / BATCH_SHARING * elements],
+                       &C[p * elements]);
+  cl::Buffer batch_a =
+      session.buffer(batch.a(), batch.a_bytes(), CL_MEM_READ_ONLY);
+  cl::Buffer batch_b =
+      session.buffer(batch.b(), batch.b_bytes(), CL_MEM_READ_ONLY);
+  cl::Buffer batch_c =
+      session.buffer(batch.c(), batch.c_bytes(), CL_MEM_WRITE_ONLY);
+  cl::Buffer batch_offsets = session.buffer(
+      batch.offsets(), batch.offsets_bytes(), CL_MEM_READ_ONLY);
+  OCL_CHECK(err, err = batched.setArg(0, batch_a));
+  OCL_CHECK(err, err = batched.setArg(1, batch_b));
+  OCL_CHECK(err, err = batched.setArg(2, batch_c));
+  OCL_CHECK(err, err = batched.setArg(3, batch_offsets));
+  OCL_CHECK(err, err = batched.setArg(4, size));
+  OCL_CHECK(err, err = batched.setArg(5, size));
+  OCL_CHECK(err, err = batched.setArg(6, size));
+  OCL_CHECK(err, err = batched.setArg(7, batch.count()));
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                     {batch_a, batch_b, batch_offsets},
+                     0 /* 0 means from host*/, NULL, &write_event));
+  std::vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(batched, &write_wait, &kernel_event));
+  std::vector<cl::Event> kernel_wait(1, kernel_event);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({batch_c},
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  &kernel_wait, &read_event));
+  OCL_CHECK(err, err = q.finish());
+  batch.scatter();
+  double batch_s = seconds_since(t);
+  profiler.h2d(write_event,
+               batch.a_bytes() + batch.b_bytes() + batch.offsets_bytes());
+  profiler.kernel(kernel_event,
+                  2.0 * DATA_SIZE * DATA_SIZE * DATA_SIZE * batch.count());
+  profiler.d2h(read_event, batch.c_bytes());
+  if (!check(gold, C, C.size()))
+    return EXIT_FAILURE;
+
+  printf("%d problems, %d A and %d shared B packed\n", batch.count(),
+         batch.a_count(), batch.b_count());
+  printf("|-----------------+----------+--------------+--------------|\n"
+         "| Launch          | Problems |    Time (ms) |   Problems/s |\n"
+         "|-----------------+----------+--------------+--------------|\n");
+  printf("| %-15s | %8d | %12.3f | %12.0f |\n", "one per problem",
+         SINGLE_PROBLEMS, single_s * 1000, SINGLE_PROBLEMS / single_s);
+  printf("| %-15s | %8d | %12.3f | %12.0f |\n", "batched", BATCH_PROBLEMS,
+         batch_s * 1000, BATCH_PROBLEMS / batch_s);
+  printf("|-----------------+----------+--------------+--------------|\n");
+  printf("Batch speedup: %.2fx\n",
+         (BATCH_PROBLEMS / batch_s) / (SINGLE_PROBLEMS / single_s));
+  profiler.report("mmult_batch_ptr");
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  std::cout << "TEST PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// Shortest paths of the semiring mode: random graph with this share of
+// edges, weights 1 to 9
+#define GRAPH_EDGE_PERCENT 10
+
+// Runs one DATA_SIZE x DATA_SIZE product of kernel on the staging buffers
+// of a, b and c
+static void run_product(cl::CommandQueue &q, cl::Kernel &kernel,
+                        cl::Buffer &buffer_a, cl::Buffer &buffer_b,
+                        cl::Buffer &buffer_c) {
+  cl_int err;
+  int size = DATA_SIZE;
+  OCL_CHECK(err, err = kernel.setArg(0, buffer_a));
+  OCL_CHECK(err, err = kernel.setArg(1, buffer_b));
+  OCL_CHECK(err, err = kernel.setArg(2, buffer_c));
+  OCL_CHECK(err, err = kernel.setArg(3, size));
+  OCL_CHECK(err, err = kernel.setArg(4, size));
+  OCL_CHECK(err, err = kernel.setArg(5, size));
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                  0 /* 0 means from host*/));
+  OCL_CHECK(err, err = q.enqueueTask(kernel));
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects(
+                     {buffer_c}, CL_MIGRATE_MEM_OBJECT_HOST));
+  OCL_CHECK(err, err = q.finish());
+}
+
+// Semiring mode: all-pairs shortest paths of a random graph by repeated
+// squaring with mmult_minplus, against Floyd-Warshall and the CPU engine,
+// then one mmult_maxplus and one mmult_bool product against the CPU
+// engine.
+static int run_semiring(const std::string &binaryFile) {
+  const int n = DATA_SIZE;
+  const int elements = n * n;
+  const size_t bytes = elements * sizeof(int);
+  const int inf = gemm::SEMIRING_INF;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel minplus = session.kernel(binaryFile, "mmult_minplus");
+  cl::Kernel maxplus = session.kernel(binaryFile, "mmult_maxplus");
+  cl::Kernel boolean = session.kernel(binaryFile, "mmult_bool");
+  cl::CommandQueue q = session.queue();
+
+  std::vector<int, aligned_allocator<int>> stage_a(elements);
+  std::vector<int, aligned_allocator<int>> stage_b(elements);
+  std::vector<int, aligned_allocator<int>> stage_c(elements);
+  cl::Buffer buffer_a =
+      session.buffer(stage_a.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b =
+      session.buffer(stage_b.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c =
+      session.buffer(stage_c.data(), bytes, CL_MEM_WRITE_ONLY);
+
+  std::default_random_engine engine;
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int> weight(1, 9);
+  std::vector<int> W(elements);
+  for (int i = 0; i < elements; i++)
+    W[i] = percent(engine) < GRAPH_EDGE_PERCENT ? weight(engine) : inf;
+
+  // Floyd-Warshall gold
+  std::vector<int> gold(W);
+  for (int i = 0; i < n; i++)
+    gold[i * n + i] = std::min(gold[i * n + i], 0);
+  for (int k = 0; k < n; k++)
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        gold[i * n + j] = gemm::MinPlus::add(
+            gold[i * n + j],
+            gemm::MinPlus::mul(gold[i * n + k], gold[k * n + j]));
+
+  gemm::MinPlusProduct device_product = [&](const int *a, const int *b,
+                                            int *c, int) {
+    std::copy(a, a + elements, stage_a.begin());
+    std::copy(b, b + elements, stage_b.begin());
+    run_product(q, minplus, buffer_a, buffer_b, buffer_c);
+    std::copy(stage_c.begin(), stage_c.end(), c);
+  };
+  std::vector<int> D(elements);
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  int device_squarings = gemm::apsp_min_plus(W.data(), D.data(), n,
+                                             device_product);
+  double device_s = seconds_since(t);
+  if (!check(gold, D, elements))
+    return EXIT_FAILURE;
+  t = std::chrono::steady_clock::now();
+  int cpu_squarings = gemm::apsp_min_plus(W.data(), D.data(), n);
+  double cpu_s = seconds_since(t);
+  if (!check(gold, D, elements))
+    return EXIT_FAILURE;
+  int unreachable = (int)std::count(gold.begin(), gold.end(), inf);
+
+  // Longest paths of one step, with missing edges as -INF
+  std::vector<int> M(elements), out(elements);
+  for (int i = 0; i < elements; i++)
+    M[i] = (W[i] == inf) ? -inf : W[i];
+  std::copy(M.begin(), M.end(), stage_a.begin());
+  std::copy(M.begin(), M.end(), stage_b.begin());
+  run_product(q, maxplus, buffer_a, buffer_b, buffer_c);
+  gemm::semiring_matmul<gemm::MaxPlus>(M.data(), M.data(), gold.data(), n, n,
+                                       n);
+  std::copy(stage_c.begin(), stage_c.end(), out.begin());
+  if (!check(gold, out, elements))
+    return EXIT_FAILURE;
+
+  // Two-step reachability: rows of A and columns of B, one word each
+  gemm::BitMatrix A(n, n);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (W[i * n + j] != inf)
+        A.set(i, j);
+  gemm::BitMatrix AT = gemm::bit_transpose(A), R(n, n);
+  gemm::bool_matmul(A, A, R);
+  for (int i = 0; i < n; i++) {
+    stage_a[i] = (unsigned int)A.row(i)[0];
+    stage_b[i] = (unsigned int)AT.row(i)[0];
+  }
+  run_product(q, boolean, buffer_a, buffer_b, buffer_c);
+  for (int i = 0; i < n; i++) {
+    gold[i] = (int)(unsigned int)R.row(i)[0];
+    out[i] = stage_c[i];
+  }
+  if (!check(gold, out, n))
+    return EXIT_FAILURE;
+
+  printf("%d nodes, %d of %d pairs unreachable\n", n, unreachable, elements);
+  printf("|-----------------+-----------+--------------|\n"
+         "| APSP            | Squarings |    Time (ms) |\n"
+         "|-----------------+-----------+--------------|\n");
+  printf("| %-15s | %9d | %12.3f |\n", "mmult_minplus", device_squarings,
+         device_s * 1000);
+  printf("| %-15s | %9d | %12.3f |\n", "CPU engine", cpu_squarings,
+         cpu_s * 1000);
+  printf("|-----------------+-----------+--------------|\n");
+  printf("mmult_maxplus and mmult_bool match the CPU engine\n");
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  std::cout << "TEST PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// Size of the floating-point modes, the largest the fp32 array takes
+#define FLOAT_SIZE 16
+
+// Floating-point modes: one FLOAT_SIZE x FLOAT_SIZE product of random
+// fractions with mmult_fp32, _bf16 or _fp16, checked against the CPU engine
+// on the same rounded operands within the tolerance of an fp32 sum. T is
+// float, gemm::bf16 or gemm::fp16.
+template <typename T>
+static int run_float(const std::string &binaryFile, const std::string &type) {
+  const int n = FLOAT_SIZE;
+  const int elements = n * n;
+  cl_int err;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel kernel = session.kernel(binaryFile, "mmult_" + type);
+  cl::CommandQueue q = session.queue();
+
+  std::default_random_engine engine;
+  std::uniform_real_distribution<float> fraction(0, 1);
+  std::vector<float> values(elements);
+  std::vector<T, aligned_allocator<T>> A(elements), B(elements);
+  for (int i = 0; i < elements; i++)
+    values[i] = fraction(engine);
+  gemm::convert(values.data(), A.data(), elements);
+  for (int i = 0; i < elements; i++)
+    values[i] = fraction(engine);
+  gemm::convert(values.data(), B.data(), elements);
+  std::vector<float> gold(elements);
+  std::vector<float, aligned_allocator<float>> C(elements);
+  gemm::float_matmul(A.data(), B.data(), gold.data(), n, n, n);
+
+  const size_t bytes = elements * sizeof(T);
+  cl::Buffer buffer_a = session.buffer(A.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b = session.buffer(B.data(), bytes, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c =
+      session.buffer(C.data(), elements * sizeof(float), CL_MEM_WRITE_ONLY);
+  int size = n;
+  OCL_CHECK(err, err = kernel.setArg(0, buffer_a));
+  OCL_CHECK(err, err = kernel.setArg(1, buffer_b));
+  OCL_CHECK(err, err = kernel.setArg(2, buffer_c));
+  OCL_CHECK(err, err = kernel.setArg(3, size));
+  OCL_CHECK(err, err = kernel.setArg(4, size));
+  OCL_CHECK(err, err = kernel.setArg(5, size));
+
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                  0 /* 0 means from host*/,
+                                                  NULL, &write_event));
+  std::vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(kernel, &write_wait, &kernel_event));
+  std::vector<cl::Event> kernel_wait(1, kernel_event);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_c},
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  &kernel_wait, &read_event));
+  OCL_CHECK(err, err = q.finish());
+  profiler.h2d(write_event, 2 * bytes);
+  profiler.kernel(kernel_event, 2.0 * n * n * n);
+  profiler.d2h(read_event, elements * sizeof(float));
+
+  gemm::FloatError error = gemm::float_error(gold.data(), C.data(), elements);
+  double tolerance = gemm::float_tolerance(n);
+  printf("Max relative error %g (%u ULP), tolerance %g\n", error.max_rel,
+         error.max_ulp, tolerance);
+  bool match = error.max_rel <= tolerance;
+  if (!match)
+    printf("Mismatch %zu: gold: %f device: %f\n", error.worst,
+           gold[error.worst], C[error.worst]);
+  profiler.report("mmult_" + type);
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  std::cout << "TEST " << (match ? "PASSED" : "FAILED") << std::endl;
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// Host to device bandwidth the bitpack mode compares its encoder against,
+// as in bitpack_bench
+#define BITPACK_LINK_GBPS 12.0
+
+// Bitpack mode: one DATA_SIZE x DATA_SIZE product of inputs in 0..15 with
+// mmult_bitpack, each operand sent at the width its min/max scan allows,
+// checked against the CPU
+static int run_bitpack(const std::string &binaryFile) {
+  const int n = DATA_SIZE;
+  const size_t elements = n * n;
+  cl_int err;
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  cl::Kernel kernel = session.kernel(binaryFile, "mmult_bitpack");
+  cl::CommandQueue q = session.queue();
+
+  std::default_random_engine engine;
+  std::uniform_int_distribution<int> dist(0, 15);
+  std::vector<int> A(elements), B(elements), gold(elements);
+  for (size_t i = 0; i < elements; i++) {
+    A[i] = dist(engine);
+    B[i] = dist(engine);
+  }
+  matmul(A.data(), B.data(), gold.data());
+
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  gemm::BitPacking packing_a = gemm::bitpack_choose(A.data(), elements);
+  gemm::BitPacking packing_b = gemm::bitpack_choose(B.data(), elements);
+  std::vector<uint32_t, aligned_allocator<uint32_t>> bits_a(
+      gemm::bitpack_words(elements, packing_a.width));
+  std::vector<uint32_t, aligned_allocator<uint32_t>> bits_b(
+      gemm::bitpack_words(elements, packing_b.width));
+  gemm::bitpack_encode(A.data(), elements, packing_a, bits_a.data());
+  gemm::bitpack_encode(B.data(), elements, packing_b, bits_b.data());
+  double pack_s = seconds_since(t);
+  printf("A packed to %d bits, B to %d bits, at %.2f GB/s; packing pays "
+         "above %.2f GB/s on a %.0f GB/s link\n",
+         packing_a.width, packing_b.width,
+         2 * elements * sizeof(int) / pack_s * 1e-9,
+         gemm::bitpack_break_even(std::max(packing_a.width, packing_b.width),
+                                  BITPACK_LINK_GBPS),
+         BITPACK_LINK_GBPS);
+
+  const size_t bytes_a = bits_a.size() * sizeof(uint32_t);
+  const size_t bytes_b = bits_b.size() * sizeof(uint32_t);
+  std::vector<int, aligned_allocator<int>> C(elements);
+  cl::Buffer buffer_a =
+      session.buffer(bits_a.data(), bytes_a, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_b =
+      session.buffer(bits_b.data(), bytes_b, CL_MEM_READ_ONLY);
+  cl::Buffer buffer_c =
+      session.buffer(C.data(), elements * sizeof(int), CL_MEM_WRITE_ONLY);
+  int size = n;
+  OCL_CHECK(err, err = kernel.setArg(0, buffer_a));
+  OCL_CHECK(err, err = kernel.setArg(1, buffer_b));
+  OCL_CHECK(err, err = kernel.setArg(2, buffer_c));
+  OCL_CHECK(err, err = kernel.setArg(3, size));
+  OCL_CHECK(err, err = kernel.setArg(4, size));
+  OCL_CHECK(err, err = kernel.setArg(5, size));
+  OCL_CHECK(err, err = kernel.setArg(6, packing_a.width));
+  OCL_CHECK(err, err = kernel.setArg(7, packing_a.base));
+  OCL_CHECK(err, err = kernel.setArg(8, packing_b.width));
+  OCL_CHECK(err, err = kernel.setArg(9, packing_b.base));
+
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_a, buffer_b},
+                                                  0 /* 0 means from host*/,
+                                                  NULL, &write_event));
+  std::vector<cl::Event> write_wait(1, write_event);
+  OCL_CHECK(err, err = q.enqueueTask(kernel, &write_wait, &kernel_event));
+  std::vector<cl::Event> kernel_wait(1, kernel_event);
+  OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_c},
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  &kernel_wait, &read_event));
+  OCL_CHECK(err, err = q.finish());
+  profiler.h2d(write_event, bytes_a + bytes_b);
+  profiler.kernel(kernel_event, 2.0 * n * n * n);
+  profiler.d2h(read_event, elements * sizeof(int));
+
+  std::vector<int> out(C.begin(), C.end());
+  bool match = check(gold, out, elements);
+  profiler.report("mmult_bitpack");
+  printf("Note: Wall Clock Time is meaningful for real hardware execution "
+         "only, not for emulation.\n");
+  std::cout << "TEST " << (match ? "PASSED" : "FAILED") << std::endl;
+  return (match ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cout << "Usage: " << argv[0] << " <XCLBIN File>" << std::endl;
+  if (argc != 2 && argc != 3) {
+    std::cout << "Usage: " << argv[0]
+              << " <XCLBIN File> [mmult|mmult_winograd|batch|semiring|"
+                 "fp32|bf16|fp16|bitpack]"
+              << std::endl;
     return EXIT_FAILURE;
   }
 
   std::string binaryFile = argv[1];
+  // mmult_winograd computes the same products with Winograd's inner-product
+  // algorithm, see src/mmult_winograd.cpp. "batch" compares one launch per
+  // small problem with one batched launch of mmult_batch_ptr. "semiring"
+  // runs shortest paths on mmult_minplus and checks mmult_maxplus and
+  // mmult_bool. "fp32", "bf16" and "fp16" run mmult_fp32/_bf16/_fp16, which
+  // accumulate in fp32. "bitpack" runs mmult_bitpack, which reads A and B
+  // bit-packed to the width of their range.
+  std::string kernelName = (argc == 3) ? argv[2] : "mmult";
+  if (kernelName == "batch")
+    return run_batch(binaryFile);
+  if (kernelName == "semiring")
+    return run_semiring(binaryFile);
+  if (kernelName == "fp32")
+    return run_float<float>(binaryFile, kernelName);
+  if (kernelName == "bf16")
+    return run_float<gemm::bf16>(binaryFile, kernelName);
+  if (kernelName == "fp16")
+    return run_float<gemm::fp16>(binaryFile, kernelName);
+  if (kernelName == "bitpack")
+    return run_bitpack(binaryFile);
+  if (kernelName != "mmult" && kernelName != "mmult_winograd") {
+    std::cout << "Unknown kernel " << kernelName << std::endl;
+    return EXIT_FAILURE;
+  }
 
   // Allocate Memory in Host Memory
   if (DATA_SIZE > MAX_SIZE) {
@@ -107,36 +604,12 @@ int main(int argc, char **argv) {
   }
 
   // OPENCL HOST CODE AREA START
-  auto devices = xcl::get_xil_devices();
-
-  // read_binary_file() is a utility API which will load the binaryFile
-  // and will return the pointer to file buffer.
-  auto fileBuf = xcl::read_binary_file(binaryFile);
-  cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
-  int valid_device = 0;
-  for (unsigned int i = 0; i < devices.size(); i++) {
-    auto device = devices[i];
-    // Creating Context and Command Queue for selected Device
-    OCL_CHECK(err, context = cl::Context(device, NULL, NULL, NULL, &err));
-    OCL_CHECK(err, q = cl::CommandQueue(context, device,
-                                        CL_QUEUE_PROFILING_ENABLE, &err));
-
-    std::cout << "Trying to program device[" << i
-              << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
-    cl::Program program(context, {device}, bins, NULL, &err);
-    if (err != CL_SUCCESS) {
-      std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
-    } else {
-      std::cout << "Device[" << i << "]: program successful!\n";
-      OCL_CHECK(err, krnl_systolic_array = cl::Kernel(program, "mmult", &err));
-      valid_device++;
-      break; // we break because we found a valid device
-    }
-  }
-  if (valid_device == 0) {
-    std::cout << "Failed to program any device found, exit!\n";
-    exit(EXIT_FAILURE);
-  }
+  // The device session programs the device once per xclbin and caches the
+  // program and kernel handles for later calls.
+  xcl::DeviceSession session(CL_QUEUE_PROFILING_ENABLE);
+  krnl_systolic_array = session.kernel(binaryFile, kernelName);
+  context = session.context();
+  q = session.queue();
 
   // Allocate Buffer in Global Memory
   OCL_CHECK(err, cl::Buffer buffer_in1(
@@ -160,18 +633,27 @@ int main(int argc, char **argv) {
   OCL_CHECK(err, err = krnl_systolic_array.setArg(4, a_col));
   OCL_CHECK(err, err = krnl_systolic_array.setArg(5, b_col));
 
+  // Time every phase of the functional run: inputs in, kernel, result out
+  xcl::EventProfiler profiler;
+  cl::Event write_event, kernel_event, read_event;
+
   // Copy input data to device global memory
   OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_in1, buffer_in2},
-                                                  0 /* 0 means from host*/));
+                                                  0 /* 0 means from host*/,
+                                                  NULL, &write_event));
 
   // Launch the Kernel
-  OCL_CHECK(err, err = q.enqueueTask(krnl_systolic_array));
+  OCL_CHECK(err, err = q.enqueueTask(krnl_systolic_array, NULL, &kernel_event));
   q.finish();
 
   // Copy Result from Device Global Memory to Host Local Memory
   OCL_CHECK(err, err = q.enqueueMigrateMemObjects({buffer_output},
-                                                  CL_MIGRATE_MEM_OBJECT_HOST));
+                                                  CL_MIGRATE_MEM_OBJECT_HOST,
+                                                  NULL, &read_event));
   q.finish();
+  profiler.h2d(write_event, 2 * matrix_size_bytes);
+  profiler.kernel(kernel_event, 2.0 * DATA_SIZE * DATA_SIZE * DATA_SIZE);
+  profiler.d2h(read_event, matrix_size_bytes);
   // OPENCL HOST CODE AREA END
 
   // Compute Software Results
@@ -223,6 +705,7 @@ int main(int argc, char **argv) {
   printf("|-------------------------+-------------------------|\n");
   printf("| Speedup:  %23f                                    | \n", time_taken_ms/avg_fpga_exec_time);
   printf("|-------------------------+-------------------------|\n");
+  profiler.report(kernelName);
   printf("Note: Wall Clock Time is meaningful for real hardware execution "
          "only, not for emulation.\n");
   printf("Please refer to profile summary for kernel execution time for "
@@ -70,12 +70,310 @@ Kernel Description :
 */
 
 #include <stdio.h>
+#include <string.h>
 
 // Maximum Array Size
 #define MAX_SIZE 32
 
-// TRIPCOUNT identifier
+// TRIPCOUNT identifiers
 const unsigned int c_size = MAX_SIZE;
+const unsigned int c_batch = 1024;
+
+// Semirings of the kernels below: zero() is the identity of add() and
+// absorbs mul(). PlusTimes is the product of mmult, MinPlus gives shortest
+// and MaxPlus longest paths, with INT_MAX / -INT_MAX as "no path" (see
+// common/includes/gemm/semiring_gemm.hpp).
+#define SEMIRING_INF 0x7fffffff
+// a + b saturated to [-SEMIRING_INF, SEMIRING_INF], so that a long finite
+// path does not wrap
+static int semiring_add_sat(int a, int b) {
+#pragma HLS INLINE
+  long long sum = (long long)a + b;
+  return (sum > SEMIRING_INF) ? SEMIRING_INF
+         : (sum < -SEMIRING_INF) ? -SEMIRING_INF
+                                 : (int)sum;
+}
+struct PlusTimes {
+  static int zero() { return 0; }
+  static int add(int a, int b) { return a + b; }
+  static int mul(int a, int b) { return a * b; }
+};
+struct MinPlus {
+  static int zero() { return SEMIRING_INF; }
+  static int add(int a, int b) { return a < b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == SEMIRING_INF || b == SEMIRING_INF) ? SEMIRING_INF
+                                                    : semiring_add_sat(a, b);
+  }
+};
+struct MaxPlus {
+  static int zero() { return -SEMIRING_INF; }
+  static int add(int a, int b) { return a > b ? a : b; }
+  static int mul(int a, int b) {
+    return (a == -SEMIRING_INF || b == -SEMIRING_INF) ? -SEMIRING_INF
+                                                      : semiring_add_sat(a, b);
+  }
+};
+
+// Epilogue of writeC, selected at run time: C = alpha * A * B + beta * C,
+// then by flags + bias[j], ReLU, and requantization to int8 by a rounding
+// right shift and saturation, computed by epilogue() of
+// common/includes/gemm/epilogue_core.hpp like the host reference. The
+// identity leaves writeC a plain copy.
+#include "../../../common/includes/gemm/epilogue_core.hpp"
+using gemm::EPI_BIAS;
+using gemm::epilogue;
+using gemm::epilogue_args;
+using gemm::epilogue_identity;
+
+// Operand packing of readA and readB (see common/includes/gemm/bitpack.hpp):
+// element loc is base plus bits width * (loc % lanes) upwards of word
+// loc / lanes, lanes = 32 / width for widths of 1, 2, 4, 8 or 32 bits. The
+// plain packing is one int32 element per word.
+struct bitpack_args {
+  int width, base;
+};
+static const bitpack_args bitpack_plain = {32, 0};
+
+// Log2 of the lanes of a packing
+static int lanes_log2(int width) {
+  switch (width) {
+  case 1:
+    return 5;
+  case 2:
+    return 4;
+  case 4:
+    return 3;
+  case 8:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// The floating-point array is smaller: each of its processing elements holds
+// an fp32 multiplier and adder, several DSPs each instead of one
+#define FLOAT_MAX_SIZE 16
+// Partial sums per processing element of the floating-point array
+#define FLOAT_PARTIALS 8
+const unsigned int c_float_size = FLOAT_MAX_SIZE;
+const unsigned int c_float_elems = FLOAT_MAX_SIZE * FLOAT_MAX_SIZE;
+
+static float bits_float(unsigned int bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Element types of the floating-point kernels below: the type read from
+// global memory and its value in fp32, which accumulates all of them. bf16
+// and fp16 are raw bit patterns; their products are exact in fp32.
+struct fp32_elem {
+  typedef float storage;
+  static float value(float x) { return x; }
+};
+struct bf16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    return bits_float((unsigned int)x << 16);
+  }
+};
+struct fp16_elem {
+  typedef unsigned short storage;
+  static float value(unsigned short x) {
+    unsigned int exp = (x >> 10) & 0x1f;
+    unsigned int mant = x & 0x3ff;
+    float mag = (exp == 0) ? mant * 5.9604645e-8f // subnormal, mant * 2^-24
+                : (exp == 0x1f)
+                    ? bits_float(0x7f800000 | (mant ? 0x400000 : 0) |
+                                 (mant << 13))
+                    : bits_float(((exp + 112) << 23) | (mant << 13));
+    return (x & 0x8000) ? -mag : mag;
+  }
+};
+
+// mmult on floating-point operands with fp32 accumulation, up to
+// FLOAT_MAX_SIZE. One running sum per processing element would put the
+// latency of the floating-point adder on the loop-carried path of systolic1;
+// each element rotates over FLOAT_PARTIALS sums instead, so that systolic1
+// still pipelines at II=1. writeC adds the partial sums, an order the host
+// verifies within a tolerance rather than exactly.
+template <typename E>
+static void mmult_typed(const typename E::storage *a,
+                        const typename E::storage *b, float *c, int a_row,
+                        int a_col, int b_col) {
+  float localA[FLOAT_MAX_SIZE][FLOAT_MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  float localB[FLOAT_MAX_SIZE][FLOAT_MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  float localC[FLOAT_PARTIALS][FLOAT_MAX_SIZE][FLOAT_MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+readA:
+  for (int loc = 0, i = 0, j = 0; loc < a_row * a_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_float_elems max = c_float_elems
+    if (j == a_col) {
+      i++;
+      j = 0;
+    }
+    localA[i][j] = E::value(a[loc]);
+  }
+
+readB:
+  for (int loc = 0, i = 0, j = 0; loc < a_col * b_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_float_elems max = c_float_elems
+    if (j == b_col) {
+      i++;
+      j = 0;
+    }
+    localB[i][j] = E::value(b[loc]);
+  }
+
+clearC:
+  for (int p = 0; p < FLOAT_PARTIALS; p++)
+    for (int i = 0; i < FLOAT_MAX_SIZE; i++)
+      for (int j = 0; j < FLOAT_MAX_SIZE; j++)
+        localC[p][i][j] = 0;
+
+systolic1:
+  for (int k = 0; k < a_col; k++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_float_size max = c_float_size
+#pragma HLS DEPENDENCE variable = localC inter distance = 8 true
+  systolic2:
+    for (int i = 0; i < FLOAT_MAX_SIZE; i++) {
+    systolic3:
+      for (int j = 0; j < FLOAT_MAX_SIZE; j++) {
+        float a_val = (i < a_row) ? localA[i][k] : 0;
+        float b_val = (j < b_col) ? localB[k][j] : 0;
+        localC[k % FLOAT_PARTIALS][i][j] += a_val * b_val;
+      }
+    }
+  }
+
+writeC:
+  for (int loc = 0, i = 0, j = 0; loc < a_row * b_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_float_elems max = c_float_elems
+    if (j == b_col) {
+      i++;
+      j = 0;
+    }
+    float sum = 0;
+    for (int p = 0; p < FLOAT_PARTIALS; p++) {
+#pragma HLS UNROLL
+      sum += localC[p][i][j];
+    }
+    c[loc] = sum;
+  }
+}
+
+// One problem of the batched, semiring and epilogue kernels below, through
+// local buffers of the caller so that B can stay on chip from one problem to
+// the next: readB is skipped unless load_b. Same loops as mmult, with the
+// multiply-add of each processing element taken from the semiring S and epi
+// applied in writeC, bias holding b_col values when epi has EPI_BIAS. a and b
+// are packed as pack_a and pack_b: readA and readB take one element per
+// iteration from a word register refilled every lanes elements, so packed
+// operands take 32 / width times fewer reads.
+template <typename S>
+static void mmult_one(const int *a, const int *b, int *c, int a_row,
+                      int a_col, int b_col, bool load_b,
+                      int localA[MAX_SIZE][MAX_SIZE],
+                      int localB[MAX_SIZE][MAX_SIZE],
+                      int localC[MAX_SIZE][MAX_SIZE],
+                      const int *bias = 0,
+                      const epilogue_args &epi = epilogue_identity,
+                      const bitpack_args &pack_a = bitpack_plain,
+                      const bitpack_args &pack_b = bitpack_plain) {
+#pragma HLS INLINE
+  int b_row = a_col;
+  int c_row = a_row;
+  int c_col = b_col;
+
+  const int shift_a = lanes_log2(pack_a.width);
+  const int shift_b = lanes_log2(pack_b.width);
+  const unsigned int mask_a =
+      (pack_a.width == 32) ? ~0u : (1u << pack_a.width) - 1;
+  const unsigned int mask_b =
+      (pack_b.width == 32) ? ~0u : (1u << pack_b.width) - 1;
+  unsigned int word_a = 0, word_b = 0;
+
+readA:
+  for (int loc = 0, i = 0, j = 0; loc < a_row * a_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == a_col) {
+      i++;
+      j = 0;
+    }
+    if ((loc & ((1 << shift_a) - 1)) == 0)
+      word_a = a[loc >> shift_a];
+    localA[i][j] = pack_a.base + (int)(word_a & mask_a);
+    word_a = (pack_a.width == 32) ? 0 : word_a >> pack_a.width;
+  }
+
+  int localBias[MAX_SIZE];
+  if (epi.flags & EPI_BIAS) {
+  readBias:
+    for (int j = 0; j < b_col; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+      localBias[j] = bias[j];
+    }
+  }
+
+  if (load_b) {
+  readB:
+    for (int loc = 0, i = 0, j = 0; loc < b_row * b_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+      if (j == b_col) {
+        i++;
+        j = 0;
+      }
+      if ((loc & ((1 << shift_b) - 1)) == 0)
+        word_b = b[loc >> shift_b];
+      localB[i][j] = pack_b.base + (int)(word_b & mask_b);
+      word_b = (pack_b.width == 32) ? 0 : word_b >> pack_b.width;
+    }
+  }
+
+systolic1:
+  for (int k = 0; k < a_col; k++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+  systolic2:
+    for (int i = 0; i < MAX_SIZE; i++) {
+    systolic3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+        int last = (k == 0) ? S::zero() : localC[i][j];
+        int a_val = (i < a_row && k < a_col) ? localA[i][k] : S::zero();
+        int b_val = (k < b_row && j < b_col) ? localB[k][j] : S::zero();
+        localC[i][j] = S::add(last, S::mul(a_val, b_val));
+      }
+    }
+  }
+
+writeC:
+  for (int loc = 0, i = 0, j = 0; loc < c_row * c_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == c_col) {
+      i++;
+      j = 0;
+    }
+    c[loc] = epilogue(epi, localC[i][j], epi.beta ? c[loc] : 0,
+                      (epi.flags & EPI_BIAS) ? localBias[j] : 0);
+  }
+}
+
+// mmult over the semiring S
+template <typename S>
+static void mmult_semiring(const int *a, const int *b, int *c, int a_row,
+                           int a_col, int b_col) {
+  int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+  mmult_one<S>(a, b, c, a_row, a_col, b_col, true, localA, localB, localC);
+}
 
 extern "C" {
 void mmult(const int *a, // Read-Only Matrix A
@@ -198,4 +496,166 @@ writeC:
     c[loc] = localC[i][j];
   }
 }
+
+// A batch of independent products in one launch, all of the same shape.
+// Problem p reads A at a + p * stride_a and B at b + p * stride_b and
+// writes C at c + p * stride_c, strides in elements. A stride_b of 0
+// applies one B to the whole batch, which is then read once.
+void mmult_batch(const int *a, const int *b, int *c, int a_row, int a_col,
+                 int b_col, int batch, int stride_a, int stride_b,
+                 int stride_c) {
+  int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+batch_loop:
+  for (int p = 0; p < batch; p++) {
+#pragma HLS LOOP_TRIPCOUNT min = 1 max = c_batch
+    mmult_one<PlusTimes>(a + p * stride_a, b + p * stride_b,
+                         c + p * stride_c, a_row, a_col, b_col,
+                         p == 0 || stride_b != 0, localA, localB, localC);
+  }
+}
+
+// A batch of independent products in one launch, placed by a table of
+// element offsets, three per problem: A in a, B in b and C in c (see
+// common/includes/xcl2/gemm_batch.hpp). B is read again only when its
+// offset differs from that of the previous problem.
+void mmult_batch_ptr(const int *a, const int *b, int *c, const int *offsets,
+                     int a_row, int a_col, int b_col, int batch) {
+  int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+  int last_b = -1;
+batch_loop:
+  for (int p = 0; p < batch; p++) {
+#pragma HLS LOOP_TRIPCOUNT min = 1 max = c_batch
+    int offset_a = offsets[3 * p];
+    int offset_b = offsets[3 * p + 1];
+    int offset_c = offsets[3 * p + 2];
+    mmult_one<PlusTimes>(a + offset_a, b + offset_b, c + offset_c, a_row,
+                         a_col, b_col, offset_b != last_b, localA, localB,
+                         localC);
+    last_b = offset_b;
+  }
+}
+
+// Shortest paths: min over k of a[i][k] + b[k][j], INT_MAX for no path
+void mmult_minplus(const int *a, const int *b, int *c, int a_row, int a_col,
+                   int b_col) {
+  mmult_semiring<MinPlus>(a, b, c, a_row, a_col, b_col);
+}
+
+// Longest paths: max over k of a[i][k] + b[k][j], -INT_MAX for no path
+void mmult_maxplus(const int *a, const int *b, int *c, int a_row, int a_col,
+                   int b_col) {
+  mmult_semiring<MaxPlus>(a, b, c, a_row, a_col, b_col);
+}
+
+// mmult with an epilogue fused into writeC, selected at run time:
+// c = alpha * a * b + beta * c, then by flags + bias[j] (b_col values),
+// ReLU and requantization to int8 by a rounding right shift of shift bits.
+// c is read back only when beta is not 0.
+void mmult_epilogue(const int *a, const int *b, int *c, const int *bias,
+                    int a_row, int a_col, int b_col, int alpha, int beta,
+                    int flags, int shift) {
+  int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+  epilogue_args epi = {alpha, beta, flags, shift};
+  mmult_one<PlusTimes>(a, b, c, a_row, a_col, b_col, true, localA, localB,
+                       localC, bias, epi);
+}
+
+// Bit-packed operands of width1 and width2 bits offset by base1 and base2,
+// int32 result
+void mmult_bitpack(const int *a, const int *b, int *c, int a_row, int a_col,
+                   int b_col, int width1, int base1, int width2, int base2) {
+  int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+  int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+  int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+  bitpack_args pack_a = {width1, base1};
+  bitpack_args pack_b = {width2, base2};
+  mmult_one<PlusTimes>(a, b, c, a_row, a_col, b_col, true, localA, localB,
+                       localC, 0, epilogue_identity, pack_a, pack_b);
+}
+
+// fp32 operands and result, up to FLOAT_MAX_SIZE
+void mmult_fp32(const float *a, const float *b, float *c, int a_row,
+                int a_col, int b_col) {
+  mmult_typed<fp32_elem>(a, b, c, a_row, a_col, b_col);
+}
+
+// bf16 operands, half the transfers of mmult_fp32 for A and B, fp32 result
+void mmult_bf16(const unsigned short *a, const unsigned short *b, float *c,
+                int a_row, int a_col, int b_col) {
+  mmult_typed<bf16_elem>(a, b, c, a_row, a_col, b_col);
+}
+
+// fp16 operands, fp32 result
+void mmult_fp16(const unsigned short *a, const unsigned short *b, float *c,
+                int a_row, int a_col, int b_col) {
+  mmult_typed<fp16_elem>(a, b, c, a_row, a_col, b_col);
+}
+
+// Boolean product over (OR, AND) on bit-packed operands: a holds the rows of
+// A and b the columns of B (rows of B transposed), bit k of each word for
+// element k, and c receives the rows of C, bit j for column j. Every
+// processing element ANDs one row with one column and ORs the 32 bits in
+// one step, so the whole array takes one cycle instead of a_col.
+void mmult_bool(const unsigned int *a, const unsigned int *b, unsigned int *c,
+                int a_row, int a_col, int b_col) {
+  unsigned int rowsA[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = rowsA dim = 1 complete
+  unsigned int colsB[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = colsB dim = 1 complete
+  unsigned int rowsC[MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = rowsC dim = 1 complete
+
+  unsigned int k_mask = (a_col >= 32) ? ~0u : (1u << a_col) - 1;
+
+readA:
+  for (int i = 0; i < a_row; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+    rowsA[i] = a[i] & k_mask;
+  }
+
+readB:
+  for (int j = 0; j < b_col; j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+    colsB[j] = b[j] & k_mask;
+  }
+
+systolic1:
+  for (int i = 0; i < MAX_SIZE; i++) {
+    unsigned int row = 0;
+  systolic2:
+    for (int j = 0; j < MAX_SIZE; j++) {
+      bool hit = (i < a_row && j < b_col) && (rowsA[i] & colsB[j]) != 0;
+      row |= (unsigned int)hit << j;
+    }
+    rowsC[i] = row;
+  }
+
+writeC:
+  for (int i = 0; i < a_row; i++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size max = c_size
+    c[i] = rowsC[i];
+  }
+}
 }
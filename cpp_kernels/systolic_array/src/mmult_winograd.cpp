@@ -0,0 +1,218 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*******************************************************************************
+
+Vitis Key Concept :
+
+    This is the systolic array matrix multiplication of mmult.cpp rewritten
+    with Winograd's 1968 inner-product algorithm. Half of the multiplications
+    in the array are traded for additions, which are cheap in FPGA fabric, so
+    the same DSP budget supports a larger tile.
+
+*******************************************************************************/
+
+/*
+
+Kernel Description :
+
+    Every element of C is an inner product of a row of A and a column of B.
+    Winograd pairs consecutive terms of the inner product:
+
+        c[i][j] = sum_k (a[i][2k] + b[2k+1][j]) * (a[i][2k+1] + b[2k][j])
+                  - rowCorr[i] - colCorr[j]
+
+        rowCorr[i] = sum_k a[i][2k] * a[i][2k+1]
+        colCorr[j] = sum_k b[2k][j] * b[2k+1][j]
+
+    The correction terms only depend on one input each, so they are
+    accumulated while A and B are read, with a single multiplier per load
+    loop. The array then needs one multiplication per pair of k instead of
+    two, and writeC subtracts the corrections. An odd a_col is padded with a
+    zero column/row, which adds nothing to either side.
+
+    The arithmetic is done in unsigned so that the result wraps modulo 2^32
+    exactly like the products and sums of mmult; the outputs are bit for bit
+    the same.
+
+    Arguments :
+
+        int *a     (input )  --> Input  Matrix A
+        int *b     (input )  --> Input  Matrix B
+        int *c     (output)  --> Output Matrix
+        int  a_row (input )  --> Row Size Matrix A
+        int  a_col (input )  --> Col Size Matrix A
+        int  b_col (input )  --> Col Size Matrix B
+
+    Kernel Configuration :
+
+        Max Size    --> 44
+
+    Note :
+        mmult consumes one k per cycle with MAX_SIZE * MAX_SIZE multipliers.
+        Here systolic1 consumes one pair of k every two cycles, the same rate,
+        so each multiplier can serve two processing elements and the array
+        needs MAX_SIZE * MAX_SIZE / 2 of them. An ALLOCATION pragma on
+        systolic1 holds HLS to that: 44 * 44 / 2 = 968, within the
+        32 * 32 = 1024 multipliers of mmult.
+*/
+
+#include <stdio.h>
+
+// Maximum Array Size
+#define MAX_SIZE 44
+
+// TRIPCOUNT identifiers
+const unsigned int c_size = MAX_SIZE;
+const unsigned int c_half = MAX_SIZE / 2;
+
+extern "C" {
+void mmult_winograd(const int *a, // Read-Only Matrix A
+                    const int *b, // Read-Only Matrix B
+                    int *c,       // Output Result
+                    int a_row,    // Matrix A Row Size
+                    int a_col,    // Matrix A Col Size
+                    int b_col     // Matrix B Col Size
+                    ) {
+
+  int b_row = a_col;
+  int c_row = a_row;
+  int c_col = b_col;
+
+  // Local memory to store input and output matrices
+  unsigned int localA[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localA dim = 1 complete
+
+  unsigned int localB[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localB dim = 2 complete
+
+  unsigned int localC[MAX_SIZE][MAX_SIZE];
+#pragma HLS ARRAY_PARTITION variable = localC dim = 0 complete
+
+  // Correction terms, one per row of A and one per column of B
+  unsigned int rowCorr[MAX_SIZE];
+  unsigned int colCorr[MAX_SIZE];
+
+  // Value of the previous element, the even partner of the next odd one
+  unsigned int even = 0;
+
+// Burst reads on input matrices from global memory
+// Read Input A and accumulate the row corrections: every odd column is
+// multiplied with the even column read just before it
+readA:
+  for (int loc = 0, i = 0, j = 0; loc < a_row * a_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == a_col) {
+      i++;
+      j = 0;
+    }
+    unsigned int val = a[loc];
+    localA[i][j] = val;
+    if (j == 0)
+      rowCorr[i] = 0;
+    if (j & 1)
+      rowCorr[i] += even * val;
+    even = val;
+  }
+
+// Read Input B and accumulate the column corrections. B is read row by row,
+// so the even row is kept in localB and read back on the odd row
+readB:
+  for (int loc = 0, i = 0, j = 0; loc < b_row * b_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == b_col) {
+      i++;
+      j = 0;
+    }
+    unsigned int val = b[loc];
+    localB[i][j] = val;
+    if (i == 0)
+      colCorr[j] = 0;
+    if (i & 1)
+      colCorr[j] += localB[i - 1][j] * val;
+  }
+
+// Perform systolic matrix multiply
+// The array has the same shape as in mmult.cpp, but every iteration of
+// systolic1 consumes the pair of columns 2k, 2k+1 of A and the pair of rows
+// 2k, 2k+1 of B. Each processing element computes one product per pair:
+//
+//   C[i][j] += (A[i][2k] + B[2k+1][j]) * (A[i][2k+1] + B[2k][j])
+//
+// The initiation interval of 2 keeps the rate at one k per cycle, and the
+// ALLOCATION limit (MAX_SIZE * MAX_SIZE / 2) makes HLS share each multiplier
+// between two processing elements rather than leave that to its scheduler.
+systolic1:
+  for (int k = 0; k < a_col; k += 2) {
+#pragma HLS LOOP_TRIPCOUNT min = c_half max = c_half
+#pragma HLS PIPELINE II = 2
+#pragma HLS ALLOCATION operation instances = mul limit = 968
+  systolic2:
+    for (int i = 0; i < MAX_SIZE; i++) {
+    systolic3:
+      for (int j = 0; j < MAX_SIZE; j++) {
+
+        // Get previous sum
+        unsigned int last = (k == 0) ? 0 : localC[i][j];
+
+        // Update current sum
+        // Handle boundary conditions, the missing partner of an odd
+        // a_col is zero
+        bool paired = (k + 1 < a_col);
+        unsigned int a0 = (i < a_row) ? localA[i][k] : 0;
+        unsigned int a1 = (i < a_row && paired) ? localA[i][k + 1] : 0;
+        unsigned int b0 = (j < b_col) ? localB[k][j] : 0;
+        unsigned int b1 = (j < b_col && paired) ? localB[k + 1][j] : 0;
+        unsigned int result = last + (a0 + b1) * (a1 + b0);
+
+        // Write back results
+        localC[i][j] = result;
+      }
+    }
+  }
+
+// Burst write from output matrices to global memory
+// Burst write from matrix C, removing the correction terms
+writeC:
+  for (int loc = 0, i = 0, j = 0; loc < c_row * c_col; loc++, j++) {
+#pragma HLS LOOP_TRIPCOUNT min = c_size*c_size max = c_size*c_size
+    if (j == c_col) {
+      i++;
+      j = 0;
+    }
+    c[loc] = localC[i][j] - rowCorr[i] - colCorr[j];
+  }
+}
+}
@@ -0,0 +1,193 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+
+/*  Winograd inner-product kernel verification and operation count
+https://github.com/kaanolgu/matrix_multiplications
+**********************************************
+Runs mmult and mmult_winograd on the host as a C++ simulation of the two
+kernels and checks them bit for bit against a reference:
+  - random shapes up to 32 x 32, with both even and odd a_col, against
+    mmult and the reference,
+  - random shapes up to 44 x 44 with full-range values, whose products and
+    sums wrap, against the reference computed modulo 2^32.
+It then reports the multiplications and additions of both kernels for one
+tile, and the multipliers their arrays need at one k per cycle.
+Build and run with "make bench".
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+extern "C" void mmult(const int *a, const int *b, int *c, int a_row,
+                      int a_col, int b_col);
+extern "C" void mmult_winograd(const int *a, const int *b, int *c, int a_row,
+                               int a_col, int b_col);
+
+// Must match MAX_SIZE in mmult.cpp and mmult_winograd.cpp
+const int MMULT_MAX_SIZE = 32;
+const int WINOGRAD_MAX_SIZE = 44;
+const int SHAPES_PER_TEST = 200;
+
+std::default_random_engine engine;
+
+int gen_random(int lo, int hi) {
+  std::uniform_int_distribution<int> dist(lo, hi);
+  return dist(engine);
+}
+
+// Classical inner products, wrapping modulo 2^32
+void reference(const std::vector<int> &a, const std::vector<int> &b,
+               std::vector<int> &c, int a_row, int a_col, int b_col) {
+  for (int i = 0; i < a_row; i++) {
+    for (int j = 0; j < b_col; j++) {
+      unsigned int sum = 0;
+      for (int k = 0; k < a_col; k++)
+        sum += (unsigned int)a[i * a_col + k] * (unsigned int)b[k * b_col + j];
+      c[i * b_col + j] = sum;
+    }
+  }
+}
+
+bool verify(const std::vector<int> &gold, const std::vector<int> &output,
+            const char *name, int a_row, int a_col, int b_col) {
+  for (int i = 0; i < a_row * b_col; i++) {
+    if (output[i] != gold[i]) {
+      printf("Mismatch (%s, %d x %d x %d) %d: gold: %d result: %d\n", name,
+             a_row, a_col, b_col, i, gold[i], output[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs the kernels on random shapes up to max_size, with values in [lo, hi].
+// mmult is only run when the shape fits its array and the values can not
+// overflow a signed int.
+bool run_shapes(int max_size, int lo, int hi, bool with_mmult,
+                int *odd_shapes) {
+  for (int s = 0; s < SHAPES_PER_TEST; s++) {
+    int a_row = gen_random(1, max_size);
+    int a_col = gen_random(1, max_size);
+    int b_col = gen_random(1, max_size);
+    if (a_col & 1)
+      (*odd_shapes)++;
+
+    std::vector<int> a(a_row * a_col), b(a_col * b_col);
+    std::vector<int> gold(a_row * b_col), c(a_row * b_col);
+    for (size_t i = 0; i < a.size(); i++)
+      a[i] = gen_random(lo, hi);
+    for (size_t i = 0; i < b.size(); i++)
+      b[i] = gen_random(lo, hi);
+    reference(a, b, gold, a_row, a_col, b_col);
+
+    mmult_winograd(a.data(), b.data(), c.data(), a_row, a_col, b_col);
+    if (!verify(gold, c, "mmult_winograd", a_row, a_col, b_col))
+      return false;
+    if (with_mmult) {
+      mmult(a.data(), b.data(), c.data(), a_row, a_col, b_col);
+      if (!verify(gold, c, "mmult", a_row, a_col, b_col))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Operations of one tile of n x n x n in the systolic array and the load and
+// store loops around it
+struct OpCount {
+  long mults;
+  long adds;
+  long multipliers; // in the array, at one k per cycle
+};
+
+OpCount classical_ops(long n) {
+  OpCount ops;
+  ops.mults = n * n * n;
+  ops.adds = n * n * n;
+  ops.multipliers = n * n;
+  return ops;
+}
+
+OpCount winograd_ops(long n) {
+  long pairs = (n + 1) / 2;
+  OpCount ops;
+  // Array: one product, two pre-additions and one accumulation per pair.
+  // Loads: one product and one accumulation per pair of every row of A and
+  // column of B. Store: two subtractions per element of C
+  ops.mults = n * n * pairs + 2 * n * pairs;
+  ops.adds = 3 * n * n * pairs + 2 * n * pairs + 2 * n * n;
+  // Each multiplier is shared by two processing elements
+  ops.multipliers = (n * n + 1) / 2;
+  return ops;
+}
+
+void print_ops(const char *name, long n, const OpCount &ops) {
+  char tile[32];
+  snprintf(tile, sizeof(tile), "%ld x %ld x %ld", n, n, n);
+  printf("| %-14s | %-14s | %9ld | %9ld | %11ld |\n", name, tile, ops.mults,
+         ops.adds, ops.multipliers);
+}
+
+int main() {
+  int odd_shapes = 0;
+  bool match = run_shapes(MMULT_MAX_SIZE, -100, 100, true, &odd_shapes) &&
+               run_shapes(WINOGRAD_MAX_SIZE, -2147483647 - 1, 2147483647,
+                          false, &odd_shapes);
+  printf("Verified %d shapes (%d with odd a_col) bit for bit\n",
+         2 * SHAPES_PER_TEST, odd_shapes);
+
+  OpCount c32 = classical_ops(MMULT_MAX_SIZE);
+  OpCount w32 = winograd_ops(MMULT_MAX_SIZE);
+  OpCount w44 = winograd_ops(WINOGRAD_MAX_SIZE);
+  printf("|----------------+----------------+-----------+-----------+-------------|\n"
+         "| Kernel         | Tile           |     Mults |      Adds | Multipliers |\n"
+         "|----------------+----------------+-----------+-----------+-------------|\n");
+  print_ops("mmult", MMULT_MAX_SIZE, c32);
+  print_ops("mmult_winograd", MMULT_MAX_SIZE, w32);
+  print_ops("mmult_winograd", WINOGRAD_MAX_SIZE, w44);
+  printf("|----------------+----------------+-----------+-----------+-------------|\n");
+  printf("Multiplications per tile at %d: %.3fx of mmult\n", MMULT_MAX_SIZE,
+         (double)w32.mults / c32.mults);
+  printf("Multipliers at one k per cycle: mmult %ld for %d x %d, "
+         "mmult_winograd %ld for %d x %d (%.3fx the tile area)\n",
+         c32.multipliers, MMULT_MAX_SIZE, MMULT_MAX_SIZE, w44.multipliers,
+         WINOGRAD_MAX_SIZE, WINOGRAD_MAX_SIZE,
+         (double)(WINOGRAD_MAX_SIZE * WINOGRAD_MAX_SIZE) /
+             (MMULT_MAX_SIZE * MMULT_MAX_SIZE));
+  printf("TEST %s\n", match ? "PASSED" : "FAILED");
+  return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}